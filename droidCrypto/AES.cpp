@@ -1,6 +1,13 @@
 #include <assert.h>
 #include <droidCrypto/AES.h>
 
+#include <algorithm>
+
+#if !defined(HAVE_NEON)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 namespace droidCrypto {
 const uint8_t fixed_key[16] = {36,  156, 50,  234, 92, 230, 49, 9,
                                174, 170, 205, 160, 98, 236, 29, 243};
@@ -630,8 +637,130 @@ void AES::encryptCTR(uint64_t baseIdx, uint64_t blockLength,
     ciphertext[idx] = veorq_u8(ciphertext[idx], mRoundKeysEnc[10]);
   }
 }
+
+bool AES::vaesSupported() { return false; }
+
+void AES::setVAES(bool) {}
 #else
 
+// AVX-512 VAES kernels. They are compiled through target attributes so the
+// rest of the library keeps its SSE/AES-NI baseline, and only called after
+// vaesEnabled() checked the CPU. Each iteration keeps 8 zmm registers of 4
+// blocks in flight, four times the 8 blocks of the AES-NI loops.
+#define VAES_TARGET __attribute__((target("avx512f,vaes")))
+
+namespace {
+bool cpuHasVAES() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE))
+    return false;
+  if (__get_cpuid_max(0, nullptr) < 7) return false;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if (!(ebx & bit_AVX512F) || !(ecx & bit_VAES)) return false;
+  // the OS has to save the opmask and all zmm registers on context switches
+  uint32_t xcr0, xcr0hi;
+  __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+  return (xcr0 & 0xe6) == 0xe6;
+}
+
+bool &vaesEnabled() {
+  static bool enabled = cpuHasVAES();
+  return enabled;
+}
+
+const uint64_t vaesStep = 32;
+
+// b in all four lanes. _mm512_broadcast_i32x4 and _mm512_slli_epi64 pass
+// _mm512_undefined_epi32() as the unused source, which GCC reports as
+// uninitialized, so the kernels build the values from defined ones only.
+VAES_TARGET inline __m512i vaesBroadcast(const block &b) {
+  const long long lo = _mm_cvtsi128_si64(b);
+  const long long hi = _mm_extract_epi64(b, 1);
+  return _mm512_set_epi64(hi, lo, hi, lo, hi, lo, hi, lo);
+}
+
+VAES_TARGET inline void vaesLoadKeys(const block *roundKeys, __m512i *k) {
+  for (int r = 0; r < 11; r++) k[r] = vaesBroadcast(roundKeys[r]);
+}
+
+VAES_TARGET inline void vaesEnc8(__m512i *x, const __m512i *k) {
+  for (int j = 0; j < 8; j++) x[j] = _mm512_xor_si512(x[j], k[0]);
+  for (int r = 1; r < 10; r++)
+    for (int j = 0; j < 8; j++) x[j] = _mm512_aesenc_epi128(x[j], k[r]);
+  for (int j = 0; j < 8; j++) x[j] = _mm512_aesenclast_epi128(x[j], k[10]);
+}
+
+// blockLength has to be a multiple of vaesStep in all kernels
+VAES_TARGET void vaesECB(const block *roundKeys, const block *in,
+                         uint64_t blockLength, block *out) {
+  __m512i k[11], x[8];
+  vaesLoadKeys(roundKeys, k);
+  for (uint64_t idx = 0; idx < blockLength; idx += vaesStep) {
+    for (int j = 0; j < 8; j++) x[j] = _mm512_loadu_si512(in + idx + 4 * j);
+    vaesEnc8(x, k);
+    for (int j = 0; j < 8; j++) _mm512_storeu_si512(out + idx + 4 * j, x[j]);
+  }
+}
+
+VAES_TARGET void vaesCTR(const block *roundKeys, uint64_t baseIdx,
+                         uint64_t blockLength, block *out) {
+  __m512i k[11], x[8];
+  vaesLoadKeys(roundKeys, k);
+  // counter blocks have baseIdx + i in both halves, like the AES-NI path
+  __m512i ctr = _mm512_set_epi64(baseIdx + 3, baseIdx + 3, baseIdx + 2,
+                                 baseIdx + 2, baseIdx + 1, baseIdx + 1,
+                                 baseIdx, baseIdx);
+  const __m512i four = _mm512_set1_epi64(4);
+  for (uint64_t idx = 0; idx < blockLength; idx += vaesStep) {
+    for (int j = 0; j < 8; j++) {
+      x[j] = ctr;
+      ctr = _mm512_add_epi64(ctr, four);
+    }
+    vaesEnc8(x, k);
+    for (int j = 0; j < 8; j++) _mm512_storeu_si512(out + idx + 4 * j, x[j]);
+  }
+}
+
+VAES_TARGET void vaesHash(const block *roundKeys, const block *in,
+                          uint64_t blockLength, const block &tweak,
+                          const block &offset, block *out) {
+  __m512i k[11], x[8], kid[8];
+  vaesLoadKeys(roundKeys, k);
+  const __m512i t = vaesBroadcast(tweak);
+  const __m512i o = vaesBroadcast(offset);
+  for (uint64_t idx = 0; idx < blockLength; idx += vaesStep) {
+    for (int j = 0; j < 8; j++) {
+      kid[j] = _mm512_xor_si512(_mm512_loadu_si512(in + idx + 4 * j), o);
+      // shiftBlock, each 64-bit half shifted left by one
+      kid[j] = _mm512_xor_si512(_mm512_add_epi64(kid[j], kid[j]), t);
+      x[j] = kid[j];
+    }
+    vaesEnc8(x, k);
+    for (int j = 0; j < 8; j++)
+      _mm512_storeu_si512(out + idx + 4 * j, _mm512_xor_si512(x[j], kid[j]));
+  }
+}
+
+VAES_TARGET void vaesHashKeys(const block *roundKeys, const block *keys,
+                              uint64_t blockLength, block *out) {
+  __m512i k[11], x[8], kid[8];
+  vaesLoadKeys(roundKeys, k);
+  for (uint64_t idx = 0; idx < blockLength; idx += vaesStep) {
+    for (int j = 0; j < 8; j++) {
+      kid[j] = _mm512_loadu_si512(keys + idx + 4 * j);
+      x[j] = kid[j];
+    }
+    vaesEnc8(x, k);
+    for (int j = 0; j < 8; j++)
+      _mm512_storeu_si512(out + idx + 4 * j, _mm512_xor_si512(x[j], kid[j]));
+  }
+}
+}  // namespace
+
+bool AES::vaesSupported() { return cpuHasVAES(); }
+
+void AES::setVAES(bool enable) { vaesEnabled() = enable && cpuHasVAES(); }
+
 void AES::encryptECB(const block &plaintext, block &ciphertext) const {
   ciphertext = _mm_xor_si128(plaintext, mRoundKeysEnc[0]);
   ciphertext = _mm_aesenc_si128(ciphertext, mRoundKeysEnc[1]);
@@ -649,6 +778,14 @@ void AES::encryptECB(const block &plaintext, block &ciphertext) const {
 // void decryptECB(const block& ciphertext, block& plaintext) const;
 void AES::encryptECBBlocks(const block *plaintexts, uint64_t blockLength,
                            block *ciphertexts) const {
+  if (vaesEnabled() && blockLength >= vaesStep) {
+    uint64_t done = blockLength - blockLength % vaesStep;
+    vaesECB(mRoundKeysEnc, plaintexts, done, ciphertexts);
+    plaintexts += done;
+    ciphertexts += done;
+    blockLength -= done;
+  }
+
   const uint64_t step = 8;
   uint64_t idx = 0;
   uint64_t length = blockLength - blockLength % step;
@@ -775,6 +912,14 @@ void AES::encryptECBBlocks(const block *plaintexts, uint64_t blockLength,
 
 void AES::encryptCTR(uint64_t baseIdx, uint64_t blockLength,
                      block *ciphertext) const {
+  if (vaesEnabled() && blockLength >= vaesStep) {
+    uint64_t done = blockLength - blockLength % vaesStep;
+    vaesCTR(mRoundKeysEnc, baseIdx, done, ciphertext);
+    baseIdx += done;
+    ciphertext += done;
+    blockLength -= done;
+  }
+
   const uint64_t step = 8;
   uint64_t idx = 0;
   uint64_t length = blockLength - blockLength % step;
@@ -899,6 +1044,50 @@ void AES::encryptCTR(uint64_t baseIdx, uint64_t blockLength,
 }
 #endif
 
+void AES::hashBlocks(const block *in, uint64_t blockLength, const block &tweak,
+                     const block &offset, block *out) const {
+#if !defined(HAVE_NEON)
+  if (vaesEnabled() && blockLength >= vaesStep) {
+    uint64_t done = blockLength - blockLength % vaesStep;
+    vaesHash(mRoundKeysEnc, in, done, tweak, offset, out);
+    in += done;
+    out += done;
+    blockLength -= done;
+  }
+#endif
+  const uint64_t step = 8;
+  block kid[step];
+  for (uint64_t idx = 0; idx < blockLength; idx += step) {
+    uint64_t len = std::min(step, blockLength - idx);
+    for (uint64_t j = 0; j < len; j++)
+      kid[j] = shiftBlock(in[idx + j] ^ offset) ^ tweak;
+    encryptECBBlocks(kid, len, out + idx);
+    for (uint64_t j = 0; j < len; j++) out[idx + j] = out[idx + j] ^ kid[j];
+  }
+}
+
+void AES::hashBlocks(const block *keys, uint64_t blockLength,
+                     block *out) const {
+#if !defined(HAVE_NEON)
+  if (vaesEnabled() && blockLength >= vaesStep) {
+    uint64_t done = blockLength - blockLength % vaesStep;
+    vaesHashKeys(mRoundKeysEnc, keys, done, out);
+    keys += done;
+    out += done;
+    blockLength -= done;
+  }
+#endif
+  const uint64_t step = 8;
+  block kid[step];
+  for (uint64_t idx = 0; idx < blockLength; idx += step) {
+    uint64_t len = std::min(step, blockLength - idx);
+    // out may alias keys
+    for (uint64_t j = 0; j < len; j++) kid[j] = keys[idx + j];
+    encryptECBBlocks(kid, len, out + idx);
+    for (uint64_t j = 0; j < len; j++) out[idx + j] = out[idx + j] ^ kid[j];
+  }
+}
+
 }  // namespace droidCrypto
 
 JNIEXPORT void JNICALL
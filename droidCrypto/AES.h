@@ -45,6 +45,22 @@ class AES {
 
   void encryptCTR(uint64_t baseIdx, uint64_t blockLength,
                   block *ciphertext) const;
+
+  // out[i] = E(k) ^ k with k = shiftBlock(in[i] ^ offset) ^ tweak, the fixed
+  // key hash of the garbling schemes with the tweak, shift and XORs done in
+  // the same pass as the encryption
+  void hashBlocks(const block *in, uint64_t blockLength, const block &tweak,
+                  const block &offset, block *out) const;
+  // out[i] = E(k[i]) ^ k[i] for keys k already tweaked, so labels with
+  // different tweaks and offsets share one pass
+  void hashBlocks(const block *keys, uint64_t blockLength, block *out) const;
+
+  // encryptECBBlocks, encryptCTR and hashBlocks use AVX-512 VAES kernels if
+  // the CPU and OS support them. setVAES(false) forces the AES-NI path, it is
+  // meant for benchmarks and not synchronized with running encryptions.
+  static bool vaesSupported();
+  static void setVAES(bool enable);
+
   block key;
 
  private:
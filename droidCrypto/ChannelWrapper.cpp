@@ -3,17 +3,33 @@
 //#include <android/log.h>
 #include <arpa/inet.h>
 #include <assert.h>
+#include <endian.h>
 #include <netinet/in.h>
 #include <sys/param.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <limits.h>
 #include <unistd.h>
 #include <cstring>
+#include <cerrno>
 #include "ChannelWrapper.h"
 
 #define APPNAME "droidCrypto"
 
 namespace droidCrypto {
 
+static std::future<void> readyFuture() {
+  std::promise<void> done;
+  done.set_value();
+  return done.get_future();
+}
+
+void ChannelWrapper::sendBuffer(BufferChannel &buf, size_t length) {
+  for (const span<const uint8_t> &view : buf.peek(length))
+    send((uint8_t *)view.data(), view.size());
+  buf.consume(length);
+}
+
 JavaChannelWrapper::JavaChannelWrapper(JNIEnv *env, jobject channel)
     : ChannelWrapper() {
   mEnv = env;
@@ -40,13 +56,14 @@ JavaChannelWrapper::JavaChannelWrapper(JNIEnv *env, jobject channel)
   assert(mRecvID != nullptr);
 }
 
-void JavaChannelWrapper::sendAsync(std::vector<block> &data) {
+std::future<void> JavaChannelWrapper::sendAsync(std::vector<block> &data) {
   size_t bytes = data.size() * sizeof(block);
   void *buf = (void *)data.data();
   jbyteArray dataBuffer = mEnv->NewByteArray(bytes);
   mEnv->SetByteArrayRegion(dataBuffer, 0, bytes, (jbyte *)buf);
   //        mEnv->CallObjectMethod(mChannel, mSendAsyncID, dataBuffer);
   mEnv->CallVoidMethod(mChannel, mSendAsyncVoidID, dataBuffer);
+  return readyFuture();
 }
 
 void JavaChannelWrapper::send(uint8_t *data, size_t length) {
@@ -67,9 +84,11 @@ void JavaChannelWrapper::send(const std::vector<block> &data) {
   mEnv->CallVoidMethod(mChannel, mSendID, dataBuffer);
 }
 
-void JavaChannelWrapper::recvAsync(uint8_t *data, size_t length) {
-  // TODO: not implemented yet
-  assert(false);
+std::future<void> JavaChannelWrapper::recvAsync(uint8_t *data,
+                                                size_t length) {
+  // JNIEnv is bound to the calling thread, so receive right away
+  recv(data, length);
+  return readyFuture();
 }
 
 void JavaChannelWrapper::recv(uint8_t *data, size_t length) {
@@ -89,9 +108,31 @@ void JavaChannelWrapper::recv(std::vector<block> &data) {
   mEnv->CallVoidMethod(mChannel, mRecvID, dataBuffer);
 }
 
+constexpr size_t socketBufferSize = 64 * 1024;
+// sendAsync blocks while more than this is waiting to be written
+constexpr size_t asyncQueueBytes = 16 * 1024 * 1024;
+
+
+CSocketChannel::CSocketChannel(int socket, bool buffered /*= true */)
+    : csocket(socket),
+      serversocket(-1),
+      buffered(buffered),
+      sendLen(0),
+      recvPos(0),
+      recvLen(0),
+      sendQueueBytes(0),
+      sendBusy(false),
+      recvBusy(false),
+      stopIO(false) {
+  if (buffered) {
+    sendBuf.resize(socketBufferSize);
+    recvBuf.resize(socketBufferSize);
+  }
+}
+
 CSocketChannel::CSocketChannel(const char *hostname, uint16_t port,
-                               bool isServer)
-    : csocket(-1), serversocket(-1) {
+                               bool isServer, bool buffered /*= true */)
+    : CSocketChannel(-1, buffered) {
   struct sockaddr_in sockaddr;
   memset(&sockaddr, 0, sizeof(sockaddr));
   sockaddr.sin_family = AF_INET;
@@ -128,37 +169,269 @@ CSocketChannel::CSocketChannel(const char *hostname, uint16_t port,
 }
 
 CSocketChannel::~CSocketChannel() {
+  {
+    std::lock_guard<std::mutex> lock(queueMtx);
+    stopIO = true;
+    // a posted receive nobody is going to answer would block forever
+    if (csocket >= 0 && (recvBusy || !recvQueue.empty()))
+      ::shutdown(csocket, SHUT_RD);
+  }
+  queueCv.notify_all();
+  if (sendThread.joinable()) sendThread.join();
+  if (recvThread.joinable()) recvThread.join();
+  try {
+    if (csocket >= 0) flush();
+  } catch (const std::runtime_error &) {
+    // peer is gone, nothing left to deliver to
+  }
   if (serversocket >= 0) close(serversocket);
   if (csocket >= 0) close(csocket);
 }
 
-void CSocketChannel::send_all(uint8_t *data, size_t length) {
-  size_t totalsent = 0;
-  while (totalsent < length) {
-    ssize_t sent = ::send(csocket, data + totalsent,
-                          MIN(length - totalsent, 1024 * 1024ULL), 0);
+CSocketListener::CSocketListener(uint16_t port, int backlog /*= 128 */) {
+  struct sockaddr_in sockaddr;
+  memset(&sockaddr, 0, sizeof(sockaddr));
+  sockaddr.sin_family = AF_INET;
+  sockaddr.sin_addr.s_addr = INADDR_ANY;
+  sockaddr.sin_port = htons(port);
+
+  serversocket = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(serversocket, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse,
+             sizeof(reuse));
+  if (bind(serversocket, (struct sockaddr *)&sockaddr,
+           sizeof(struct sockaddr_in)) < 0 ||
+      listen(serversocket, backlog) < 0) {
+    ::close(serversocket);
+    throw std::runtime_error("socket listen error");
+  }
+}
+
+CSocketListener::~CSocketListener() { ::close(serversocket); }
+
+std::unique_ptr<CSocketChannel> CSocketListener::accept(
+    bool buffered /*= true */) {
+  struct sockaddr_in other;
+  socklen_t otherlen = sizeof(struct sockaddr_in);
+  int csocket;
+  do {
+    csocket = ::accept(serversocket, (struct sockaddr *)&other, &otherlen);
+  } while (csocket < 0 && errno == EINTR);
+  if (csocket < 0) return nullptr;
+  return std::unique_ptr<CSocketChannel>(new CSocketChannel(csocket, buffered));
+}
+
+void CSocketListener::close() { ::shutdown(serversocket, SHUT_RDWR); }
+
+void CSocketChannel::write_all(std::vector<struct iovec> &iov) {
+  size_t idx = 0;
+  while (idx < iov.size()) {
+    ssize_t sent = ::writev(csocket, &iov[idx], MIN(iov.size() - idx, IOV_MAX));
     if (sent < 0) throw std::runtime_error("socket sent error");
-    totalsent += sent;
+    while (idx < iov.size() && (size_t)sent >= iov[idx].iov_len) {
+      sent -= iov[idx].iov_len;
+      idx++;
+    }
+    if (idx < iov.size()) {
+      iov[idx].iov_base = (uint8_t *)iov[idx].iov_base + sent;
+      iov[idx].iov_len -= sent;
+    }
   }
-  bytes_sent += length;
 }
 
-void CSocketChannel::recv_all(uint8_t *data, size_t length) {
+void CSocketChannel::read_all(uint8_t *data, size_t length) {
   size_t bytes_recvd = 0;
   while (bytes_recvd < length) {
     ssize_t recvd = ::recv(csocket, data + bytes_recvd,
                            MIN(length - bytes_recvd, 1024 * 1024ULL), 0);
     if (recvd < 0) throw std::runtime_error("socket recv error");
+    if (recvd == 0) throw std::runtime_error("socket closed by peer");
     bytes_recvd += recvd;
   }
+}
+
+void CSocketChannel::send_all(uint8_t *data, size_t length) {
+  waitSendQueue();
+  std::lock_guard<std::mutex> lock(sendMtx);
+  bytes_sent += length;
+  if (buffered && sendLen + length <= sendBuf.size()) {
+    memcpy(sendBuf.data() + sendLen, data, length);
+    sendLen += length;
+    if (sendLen == sendBuf.size()) flushLocked();
+    return;
+  }
+  // does not fit, write out what is buffered together with the new data
+  std::vector<struct iovec> iov;
+  if (sendLen > 0) iov.push_back({sendBuf.data(), sendLen});
+  iov.push_back({data, length});
+  write_all(iov);
+  sendLen = 0;
+}
+
+void CSocketChannel::recv_all(uint8_t *data, size_t length) {
+  flush();
+  waitRecvQueue();
+  std::lock_guard<std::mutex> lock(recvMtx);
+  recvLocked(data, length);
+}
+
+void CSocketChannel::recvLocked(uint8_t *data, size_t length) {
   bytes_recv += length;
+  size_t avail = recvLen - recvPos;
+  size_t len = MIN(avail, length);
+  if (len > 0) {
+    memcpy(data, recvBuf.data() + recvPos, len);
+    recvPos += len;
+    data += len;
+    length -= len;
+  }
+  if (!buffered || length >= recvBuf.size()) {
+    read_all(data, length);
+    return;
+  }
+  while (length > 0) {
+    ssize_t recvd = ::recv(csocket, recvBuf.data(), recvBuf.size(), 0);
+    if (recvd < 0) throw std::runtime_error("socket recv error");
+    if (recvd == 0) throw std::runtime_error("socket closed by peer");
+    recvLen = recvd;
+    len = MIN(recvLen, length);
+    memcpy(data, recvBuf.data(), len);
+    recvPos = len;
+    data += len;
+    length -= len;
+  }
+}
+
+void CSocketChannel::flushLocked() {
+  if (sendLen == 0) return;
+  std::vector<struct iovec> iov = {{sendBuf.data(), sendLen}};
+  write_all(iov);
+  sendLen = 0;
 }
 
-void CSocketChannel::sendAsync(std::vector<block> &data) {
-  assert(false);
-  //        size_t bytes = data.size() * sizeof(block);
-  //        uint8_t* buf = (uint8_t*) data.data();
-  //        send_all(buf, bytes);
+void CSocketChannel::flush() {
+  waitSendQueue();
+  std::lock_guard<std::mutex> lock(sendMtx);
+  flushLocked();
+}
+
+void CSocketChannel::sendBuffer(BufferChannel &buf, size_t length) {
+  waitSendQueue();
+  std::lock_guard<std::mutex> lock(sendMtx);
+  std::vector<span<const uint8_t>> views = buf.peek(length);
+  std::vector<struct iovec> iov;
+  iov.reserve(views.size() + 1);
+  if (sendLen > 0) iov.push_back({sendBuf.data(), sendLen});
+  for (const span<const uint8_t> &view : views)
+    iov.push_back({(void *)view.data(), (size_t)view.size()});
+  write_all(iov);
+  sendLen = 0;
+  bytes_sent += length;
+  buf.consume(length);
+}
+
+void CSocketChannel::startIO() {
+  // only called from the thread owning the channel
+  if (sendThread.joinable()) return;
+  sendThread = std::thread(&CSocketChannel::sendLoop, this);
+  recvThread = std::thread(&CSocketChannel::recvLoop, this);
+}
+
+void CSocketChannel::waitSendQueue() {
+  std::unique_lock<std::mutex> lock(queueMtx);
+  queueCv.wait(lock, [this] { return sendQueue.empty() && !sendBusy; });
+  if (sendError) std::rethrow_exception(sendError);
+}
+
+void CSocketChannel::waitRecvQueue() {
+  std::unique_lock<std::mutex> lock(queueMtx);
+  queueCv.wait(lock, [this] { return recvQueue.empty() && !recvBusy; });
+}
+
+void CSocketChannel::sendLoop() {
+  while (true) {
+    SendJob job;
+    {
+      std::unique_lock<std::mutex> lock(queueMtx);
+      queueCv.wait(lock, [this] { return stopIO || !sendQueue.empty(); });
+      if (sendQueue.empty()) return;
+      job = std::move(sendQueue.front());
+      sendQueue.pop_front();
+      sendBusy = true;
+    }
+    size_t bytes = job.data.size() * sizeof(block);
+    try {
+      std::lock_guard<std::mutex> lock(sendMtx);
+      // whatever is buffered was sent before this job was queued
+      std::vector<struct iovec> iov;
+      if (sendLen > 0) iov.push_back({sendBuf.data(), sendLen});
+      iov.push_back({job.data.data(), bytes});
+      write_all(iov);
+      sendLen = 0;
+      bytes_sent += bytes;
+      job.done.set_value();
+    } catch (const std::runtime_error &) {
+      std::lock_guard<std::mutex> lock(queueMtx);
+      sendError = std::current_exception();
+      job.done.set_exception(sendError);
+    }
+    {
+      std::lock_guard<std::mutex> lock(queueMtx);
+      sendQueueBytes -= bytes;
+      sendBusy = false;
+    }
+    queueCv.notify_all();
+  }
+}
+
+void CSocketChannel::recvLoop() {
+  while (true) {
+    RecvJob job;
+    {
+      std::unique_lock<std::mutex> lock(queueMtx);
+      queueCv.wait(lock, [this] { return stopIO || !recvQueue.empty(); });
+      if (recvQueue.empty()) return;
+      job = std::move(recvQueue.front());
+      recvQueue.pop_front();
+      recvBusy = true;
+    }
+    try {
+      {
+        // the peer might wait for buffered data before answering
+        std::lock_guard<std::mutex> lock(sendMtx);
+        flushLocked();
+      }
+      std::lock_guard<std::mutex> lock(recvMtx);
+      recvLocked(job.data, job.length);
+      job.done.set_value();
+    } catch (const std::runtime_error &) {
+      job.done.set_exception(std::current_exception());
+    }
+    {
+      std::lock_guard<std::mutex> lock(queueMtx);
+      recvBusy = false;
+    }
+    queueCv.notify_all();
+  }
+}
+
+std::future<void> CSocketChannel::sendAsync(std::vector<block> &data) {
+  startIO();
+  SendJob job;
+  job.data = data;
+  std::future<void> done = job.done.get_future();
+  size_t bytes = data.size() * sizeof(block);
+  {
+    std::unique_lock<std::mutex> lock(queueMtx);
+    queueCv.wait(lock, [this, bytes] {
+      return sendQueue.empty() || sendQueueBytes + bytes <= asyncQueueBytes;
+    });
+    if (sendError) std::rethrow_exception(sendError);
+    sendQueue.push_back(std::move(job));
+    sendQueueBytes += bytes;
+  }
+  queueCv.notify_all();
+  return done;
 }
 
 void CSocketChannel::send(const std::vector<block> &data) {
@@ -177,7 +450,19 @@ void CSocketChannel::send(uint8_t *data, size_t length) {
   send_all(data, length);
 }
 
-void CSocketChannel::recvAsync(uint8_t *data, size_t length) { assert(false); }
+std::future<void> CSocketChannel::recvAsync(uint8_t *data, size_t length) {
+  startIO();
+  RecvJob job;
+  job.data = data;
+  job.length = length;
+  std::future<void> done = job.done.get_future();
+  {
+    std::lock_guard<std::mutex> lock(queueMtx);
+    recvQueue.push_back(std::move(job));
+  }
+  queueCv.notify_all();
+  return done;
+}
 
 void CSocketChannel::recv(uint8_t *data, size_t length) {
   recv_all(data, length);
@@ -196,50 +481,288 @@ void CSocketChannel::recv(std::vector<block> &data) {
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void BufferChannel::sendAsync(std::vector<block> &data) { assert(false); }
+constexpr size_t segmentBlocks = 16384;
+constexpr size_t segmentBytes = segmentBlocks * sizeof(block);
+
+std::future<void> BufferChannel::sendAsync(std::vector<block> &data) {
+  send(data);
+  return readyFuture();
+}
+
+uint8_t *BufferChannel::writeSpace(size_t &avail) {
+  if (segments.empty() || writePos == segmentBytes) {
+    if (spare)
+      segments.push_back(std::move(spare));
+    else
+      segments.emplace_back(new block[segmentBlocks]);
+    writePos = 0;
+  }
+  avail = segmentBytes - writePos;
+  return (uint8_t *)segments.back().get() + writePos;
+}
+
+void BufferChannel::append(const uint8_t *data, size_t length) {
+  while (length > 0) {
+    size_t avail;
+    uint8_t *dst = writeSpace(avail);
+    size_t len = MIN(avail, length);
+    memcpy(dst, data, len);
+    writePos += len;
+    bufSize += len;
+    data += len;
+    length -= len;
+  }
+}
 
 void BufferChannel::send(const std::vector<block> &data) {
-  auto len = data.size() * sizeof(block);
-  buffer.insert(buffer.end(), (const uint8_t *)data.data(),
-                ((const uint8_t *)data.data()) + len);
+  append((const uint8_t *)data.data(), data.size() * sizeof(block));
 }
 
 void BufferChannel::send(const block &data) {
-  buffer.insert(buffer.end(), (const uint8_t *)&data,
-                ((const uint8_t *)&data) + sizeof(block));
+  append((const uint8_t *)&data, sizeof(block));
 }
 
-void BufferChannel::send(uint8_t *data, size_t length) {
-  buffer.insert(buffer.end(), data, data + length);
-}
+void BufferChannel::send(uint8_t *data, size_t length) { append(data, length); }
 
-void BufferChannel::recvAsync(uint8_t *data, size_t length) { assert(false); }
+std::future<void> BufferChannel::recvAsync(uint8_t *data, size_t length) {
+  recv(data, length);
+  return readyFuture();
+}
 
 void BufferChannel::recv(uint8_t *data, size_t length) {
-  assert(buffer.size() >= length);
-  std::copy_n(buffer.begin(), length, data);
-  buffer.erase(buffer.begin(), buffer.begin() + length);
+  assert(bufSize >= length);
+  while (length > 0) {
+    size_t len = MIN(segmentBytes - readPos, length);
+    memcpy(data, (uint8_t *)segments.front().get() + readPos, len);
+    consume(len);
+    data += len;
+    length -= len;
+  }
 }
 
-void BufferChannel::recv(block &data) {
-  assert(buffer.size() >= sizeof(block));
-  std::copy_n(buffer.begin(), sizeof(block), (uint8_t *)&data);
-  buffer.erase(buffer.begin(), buffer.begin() + sizeof(block));
-}
+void BufferChannel::recv(block &data) { recv((uint8_t *)&data, sizeof(block)); }
 
 void BufferChannel::recv(std::vector<block> &data) {
-  auto len = data.size() * sizeof(block);
-  assert(buffer.size() >= len);
-  std::copy_n(buffer.begin(), len, (uint8_t *)data.data());
-  buffer.erase(buffer.begin(), buffer.begin() + len);
+  recv((uint8_t *)data.data(), data.size() * sizeof(block));
+}
+
+std::vector<span<const uint8_t>> BufferChannel::peek(size_t length) const {
+  assert(bufSize >= length);
+  std::vector<span<const uint8_t>> views;
+  size_t pos = readPos;
+  for (auto it = segments.begin(); length > 0; ++it) {
+    size_t len = MIN(segmentBytes - pos, length);
+    views.emplace_back((const uint8_t *)it->get() + pos, len);
+    length -= len;
+    pos = 0;
+  }
+  return views;
+}
+
+void BufferChannel::read(size_t offset, uint8_t *data, size_t length) const {
+  assert(bufSize >= offset + length);
+  size_t pos = readPos + offset;
+  auto it = segments.begin() + pos / segmentBytes;
+  pos %= segmentBytes;
+  for (; length > 0; ++it) {
+    size_t len = MIN(segmentBytes - pos, length);
+    memcpy(data, (const uint8_t *)it->get() + pos, len);
+    data += len;
+    length -= len;
+    pos = 0;
+  }
+}
+
+void BufferChannel::consume(size_t length) {
+  assert(bufSize >= length);
+  bufSize -= length;
+  while (length > 0) {
+    size_t len = MIN(segmentBytes - readPos, length);
+    readPos += len;
+    length -= len;
+    if (readPos == segmentBytes) {
+      spare = std::move(segments.front());
+      segments.pop_front();
+      readPos = 0;
+    }
+  }
+  if (bufSize == 0 && !segments.empty()) {
+    // everything was read, start over at the beginning of the last segment
+    readPos = 0;
+    writePos = 0;
+  }
+}
+
+void BufferChannel::recvFrom(ChannelWrapper &chan, size_t length) {
+  while (length > 0) {
+    size_t avail;
+    uint8_t *dst = writeSpace(avail);
+    size_t len = MIN(avail, length);
+    chan.recv(dst, len);
+    writePos += len;
+    bufSize += len;
+    length -= len;
+  }
 }
 
 std::vector<uint8_t> BufferChannel::getBuffer() {
-  return std::vector<uint8_t>(buffer.begin(), buffer.end());
+  std::vector<uint8_t> buf;
+  buf.reserve(bufSize);
+  for (const span<const uint8_t> &view : peek(bufSize))
+    buf.insert(buf.end(), view.begin(), view.end());
+  return buf;
 }
 
 void BufferChannel::setBuffer(const std::vector<uint8_t> &buf) {
-  buffer.assign(buf.begin(), buf.end());
+  consume(bufSize);
+  append(buf.data(), buf.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// frames are this header, big-endian, followed by length bytes of the stream
+struct FrameHeader {
+  uint32_t stream;
+  uint32_t reserved;
+  uint64_t length;
+};
+
+ChannelMux::ChannelMux(ChannelWrapper &chan, size_t numStreams) : chan(chan) {
+  streams.reserve(numStreams);
+  for (size_t i = 0; i < numStreams; i++)
+    streams.emplace_back(new MuxChannel(*this, i));
+}
+
+void ChannelMux::sendFrame(uint32_t id, const uint8_t *data, size_t length) {
+  FrameHeader header = {htobe32(id), 0, htobe64(length)};
+  std::lock_guard<std::mutex> lock(sendMtx);
+  chan.send((uint8_t *)&header, sizeof(header));
+  chan.send((uint8_t *)data, length);
+  // the other end may only read once this arrived
+  chan.flush();
+}
+
+void ChannelMux::recvFrame(std::unique_lock<std::mutex> &lock) {
+  reading = true;
+  lock.unlock();
+  FrameHeader header;
+  std::exception_ptr error;
+  try {
+    chan.recv((uint8_t *)&header, sizeof(header));
+    header.stream = be32toh(header.stream);
+    header.length = be64toh(header.length);
+    frame.resize(header.length);
+    chan.recv(frame.data(), frame.size());
+  } catch (...) {
+    error = std::current_exception();
+  }
+  lock.lock();
+  reading = false;
+  if (!error && header.stream >= streams.size())
+    error = std::make_exception_ptr(
+        std::runtime_error("frame for unknown mux stream"));
+  if (error)
+    recvError = error;
+  else
+    streams[header.stream]->inbox.send(frame.data(), frame.size());
+  recvCv.notify_all();
+}
+
+MuxChannel::~MuxChannel() {
+  {
+    std::lock_guard<std::mutex> lock(queueMtx);
+    stopIO = true;
+  }
+  queueCv.notify_all();
+  // queued receives are finished first
+  if (recvThread.joinable()) recvThread.join();
+}
+
+std::future<void> MuxChannel::sendAsync(std::vector<block> &data) {
+  send(data);
+  return readyFuture();
+}
+
+void MuxChannel::send(const std::vector<block> &data) {
+  send((uint8_t *)data.data(), data.size() * sizeof(block));
+}
+
+void MuxChannel::send(const block &data) {
+  send((uint8_t *)&data, sizeof(block));
+}
+
+void MuxChannel::send(uint8_t *data, size_t length) {
+  mux.sendFrame(id, data, length);
+  bytes_sent += length;
+}
+
+std::future<void> MuxChannel::recvAsync(uint8_t *data, size_t length) {
+  // only called from the thread owning the stream
+  if (!recvThread.joinable())
+    recvThread = std::thread(&MuxChannel::recvLoop, this);
+  RecvJob job;
+  job.data = data;
+  job.length = length;
+  std::future<void> done = job.done.get_future();
+  {
+    std::lock_guard<std::mutex> lock(queueMtx);
+    recvQueue.push_back(std::move(job));
+  }
+  queueCv.notify_all();
+  return done;
 }
 
-}
\ No newline at end of file
+void MuxChannel::recv(uint8_t *data, size_t length) {
+  waitRecvQueue();
+  recvNow(data, length);
+}
+
+void MuxChannel::recv(block &data) { recv((uint8_t *)&data, sizeof(block)); }
+
+void MuxChannel::recv(std::vector<block> &data) {
+  recv((uint8_t *)data.data(), data.size() * sizeof(block));
+}
+
+void MuxChannel::waitRecvQueue() {
+  std::unique_lock<std::mutex> lock(queueMtx);
+  queueCv.wait(lock, [this] { return recvQueue.empty() && !recvBusy; });
+}
+
+void MuxChannel::recvLoop() {
+  while (true) {
+    RecvJob job;
+    {
+      std::unique_lock<std::mutex> lock(queueMtx);
+      queueCv.wait(lock, [this] { return stopIO || !recvQueue.empty(); });
+      if (recvQueue.empty()) return;
+      job = std::move(recvQueue.front());
+      recvQueue.pop_front();
+      recvBusy = true;
+    }
+    try {
+      recvNow(job.data, job.length);
+      job.done.set_value();
+    } catch (...) {
+      job.done.set_exception(std::current_exception());
+    }
+    {
+      std::lock_guard<std::mutex> lock(queueMtx);
+      recvBusy = false;
+    }
+    queueCv.notify_all();
+  }
+}
+
+void MuxChannel::recvNow(uint8_t *data, size_t length) {
+  std::unique_lock<std::mutex> lock(mux.recvMtx);
+  while (inbox.size() < length) {
+    if (mux.recvError) std::rethrow_exception(mux.recvError);
+    if (mux.reading)
+      mux.recvCv.wait(lock);
+    else
+      mux.recvFrame(lock);
+  }
+  inbox.recv(data, length);
+  bytes_recv += length;
+}
+
+}
@@ -5,27 +5,45 @@
 #include <jni.h>
 #include <vector>
 #include <deque>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <sys/uio.h>
 
 
 namespace droidCrypto {
 
+    class BufferChannel;
+
     class ChannelWrapper {
     public:
 
         ChannelWrapper() { clearStats(); };
 
-        virtual void sendAsync(std::vector<block>& data) = 0;
+        // async operations keep their order relative to each other and to the
+        // blocking ones. sendAsync works on a copy of data, the buffer given to
+        // recvAsync has to stay valid until the returned future is ready.
+        virtual std::future<void> sendAsync(std::vector<block>& data) = 0;
 
         virtual void send(const std::vector<block>& data) = 0;
         virtual void send(const block& data) = 0;
         virtual void send(uint8_t* data, size_t length) = 0;
 
-        virtual void recvAsync(uint8_t* data, size_t length) = 0;
+        virtual std::future<void> recvAsync(uint8_t* data, size_t length) = 0;
 
         virtual void recv(uint8_t* data, size_t length) = 0;
         virtual void recv(block& data) = 0;
         virtual void recv(std::vector<block>& data) = 0;
 
+        // sends the first length bytes of buf and removes them from buf
+        virtual void sendBuffer(BufferChannel& buf, size_t length);
+
+        // pushes out data the channel may still hold back
+        virtual void flush() {}
+
         void clearStats() { bytes_sent = 0; bytes_recv = 0;}
         uint64_t getBytesSent() { return bytes_sent; }
         uint64_t getBytesRecv() { return bytes_recv; }
@@ -48,13 +66,13 @@ namespace droidCrypto {
     public:
         JavaChannelWrapper(JNIEnv* env, jobject channel);
 
-        void sendAsync(std::vector<block>& data) override;
+        std::future<void> sendAsync(std::vector<block>& data) override;
 
         void send(const std::vector<block>& data) override;
         void send(const block& data) override;
         void send(uint8_t* data, size_t length) override;
 
-        void recvAsync(uint8_t* data, size_t length) override;
+        std::future<void> recvAsync(uint8_t* data, size_t length) override;
 
         void recv(uint8_t* data, size_t length) override;
         void recv(block& data) override;
@@ -67,42 +85,118 @@ namespace droidCrypto {
         int csocket;
         int serversocket;
 
+        // with buffering, small sends are collected in sendBuf until it is
+        // full, flush() is called or we are about to receive; receives are
+        // served from recvBuf which is filled with as much as is available
+        bool buffered;
+        std::vector<uint8_t> sendBuf;
+        size_t sendLen;
+        std::vector<uint8_t> recvBuf;
+        size_t recvPos;
+        size_t recvLen;
+
+        // async operations are handled by one sending and one receiving
+        // thread, started on first use. sendMtx guards sendBuf and writes to
+        // the socket, recvMtx recvBuf and reads, queueMtx the job queues.
+        struct SendJob {
+            std::vector<block> data;
+            std::promise<void> done;
+        };
+        struct RecvJob {
+            uint8_t* data;
+            size_t length;
+            std::promise<void> done;
+        };
+        std::mutex sendMtx;
+        std::mutex recvMtx;
+        std::mutex queueMtx;
+        std::condition_variable queueCv;
+        std::deque<SendJob> sendQueue;
+        std::deque<RecvJob> recvQueue;
+        size_t sendQueueBytes;
+        bool sendBusy;
+        bool recvBusy;
+        bool stopIO;
+        std::exception_ptr sendError;
+        std::thread sendThread;
+        std::thread recvThread;
+
         void send_all(uint8_t* data, size_t length);
         void recv_all(uint8_t* data, size_t length);
+        void write_all(std::vector<struct iovec>& iov);
+        void read_all(uint8_t* data, size_t length);
+        void flushLocked();
+        void recvLocked(uint8_t* data, size_t length);
+        void startIO();
+        void waitSendQueue();
+        void waitRecvQueue();
+        void sendLoop();
+        void recvLoop();
 
     public:
-        CSocketChannel(const char* hostname, uint16_t port, bool isServer);
+        CSocketChannel(const char* hostname, uint16_t port, bool isServer,
+                       bool buffered = true);
+        // takes ownership of an already connected socket
+        explicit CSocketChannel(int socket, bool buffered = true);
         ~CSocketChannel();
 
-        void sendAsync(std::vector<block>& data) override;
+        std::future<void> sendAsync(std::vector<block>& data) override;
 
         void send(const std::vector<block>& data) override;
         void send(const block& data) override;
         void send(uint8_t* data, size_t length) override;
 
-        void recvAsync(uint8_t* data, size_t length) override;
+        std::future<void> recvAsync(uint8_t* data, size_t length) override;
 
         void recv(uint8_t* data, size_t length) override;
         void recv(block& data) override;
         void recv(std::vector<block>& data) override;
+
+        void sendBuffer(BufferChannel& buf, size_t length) override;
+
+        void flush() override;
+    };
+
+    // listening socket handing out one CSocketChannel per accepted client
+    class CSocketListener {
+
+    private:
+        int serversocket;
+
+    public:
+        CSocketListener(uint16_t port, int backlog = 128);
+        ~CSocketListener();
+
+        // blocks until a client connects, returns nullptr after close()
+        std::unique_ptr<CSocketChannel> accept(bool buffered = true);
+        void close();
     };
 
     class BufferChannel : public ChannelWrapper {
 
     private:
-        std::deque<uint8_t> buffer;
+        // data is kept in a list of fixed-size segments, bytes are read from
+        // the front segment at readPos and appended to the back one at writePos
+        std::deque<std::unique_ptr<block[]>> segments;
+        std::unique_ptr<block[]> spare;
+        size_t readPos = 0;
+        size_t writePos = 0;
+        size_t bufSize = 0;
+
+        uint8_t* writeSpace(size_t& avail);
+        void append(const uint8_t* data, size_t length);
 
     public:
         BufferChannel() = default;
         ~BufferChannel() = default;
 
-        void sendAsync(std::vector<block>& data) override;
+        std::future<void> sendAsync(std::vector<block>& data) override;
 
         void send(const std::vector<block>& data) override;
         void send(const block& data) override;
         void send(uint8_t* data, size_t length) override;
 
-        void recvAsync(uint8_t* data, size_t length) override;
+        std::future<void> recvAsync(uint8_t* data, size_t length) override;
 
         void recv(uint8_t* data, size_t length) override;
         void recv(block& data) override;
@@ -110,5 +204,98 @@ namespace droidCrypto {
 
         std::vector<uint8_t> getBuffer();
         void setBuffer(const std::vector<uint8_t>& buf);
+        size_t size() const { return bufSize; }
+
+        // views on the segments holding the first length bytes, without copying
+        std::vector<span<const uint8_t>> peek(size_t length) const;
+        // copies length bytes starting offset bytes after the read position,
+        // without consuming them. Safe from several threads as long as
+        // nothing is sent or received meanwhile.
+        void read(size_t offset, uint8_t* data, size_t length) const;
+        // drops the first length bytes
+        void consume(size_t length);
+        // receives length bytes from chan directly into the segments
+        void recvFrom(ChannelWrapper& chan, size_t length);
+    };
+
+    class ChannelMux;
+
+    // one stream of a ChannelMux, only used by one thread at a time
+    class MuxChannel : public ChannelWrapper {
+
+    private:
+        friend class ChannelMux;
+        MuxChannel(ChannelMux& mux, uint32_t id) : mux(mux), id(id) {}
+
+        ChannelMux& mux;
+        uint32_t id;
+        // data of this stream read from the channel, guarded by mux.recvMtx
+        BufferChannel inbox;
+        // recvAsync jobs run in order on one thread, started on first use,
+        // later receives wait for them to keep their order. queueMtx guards
+        // the queue.
+        struct RecvJob {
+            uint8_t* data;
+            size_t length;
+            std::promise<void> done;
+        };
+        std::mutex queueMtx;
+        std::condition_variable queueCv;
+        std::deque<RecvJob> recvQueue;
+        bool recvBusy = false;
+        bool stopIO = false;
+        std::thread recvThread;
+
+        void recvNow(uint8_t* data, size_t length);
+        void waitRecvQueue();
+        void recvLoop();
+
+    public:
+        ~MuxChannel();
+
+        std::future<void> sendAsync(std::vector<block>& data) override;
+
+        void send(const std::vector<block>& data) override;
+        void send(const block& data) override;
+        void send(uint8_t* data, size_t length) override;
+
+        std::future<void> recvAsync(uint8_t* data, size_t length) override;
+
+        void recv(uint8_t* data, size_t length) override;
+        void recv(block& data) override;
+        void recv(std::vector<block>& data) override;
+    };
+
+    // Carries numStreams independent conversations over one channel, each
+    // driven by its own thread. Sends go out as frames tagged with their
+    // stream. There is no reader thread: a stream waiting for data reads
+    // frames for all streams until its own data is there, so at least one
+    // stream on each end has to be receiving for the other end to make
+    // progress. Both ends need the same number of streams. chan is used from
+    // all these threads, which a JavaChannelWrapper does not allow.
+    class ChannelMux {
+
+    private:
+        friend class MuxChannel;
+
+        ChannelWrapper& chan;
+        std::vector<std::unique_ptr<MuxChannel>> streams;
+        std::mutex sendMtx;
+        std::mutex recvMtx;
+        std::condition_variable recvCv;
+        bool reading = false;
+        std::exception_ptr recvError;
+        std::vector<uint8_t> frame;
+
+        void sendFrame(uint32_t id, const uint8_t* data, size_t length);
+        // reads the next frame into the inbox of its stream, with recvMtx
+        // held by lock on entry and exit
+        void recvFrame(std::unique_lock<std::mutex>& lock);
+
+    public:
+        ChannelMux(ChannelWrapper& chan, size_t numStreams);
+
+        ChannelWrapper& stream(size_t i) { return *streams[i]; }
+        size_t numStreams() const { return streams.size(); }
     };
 }
\ No newline at end of file
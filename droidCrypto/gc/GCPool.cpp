@@ -0,0 +1,272 @@
+#include <droidCrypto/gc/GCPool.h>
+#include <droidCrypto/gc/circuits/Circuit.h>
+#include <droidCrypto/utils/Log.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+namespace {
+const char spoolMagic[8] = {'D', 'C', 'G', 'C', 'S', 'P', 'O', 'L'};
+const uint32_t spoolVersion = 1;
+const uint64_t spoolAlign = 4096;
+
+struct SpoolHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t lanes;
+  uint64_t inputA_size;
+  uint64_t inputB_size;
+  uint64_t output_size;
+  uint8_t delta[16];
+  // Bob's 0-labels, per input wire the labels of all lanes
+  uint64_t labels_offset;
+  // the framed GC stream, up to the end of the file
+  uint64_t gc_offset;
+};
+
+uint64_t alignUp(uint64_t val) {
+  return (val + spoolAlign - 1) / spoolAlign * spoolAlign;
+}
+
+uint64_t labelsLen(uint64_t lanes, uint64_t inputB_size) {
+  return lanes * inputB_size * sizeof(block);
+}
+}  // namespace
+
+GCSpool::GCSpool(const std::string &path) : file_(path) {
+  const uint8_t *base = file_.data();
+  const uint64_t file_size = file_.size();
+
+  SpoolHeader hdr;
+  if (file_size < sizeof(hdr)) {
+    throw std::runtime_error("GC spool truncated: " + path);
+  }
+  memcpy(&hdr, base, sizeof(hdr));
+  if (memcmp(hdr.magic, spoolMagic, sizeof(hdr.magic)) != 0) {
+    throw std::runtime_error("not a GC spool: " + path);
+  }
+  if (hdr.version != spoolVersion) {
+    throw std::runtime_error("unsupported GC spool version: " + path);
+  }
+  // the stream ends with an empty chunk
+  const uint64_t end_marker = 0;
+  if (hdr.lanes == 0 || hdr.labels_offset != sizeof(hdr) ||
+      hdr.inputB_size > (file_size - sizeof(hdr)) / sizeof(block) / hdr.lanes ||
+      hdr.gc_offset !=
+          alignUp(hdr.labels_offset + labelsLen(hdr.lanes, hdr.inputB_size)) ||
+      hdr.gc_offset > file_size ||
+      file_size - hdr.gc_offset < sizeof(end_marker) ||
+      memcmp(base + file_size - sizeof(end_marker), &end_marker,
+             sizeof(end_marker)) != 0) {
+    throw std::runtime_error("GC spool corrupted: " + path);
+  }
+  lanes_ = hdr.lanes;
+  inputA_size_ = hdr.inputA_size;
+  inputB_size_ = hdr.inputB_size;
+  output_size_ = hdr.output_size;
+  labels_ = base + hdr.labels_offset;
+  gc_ = span<const uint8_t>(base + hdr.gc_offset, file_size - hdr.gc_offset);
+}
+
+block GCSpool::delta() const {
+  SpoolHeader hdr;
+  memcpy(&hdr, file_.data(), sizeof(hdr));
+  block delta;
+  memcpy(&delta, hdr.delta, sizeof(delta));
+  return delta;
+}
+
+std::vector<SIMDWireLabel> GCSpool::bobInputLabels() const {
+  std::vector<SIMDWireLabel> labels;
+  labels.reserve(inputB_size_);
+  for (size_t idx = 0; idx < inputB_size_; idx++) {
+    std::vector<block> lanes(lanes_);
+    memcpy(lanes.data(), labels_ + idx * lanes_ * sizeof(block),
+           lanes_ * sizeof(block));
+    labels.emplace_back(std::move(lanes));
+  }
+  return labels;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+GCSpoolWriter::GCSpoolWriter(const std::string &path, size_t lanes,
+                             size_t inputA_size, size_t inputB_size,
+                             size_t output_size, const block &delta,
+                             const std::vector<SIMDWireLabel> &bobInputLabels)
+    : file_(path) {
+  SpoolHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, spoolMagic, sizeof(hdr.magic));
+  hdr.version = spoolVersion;
+  hdr.lanes = lanes;
+  hdr.inputA_size = inputA_size;
+  hdr.inputB_size = inputB_size;
+  hdr.output_size = output_size;
+  memcpy(hdr.delta, &delta, sizeof(hdr.delta));
+  hdr.labels_offset = sizeof(hdr);
+  hdr.gc_offset = alignUp(hdr.labels_offset + labelsLen(lanes, inputB_size));
+
+  file_.write(&hdr, sizeof(hdr));
+  for (const SIMDWireLabel &label : bobInputLabels) {
+    file_.write(label.bytes.data(), label.bytes.size() * sizeof(block));
+  }
+  file_.padTo(hdr.gc_offset);
+}
+
+std::future<void> GCSpoolWriter::sendAsync(std::vector<block> &data) {
+  send(data);
+  std::promise<void> done;
+  done.set_value();
+  return done.get_future();
+}
+
+void GCSpoolWriter::send(const std::vector<block> &data) {
+  send((uint8_t *)data.data(), data.size() * sizeof(block));
+}
+
+void GCSpoolWriter::send(const block &data) {
+  send((uint8_t *)&data, sizeof(block));
+}
+
+void GCSpoolWriter::send(uint8_t *data, size_t length) {
+  file_.write(data, length);
+  bytes_sent += length;
+}
+
+std::future<void> GCSpoolWriter::recvAsync(uint8_t *data, size_t length) {
+  recv(data, length);
+  return std::future<void>();
+}
+
+void GCSpoolWriter::recv(uint8_t *, size_t) {
+  throw std::runtime_error("a GC spool cannot receive");
+}
+
+void GCSpoolWriter::recv(block &data) { recv((uint8_t *)&data, sizeof(data)); }
+
+void GCSpoolWriter::recv(std::vector<block> &data) {
+  recv((uint8_t *)data.data(), data.size() * sizeof(block));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+GCPool::GCPool(const std::string &dir, CircuitFactory factory,
+               const BitVector &inputA, const std::vector<size_t> &lanes,
+               size_t depth /*= 2*/, size_t num_threads /*= 1*/)
+    : dir_(dir),
+      factory_(std::move(factory)),
+      inputA_(inputA),
+      depth_(depth),
+      num_threads_(num_threads),
+      next_id_(0),
+      num_taken_(0),
+      num_missed_(0),
+      stop_(false) {
+  for (size_t l : lanes) ready_[l];
+  worker_ = std::thread(&GCPool::Worker, this);
+}
+
+GCPool::~GCPool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  worker_.join();
+  for (auto &r : ready_) {
+    for (const std::string &path : r.second) unlink(path.c_str());
+  }
+}
+
+std::unique_ptr<GCSpool> GCPool::take(size_t lanes) {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = ready_.find(lanes);
+    if (it == ready_.end() || it->second.empty()) {
+      num_missed_++;
+      return nullptr;
+    }
+    path = it->second.front();
+    it->second.erase(it->second.begin());
+    num_taken_++;
+  }
+  cv_.notify_all();
+  // the mapping outlives the file, which is gone before the GC is sent
+  std::unique_ptr<GCSpool> spool;
+  try {
+    spool.reset(new GCSpool(path));
+  } catch (...) {
+    unlink(path.c_str());
+    throw;
+  }
+  unlink(path.c_str());
+  return spool;
+}
+
+void GCPool::waitFull() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  cv_.wait(lock, [this] {
+    return stop_ || std::all_of(ready_.begin(), ready_.end(), [this](
+                                    const std::pair<const size_t,
+                                                    std::vector<std::string>>
+                                        &r) { return r.second.size() >= depth_; });
+  });
+}
+
+size_t GCPool::getNumReady(size_t lanes) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = ready_.find(lanes);
+  return it == ready_.end() ? 0 : it->second.size();
+}
+
+void GCPool::Worker() {
+  // the circuit never talks to a client, its GCs go to GCSpoolWriters
+  BufferChannel unused;
+  std::unique_ptr<SIMDCircuitPhases> circ = factory_(unused);
+  circ->setNumThreads(num_threads_);
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!stop_) {
+    // refill the lane count with the fewest ready GCs first
+    size_t lanes = 0;
+    size_t fewest = depth_;
+    for (auto &r : ready_) {
+      if (r.second.size() < fewest) {
+        fewest = r.second.size();
+        lanes = r.first;
+      }
+    }
+    if (fewest >= depth_) {
+      cv_.wait(lock);
+      continue;
+    }
+    std::string path = dir_ + "/gc-" + std::to_string(getpid()) + "-" +
+                       std::to_string(lanes) + "-" +
+                       std::to_string(next_id_++) + ".spool";
+    lock.unlock();
+    auto time0 = std::chrono::high_resolution_clock::now();
+    try {
+      circ->garbleSpool(inputA_, lanes, path);
+    } catch (const std::exception &e) {
+      Log::e("GC", "could not garble for the pool: %s", e.what());
+      lock.lock();
+      stop_ = true;
+      cv_.notify_all();
+      break;
+    }
+    auto time1 = std::chrono::high_resolution_clock::now();
+    Log::v("GC", "pool: garbled %zu lanes in %fsec", lanes,
+           std::chrono::duration<double>(time1 - time0).count());
+    lock.lock();
+    ready_[lanes].push_back(path);
+    cv_.notify_all();
+  }
+}
+}  // namespace droidCrypto
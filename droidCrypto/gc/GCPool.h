@@ -0,0 +1,131 @@
+#pragma once
+
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/Defines.h>
+#include <droidCrypto/gc/WireLabel.h>
+#include <droidCrypto/utils/MappedFile.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace droidCrypto {
+class SIMDCircuitPhases;
+
+// A GC garbled before its client connected, see
+// SIMDCircuitPhases::garbleSpool. The file holds a versioned header, the
+// garbler's R, the 0-labels of Bob's inputs that inputOfBobOnline masks with
+// the OTs of the session, and the GC exactly as SIMDGarblerPhases::flushGC
+// frames it, so garbleBase sends it from the mapped pages as it is.
+//
+// R and the labels are secret, the file is created with mode 0600. A GC must
+// only be sent once, GCPool removes the file when it hands a spool out.
+class GCSpool {
+ public:
+  // maps a spool, throws std::runtime_error if the file is missing, truncated
+  // or of a different format version
+  explicit GCSpool(const std::string &path);
+
+  size_t lanes() const { return lanes_; }
+  size_t inputASize() const { return inputA_size_; }
+  size_t inputBSize() const { return inputB_size_; }
+  size_t outputSize() const { return output_size_; }
+
+  block delta() const;
+  std::vector<SIMDWireLabel> bobInputLabels() const;
+  span<const uint8_t> gcStream() const { return gc_; }
+
+ private:
+  MappedFile file_;
+  size_t lanes_;
+  size_t inputA_size_;
+  size_t inputB_size_;
+  size_t output_size_;
+  const uint8_t *labels_;
+  span<const uint8_t> gc_;
+};
+
+// Channel that writes everything sent on it into a spool file, used by
+// garbleSpool in place of the client connection. Receiving throws.
+class GCSpoolWriter : public ChannelWrapper {
+ public:
+  GCSpoolWriter(const std::string &path, size_t lanes, size_t inputA_size,
+                size_t inputB_size, size_t output_size, const block &delta,
+                const std::vector<SIMDWireLabel> &bobInputLabels);
+
+  std::future<void> sendAsync(std::vector<block> &data) override;
+
+  void send(const std::vector<block> &data) override;
+  void send(const block &data) override;
+  void send(uint8_t *data, size_t length) override;
+
+  std::future<void> recvAsync(uint8_t *data, size_t length) override;
+
+  void recv(uint8_t *data, size_t length) override;
+  void recv(block &data) override;
+  void recv(std::vector<block> &data) override;
+
+  // moves the file into place once the whole GC was sent
+  void commit() { file_.commit(); }
+
+ private:
+  AtomicFileWriter file_;
+};
+
+// Keeps a number of GCs garbled ahead of time for each of a set of lane
+// counts. A background thread garbles them under inputA into spool files in
+// dir and refills the pool whenever a spool is taken, so a server whose
+// client asks for one of these lane counts only has to run the OTs and send
+// the GC in its Base phase.
+class GCPool {
+ public:
+  typedef std::function<std::unique_ptr<SIMDCircuitPhases>(ChannelWrapper &)>
+      CircuitFactory;
+
+  GCPool(const std::string &dir, CircuitFactory factory,
+         const BitVector &inputA, const std::vector<size_t> &lanes,
+         size_t depth = 2, size_t num_threads = 1);
+  // stops garbling and removes the spools that were not taken
+  ~GCPool();
+
+  GCPool(const GCPool &) = delete;
+  GCPool &operator=(const GCPool &) = delete;
+
+  // a ready GC for lanes, whose file is already removed, or nullptr if none
+  // is ready and the caller has to garble on demand
+  std::unique_ptr<GCSpool> take(size_t lanes);
+
+  // blocks until depth GCs are ready for every lane count
+  void waitFull();
+
+  const BitVector &getInputA() const { return inputA_; }
+  size_t getNumReady(size_t lanes);
+  size_t getNumTaken() const { return num_taken_; }
+  size_t getNumMissed() const { return num_missed_; }
+
+ private:
+  void Worker();
+
+  const std::string dir_;
+  CircuitFactory factory_;
+  const BitVector inputA_;
+  const size_t depth_;
+  const size_t num_threads_;
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  // paths of the ready spools per lane count, oldest first
+  std::map<size_t, std::vector<std::string>> ready_;
+  uint64_t next_id_;
+  std::atomic<size_t> num_taken_;
+  std::atomic<size_t> num_missed_;
+  bool stop_;
+  std::thread worker_;
+};
+}  // namespace droidCrypto
@@ -0,0 +1,367 @@
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/gc/GateList.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+namespace {
+// a traced label holds the id of its wire: the id + 1 in the low half and the
+// kind of wire in the high half, the zero label stays the constant 0
+enum WireKind : uint64_t { kZero = 0, kRow = 1, kScalar = 2 };
+
+block encode(WireKind kind, uint64_t id) {
+  uint64_t v[2] = {id + 1, kind};
+  block b;
+  memcpy(&b, v, sizeof(b));
+  return b;
+}
+
+WireKind kindOf(const block &b) {
+  uint64_t v[2];
+  memcpy(v, &b, sizeof(v));
+  if (v[0] == 0 && v[1] == 0) return kZero;
+  if (v[0] == 0 || (v[1] != kRow && v[1] != kScalar))
+    throw std::runtime_error("circuit computed on a traced label");
+  return (WireKind)v[1];
+}
+
+uint32_t idOf(const block &b) {
+  uint64_t v[2];
+  memcpy(v, &b, sizeof(v));
+  return (uint32_t)(v[0] - 1);
+}
+
+// Records the gates a circuit calls with one lane. Every row and scalar wire
+// is defined once, XORs with 0 and of a wire with itself are resolved while
+// tracing. ANDs are all recorded, they send a table whatever their inputs.
+class GateListTracer : public SIMDGCEnv {
+ public:
+  GateListTracer(ChannelWrapper &chan, size_t inputA_size, size_t inputB_size)
+      : SIMDGCEnv(chan, 1),
+        numRowWires(inputB_size),
+        numScalarWires(1 + inputA_size) {}
+
+  using SIMDGCEnv::NOT;
+  using SIMDGCEnv::XOR;
+
+  WireLabel XOR(const WireLabel &a, const WireLabel &b) override {
+    WireKind ka = scalarKind(a.bytes), kb = scalarKind(b.bytes);
+    if (ka == kZero) return b;
+    if (kb == kZero) return a;
+    if (eq(a.bytes, b.bytes)) return WireLabel(ZeroBlock);
+    uint32_t out = numScalarWires++;
+    scalarGates.push_back({out, idOf(a.bytes), idOf(b.bytes)});
+    return WireLabel(encode(kScalar, out));
+  }
+
+  WireLabel NOT(const WireLabel &a) override {
+    return XOR(a, WireLabel(encode(kScalar, 0)));
+  }
+
+  void XOR(block *out, const block *a, const block *b) override {
+    WireKind ka = rowKind(a[0]), kb = rowKind(b[0]);
+    if (ka == kZero) {
+      out[0] = b[0];
+    } else if (kb == kZero) {
+      out[0] = a[0];
+    } else if (eq(a[0], b[0])) {
+      out[0] = ZeroBlock;
+    } else {
+      uint32_t id = numRowWires++;
+      gates.push_back({GateList::XOR, id, idOf(a[0]), idOf(b[0])});
+      out[0] = encode(kRow, id);
+    }
+  }
+
+  void XOR(block *out, const block *a, const WireLabel &b) override {
+    if (scalarKind(b.bytes) == kZero) {
+      out[0] = a[0];
+      return;
+    }
+    uint32_t ra = materialize(a[0]);
+    uint32_t id = numRowWires++;
+    gates.push_back({GateList::XOR_ONE, id, ra, idOf(b.bytes)});
+    out[0] = encode(kRow, id);
+  }
+
+  void NOT(block *out, const block *a) override {
+    XOR(out, a, WireLabel(encode(kScalar, 0)));
+  }
+
+  void ANDLayer(span<const ANDGate> layer) override {
+    // an AND with 0 still sends a table, so it is kept on a ZERO row; all
+    // inputs are read before any output is written
+    const size_t n = layer.size();
+    std::vector<uint32_t> ins(2 * n);
+    uint32_t zero = GateList::noRow;
+    for (size_t k = 0; k < n; k++) {
+      for (size_t i = 0; i < 2; i++) {
+        const block &in = i == 0 ? layer[k].a[0] : layer[k].b[0];
+        if (rowKind(in) != kZero) {
+          ins[2 * k + i] = idOf(in);
+        } else {
+          if (zero == GateList::noRow) zero = materialize(in);
+          ins[2 * k + i] = zero;
+        }
+      }
+    }
+    if (n == 0) return;
+    gates.push_back({GateList::AND_LAYER, 0, (uint32_t)n, 0});
+    for (size_t k = 0; k < n; k++) {
+      uint32_t id = numRowWires++;
+      gates.push_back({GateList::AND, id, ins[2 * k], ins[2 * k + 1]});
+      layer[k].out[0] = encode(kRow, id);
+    }
+  }
+
+  void PRINT(const char *, const std::vector<SIMDWireLabel> &) override {
+    throw std::runtime_error("PRINT cannot be traced");
+  }
+  void PRINT(const char *, const std::vector<WireLabel> &) override {
+    throw std::runtime_error("PRINT cannot be traced");
+  }
+
+  // the row of a label, a ZERO gate for the constant 0
+  uint32_t materialize(const block &label) {
+    if (rowKind(label) != kZero) return idOf(label);
+    uint32_t id = numRowWires++;
+    gates.push_back({GateList::ZERO, id, 0, 0});
+    return id;
+  }
+
+  // AND is only a marker here, AND_LAYER headers give the length of a layer
+  std::vector<GateList::Gate> gates;
+  std::vector<GateList::ScalarGate> scalarGates;
+  uint32_t numRowWires;
+  uint32_t numScalarWires;
+
+ private:
+  WireKind rowKind(const block &b) {
+    WireKind k = kindOf(b);
+    if (k == kScalar)
+      throw std::runtime_error("scalar label used as a row while tracing");
+    return k;
+  }
+  WireKind scalarKind(const block &b) {
+    WireKind k = kindOf(b);
+    if (k == kRow)
+      throw std::runtime_error("row label used as a scalar while tracing");
+    return k;
+  }
+};
+}  // namespace
+
+GateList GateList::trace(size_t inputA_size, size_t inputB_size,
+                         const TraceFunction &f) {
+  BufferChannel unused;
+  GateListTracer tracer(unused, inputA_size, inputB_size);
+  std::vector<WireLabel> inputA;
+  for (size_t i = 0; i < inputA_size; i++)
+    inputA.emplace_back(encode(kScalar, 1 + i));
+  std::vector<SIMDWireLabel> inputB;
+  for (size_t i = 0; i < inputB_size; i++)
+    inputB.emplace_back(std::vector<block>(1, encode(kRow, i)));
+
+  std::vector<SIMDWireLabel> outputs = f(inputA, inputB, tracer);
+  std::vector<uint32_t> outputWires;
+  for (const SIMDWireLabel &label : outputs) {
+    if (label.bytes.size() != 1)
+      throw std::runtime_error("traced circuit returned labels of many lanes");
+    outputWires.push_back(tracer.materialize(label.bytes[0]));
+  }
+  std::vector<Gate> &traced = tracer.gates;
+  const uint32_t numWires = tracer.numRowWires;
+
+  // dead gate elimination, backwards from the outputs and the ANDs: an AND
+  // sends a table even if its output is unused, dropping it would change the
+  // GC
+  std::vector<bool> liveRow(numWires, false), liveScalar(tracer.numScalarWires,
+                                                         false);
+  for (uint32_t w : outputWires) liveRow[w] = true;
+  for (const Gate &g : traced) {
+    if (g.op == AND) liveRow[g.out] = true;
+  }
+  for (size_t k = traced.size(); k-- > 0;) {
+    const Gate &g = traced[k];
+    if (g.op == AND_LAYER || !liveRow[g.out]) continue;
+    if (g.op == XOR || g.op == AND) {
+      liveRow[g.a] = true;
+      liveRow[g.b] = true;
+    } else if (g.op == XOR_ONE) {
+      liveRow[g.a] = true;
+      liveScalar[g.b] = true;
+    }
+  }
+  for (size_t k = tracer.scalarGates.size(); k-- > 0;) {
+    const ScalarGate &g = tracer.scalarGates[k];
+    if (!liveScalar[g.out]) continue;
+    liveScalar[g.a] = true;
+    liveScalar[g.b] = true;
+  }
+
+  GateList list;
+  list.inputA_size_ = inputA_size;
+  list.numScalars_ = tracer.numScalarWires;
+  for (const ScalarGate &g : tracer.scalarGates) {
+    if (liveScalar[g.out]) list.scalarGates_.push_back(g);
+  }
+
+  // the live gates, layers as header followed by their ANDs
+  std::vector<Gate> gates;
+  for (size_t k = 0; k < traced.size(); k++) {
+    const Gate &g = traced[k];
+    if (g.op == AND_LAYER) {
+      size_t header = gates.size();
+      gates.push_back(g);
+      for (size_t j = 0; j < g.a; j++) {
+        const Gate &and_gate = traced[k + 1 + j];
+        if (liveRow[and_gate.out]) gates.push_back(and_gate);
+      }
+      k += g.a;
+      gates[header].a = gates.size() - header - 1;
+      if (gates[header].a == 0) gates.pop_back();
+    } else if (liveRow[g.out]) {
+      gates.push_back(g);
+    }
+  }
+
+  // last gate reading each wire, a layer counts as its header
+  const size_t never = SIZE_MAX, forever = SIZE_MAX - 1;
+  std::vector<size_t> lastUse(numWires, never);
+  for (size_t k = 0; k < gates.size(); k++) {
+    const Gate &g = gates[k];
+    if (g.op == AND_LAYER) {
+      for (size_t j = 1; j <= g.a; j++) {
+        lastUse[gates[k + j].a] = k;
+        lastUse[gates[k + j].b] = k;
+      }
+      k += g.a;
+    } else if (g.op == XOR) {
+      lastUse[g.a] = k;
+      lastUse[g.b] = k;
+    } else if (g.op == XOR_ONE) {
+      lastUse[g.a] = k;
+    }
+  }
+  for (uint32_t w : outputWires) lastUse[w] = forever;
+
+  // rows are handed out again once the last reader of their wire ran
+  std::vector<uint32_t> rowOf(numWires, noRow);
+  std::vector<uint32_t> freeRows;
+  uint32_t numRows = 0;
+  auto alloc = [&](uint32_t wire) {
+    if (freeRows.empty()) {
+      rowOf[wire] = numRows++;
+    } else {
+      rowOf[wire] = freeRows.back();
+      freeRows.pop_back();
+    }
+    return rowOf[wire];
+  };
+  auto release = [&](uint32_t wire, size_t k) {
+    if (lastUse[wire] == k) {
+      freeRows.push_back(rowOf[wire]);
+      lastUse[wire] = never;
+    }
+  };
+  for (size_t i = 0; i < inputB_size; i++) {
+    list.inputRows_.push_back(lastUse[i] == never ? noRow : alloc(i));
+  }
+  for (size_t k = 0; k < gates.size(); k++) {
+    Gate g = gates[k];
+    if (g.op == AND_LAYER) {
+      // outputs may not share a row with an input of the same layer
+      list.gates_.push_back(g);
+      for (size_t j = 1; j <= g.a; j++) {
+        const Gate &and_gate = gates[k + j];
+        list.gates_.push_back(
+            {AND, alloc(and_gate.out), rowOf[and_gate.a], rowOf[and_gate.b]});
+      }
+      for (size_t j = 1; j <= g.a; j++) {
+        release(gates[k + j].a, k);
+        release(gates[k + j].b, k);
+      }
+      // the outputs of dead ANDs are free again after their layer
+      for (size_t j = 1; j <= g.a; j++) {
+        if (lastUse[gates[k + j].out] == never)
+          freeRows.push_back(rowOf[gates[k + j].out]);
+      }
+      k += g.a;
+      list.numANDs_ += g.a;
+      list.numLayers_++;
+      continue;
+    }
+    // XORs work lane by lane, so the output may take over an input's row
+    uint32_t a = g.op == ZERO ? 0 : rowOf[g.a];
+    uint32_t b = g.op == XOR ? rowOf[g.b] : g.b;
+    if (g.op != ZERO) release(g.a, k);
+    if (g.op == XOR) release(g.b, k);
+    list.gates_.push_back({g.op, alloc(g.out), a, b});
+    if (g.op != ZERO) list.numXORs_++;
+  }
+  for (uint32_t w : outputWires) list.outputRows_.push_back(rowOf[w]);
+  list.numRows_ = numRows;
+  list.numXORs_ += list.scalarGates_.size();
+  return list;
+}
+
+std::vector<SIMDWireLabel> GateList::run(
+    const std::vector<WireLabel> &inputA,
+    const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env,
+    Workspace &ws) const {
+  const size_t n = env.SIMDInputs;
+  ws.rows.resize(numRows_, n);
+  ws.scalars.resize(numScalars_);
+
+  block *s = ws.scalars.data();
+  s[0] = env.NOT(WireLabel(ZeroBlock)).bytes;
+  for (size_t i = 0; i < inputA_size_; i++) s[1 + i] = inputA[i].bytes;
+  for (const ScalarGate &g : scalarGates_) s[g.out] = s[g.a] ^ s[g.b];
+  for (size_t i = 0; i < inputRows_.size(); i++) {
+    if (inputRows_[i] != noRow) ws.rows.set(inputRows_[i], inputB[i]);
+  }
+
+  WireLabelMatrix &rows = ws.rows;
+  for (size_t k = 0; k < gates_.size(); k++) {
+    const Gate &g = gates_[k];
+    switch (g.op) {
+      case XOR: {
+        block *out = rows[g.out];
+        const block *a = rows[g.a], *b = rows[g.b];
+        for (size_t i = 0; i < n; i++) out[i] = a[i] ^ b[i];
+        break;
+      }
+      case XOR_ONE: {
+        block *out = rows[g.out];
+        const block *a = rows[g.a];
+        const block b = s[g.b];
+        for (size_t i = 0; i < n; i++) out[i] = a[i] ^ b;
+        break;
+      }
+      case ZERO:
+        rows.setZero(g.out);
+        break;
+      case AND_LAYER:
+        ws.layer.clear();
+        for (size_t j = 1; j <= g.a; j++) {
+          const Gate &and_gate = gates_[k + j];
+          ws.layer.push_back(
+              {rows[and_gate.out], rows[and_gate.a], rows[and_gate.b]});
+        }
+        env.ANDLayer(span<const ANDGate>(ws.layer.data(), ws.layer.size()));
+        k += g.a;
+        break;
+      case AND:
+        throw std::logic_error("AND outside of an AND layer");
+    }
+  }
+  env.numXORs += numXORs_;
+
+  std::vector<SIMDWireLabel> outputs;
+  outputs.reserve(outputRows_.size());
+  for (uint32_t row : outputRows_) outputs.push_back(rows.get(row));
+  return outputs;
+}
+}  // namespace droidCrypto
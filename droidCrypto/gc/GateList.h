@@ -0,0 +1,93 @@
+#pragma once
+
+#include <droidCrypto/Defines.h>
+#include <droidCrypto/gc/HalfGate.h>
+#include <droidCrypto/gc/WireLabel.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace droidCrypto {
+
+// Flat gate list of a SIMD circuit, traced once from circuit code written
+// against the row gates of SIMDGCEnv and then run by a loop over the list
+// instead of that code. Gates work on the rows of an arena that is reused as
+// wires die, XORs whose outputs are never used are dropped. Every AND is kept
+// and AND layers stay in their traced order, so the GC is the same one the
+// circuit code produces.
+//
+// Alice's labels are the same on all lanes. Gates on them alone are kept in a
+// separate scalar list of XORs that is run before the rows. NOT is an XOR
+// with scalar 0, which holds the label of 1: R for the garbler, 0 for the
+// evaluator.
+class GateList {
+ public:
+  typedef std::function<std::vector<SIMDWireLabel>(
+      const std::vector<WireLabel> &inputA,
+      const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env)>
+      TraceFunction;
+
+  enum Op : uint8_t {
+    XOR,       // row out = row a ^ row b
+    XOR_ONE,   // row out = row a ^ scalar b on all lanes
+    ZERO,      // row out = 0
+    AND_LAYER,  // the next a gates are ANDs of one layer
+    AND         // row out = row a & row b
+  };
+
+  struct Gate {
+    Op op;
+    uint32_t out;
+    uint32_t a;
+    uint32_t b;
+  };
+
+  // scalar out = scalar a ^ scalar b
+  struct ScalarGate {
+    uint32_t out;
+    uint32_t a;
+    uint32_t b;
+  };
+
+  // row memory and layer scratch of one worker, kept between runs
+  struct Workspace {
+    WireLabelMatrix rows;
+    std::vector<block> scalars;
+    std::vector<ANDGate> layer;
+  };
+
+  // traces f on an environment with one lane that records gates instead of
+  // computing them. f may only use the row gates, ANDLayer and the scalar
+  // XOR and NOT of its environment.
+  static GateList trace(size_t inputA_size, size_t inputB_size,
+                        const TraceFunction &f);
+
+  // runs the list on env, the same as f(inputA, inputB, env)
+  std::vector<SIMDWireLabel> run(const std::vector<WireLabel> &inputA,
+                                 const std::vector<SIMDWireLabel> &inputB,
+                                 SIMDGCEnv &env, Workspace &ws) const;
+
+  size_t numRows() const { return numRows_; }
+  size_t numGates() const { return gates_.size(); }
+  size_t numANDs() const { return numANDs_; }
+  size_t numLayers() const { return numLayers_; }
+  size_t numScalarGates() const { return scalarGates_.size(); }
+
+  static constexpr uint32_t noRow = UINT32_MAX;
+
+ private:
+  friend class BristolCircuit;
+
+  std::vector<Gate> gates_;
+  std::vector<ScalarGate> scalarGates_;
+  // row of each input of Bob, noRow for unused ones, and of each output
+  std::vector<uint32_t> inputRows_;
+  std::vector<uint32_t> outputRows_;
+  size_t inputA_size_ = 0;
+  size_t numScalars_ = 0;
+  size_t numRows_ = 0;
+  size_t numXORs_ = 0;
+  size_t numANDs_ = 0;
+  size_t numLayers_ = 0;
+};
+}  // namespace droidCrypto
@@ -1,9 +1,16 @@
 #include <droidCrypto/PRNG.h>
 #include <droidCrypto/SHA1.h>
 #include <droidCrypto/gc/HalfGate.h>
-#include <droidCrypto/ot/NaorPinkas.h>
-#include <droidCrypto/ot/VerifiedSimplestOT.h>
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/ot/TwoChooseOne/ParallelOtExt.h>
+#include <droidCrypto/ot/TwoChooseOne/StreamingOtExt.h>
 #include <droidCrypto/utils/Log.h>
+#include <endian.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace droidCrypto {
 
@@ -13,19 +20,26 @@ WireLabel Hasher::hash(const WireLabel &wire, uint64_t id) {
 }
 
 SIMDWireLabel Hasher::hash(const SIMDWireLabel &wire, uint64_t id) {
-  block bid = dupUint64(id);
-  std::vector<block> kid(wire.bytes);
-  std::vector<block> enc;
-  enc.resize(kid.size());
-  for (block &b : kid) {
-    b = shiftBlock(b) ^ bid;
-  }
-  mAES.encryptECBBlocks(kid.data(), kid.size(), enc.data());
-  for (size_t i = 0; i < kid.size(); i++) {
-    kid[i] ^= enc[i];
+  SIMDWireLabel out(std::vector<block>(wire.bytes.size()));
+  hash(wire.bytes.data(), out.bytes.data(), wire.bytes.size(), id);
+  return out;
+}
+
+void Hasher::hash(const block *wire, block *out, size_t n, uint64_t id,
+                  const block &offset /*= ZeroBlock */) {
+  mAES.hashBlocks(wire, n, dupUint64(id), offset, out);
+}
+
+void Hasher::tweak(const block *wire, block *kid, size_t n, uint64_t id,
+                   const block &offset /*= ZeroBlock */) {
+  const block bid = dupUint64(id);
+  for (size_t i = 0; i < n; i++) {
+    kid[i] = shiftBlock(wire[i] ^ offset) ^ bid;
   }
+}
 
-  return SIMDWireLabel(kid);
+void Hasher::hashTweaked(const block *kid, block *out, size_t n) {
+  mAES.hashBlocks(kid, n, out);
 }
 
 Garbler::Garbler(ChannelWrapper &chan) : GCEnv(chan) {
@@ -100,22 +114,15 @@ WireLabel Garbler::AND(const WireLabel &a, const WireLabel &b) {
 
 WireLabel Garbler::NOT(const WireLabel &a) { return a ^ R; }
 
-void Garbler::performBaseOTs(size_t numBaseOTs /* = 128 */) {
-  PRNG p = PRNG::getTestPRNG();  // TODO: use real prngs
-
-  std::vector<block> baseOTs;
-  BitVector baseChoices(numBaseOTs);
-  baseChoices.randomize(p);
-  baseOTs.resize(numBaseOTs);
+BaseOtCache::Pending Garbler::performBaseOTs(BaseOtCache *cache,
+                                             size_t numBaseOTs /* = 128 */) {
+  std::vector<block> baseOTs(numBaseOTs);
+  BitVector baseChoices;
   span<block> baseOTsSpan(baseOTs.data(), baseOTs.size());
-
-#if defined(ENABLE_SIMPLEST_OT)
-  VerifiedSimplestOT ot;
-#else
-  NaorPinkas ot;
-#endif
-  ot.receive(baseChoices, baseOTsSpan, p, channel);
+  BaseOtCache::Pending entry =
+      BaseOtCache::receive(cache, baseChoices, baseOTsSpan, channel);
   OTeSender.setBaseOts(baseOTsSpan, baseChoices);
+  return entry;
 }
 
 void Garbler::doOTPhase(size_t numOTs) {
@@ -184,18 +191,15 @@ WireLabel Evaluator::AND(const WireLabel &a, const WireLabel &b) {
   return WG ^ WE;
 }
 
-void Evaluator::performBaseOTs(size_t numBaseOTs /* = 128 */) {
-#if defined(ENABLE_SIMPLEST_OT)
-  VerifiedSimplestOT ot;
-#else
-  NaorPinkas ot;
-#endif
-  std::vector<std::array<block, 2>> baseOTs;
-  baseOTs.resize(numBaseOTs);
-  PRNG p = PRNG::getTestPRNG();
+BaseOtCache::Pending Evaluator::performBaseOTs(BaseOtCache *cache,
+                                               const std::string &peer,
+                                               size_t numBaseOTs /* = 128 */) {
+  std::vector<std::array<block, 2>> baseOTs(numBaseOTs);
   span<std::array<block, 2>> baseOTsSpan(baseOTs.data(), baseOTs.size());
-  ot.send(baseOTsSpan, p, channel);
+  BaseOtCache::Pending entry =
+      BaseOtCache::send(cache, baseOTsSpan, channel, peer);
   OTeRecv.setBaseOts(baseOTsSpan);
+  return entry;
 }
 
 void Evaluator::doOTPhase(const BitVector &choices) {
@@ -205,60 +209,130 @@ void Evaluator::doOTPhase(const BitVector &choices) {
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-// SIMDGarbler
+// SIMDGCEnv
 //----------------------------------------------------------------------------------------------------------------------
 
-SIMDGarbler::SIMDGarbler(ChannelWrapper &chan, size_t numinputs,
-                         block delta /*= ZeroBlock */)
-    : SIMDGCEnv(chan, numinputs) {
-  if (eq(delta, ZeroBlock)) delta = rnd.randBlock();
-  R = WireLabel(delta);
-  R.setLSB();
-#ifdef USE_DOTE
-  OTeSender.setDelta(R.bytes);
-#endif
+WireLabel SIMDGCEnv::XOR(const WireLabel &a, const WireLabel &b) {
+  numXORs++;
+  return a ^ b;
 }
 
-WireLabel SIMDGarbler::XOR(const WireLabel &a, const WireLabel &b) {
+SIMDWireLabel SIMDGCEnv::XOR(const SIMDWireLabel &a, const SIMDWireLabel &b) {
   numXORs++;
   return a ^ b;
 }
 
-SIMDWireLabel SIMDGarbler::XOR(const SIMDWireLabel &a, const SIMDWireLabel &b) {
+SIMDWireLabel SIMDGCEnv::XOR(const SIMDWireLabel &a, const WireLabel &b) {
   numXORs++;
   return a ^ b;
 }
 
-SIMDWireLabel SIMDGarbler::XOR(const SIMDWireLabel &a, const WireLabel &b) {
+SIMDWireLabel SIMDGCEnv::AND(const SIMDWireLabel &a, const SIMDWireLabel &b) {
+  SIMDWireLabel out = SIMDWireLabel::getZEROLabel(SIMDInputs);
+  AND(out.bytes.data(), a.bytes.data(), b.bytes.data());
+  return out;
+}
+
+SIMDWireLabel SIMDGCEnv::NOT(const SIMDWireLabel &a) {
+  SIMDWireLabel out = SIMDWireLabel::getZEROLabel(SIMDInputs);
+  NOT(out.bytes.data(), a.bytes.data());
+  return out;
+}
+
+void SIMDGCEnv::XOR(block *out, const block *a, const block *b) {
   numXORs++;
-  return a ^ b;
+  for (size_t i = 0; i < SIMDInputs; i++) out[i] = a[i] ^ b[i];
 }
 
-SIMDWireLabel SIMDGarbler::AND(const SIMDWireLabel &a, const SIMDWireLabel &b) {
-  SIMDWireLabel G1 = gb.hash(a, gid);
-  SIMDWireLabel TG = G1 ^ gb.hash(a ^ R, gid);
-  for (size_t i = 0; i < b.bytes.size(); i++) {
-    if (b.bytes[i][0] & 1) TG.bytes[i] = TG.bytes[i] ^ R.bytes;
-  }
-  SIMDWireLabel WG = G1;
-  for (size_t i = 0; i < a.bytes.size(); i++) {
-    if (a.bytes[i][0] & 1) WG.bytes[i] = WG.bytes[i] ^ TG.bytes[i];
-  }
+void SIMDGCEnv::XOR(block *out, const block *a, const WireLabel &b) {
+  numXORs++;
+  for (size_t i = 0; i < SIMDInputs; i++) out[i] = a[i] ^ b.bytes;
+}
 
-  G1 = gb.hash(b, gid);
-  SIMDWireLabel TE = G1 ^ gb.hash(b ^ R, gid) ^ a;
-  SIMDWireLabel WE = G1;
-  for (size_t i = 0; i < b.bytes.size(); i++) {
-    if (b.bytes[i][0] & 1) WE.bytes[i] = WE.bytes[i] ^ TE.bytes[i] ^ a.bytes[i];
+void SIMDGCEnv::AND(block *out, const block *a, const block *b) {
+  ANDGate gate = {out, a, b};
+  ANDLayer(span<const ANDGate>(&gate, 1));
+}
+
+void SIMDGCEnv::reserveLayer(size_t numGates, size_t hashesPerGate) {
+  const size_t numHashes =
+      numGates * hashesPerGate * std::min(layerTile, SIMDInputs);
+  if (hashIn.size() < numHashes) {
+    hashIn.resize(numHashes);
+    hashOut.resize(numHashes);
   }
+  if (tables.size() < 2 * numGates * SIMDInputs)
+    tables.resize(2 * numGates * SIMDInputs);
+}
 
-  gid++;
-  numANDs++;
+//----------------------------------------------------------------------------------------------------------------------
+// SIMDGarbler
+//----------------------------------------------------------------------------------------------------------------------
 
-  TG.send(channel);
-  TE.send(channel);
+SIMDGarbler::SIMDGarbler(ChannelWrapper &chan, size_t numinputs,
+                         block delta /*= ZeroBlock */)
+    : SIMDGCEnv(chan, numinputs) {
+  if (eq(delta, ZeroBlock)) delta = rnd.randBlock();
+  R = WireLabel(delta);
+  R.setLSB();
+#ifdef USE_DOTE
+  OTeSender.setDelta(R.bytes);
+#endif
+}
 
-  return WG ^ WE;
+void SIMDGarbler::garbleANDLayer(span<const ANDGate> gates) {
+  const size_t n = SIMDInputs;
+  const size_t numGates = gates.size();
+  reserveLayer(numGates, 4);
+
+  // hash inputs a, a ^ R, b and b ^ R of all gates one lane tile at a time,
+  // one AES pass per tile keeps the pipeline full across gates
+  for (size_t i0 = 0; i0 < n; i0 += layerTile) {
+    const size_t t = std::min(layerTile, n - i0);
+    for (size_t k = 0; k < numGates; k++) {
+      block *kid = hashIn.data() + 4 * k * t;
+      gb.tweak(gates[k].a + i0, kid, t, gid + k);
+      gb.tweak(gates[k].a + i0, kid + t, t, gid + k, R.bytes);
+      gb.tweak(gates[k].b + i0, kid + 2 * t, t, gid + k);
+      gb.tweak(gates[k].b + i0, kid + 3 * t, t, gid + k, R.bytes);
+    }
+    gb.hashTweaked(hashIn.data(), hashOut.data(), 4 * numGates * t);
+
+    for (size_t k = 0; k < numGates; k++) {
+      const block *h = hashOut.data() + 4 * k * t;
+      const block *a = gates[k].a + i0;
+      const block *b = gates[k].b + i0;
+      block *out = gates[k].out + i0;
+      block *TG = tables.data() + 2 * k * n + i0;
+      block *TE = TG + n;
+      for (size_t i = 0; i < t; i++) {
+        block G0 = h[i];
+        block H0 = h[2 * t + i];
+
+        block tg = G0 ^ h[t + i];
+        if (b[i][0] & 1) tg = tg ^ R.bytes;
+        block WG = G0;
+        if (a[i][0] & 1) WG = WG ^ tg;
+
+        block te = H0 ^ h[3 * t + i] ^ a[i];
+        block WE = H0;
+        if (b[i][0] & 1) WE = WE ^ te ^ a[i];
+
+        TG[i] = tg;
+        TE[i] = te;
+        out[i] = WG ^ WE;
+      }
+    }
+  }
+
+  gid += numGates;
+  numANDs += numGates;
+}
+
+void SIMDGarbler::ANDLayer(span<const ANDGate> gates) {
+  garbleANDLayer(gates);
+  channel.send((uint8_t *)tables.data(),
+               2 * gates.size() * SIMDInputs * sizeof(block));
 }
 
 void SIMDGarbler::PRINT(const char *, const std::vector<SIMDWireLabel> &vec) {
@@ -279,31 +353,28 @@ void SIMDGarbler::PRINT(const char *, const std::vector<WireLabel> &vec) {
 
 WireLabel SIMDGarbler::NOT(const WireLabel &a) { return a ^ R; }
 
-SIMDWireLabel SIMDGarbler::NOT(const SIMDWireLabel &a) { return a ^ R; }
-
-void SIMDGarbler::performBaseOTs(size_t numBaseOTs /* = 128 */) {
-  PRNG p = PRNG::getTestPRNG();  // TODO: use real prngs
+void SIMDGarbler::NOT(block *out, const block *a) {
+  for (size_t i = 0; i < SIMDInputs; i++) out[i] = a[i] ^ R.bytes;
+}
 
-  std::vector<block> baseOTs;
-  BitVector baseChoices(numBaseOTs);
-  baseChoices.randomize(p);
-  baseOTs.resize(numBaseOTs);
+BaseOtCache::Pending SIMDGarbler::performBaseOTs(
+    BaseOtCache *cache, size_t numBaseOTs /* = 128 */,
+    size_t numThreads /* = 1 */) {
+  std::vector<block> baseOTs(numBaseOTs);
+  BitVector baseChoices;
   span<block> baseOTsSpan(baseOTs.data(), baseOTs.size());
-
-#if defined(ENABLE_SIMPLEST_OT)
-  VerifiedSimplestOT ot;
-#else
-  NaorPinkas ot;
-#endif
-  ot.receive(baseChoices, baseOTsSpan, p, channel);
+  BaseOtCache::Pending entry = BaseOtCache::receive(
+      cache, baseChoices, baseOTsSpan, channel, numThreads);
   OTeSender.setBaseOts(baseOTsSpan, baseChoices);
+  return entry;
 }
 
-void SIMDGarbler::doOTPhase(size_t numOTs) {
+void SIMDGarbler::doOTPhase(size_t numOTs, size_t numThreads /* = 1 */) {
   OTs.resize(numOTs);
   PRNG p = PRNG::getTestPRNG();
-  OTeSender.send(span<std::array<block, 2>>(OTs.data(), OTs.size()), p,
-                 channel);
+  otExtSendParallel(OTeSender,
+                    span<std::array<block, 2>>(OTs.data(), OTs.size()), p,
+                    channel, numThreads);
 }
 
 std::vector<WireLabel> SIMDGarbler::inputOfAlice(const BitVector &input) {
@@ -342,24 +413,29 @@ std::vector<SIMDWireLabel> SIMDGarbler::inputOfAlice(
 }
 
 std::vector<SIMDWireLabel> SIMDGarbler::inputOfBob(const size_t size) {
-  std::vector<SIMDWireLabel> bobInput;
-  bobInput.reserve(size);
-  doOTPhase(size * SIMDInputs);
+  std::vector<SIMDWireLabel> bobInput(
+      size, SIMDWireLabel(std::vector<block>(SIMDInputs)));
+  PRNG p = PRNG::getTestPRNG();
 
-  for (size_t idx = 0; idx < size; idx++) {
-    std::vector<block> tmp;
-    tmp.reserve(SIMDInputs);
-    for (size_t input_idx = 0; input_idx < SIMDInputs; input_idx++) {
-      tmp.push_back(OTs[input_idx * size + idx][0]);
-    }
-    bobInput.emplace_back(tmp);
-#ifdef USE_DOTE
-#else
-    for (size_t input_idx = 0; input_idx < SIMDInputs; input_idx++)
-      tmp[input_idx] ^= OTs[input_idx * size + idx][1] ^ R.bytes;
-    channel.send(tmp);
+  // OT i is lane i / size of wire i % size, the OTs are written into the
+  // labels as they are extended instead of being kept in OTs
+  otExtSendStreaming(
+      OTeSender, size * SIMDInputs, p, channel,
+      [&](size_t begin, span<std::array<block, 2>> ots) {
+        const size_t numOTs = ots.size();
+#ifndef USE_DOTE
+        std::vector<block> tmp(numOTs);
 #endif
-  }
+        for (size_t i = 0; i < numOTs; i++) {
+          bobInput[(begin + i) % size].bytes[(begin + i) / size] = ots[i][0];
+#ifndef USE_DOTE
+          tmp[i] = ots[i][0] ^ ots[i][1] ^ R.bytes;
+#endif
+        }
+#ifndef USE_DOTE
+        channel.send(tmp);
+#endif
+      });
   return bobInput;  // Garbler needs the 0-Labels for garbling, not the actual
                     // input
 }
@@ -373,25 +449,23 @@ void SIMDGarbler::outputToBob(const std::vector<SIMDWireLabel> &outputLabels) {
 //----------------------------------------------------------------------------------------------------------------------
 // SIMDEvaluator
 //----------------------------------------------------------------------------------------------------------------------
-void SIMDEvaluator::performBaseOTs(size_t numBaseOTs /* = 128 */) {
-#if defined(ENABLE_SIMPLEST_OT)
-  VerifiedSimplestOT ot;
-#else
-  NaorPinkas ot;
-#endif
-
-  std::vector<std::array<block, 2>> baseOTs;
-  baseOTs.resize(numBaseOTs);
-  PRNG p = PRNG::getTestPRNG();
+BaseOtCache::Pending SIMDEvaluator::performBaseOTs(
+    BaseOtCache *cache, const std::string &peer, size_t numBaseOTs /* = 128 */,
+    size_t numThreads /* = 1 */) {
+  std::vector<std::array<block, 2>> baseOTs(numBaseOTs);
   span<std::array<block, 2>> baseOTsSpan(baseOTs.data(), baseOTs.size());
-  ot.send(baseOTsSpan, p, channel);
+  BaseOtCache::Pending entry =
+      BaseOtCache::send(cache, baseOTsSpan, channel, peer, numThreads);
   OTeRecv.setBaseOts(baseOTsSpan);
+  return entry;
 }
 
-void SIMDEvaluator::doOTPhase(const BitVector &choices) {
+void SIMDEvaluator::doOTPhase(const BitVector &choices,
+                              size_t numThreads /* = 1 */) {
   OTs.resize(choices.size());
   PRNG p = PRNG::getTestPRNG();
-  OTeRecv.receive(choices, span<block>(OTs.data(), OTs.size()), p, channel);
+  otExtReceiveParallel(OTeRecv, choices, span<block>(OTs.data(), OTs.size()),
+                       p, channel, numThreads);
 }
 
 std::vector<WireLabel> SIMDEvaluator::inputOfAlice(const size_t size) {
@@ -416,35 +490,32 @@ std::vector<SIMDWireLabel> SIMDEvaluator::inputOfAliceSIMD(const size_t size) {
 
 std::vector<SIMDWireLabel> SIMDEvaluator::inputOfBob(
     const std::vector<BitVector> &input) {
-  std::vector<SIMDWireLabel> bobInput;
   const size_t input_size = input.front().size();
   const size_t num_input = input.size();
-  bobInput.reserve(input_size);
+  std::vector<SIMDWireLabel> bobInput(
+      input_size, SIMDWireLabel(std::vector<block>(num_input)));
   BitVector all;
   for (const BitVector &bv : input) {
     all.append(bv);
   }
-  doOTPhase(all);
+  PRNG p = PRNG::getTestPRNG();
 
-  for (size_t idx = 0; idx < input_size; idx++) {
-    std::vector<block> tmp;
-    tmp.reserve(num_input);
-#ifdef USE_DOTE
-    for (size_t input_idx = 0; input_idx < num_input; input_idx++) {
-      tmp.push_back(OTs[input_idx * input_size + idx]);
-    }
-#else
-    std::vector<block> b1(num_input);
-    channel.recv(b1);
-    for (size_t input_idx = 0; input_idx < num_input; input_idx++) {
-      if (input[input_idx][idx])
-        tmp.push_back(b1[input_idx] ^ OTs[input_idx * input_size + idx]);
-      else
-        tmp.push_back(OTs[input_idx * input_size + idx]);
-    }
+  otExtReceiveStreaming(
+      OTeRecv, all, p, channel, [&](size_t begin, span<block> ots) {
+        const size_t numOTs = ots.size();
+#ifndef USE_DOTE
+        std::vector<block> b1(numOTs);
+        channel.recv(b1);
 #endif
-    bobInput.emplace_back(tmp);
-  }
+        for (size_t i = 0; i < numOTs; i++) {
+          block label = ots[i];
+#ifndef USE_DOTE
+          if (all[begin + i]) label ^= b1[i];
+#endif
+          bobInput[(begin + i) % input_size]
+              .bytes[(begin + i) / input_size] = label;
+        }
+      });
   return bobInput;
 }
 
@@ -509,42 +580,49 @@ WireLabel SIMDEvaluator::NOT(const WireLabel &a) {
   return a;  // NOT happens at the garbler
 }
 
-SIMDWireLabel SIMDEvaluator::NOT(const SIMDWireLabel &a) {
-  return a;  // NOT happens at the garbler
+void SIMDEvaluator::NOT(block *out, const block *a) {
+  // NOT happens at the garbler
+  if (out != a) memcpy(out, a, SIMDInputs * sizeof(block));
 }
 
-WireLabel SIMDEvaluator::XOR(const WireLabel &a, const WireLabel &b) {
-  numXORs++;
-  return a ^ b;
-}
+void SIMDEvaluator::evaluateANDLayer(span<const ANDGate> gates) {
+  const size_t n = SIMDInputs;
+  const size_t numGates = gates.size();
 
-SIMDWireLabel SIMDEvaluator::XOR(const SIMDWireLabel &a,
-                                 const SIMDWireLabel &b) {
-  numXORs++;
-  return a ^ b;
-}
-
-SIMDWireLabel SIMDEvaluator::XOR(const SIMDWireLabel &a, const WireLabel &b) {
-  numXORs++;
-  return a ^ b;
+  for (size_t i0 = 0; i0 < n; i0 += layerTile) {
+    const size_t t = std::min(layerTile, n - i0);
+    for (size_t k = 0; k < numGates; k++) {
+      block *kid = hashIn.data() + 2 * k * t;
+      gb.tweak(gates[k].a + i0, kid, t, gid + k);
+      gb.tweak(gates[k].b + i0, kid + t, t, gid + k);
+    }
+    gb.hashTweaked(hashIn.data(), hashOut.data(), 2 * numGates * t);
+
+    for (size_t k = 0; k < numGates; k++) {
+      const block *h = hashOut.data() + 2 * k * t;
+      const block *a = gates[k].a + i0;
+      const block *b = gates[k].b + i0;
+      block *out = gates[k].out + i0;
+      const block *TG = tables.data() + 2 * k * n + i0;
+      const block *TE = TG + n;
+      for (size_t i = 0; i < t; i++) {
+        block WG = h[i];
+        if (a[i][0] & 1) WG = WG ^ TG[i];
+        block WE = h[t + i];
+        if (b[i][0] & 1) WE = WE ^ TE[i] ^ a[i];
+        out[i] = WG ^ WE;
+      }
+    }
+  }
+  gid += numGates;
+  numANDs += numGates;
 }
 
-SIMDWireLabel SIMDEvaluator::AND(const SIMDWireLabel &a,
-                                 const SIMDWireLabel &b) {
-  SIMDWireLabel TG = SIMDWireLabel::recv(channel, SIMDInputs);
-  SIMDWireLabel TE = SIMDWireLabel::recv(channel, SIMDInputs);
-
-  SIMDWireLabel WG = gb.hash(a, gid);
-  for (size_t i = 0; i < a.bytes.size(); i++) {
-    if (a.bytes[i][0] & 1) WG.bytes[i] = WG.bytes[i] ^ TG.bytes[i];
-  }
-  SIMDWireLabel WE = gb.hash(b, gid);
-  for (size_t i = 0; i < b.bytes.size(); i++) {
-    if (b.bytes[i][0] & 1) WE.bytes[i] = WE.bytes[i] ^ TE.bytes[i] ^ a.bytes[i];
-  }
-  gid++;
-  numANDs++;
-  return WG ^ WE;
+void SIMDEvaluator::ANDLayer(span<const ANDGate> gates) {
+  reserveLayer(gates.size(), 2);
+  channel.recv((uint8_t *)tables.data(),
+               2 * gates.size() * SIMDInputs * sizeof(block));
+  evaluateANDLayer(gates);
 }
 
 //-----------------------------------------------------------------------------------------------
@@ -571,6 +649,7 @@ std::vector<WireLabel> SIMDGarblerPhases::inputOfAlice(const BitVector &input) {
 std::vector<WireLabel> SIMDEvaluatorPhases::inputOfAlice(const size_t size) {
   std::vector<WireLabel> aliceInput;
   aliceInput.reserve(size);
+  pullGC(size * sizeof(block));
 
   for (size_t idx = 0; idx < size; idx++) {
     aliceInput.push_back(WireLabel::recv(bufChan));
@@ -648,6 +727,7 @@ std::vector<BitVector> SIMDEvaluatorPhases::outputToBob(
   for (BitVector &bv : output) bv.reserve(outputLabels.size());
 
   BitVector buf(SIMDInputs);
+  pullGC(outputLabels.size() * buf.sizeBytes());
   for (const SIMDWireLabel &label : outputLabels) {
     bufChan.recv(buf.data(), buf.sizeBytes());
     BitVector bv = label.getLSB();
@@ -659,49 +739,292 @@ std::vector<BitVector> SIMDEvaluatorPhases::outputToBob(
   return output;
 }
 
-SIMDWireLabel SIMDGarblerPhases::AND(const SIMDWireLabel &a,
-                                     const SIMDWireLabel &b) {
-  SIMDWireLabel G1 = gb.hash(a, gid);
-  SIMDWireLabel TG = G1 ^ gb.hash(a ^ R, gid);
-  for (size_t i = 0; i < b.bytes.size(); i++) {
-    if (b.bytes[i][0] & 1) TG.bytes[i] = TG.bytes[i] ^ R.bytes;
+void SIMDGarblerPhases::ANDLayer(span<const ANDGate> gates) {
+  garbleANDLayer(gates);
+  bufChan.send((uint8_t *)tables.data(),
+               2 * gates.size() * SIMDInputs * sizeof(block));
+  if (bufChan.size() >= gcChunkSize) flushGC();
+}
+
+uint64_t SIMDGarblerPhases::flushGC(bool last /*= false */) {
+  while (bufChan.size() >= gcChunkSize || (last && bufChan.size() > 0)) {
+    size_t len = std::min(bufChan.size(), gcChunkSize);
+    uint64_t transfer = htobe64(len);
+    channel.send((uint8_t *)&transfer, sizeof(transfer));
+    channel.sendBuffer(bufChan, len);
+    gcBytesSent += len;
   }
-  SIMDWireLabel WG = G1;
-  for (size_t i = 0; i < a.bytes.size(); i++) {
-    if (a.bytes[i][0] & 1) WG.bytes[i] = WG.bytes[i] ^ TG.bytes[i];
+  if (last) {
+    uint64_t transfer = 0;
+    channel.send((uint8_t *)&transfer, sizeof(transfer));
+    channel.flush();
   }
+  return gcBytesSent;
+}
 
-  G1 = gb.hash(b, gid);
-  SIMDWireLabel TE = G1 ^ gb.hash(b ^ R, gid) ^ a;
-  SIMDWireLabel WE = G1;
-  for (size_t i = 0; i < b.bytes.size(); i++) {
-    if (b.bytes[i][0] & 1) WE.bytes[i] = WE.bytes[i] ^ TE.bytes[i] ^ a.bytes[i];
+namespace {
+// Puts the tables of workers that garble disjoint lane ranges back into the
+// stream order of a single garbler. Gates are collected in windows of a few
+// MiB, workers write their lanes of a gate straight to its place in the
+// window, and once all of them are past a window the coordinator sends it.
+// Two windows are used in turns, so workers only wait for a slow one of them
+// or for the channel when they are a whole window ahead.
+class LaneTableMerger {
+ public:
+  LaneTableMerger(SIMDGarblerPhases &out, size_t numWorkers)
+      : out(out),
+        numWorkers(numWorkers),
+        lanes(out.SIMDInputs),
+        windowGates(std::max<size_t>(
+            1, 4 * gcChunkSize / (2 * lanes * sizeof(block)))) {
+    for (auto &w : windows) w.resize(2 * windowGates * lanes);
   }
 
-  gid++;
-  numANDs++;
+  // worker side, tables holds TG, TE of numGates gates for the given lanes
+  void write(uint64_t gid, size_t numGates, size_t laneBegin,
+             size_t laneCount, const block *tables) {
+    for (size_t k = 0; k < numGates; k++) {
+      const uint64_t gate = gid + k;
+      const uint64_t window = gate / windowGates;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return window < nextSend + 2; });
+      }
+      block *dst = windows[window % 2].data() +
+                   2 * (gate % windowGates) * lanes + laneBegin;
+      memcpy(dst, tables + 2 * k * laneCount, laneCount * sizeof(block));
+      memcpy(dst + lanes, tables + (2 * k + 1) * laneCount,
+             laneCount * sizeof(block));
+      if ((gate + 1) % windowGates == 0) {
+        std::lock_guard<std::mutex> lock(mtx);
+        done[window % 2]++;
+        cv.notify_all();
+      }
+    }
+  }
 
-  TG.send(bufChan);
-  TE.send(bufChan);
+  // worker side, after its last gate
+  void finish(uint64_t numGates) {
+    std::lock_guard<std::mutex> lock(mtx);
+    totalGates = numGates;
+    if (numGates % windowGates != 0) done[(numGates / windowGates) % 2]++;
+    finished++;
+    cv.notify_all();
+  }
 
-  return WG ^ WE;
+  // coordinator side, streams the windows to out until all workers finished.
+  // Returns the number of gates.
+  uint64_t run() {
+    while (true) {
+      size_t gates;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] {
+          return done[nextSend % 2] == numWorkers ||
+                 (finished == numWorkers && nextSend * windowGates >= totalGates);
+        });
+        if (done[nextSend % 2] != numWorkers) break;
+        gates = windowGates;
+        if (finished == numWorkers)
+          gates = std::min<uint64_t>(gates, totalGates - nextSend * windowGates);
+      }
+      out.bufChan.send((uint8_t *)windows[nextSend % 2].data(),
+                       2 * gates * lanes * sizeof(block));
+      out.flushGC();
+      std::lock_guard<std::mutex> lock(mtx);
+      done[nextSend % 2] = 0;
+      nextSend++;
+      cv.notify_all();
+    }
+    return totalGates;
+  }
+
+ private:
+  SIMDGarblerPhases &out;
+  const size_t numWorkers;
+  const size_t lanes;
+  const uint64_t windowGates;
+  std::vector<block> windows[2];
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  uint64_t nextSend = 0;
+  size_t done[2] = {0, 0};
+  size_t finished = 0;
+  uint64_t totalGates = 0;
+};
+
+// evaluates one lane range of a parallel evaluation, the tables of gate gid
+// start at byte 2 * gid * lanes * sizeof(block) of gc
+class SIMDEvaluatorLanes : public SIMDEvaluator {
+ public:
+  SIMDEvaluatorLanes(ChannelWrapper &chan, size_t laneBegin, size_t laneCount,
+                     size_t lanes, const BufferChannel &gc)
+      : SIMDEvaluator(chan, laneCount),
+        laneBegin(laneBegin),
+        lanes(lanes),
+        gc(gc) {}
+
+  void ANDLayer(span<const ANDGate> gates) override {
+    const size_t n = SIMDInputs;
+    const size_t numGates = gates.size();
+    reserveLayer(numGates, 2);
+    for (size_t k = 0; k < numGates; k++) {
+      size_t offset = (2 * (gid + k) * lanes + laneBegin) * sizeof(block);
+      gc.read(offset, (uint8_t *)(tables.data() + 2 * k * n), n * sizeof(block));
+      gc.read(offset + lanes * sizeof(block),
+              (uint8_t *)(tables.data() + (2 * k + 1) * n), n * sizeof(block));
+    }
+    evaluateANDLayer(gates);
+  }
+
+ private:
+  const size_t laneBegin;
+  const size_t lanes;
+  const BufferChannel &gc;
+};
+
+std::vector<SIMDWireLabel> sliceLanes(const std::vector<SIMDWireLabel> &labels,
+                                      size_t begin, size_t count) {
+  std::vector<SIMDWireLabel> lanes;
+  lanes.reserve(labels.size());
+  for (const SIMDWireLabel &label : labels)
+    lanes.emplace_back(std::vector<block>(label.bytes.begin() + begin,
+                                          label.bytes.begin() + begin + count));
+  return lanes;
 }
 
-SIMDWireLabel SIMDEvaluatorPhases::AND(const SIMDWireLabel &a,
-                                       const SIMDWireLabel &b) {
-  SIMDWireLabel TG = SIMDWireLabel::recv(bufChan, SIMDInputs);
-  SIMDWireLabel TE = SIMDWireLabel::recv(bufChan, SIMDInputs);
+// concatenates the lanes of each label of the parts, in order
+std::vector<SIMDWireLabel> mergeLanes(
+    const std::vector<std::vector<SIMDWireLabel>> &parts, size_t lanes) {
+  std::vector<SIMDWireLabel> result;
+  result.reserve(parts[0].size());
+  for (size_t i = 0; i < parts[0].size(); i++) {
+    std::vector<block> bytes;
+    bytes.reserve(lanes);
+    for (const std::vector<SIMDWireLabel> &part : parts)
+      bytes.insert(bytes.end(), part[i].bytes.begin(), part[i].bytes.end());
+    result.emplace_back(std::move(bytes));
+  }
+  return result;
+}
 
-  SIMDWireLabel WG = gb.hash(a, gid);
-  for (size_t i = 0; i < a.bytes.size(); i++) {
-    if (a.bytes[i][0] & 1) WG.bytes[i] = WG.bytes[i] ^ TG.bytes[i];
+// garbles one lane range of a parallel garbling into a LaneTableMerger
+class SIMDGarblerLanes : public SIMDGarbler {
+ public:
+  SIMDGarblerLanes(ChannelWrapper &chan, size_t laneBegin, size_t laneCount,
+                   const block &delta, LaneTableMerger &merger)
+      : SIMDGarbler(chan, laneCount, delta),
+        laneBegin(laneBegin),
+        merger(merger) {}
+
+  void ANDLayer(span<const ANDGate> gates) override {
+    const uint64_t first = gid;
+    garbleANDLayer(gates);
+    merger.write(first, gates.size(), laneBegin, SIMDInputs, tables.data());
   }
-  SIMDWireLabel WE = gb.hash(b, gid);
-  for (size_t i = 0; i < b.bytes.size(); i++) {
-    if (b.bytes[i][0] & 1) WE.bytes[i] = WE.bytes[i] ^ TE.bytes[i] ^ a.bytes[i];
+
+  void finish() { merger.finish(gid); }
+
+ private:
+  const size_t laneBegin;
+  LaneTableMerger &merger;
+};
+}  // namespace
+
+std::vector<SIMDWireLabel> SIMDGarblerPhases::garbleParallel(
+    const std::vector<SIMDWireLabel> &inputB, size_t numThreads,
+    const LaneFunction &compute) {
+  numThreads = std::min<size_t>(numThreads, SIMDInputs);
+  if (numThreads <= 1) return compute(inputB, *this, 0);
+
+  const size_t perThread = (SIMDInputs + numThreads - 1) / numThreads;
+  numThreads = (SIMDInputs + perThread - 1) / perThread;
+  LaneTableMerger merger(*this, numThreads);
+  std::vector<std::vector<SIMDWireLabel>> outputs(numThreads);
+  uint64_t workerXORs = 0;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; t++) {
+    const size_t begin = t * perThread;
+    const size_t count = std::min(perThread, SIMDInputs - begin);
+    threads.emplace_back([&, t, begin, count] {
+      SIMDGarblerLanes env(channel, begin, count, R.bytes, merger);
+      outputs[t] = compute(sliceLanes(inputB, begin, count), env, t);
+      env.finish();
+      if (t == 0) workerXORs = env.getNumXORs();
+    });
   }
-  gid++;
-  numANDs++;
-  return WG ^ WE;
+  uint64_t numGates = merger.run();
+  for (std::thread &t : threads) t.join();
+  gid += numGates;
+  numANDs += numGates;
+  numXORs += workerXORs;
+  return mergeLanes(outputs, SIMDInputs);
+}
+
+std::vector<SIMDWireLabel> SIMDEvaluatorPhases::evaluateParallel(
+    const std::vector<SIMDWireLabel> &inputB, size_t numThreads,
+    const SIMDGarblerPhases::LaneFunction &compute) {
+  numThreads = std::min<size_t>(numThreads, SIMDInputs);
+  if (numThreads <= 1) return compute(inputB, *this, 0);
+
+  const size_t perThread = (SIMDInputs + numThreads - 1) / numThreads;
+  numThreads = (SIMDInputs + perThread - 1) / perThread;
+  std::vector<std::vector<SIMDWireLabel>> outputs(numThreads);
+  std::vector<uint64_t> numGates(numThreads), workerXORs(numThreads);
+  auto work = [&](size_t t) {
+    const size_t begin = t * perThread;
+    const size_t count = std::min(perThread, SIMDInputs - begin);
+    SIMDEvaluatorLanes env(channel, begin, count, SIMDInputs, bufChan);
+    outputs[t] = compute(sliceLanes(inputB, begin, count), env, t);
+    numGates[t] = env.getNumANDs();
+    workerXORs[t] = env.getNumXORs();
+  };
+  // the calling thread takes the first range
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < numThreads; t++) threads.emplace_back(work, t);
+  work(0);
+  for (std::thread &t : threads) t.join();
+
+  bufChan.consume(2 * numGates[0] * SIMDInputs * sizeof(block));
+  gid += numGates[0];
+  numANDs += numGates[0];
+  numXORs += workerXORs[0];
+  return mergeLanes(outputs, SIMDInputs);
+}
+
+void SIMDEvaluatorPhases::ANDLayer(span<const ANDGate> gates) {
+  reserveLayer(gates.size(), 2);
+  pullGC(2 * gates.size() * SIMDInputs * sizeof(block));
+  bufChan.recv((uint8_t *)tables.data(),
+               2 * gates.size() * SIMDInputs * sizeof(block));
+  evaluateANDLayer(gates);
+}
+
+uint64_t SIMDEvaluatorPhases::recvGC() {
+  while (recvGCChunk()) {
+  }
+  return gcBytesRecv;
+}
+
+void SIMDEvaluatorPhases::pullGC(size_t length) {
+  while (bufChan.size() < length) {
+    if (!recvGCChunk()) throw std::runtime_error("GC stream ended early");
+  }
+}
+
+bool SIMDEvaluatorPhases::recvGCChunk() {
+  if (gcDone) return false;
+  uint64_t transfer;
+  channel.recv((uint8_t *)&transfer, sizeof(transfer));
+  uint64_t len = be64toh(transfer);
+  if (len == 0) {
+    gcDone = true;
+    return false;
+  }
+  bufChan.recvFrom(channel, len);
+  gcBytesRecv += len;
+  maxBuffered = std::max(maxBuffered, bufChan.size());
+  return true;
+}
 }
-}
\ No newline at end of file
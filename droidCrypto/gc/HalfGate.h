@@ -5,6 +5,7 @@
 #include <droidCrypto/Defines.h>
 #include <droidCrypto/SecureRandom.h>
 #include <droidCrypto/gc/WireLabel.h>
+#include <droidCrypto/ot/BaseOtCache.h>
 #include <droidCrypto/ot/TwoChooseOne/IknpDotExtReceiver.h>
 #include <droidCrypto/ot/TwoChooseOne/IknpDotExtSender.h>
 #include <droidCrypto/ot/TwoChooseOne/KosDotExtReceiver.h>
@@ -12,10 +13,16 @@
 #include <droidCrypto/ot/TwoChooseOne/KosOtExtReceiver.h>
 #include <droidCrypto/ot/TwoChooseOne/KosOtExtSender.h>
 
+#include <functional>
+#include <string>
+
 #define USE_DOTE
 
 namespace droidCrypto {
 
+// garbled tables are streamed to the evaluator in chunks of this many bytes
+constexpr size_t gcChunkSize = 1 << 20;
+
 class Hasher {
  public:
   Hasher() : mAES(mAesFixedKey) {}
@@ -24,6 +31,17 @@ class Hasher {
 
   SIMDWireLabel hash(const SIMDWireLabel &wire, uint64_t id);
 
+  // hashes the n labels wire[i] ^ offset into out, out may alias wire
+  void hash(const block *wire, block *out, size_t n, uint64_t id,
+            const block &offset = ZeroBlock);
+
+  // the hash split in two steps so labels of many gates share one AES pass:
+  // tweak writes the keys of the labels wire[i] ^ offset to kid, hashTweaked
+  // hashes n such keys of any gates and offsets
+  void tweak(const block *wire, block *kid, size_t n, uint64_t id,
+             const block &offset = ZeroBlock);
+  void hashTweaked(const block *kid, block *out, size_t n);
+
  private:
   const AES &mAES;
 };
@@ -66,7 +84,14 @@ class Garbler : public GCEnv {
 
   virtual WireLabel NOT(const WireLabel &a);
 
-  void performBaseOTs(size_t numBaseOTs = 128);
+  // resumes the base OTs of an earlier session with the evaluator if both
+  // have a cache, see BaseOtCache. cache may be null, the entry for the next
+  // session is to be committed once this one finished.
+  BaseOtCache::Pending performBaseOTs(BaseOtCache *cache,
+                                      size_t numBaseOTs = 128);
+  void performBaseOTs(size_t numBaseOTs = 128) {
+    performBaseOTs(nullptr, numBaseOTs);
+  }
 
   void doOTPhase(size_t numOTs);
 
@@ -95,7 +120,15 @@ class Evaluator : public GCEnv {
 
   virtual WireLabel NOT(const WireLabel &a);
 
-  void performBaseOTs(size_t numBaseOTs = 128);
+  // resumes the base OTs of an earlier session with the garbler called peer
+  // if both have a cache, see BaseOtCache. cache may be null, the entry for
+  // the next session is to be committed once this one finished.
+  BaseOtCache::Pending performBaseOTs(BaseOtCache *cache,
+                                      const std::string &peer,
+                                      size_t numBaseOTs = 128);
+  void performBaseOTs(size_t numBaseOTs = 128) {
+    performBaseOTs(nullptr, "", numBaseOTs);
+  }
 
   void doOTPhase(const BitVector &choices);
 
@@ -106,6 +139,13 @@ class Evaluator : public GCEnv {
 
 // SIMD
 
+// one gate out = a & b of an AND layer, on rows of SIMDInputs labels
+struct ANDGate {
+  block *out;
+  const block *a;
+  const block *b;
+};
+
 class SIMDGCEnv {
  public:
   SIMDGCEnv(ChannelWrapper &chan, size_t numinputs)
@@ -115,16 +155,30 @@ class SIMDGCEnv {
         gid(0),
         numANDs(0),
         numXORs(0) {}
+  virtual ~SIMDGCEnv() = default;
 
-  virtual WireLabel XOR(const WireLabel &a, const WireLabel &b) = 0;
-  virtual SIMDWireLabel XOR(const SIMDWireLabel &a, const SIMDWireLabel &b) = 0;
-  virtual SIMDWireLabel XOR(const SIMDWireLabel &a, const WireLabel &b) = 0;
+  virtual WireLabel XOR(const WireLabel &a, const WireLabel &b);
+  SIMDWireLabel XOR(const SIMDWireLabel &a, const SIMDWireLabel &b);
+  SIMDWireLabel XOR(const SIMDWireLabel &a, const WireLabel &b);
 
-  virtual SIMDWireLabel AND(const SIMDWireLabel &a, const SIMDWireLabel &b) = 0;
+  SIMDWireLabel AND(const SIMDWireLabel &a, const SIMDWireLabel &b);
 
-  virtual SIMDWireLabel NOT(const SIMDWireLabel &a) = 0;
+  SIMDWireLabel NOT(const SIMDWireLabel &a);
   virtual WireLabel NOT(const WireLabel &a) = 0;
 
+  // In-place gates on rows of SIMDInputs labels, e.g. of a WireLabelMatrix.
+  // out may alias any of the inputs, none of them allocate.
+  virtual void XOR(block *out, const block *a, const block *b);
+  virtual void XOR(block *out, const block *a, const WireLabel &b);
+  void AND(block *out, const block *a, const block *b);
+  virtual void NOT(block *out, const block *a) = 0;
+
+  // Garbles/evaluates a layer of AND gates with one AES pass per lane tile
+  // for all their hashes and sends/receives their tables at once. No gate may
+  // read the output of another one of the same layer, the tables are in gate
+  // order, so the result is the same as calling AND for each gate.
+  virtual void ANDLayer(span<const ANDGate> gates) = 0;
+
   virtual void PRINT(const char *info,
                      const std::vector<SIMDWireLabel> &vec) = 0;
   virtual void PRINT(const char *info, const std::vector<WireLabel> &vec) = 0;
@@ -135,11 +189,27 @@ class SIMDGCEnv {
   uint64_t SIMDInputs;
 
  protected:
+  friend class GateList;
+
   ChannelWrapper &channel;
   Hasher gb;
   uint64_t gid;
   uint64_t numANDs;
   uint64_t numXORs;
+
+  // lanes hashed per AES pass in a layer, bounds the hash buffers to a few
+  // hundred KiB for wide layers while each pass interleaves all their gates
+  static constexpr size_t layerTile = 256;
+
+  // grows the per layer buffers for numGates gates, they are kept between
+  // layers so only the largest layer allocates
+  void reserveLayer(size_t numGates, size_t hashesPerGate);
+
+  // tweaked hash inputs and their hashes for one lane tile, and the garbled
+  // tables TG, TE of each gate in the order they are sent
+  std::vector<block> hashIn;
+  std::vector<block> hashOut;
+  std::vector<block> tables;
 };
 
 class SIMDGarbler : public SIMDGCEnv {
@@ -154,23 +224,33 @@ class SIMDGarbler : public SIMDGCEnv {
 
   virtual void outputToBob(const std::vector<SIMDWireLabel> &outputLabels);
 
-  virtual WireLabel XOR(const WireLabel &a, const WireLabel &b);
-  virtual SIMDWireLabel XOR(const SIMDWireLabel &a, const SIMDWireLabel &b);
-  virtual SIMDWireLabel XOR(const SIMDWireLabel &a, const WireLabel &b);
-
-  virtual SIMDWireLabel AND(const SIMDWireLabel &a, const SIMDWireLabel &b);
-
-  virtual SIMDWireLabel NOT(const SIMDWireLabel &a);
-  virtual WireLabel NOT(const WireLabel &a);
+  using SIMDGCEnv::NOT;
+  void ANDLayer(span<const ANDGate> gates) override;
+  void NOT(block *out, const block *a) override;
+  WireLabel NOT(const WireLabel &a) override;
 
   virtual void PRINT(const char *info, const std::vector<SIMDWireLabel> &vec);
   virtual void PRINT(const char *info, const std::vector<WireLabel> &vec);
 
-  void performBaseOTs(size_t numBaseOTs = 128);
-
-  virtual void doOTPhase(size_t numOTs);
+  // resumes the base OTs of an earlier session with the evaluator if both
+  // have a cache, see BaseOtCache. cache may be null, the entry for the next
+  // session is to be committed once this one finished. Its threads() are the
+  // threads the OT phase may use, at most numThreads.
+  BaseOtCache::Pending performBaseOTs(BaseOtCache *cache,
+                                      size_t numBaseOTs = 128,
+                                      size_t numThreads = 1);
+  void performBaseOTs(size_t numBaseOTs = 128) {
+    performBaseOTs(nullptr, numBaseOTs);
+  }
+
+  // extends the OTs on numThreads threads, which both ends have to agree on,
+  // see otExtSendParallel
+  virtual void doOTPhase(size_t numOTs, size_t numThreads = 1);
 
  protected:
+  // garbles the layer, leaving the tables to send in tables
+  void garbleANDLayer(span<const ANDGate> gates);
+
   SecureRandom rnd;
 
   WireLabel R;
@@ -179,6 +259,7 @@ class SIMDGarbler : public SIMDGCEnv {
 #else
   KosOtExtSender OTeSender;
 #endif
+  // filled by doOTPhase for the phases, inputOfBob streams its OTs instead
   std::vector<std::array<block, 2>> OTs;
 };
 
@@ -196,28 +277,38 @@ class SIMDEvaluator : public SIMDGCEnv {
   virtual std::vector<BitVector> outputToBob(
       const std::vector<SIMDWireLabel> &outputLabels);
 
-  virtual WireLabel XOR(const WireLabel &a, const WireLabel &b);
-  virtual SIMDWireLabel XOR(const SIMDWireLabel &a, const SIMDWireLabel &b);
-  virtual SIMDWireLabel XOR(const SIMDWireLabel &a, const WireLabel &b);
-
-  virtual SIMDWireLabel AND(const SIMDWireLabel &a, const SIMDWireLabel &b);
-
-  virtual SIMDWireLabel NOT(const SIMDWireLabel &a);
-  virtual WireLabel NOT(const WireLabel &a);
+  using SIMDGCEnv::NOT;
+  void ANDLayer(span<const ANDGate> gates) override;
+  void NOT(block *out, const block *a) override;
+  WireLabel NOT(const WireLabel &a) override;
 
   virtual void PRINT(const char *info, const std::vector<SIMDWireLabel> &vec);
   virtual void PRINT(const char *info, const std::vector<WireLabel> &vec);
 
-  void performBaseOTs(size_t numBaseOTs = 128);
+  // resumes the base OTs of an earlier session with the garbler called peer
+  // if both have a cache, see BaseOtCache. cache may be null, the entry for
+  // the next session is to be committed once this one finished. Its
+  // threads() are the threads the OT phase may use, at most numThreads.
+  BaseOtCache::Pending performBaseOTs(BaseOtCache *cache,
+                                      const std::string &peer,
+                                      size_t numBaseOTs = 128,
+                                      size_t numThreads = 1);
+  void performBaseOTs(size_t numBaseOTs = 128) {
+    performBaseOTs(nullptr, "", numBaseOTs);
+  }
 
-  virtual void doOTPhase(const BitVector &choices);
+  virtual void doOTPhase(const BitVector &choices, size_t numThreads = 1);
 
  protected:
+  // evaluates the layer with its received tables in tables
+  void evaluateANDLayer(span<const ANDGate> gates);
+
 #ifdef USE_DOTE
   KosDotExtReceiver OTeRecv;
 #else
   KosOtExtReceiver OTeRecv;
 #endif
+  // filled by doOTPhase for the phases, inputOfBob streams its OTs instead
   std::vector<block> OTs;
 };
 
@@ -233,14 +324,37 @@ class SIMDGarblerPhases : public SIMDGarbler {
 
   void inputOfBobOnline();
 
+  // for a GC garbled ahead of time: the labels inputOfBobOffline returned
+  // when it was garbled, which inputOfBobOnline masks with this session's OTs
+  void setBobInputLabels(std::vector<SIMDWireLabel> labels) {
+    bobInputLabels = std::move(labels);
+  }
+
   void outputToBob(const std::vector<SIMDWireLabel> &outputLabels);
 
-  virtual SIMDWireLabel AND(const SIMDWireLabel &a, const SIMDWireLabel &b);
+  void ANDLayer(span<const ANDGate> gates) override;
+
+  // computes outputs = compute(inputB, env, worker) for a function that only
+  // writes AND tables, on numThreads workers that each garble a range of the
+  // lanes with this R and the same gate ids. Their tables are merged into
+  // bufChan in the order this garbler would have written them, so the
+  // evaluator sees no difference. Returns the output labels of all lanes.
+  using LaneFunction = std::function<std::vector<SIMDWireLabel>(
+      const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env,
+      size_t worker)>;
+  std::vector<SIMDWireLabel> garbleParallel(
+      const std::vector<SIMDWireLabel> &inputB, size_t numThreads,
+      const LaneFunction &compute);
+
+  // sends all full chunks of bufChan over the channel, if last is set also the
+  // remainder followed by an empty chunk. Returns the GC bytes sent so far.
+  uint64_t flushGC(bool last = false);
 
   BufferChannel bufChan;
 
  private:
   std::vector<SIMDWireLabel> bobInputLabels;
+  uint64_t gcBytesSent = 0;
 };
 
 class SIMDEvaluatorPhases : public SIMDEvaluator {
@@ -257,8 +371,36 @@ class SIMDEvaluatorPhases : public SIMDEvaluator {
   std::vector<BitVector> outputToBob(
       const std::vector<SIMDWireLabel> &outputLabels);
 
-  virtual SIMDWireLabel AND(const SIMDWireLabel &a, const SIMDWireLabel &b);
+  void ANDLayer(span<const ANDGate> gates) override;
+
+  // evaluates outputs = compute(inputB, env, worker) on numThreads workers
+  // that each take a range of the lanes and read their part of the tables
+  // from bufChan, the counterpart of SIMDGarblerPhases::garbleParallel.
+  // Returns the output labels of all lanes.
+  std::vector<SIMDWireLabel> evaluateParallel(
+      const std::vector<SIMDWireLabel> &inputB, size_t numThreads,
+      const SIMDGarblerPhases::LaneFunction &compute);
+
+  // receives the chunked GC stream written by SIMDGarblerPhases::flushGC into
+  // bufChan. Returns the number of GC bytes received.
+  uint64_t recvGC();
+
+  // receives chunks of the GC stream until bufChan holds length bytes. Reads
+  // of bufChan call it, so without recvGC the circuit is evaluated while
+  // the rest of the GC is still arriving, with only a chunk or so buffered.
+  void pullGC(size_t length);
+
+  // largest amount of GC bytes that were buffered at once
+  size_t getMaxBuffered() const { return maxBuffered; }
 
   BufferChannel bufChan;
+
+ private:
+  // reads one chunk of the GC stream, returns false at its end
+  bool recvGCChunk();
+
+  uint64_t gcBytesRecv = 0;
+  size_t maxBuffered = 0;
+  bool gcDone = false;
 };
 }
\ No newline at end of file
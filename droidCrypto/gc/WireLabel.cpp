@@ -1,5 +1,9 @@
 #include <droidCrypto/gc/WireLabel.h>
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <utility>
 
 namespace droidCrypto {
 
@@ -37,15 +41,6 @@ namespace droidCrypto {
         return WireLabel(ZeroBlock);
     }
 
-    SIMDWireLabel::SIMDWireLabel(const SIMDWireLabel& other) {
-        bytes = other.bytes;
-    }
-
-    SIMDWireLabel& SIMDWireLabel::operator=(const SIMDWireLabel& other) {
-        bytes = other.bytes;
-        return *this;
-    }
-
     SIMDWireLabel SIMDWireLabel::operator^(const SIMDWireLabel& other) const {
         std::vector<block> b(other.bytes);
         for(size_t i = 0; i < b.size(); i++) {
@@ -62,6 +57,13 @@ namespace droidCrypto {
         return SIMDWireLabel(b);
     }
 
+    SIMDWireLabel& SIMDWireLabel::operator^=(const SIMDWireLabel& other) {
+        for(size_t i = 0; i < bytes.size(); i++) {
+            bytes[i] ^= other.bytes[i];
+        }
+        return *this;
+    }
+
     void SIMDWireLabel::send(ChannelWrapper& chan) const {
         chan.send(bytes);
     }
@@ -77,4 +79,85 @@ namespace droidCrypto {
         std::vector<block> tmp(numvals, ZeroBlock);
         return SIMDWireLabel(tmp);
     }
-}
\ No newline at end of file
+
+    // rows are padded to whole cache lines
+    constexpr size_t wireLabelAlignment = 64;
+    constexpr size_t blocksPerLine = wireLabelAlignment / sizeof(block);
+
+    WireLabelMatrix::WireLabelMatrix(size_t wires, size_t lanes) {
+        resize(wires, lanes);
+    }
+
+    WireLabelMatrix::~WireLabelMatrix() {
+        free(mData);
+    }
+
+    WireLabelMatrix::WireLabelMatrix(WireLabelMatrix&& other) noexcept
+        : mData(other.mData), mWires(other.mWires), mLanes(other.mLanes),
+          mStride(other.mStride), mCapacity(other.mCapacity) {
+        other.mData = nullptr;
+        other.mWires = other.mLanes = other.mStride = other.mCapacity = 0;
+    }
+
+    WireLabelMatrix& WireLabelMatrix::operator=(WireLabelMatrix&& other) noexcept {
+        std::swap(mData, other.mData);
+        std::swap(mWires, other.mWires);
+        std::swap(mLanes, other.mLanes);
+        std::swap(mStride, other.mStride);
+        std::swap(mCapacity, other.mCapacity);
+        return *this;
+    }
+
+    void WireLabelMatrix::resize(size_t wires, size_t lanes) {
+        size_t stride = (lanes + blocksPerLine - 1) / blocksPerLine * blocksPerLine;
+        size_t needed = wires * stride;
+        if(needed > mCapacity) {
+            void* data = nullptr;
+            if(posix_memalign(&data, wireLabelAlignment, needed * sizeof(block)) != 0)
+                throw std::bad_alloc();
+            free(mData);
+            mData = (block*) data;
+            mCapacity = needed;
+        }
+        mWires = wires;
+        mLanes = lanes;
+        mStride = stride;
+    }
+
+    void WireLabelMatrix::setZero(size_t wire) {
+        memset((*this)[wire], 0, mLanes * sizeof(block));
+    }
+
+    void WireLabelMatrix::copy(size_t wire, const block* src) {
+        block* dst = (*this)[wire];
+        if(dst != src)
+            memcpy(dst, src, mLanes * sizeof(block));
+    }
+
+    void WireLabelMatrix::set(size_t wire, const SIMDWireLabel& label) {
+        assert(label.bytes.size() == mLanes);
+        copy(wire, label.bytes.data());
+    }
+
+    SIMDWireLabel WireLabelMatrix::get(size_t wire) const {
+        const block* row = (*this)[wire];
+        return SIMDWireLabel(std::vector<block>(row, row + mLanes));
+    }
+
+    WireLabelMatrix WireLabelMatrix::fromLabels(const std::vector<SIMDWireLabel>& labels) {
+        WireLabelMatrix m(labels.size(), labels.empty() ? 0 : labels.front().bytes.size());
+        for(size_t i = 0; i < labels.size(); i++) {
+            m.set(i, labels[i]);
+        }
+        return m;
+    }
+
+    std::vector<SIMDWireLabel> WireLabelMatrix::toLabels() const {
+        std::vector<SIMDWireLabel> labels;
+        labels.reserve(mWires);
+        for(size_t i = 0; i < mWires; i++) {
+            labels.push_back(get(i));
+        }
+        return labels;
+    }
+}
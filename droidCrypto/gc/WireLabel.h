@@ -36,10 +36,7 @@ namespace droidCrypto {
 
         public:
             SIMDWireLabel() = default;
-            SIMDWireLabel(std::vector<block> b) : bytes(b) {}
-
-            SIMDWireLabel(const SIMDWireLabel& other);
-            SIMDWireLabel& operator=(const SIMDWireLabel& other);
+            SIMDWireLabel(std::vector<block> b) : bytes(std::move(b)) {}
 
             inline void setLSB() { for(size_t i = 0; i < bytes.size(); i++) { bytes[i][0] |= 1; } }
             inline void clrLSB() { for(size_t i = 0; i < bytes.size(); i++) { bytes[i][0] &= 0xfe; } }
@@ -52,6 +49,7 @@ namespace droidCrypto {
 
             SIMDWireLabel operator^(const SIMDWireLabel& other) const;
             SIMDWireLabel operator^(const WireLabel& other) const;
+            SIMDWireLabel& operator^=(const SIMDWireLabel& other);
 
             void send(ChannelWrapper& chan) const;
             static SIMDWireLabel recv(ChannelWrapper& chan, size_t numinputs);
@@ -60,4 +58,45 @@ namespace droidCrypto {
             static SIMDWireLabel getZEROLabel(uint64_t numvals);
 
     };
+
+    // Labels of many SIMD wires in one contiguous arena: wire w owns the
+    // lanes() blocks starting at (*this)[w], and every row starts on a 64 byte
+    // boundary. Gates work on these rows in place (see SIMDGCEnv), so circuits
+    // keep their whole state here and do not allocate per gate.
+    class WireLabelMatrix {
+
+        public:
+            WireLabelMatrix() = default;
+            WireLabelMatrix(size_t wires, size_t lanes);
+            ~WireLabelMatrix();
+
+            WireLabelMatrix(const WireLabelMatrix& other) = delete;
+            WireLabelMatrix& operator=(const WireLabelMatrix& other) = delete;
+            WireLabelMatrix(WireLabelMatrix&& other) noexcept;
+            WireLabelMatrix& operator=(WireLabelMatrix&& other) noexcept;
+
+            // only reallocates if the arena grows, contents are undefined after
+            void resize(size_t wires, size_t lanes);
+
+            inline block* operator[](size_t wire) { return mData + wire * mStride; }
+            inline const block* operator[](size_t wire) const { return mData + wire * mStride; }
+
+            inline size_t wires() const { return mWires; }
+            inline size_t lanes() const { return mLanes; }
+
+            void setZero(size_t wire);
+            void copy(size_t wire, const block* src);
+            void set(size_t wire, const SIMDWireLabel& label);
+            SIMDWireLabel get(size_t wire) const;
+
+            static WireLabelMatrix fromLabels(const std::vector<SIMDWireLabel>& labels);
+            std::vector<SIMDWireLabel> toLabels() const;
+
+        private:
+            block* mData = nullptr;
+            size_t mWires = 0;
+            size_t mLanes = 0;
+            size_t mStride = 0;
+            size_t mCapacity = 0;
+    };
 }
\ No newline at end of file
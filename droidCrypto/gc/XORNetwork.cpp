@@ -0,0 +1,237 @@
+#include <droidCrypto/gc/HalfGate.h>
+#include <droidCrypto/gc/XORNetwork.h>
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+constexpr uint32_t XORNetwork::none;
+
+namespace {
+// Paar's heuristic on rows [first, first + count), appends its merges and the
+// steps that compute it. Signals are the inputs and the merges, numbered
+// numInputs + index in merges.
+void paarGroup(size_t numInputs, const std::vector<std::vector<uint32_t>> &rows,
+               size_t first, size_t count,
+               std::vector<std::pair<uint32_t, uint32_t>> &merges,
+               std::vector<XORNetwork::Step> &steps, size_t &numNaiveXORs) {
+  const uint32_t mergeBase = numInputs + merges.size();
+  auto id = [&](uint32_t local) {
+    return local < numInputs ? local : mergeBase + (local - numInputs);
+  };
+
+  // the signals left in each row and the rows each signal occurs in, local
+  // signals are the inputs followed by the merges of this group
+  std::vector<std::vector<uint32_t>> row(count);
+  std::vector<std::vector<uint32_t>> rowsOf(numInputs);
+  for (size_t r = 0; r < count; r++) {
+    std::vector<uint32_t> &l = row[r];
+    for (uint32_t x : rows[first + r]) {
+      if (x >= numInputs)
+        throw std::runtime_error("XOR network input out of range");
+      auto it = std::find(l.begin(), l.end(), x);
+      if (it == l.end())
+        l.push_back(x);
+      else
+        l.erase(it);
+    }
+    for (uint32_t x : l) rowsOf[x].push_back(r);
+    if (!l.empty()) numNaiveXORs += l.size() - 1;
+  }
+
+  // every merge removes at least two signals from the rows, which bounds the
+  // number of signals
+  size_t ones = 0;
+  for (const std::vector<uint32_t> &l : row) ones += l.size();
+  const size_t maxSignals = numInputs + ones / 2 + 1;
+  // rows each pair of signals occurs in together
+  std::vector<uint16_t> pairs(maxSignals * maxSignals, 0);
+  auto pair = [&](uint32_t x, uint32_t y) -> uint16_t & {
+    return pairs[std::min(x, y) * maxSignals + std::max(x, y)];
+  };
+  // candidates by count, counts only ever grow for pairs with a new signal,
+  // which are pushed again. A popped entry that is still up to date is
+  // therefore a pair of most occurrences.
+  struct Candidate {
+    uint16_t count;
+    uint32_t x, y;
+    bool operator<(const Candidate &o) const {
+      if (count != o.count) return count < o.count;
+      if (x != o.x) return x > o.x;
+      return y > o.y;
+    }
+  };
+  std::priority_queue<Candidate> queue;
+  for (const std::vector<uint32_t> &l : row) {
+    for (size_t i = 0; i < l.size(); i++) {
+      for (size_t j = i + 1; j < l.size(); j++) pair(l[i], l[j])++;
+    }
+  }
+  for (uint32_t x = 0; x < numInputs; x++) {
+    for (uint32_t y = x + 1; y < numInputs; y++) {
+      if (pair(x, y) >= 2) queue.push({pair(x, y), x, y});
+    }
+  }
+
+  std::vector<uint32_t> common, touched;
+  while (!queue.empty()) {
+    Candidate c = queue.top();
+    queue.pop();
+    if (pair(c.x, c.y) != c.count) {
+      if (pair(c.x, c.y) >= 2) queue.push({pair(c.x, c.y), c.x, c.y});
+      continue;
+    }
+
+    const uint32_t a = c.x, b = c.y, m = rowsOf.size();
+    common.clear();
+    for (uint32_t r : rowsOf[a]) {
+      if (std::find(row[r].begin(), row[r].end(), b) != row[r].end())
+        common.push_back(r);
+    }
+    touched.clear();
+    for (uint32_t r : common) {
+      std::vector<uint32_t> &l = row[r];
+      l.erase(std::remove_if(l.begin(), l.end(),
+                             [&](uint32_t x) { return x == a || x == b; }),
+              l.end());
+      for (uint32_t x : l) {
+        pair(a, x)--;
+        pair(b, x)--;
+        if (pair(m, x)++ == 0) touched.push_back(x);
+      }
+      l.push_back(m);
+    }
+    pair(a, b) = 0;
+    auto notCommon = [&](uint32_t r) {
+      return std::find(common.begin(), common.end(), r) == common.end();
+    };
+    for (uint32_t x : {a, b}) {
+      std::vector<uint32_t> keep;
+      for (uint32_t r : rowsOf[x]) {
+        if (notCommon(r)) keep.push_back(r);
+      }
+      rowsOf[x].swap(keep);
+    }
+    rowsOf.push_back(common);
+    for (uint32_t x : touched) {
+      if (pair(m, x) >= 2) queue.push({pair(m, x), std::min(m, x), std::max(m, x)});
+    }
+    merges.push_back({id(a), id(b)});
+  }
+
+  // what is left of each row, in the order the signals were defined
+  std::vector<std::vector<uint32_t>> left(count);
+  for (size_t r = 0; r < count; r++) {
+    for (uint32_t x : row[r]) left[r].push_back(id(x));
+    std::sort(left[r].begin(), left[r].end());
+  }
+  // rows are written right after their last signal is defined
+  const size_t numMerges = merges.size() - (mergeBase - numInputs);
+  std::vector<std::vector<uint32_t>> rowsAfter(numMerges + 1);
+  for (size_t r = 0; r < count; r++) {
+    uint32_t last = left[r].empty() ? 0 : left[r].back();
+    rowsAfter[last < numInputs ? 0 : last - mergeBase + 1].push_back(r);
+  }
+  auto writeRows = [&](const std::vector<uint32_t> &ready) {
+    for (uint32_t r : ready) {
+      const std::vector<uint32_t> &l = left[r];
+      const uint32_t out = first + r;
+      if (l.empty()) {
+        steps.push_back({XORNetwork::OUT_ZERO, out, XORNetwork::none,
+                         XORNetwork::none});
+      } else {
+        steps.push_back({XORNetwork::OUT, out, l[0],
+                         l.size() > 1 ? l[1] : XORNetwork::none});
+        for (size_t k = 2; k < l.size(); k++)
+          steps.push_back({XORNetwork::OUT_XOR, out, l[k], XORNetwork::none});
+      }
+    }
+  };
+  writeRows(rowsAfter[0]);
+  for (size_t i = 0; i < numMerges; i++) {
+    const std::pair<uint32_t, uint32_t> &m = merges[mergeBase - numInputs + i];
+    steps.push_back(
+        {XORNetwork::TMP, (uint32_t)(mergeBase + i), m.first, m.second});
+    writeRows(rowsAfter[i + 1]);
+  }
+}
+}  // namespace
+
+XORNetwork XORNetwork::paar(size_t numInputs,
+                            const std::vector<std::vector<uint32_t>> &rows,
+                            size_t groupSize /*=0*/) {
+  XORNetwork net;
+  net.numInputs_ = numInputs;
+  net.numOutputs_ = rows.size();
+  if (groupSize == 0) groupSize = rows.size();
+
+  std::vector<std::pair<uint32_t, uint32_t>> merges;
+  std::vector<Step> steps;
+  for (size_t first = 0; first < rows.size(); first += groupSize) {
+    paarGroup(numInputs, rows, first,
+              std::min(groupSize, rows.size() - first), merges, steps,
+              net.numNaiveXORs_);
+  }
+
+  // temporaries get scratch rows that are handed out again once they die
+  std::vector<size_t> lastUse(numInputs + merges.size(), 0);
+  for (size_t k = 0; k < steps.size(); k++) {
+    if (steps[k].a != none) lastUse[steps[k].a] = k;
+    if (steps[k].b != none) lastUse[steps[k].b] = k;
+  }
+  std::vector<uint32_t> slotOf(numInputs + merges.size(), none);
+  std::vector<uint32_t> freeSlots;
+  auto operand = [&](uint32_t x, size_t k) {
+    if (x == none || x < numInputs) return x;
+    uint32_t slot = slotOf[x];
+    if (lastUse[x] == k) freeSlots.push_back(slot);
+    return (uint32_t)(numInputs + slot);
+  };
+  for (size_t k = 0; k < steps.size(); k++) {
+    Step s = steps[k];
+    s.a = operand(s.a, k);
+    s.b = operand(s.b, k);
+    if (s.op == TMP) {
+      if (freeSlots.empty()) {
+        slotOf[s.out] = net.numTemps_++;
+      } else {
+        slotOf[s.out] = freeSlots.back();
+        freeSlots.pop_back();
+      }
+      s.out = numInputs + slotOf[s.out];
+    }
+    if (s.op == TMP || s.op == OUT_XOR || (s.op == OUT && s.b != none))
+      net.numXORs_++;
+    net.steps_.push_back(s);
+  }
+  return net;
+}
+
+void XORNetwork::apply(const WireLabelMatrix &in, WireLabelMatrix &out,
+                       WireLabelMatrix &tmp, SIMDGCEnv &env) const {
+  tmp.resize(numTemps_, env.SIMDInputs);
+  auto row = [&](uint32_t x) -> const block * {
+    return x < numInputs_ ? in[x] : tmp[x - numInputs_];
+  };
+  for (const Step &s : steps_) {
+    switch (s.op) {
+      case TMP:
+        env.XOR(tmp[s.out - numInputs_], row(s.a), row(s.b));
+        break;
+      case OUT:
+        if (s.b == none)
+          out.copy(s.out, row(s.a));
+        else
+          env.XOR(out[s.out], row(s.a), row(s.b));
+        break;
+      case OUT_XOR:
+        env.XOR(out[s.out], out[s.out], row(s.a));
+        break;
+      case OUT_ZERO:
+        out.setZero(s.out);
+        break;
+    }
+  }
+}
+}  // namespace droidCrypto
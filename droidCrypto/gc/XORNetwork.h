@@ -0,0 +1,66 @@
+#pragma once
+
+#include <droidCrypto/Defines.h>
+#include <droidCrypto/gc/WireLabel.h>
+#include <cstdint>
+#include <vector>
+
+namespace droidCrypto {
+class SIMDGCEnv;
+
+// Straight-line XOR program for a linear map y = M x over GF(2), found with
+// Paar's greedy heuristic: the pair of signals that occurs together in most
+// rows of M is computed once and replaces both in those rows, until no pair
+// occurs twice. Each output is then the XOR of what is left in its row.
+// Outputs are written as soon as their last signal exists, so temporaries
+// die early and share a small number of scratch rows.
+class XORNetwork {
+ public:
+  enum Op : uint8_t {
+    TMP,      // temp out = a ^ b
+    OUT,      // output out = a, or a ^ b unless b is none
+    OUT_XOR,  // output out ^= a
+    OUT_ZERO  // output out = 0
+  };
+
+  // operands below numInputs() are inputs, the others scratch rows
+  struct Step {
+    Op op;
+    uint32_t out;
+    uint32_t a;
+    uint32_t b;
+  };
+
+  static constexpr uint32_t none = UINT32_MAX;
+
+  // rows[i] lists the inputs XORed into output i, an input listed twice
+  // cancels out. With a groupSize, terms are only shared within groups of
+  // that many consecutive outputs: fewer temporaries are alive at once at the
+  // cost of more XORs.
+  static XORNetwork paar(size_t numInputs,
+                         const std::vector<std::vector<uint32_t>> &rows,
+                         size_t groupSize = 0);
+
+  // writes the outputs to rows 0.. of out, inputs are rows 0.. of in. tmp
+  // is resized to numTemps() rows, in and out may not be the same matrix.
+  void apply(const WireLabelMatrix &in, WireLabelMatrix &out,
+             WireLabelMatrix &tmp, SIMDGCEnv &env) const;
+
+  const std::vector<Step> &steps() const { return steps_; }
+  size_t numInputs() const { return numInputs_; }
+  size_t numOutputs() const { return numOutputs_; }
+  size_t numTemps() const { return numTemps_; }
+  // XOR gates of the program, copies and zeros are free
+  size_t numXORs() const { return numXORs_; }
+  // XOR gates of computing every row on its own
+  size_t numNaiveXORs() const { return numNaiveXORs_; }
+
+ private:
+  std::vector<Step> steps_;
+  size_t numInputs_ = 0;
+  size_t numOutputs_ = 0;
+  size_t numTemps_ = 0;
+  size_t numXORs_ = 0;
+  size_t numNaiveXORs_ = 0;
+};
+}  // namespace droidCrypto
@@ -332,584 +332,276 @@ vector<WireLabel> AESCircuit::PutAESSBoxGate(vector<WireLabel> &input,
 }
 //------------------------------------------------------------------------------------------------------------------
 // SIMD
+// row of bit k of the state byte in column i and row j
+static inline size_t aesWire(uint32_t i, uint32_t j, uint32_t k) {
+  return ((i * AES_STATE_COLS) + j) * 8 + k;
+}
 
-std::vector<SIMDWireLabel> SIMDAESCircuit::computeFunction(
+std::vector<SIMDWireLabel> SIMDAESState::compute(
     const std::vector<WireLabel> &key, const std::vector<SIMDWireLabel> &pt,
     SIMDGCEnv &env) {
-  vector<vector<vector<SIMDWireLabel> > > state(
-      AES_STATE_COLS);  // the state is treated as a matrix
-  vector<vector<vector<SIMDWireLabel> > > state_temp(
-      AES_STATE_COLS);  // the state is treated as a matrix
-  vector<SIMDWireLabel> outputs(128);
-  uint32_t round, i, j, k;
+  uint32_t round, i, j;
 
-  for (i = 0; i < AES_STATE_COLS; i++) {
-    state[i].resize(AES_STATE_ROWS);
-    state_temp[i].resize(AES_STATE_ROWS);
+  // all buffers keep their memory between calls, only the first one allocates
+  mState.resize(AES_BYTES * 8, env.SIMDInputs);
+  mStateTemp.resize(AES_BYTES * 8, env.SIMDInputs);
+  mScratch.resize(sboxWires + mixColumnWires, env.SIMDInputs);
 
-    for (j = 0; j < AES_STATE_ROWS; j++) {
-      state[i][j].resize(8);
-      state_temp[i][j].resize(8);
-
-      for (k = 0; k < 8; k++) {
-        state[i][j][k] = pt[((i * AES_STATE_COLS) + j) * 8 + k];
-      }
-    }
+  for (i = 0; i < AES_BYTES * 8; i++) {
+    mState.set(i, pt[i]);
   }
 
   for (round = 0; round < AES_ROUNDS; round++) {
     for (i = 0; i < AES_STATE_COLS; i++) {
       for (j = 0; j < AES_STATE_ROWS; j++) {
-        state[i][j] = AddAESRoundKey(
-            state[i][j], key,
+        AddAESRoundKey(
+            aesWire(i, j, 0), key,
             (round * AES_STATE_SIZE + (i * AES_STATE_COLS) + j) * 8,
             env);  // ARK
-        state_temp[(i - j) & 0x3][j] = PutAESSBoxGate(state[i][j], env);
+        PutAESSBoxGate(aesWire(i, j, 0), aesWire((i - j) & 0x3, j, 0), env);
       }
     }
 
-    for (i = 0; i < AES_STATE_COLS; i++) {
-      if (round < 9)
-        state[i] = PutAESMixColumnGate(state_temp[i], env);  // MixColumns
-      else
-        state = state_temp;
+    if (round < 9) {
+      for (i = 0; i < AES_STATE_COLS; i++)
+        PutAESMixColumnGate(i, env);  // MixColumns
+    } else {
+      std::swap(mState, mStateTemp);
     }
   }
 
+  std::vector<SIMDWireLabel> outputs(AES_BYTES * 8);
   for (i = 0; i < AES_STATE_COLS; i++) {
     for (j = 0; j < AES_STATE_ROWS; j++) {
-      state[i][j] = AddAESRoundKey(
-          state[i][j], key,
+      AddAESRoundKey(
+          aesWire(i, j, 0), key,
           (AES_ROUNDS * AES_STATE_SIZE + (i * AES_STATE_COLS) + j) * 8, env);
-      for (k = 0; k < 8; k++) {
-        outputs[(i * AES_STATE_ROWS + j) * 8 + k] = state[i][j][k];
-      }
     }
   }
+  for (i = 0; i < AES_BYTES * 8; i++) {
+    outputs[i] = mState.get(i);
+  }
   return outputs;
 }
 
-vector<SIMDWireLabel> SIMDAESCircuit::AddAESRoundKey(
-    const vector<SIMDWireLabel> &val, const vector<WireLabel> &key,
-    size_t keyaddr, SIMDGCEnv &env) {
-  vector<SIMDWireLabel> out(8);
+void SIMDAESState::AddAESRoundKey(size_t val, const vector<WireLabel> &key,
+                                  size_t keyaddr, SIMDGCEnv &env) {
   for (uint32_t i = 0; i < 8; i++) {
-    out[i] = env.XOR(val[i], key[keyaddr + i]);
+    env.XOR(mState[val + i], mState[val + i], key[keyaddr + i]);
   }
-  return out;
-}
-
-// Pretty straight - forward, shift by 1 to the left and if input_msb is 1, then
-// XOR with 0x1b
-vector<SIMDWireLabel> SIMDAESCircuit::Mul2(vector<SIMDWireLabel> &element,
-                                           SIMDGCEnv &env) {
-  vector<SIMDWireLabel> out(8);
-  out[0] = element[7];
-  out[1] = env.XOR(element[0], element[7]);
-  out[2] = element[1];
-  out[3] = env.XOR(element[2], element[7]);
-  out[4] = env.XOR(element[3], element[7]);
-  out[5] = element[4];
-  out[6] = element[5];
-  out[7] = element[6];
-  return out;
 }
 
-vector<vector<SIMDWireLabel> > SIMDAESCircuit::PutAESMixColumnGate(
-    vector<vector<SIMDWireLabel> > &rows, SIMDGCEnv &env) {
+// MixColumns of column col of mStateTemp into mState. Mul2 is a shift by 1 to
+// the left and if input_msb is 1, then XOR with 0x1b, so only 3 of its output
+// bits need a gate, the others just point to the input rows
+void SIMDAESState::PutAESMixColumnGate(uint32_t col, SIMDGCEnv &env) {
   uint32_t i, j;
-  SIMDWireLabel temp;
-  vector<vector<SIMDWireLabel> > out(4);
-  vector<vector<SIMDWireLabel> > temp_mul2(4);
-
-  assert(rows.size() == 4);
+  const block *rows[4][8];
+  const block *mul2[4][8];
 
   for (j = 0; j < 4; j++) {
-    out[j].resize(8);
-    temp_mul2[j].resize(8);
-    temp_mul2[j] = Mul2(rows[j], env);
+    for (i = 0; i < 8; i++) rows[j][i] = mStateTemp[aesWire(col, j, i)];
+    block *t1 = mScratch[sboxWires + 3 * j + 0];
+    block *t3 = mScratch[sboxWires + 3 * j + 1];
+    block *t4 = mScratch[sboxWires + 3 * j + 2];
+    env.XOR(t1, rows[j][0], rows[j][7]);
+    env.XOR(t3, rows[j][2], rows[j][7]);
+    env.XOR(t4, rows[j][3], rows[j][7]);
+    mul2[j][0] = rows[j][7];
+    mul2[j][1] = t1;
+    mul2[j][2] = rows[j][1];
+    mul2[j][3] = t3;
+    mul2[j][4] = t4;
+    mul2[j][5] = rows[j][4];
+    mul2[j][6] = rows[j][5];
+    mul2[j][7] = rows[j][6];
   }
   for (j = 0; j < 4; j++) {
     for (i = 0; i < 8; i++) {
-      temp = env.XOR(temp_mul2[j][i], temp_mul2[(j + 1) % 4][i]);
-      temp = env.XOR(temp, rows[(j + 1) % 4][i]);
-      temp = env.XOR(temp, rows[(j + 2) % 4][i]);
-      out[j][i] = env.XOR(temp, rows[(j + 3) % 4][i]);
+      block *out = mState[aesWire(col, j, i)];
+      env.XOR(out, mul2[j][i], mul2[(j + 1) % 4][i]);
+      env.XOR(out, out, rows[(j + 1) % 4][i]);
+      env.XOR(out, out, rows[(j + 2) % 4][i]);
+      env.XOR(out, out, rows[(j + 3) % 4][i]);
     }
   }
-
-  return out;
 }
 
-// The Boyar-Peralta size optimized SBox circuit (32 AND gates, Depth 6)
-vector<SIMDWireLabel> SIMDAESCircuit::PutAESSBoxGate(
-    vector<SIMDWireLabel> &input, SIMDGCEnv &env) {
-  vector<SIMDWireLabel> x(8);
-  vector<SIMDWireLabel> y(22);
-  vector<SIMDWireLabel> t(68);
-  vector<SIMDWireLabel> s(8);
-  vector<SIMDWireLabel> z(18);
-  vector<SIMDWireLabel> out(8);
-
-  for (uint32_t i = 0; i < x.size(); i++) {
-    x[i] = input[7 - i];
+// The Boyar-Peralta size optimized SBox circuit (32 AND gates, Depth 6), from
+// the byte at row in of mState to the byte at row out of mStateTemp. The ANDs
+// of each depth go to the environment as one layer, their order is unchanged
+void SIMDAESState::PutAESSBoxGate(size_t in, size_t out, SIMDGCEnv &env) {
+  const block *x[8];
+  block *y[22];
+  block *t[68];
+  block *s[8];
+  block *z[18];
+  uint32_t i;
+
+  for (i = 0; i < 8; i++) {
+    x[i] = mState[in + 7 - i];
+    s[i] = mStateTemp[out + 7 - i];
   }
+  for (i = 0; i < 22; i++) y[i] = mScratch[i];
+  for (i = 0; i < 68; i++) t[i] = mScratch[22 + i];
+  for (i = 0; i < 18; i++) z[i] = mScratch[22 + 68 + i];
 
   // Top linear transform
-  y[14] = env.XOR(x[3], x[5]);
-  y[13] = env.XOR(x[0], x[6]);
-  y[9] = env.XOR(x[0], x[3]);
+  env.XOR(y[14], x[3], x[5]);
+  env.XOR(y[13], x[0], x[6]);
+  env.XOR(y[9], x[0], x[3]);
 
-  y[8] = env.XOR(x[0], x[5]);
-  t[0] = env.XOR(x[1], x[2]);
-  y[1] = env.XOR(t[0], x[7]);
+  env.XOR(y[8], x[0], x[5]);
+  env.XOR(t[0], x[1], x[2]);
+  env.XOR(y[1], t[0], x[7]);
 
-  y[4] = env.XOR(y[1], x[3]);
-  y[12] = env.XOR(y[13], y[14]);
-  y[2] = env.XOR(y[1], x[0]);
+  env.XOR(y[4], y[1], x[3]);
+  env.XOR(y[12], y[13], y[14]);
+  env.XOR(y[2], y[1], x[0]);
 
-  y[5] = env.XOR(y[1], x[6]);
-  y[3] = env.XOR(y[5], y[8]);
-  t[1] = env.XOR(x[4], y[12]);
+  env.XOR(y[5], y[1], x[6]);
+  env.XOR(y[3], y[5], y[8]);
+  env.XOR(t[1], x[4], y[12]);
 
-  y[15] = env.XOR(t[1], x[5]);
-  y[20] = env.XOR(t[1], x[1]);
-  y[6] = env.XOR(y[15], x[7]);
+  env.XOR(y[15], t[1], x[5]);
+  env.XOR(y[20], t[1], x[1]);
+  env.XOR(y[6], y[15], x[7]);
 
-  y[10] = env.XOR(y[15], t[0]);
-  y[11] = env.XOR(y[20], y[9]);
-  y[7] = env.XOR(x[7], y[11]);
+  env.XOR(y[10], y[15], t[0]);
+  env.XOR(y[11], y[20], y[9]);
+  env.XOR(y[7], x[7], y[11]);
 
-  y[17] = env.XOR(y[10], y[11]);
-  y[19] = env.XOR(y[10], y[8]);
-  y[16] = env.XOR(t[0], y[11]);
+  env.XOR(y[17], y[10], y[11]);
+  env.XOR(y[19], y[10], y[8]);
+  env.XOR(y[16], t[0], y[11]);
 
-  y[21] = env.XOR(y[13], y[16]);
-  y[18] = env.XOR(x[0], y[16]);
+  env.XOR(y[21], y[13], y[16]);
+  env.XOR(y[18], x[0], y[16]);
 
   // Middle Non-Linear Transform, Box 1
-  t[2] = env.AND(y[12], y[15]);
-  t[3] = env.AND(y[3], y[6]);
-  t[4] = env.XOR(t[3], t[2]);
-
-  t[5] = env.AND(y[4], x[7]);
-  t[6] = env.XOR(t[5], t[2]);
-  t[7] = env.AND(y[13], y[16]);
-
-  t[8] = env.AND(y[5], y[1]);
-  t[9] = env.XOR(t[8], t[7]);
-  t[10] = env.AND(y[2], y[7]);
-
-  t[11] = env.XOR(t[10], t[7]);
-  t[12] = env.AND(y[9], y[11]);
-  t[13] = env.AND(y[14], y[17]);
-
-  t[14] = env.XOR(t[13], t[12]);
-  t[15] = env.AND(y[8], y[10]);
-  t[16] = env.XOR(t[15], t[12]);
-
-  t[17] = env.XOR(t[4], t[14]);
-  t[18] = env.XOR(t[6], t[16]);
-  t[19] = env.XOR(t[9], t[14]);
-
-  t[20] = env.XOR(t[11], t[16]);
-  t[21] = env.XOR(t[17], y[20]);
-  t[22] = env.XOR(t[18], y[19]);
-
-  t[23] = env.XOR(t[19], y[21]);
-  t[24] = env.XOR(t[20], y[18]);
+  const ANDGate box1[] = {
+      {t[2], y[12], y[15]}, {t[3], y[3], y[6]},   {t[5], y[4], x[7]},
+      {t[7], y[13], y[16]}, {t[8], y[5], y[1]},   {t[10], y[2], y[7]},
+      {t[12], y[9], y[11]}, {t[13], y[14], y[17]}, {t[15], y[8], y[10]}};
+  env.ANDLayer(box1);
+
+  env.XOR(t[4], t[3], t[2]);
+  env.XOR(t[6], t[5], t[2]);
+  env.XOR(t[9], t[8], t[7]);
+  env.XOR(t[11], t[10], t[7]);
+  env.XOR(t[14], t[13], t[12]);
+  env.XOR(t[16], t[15], t[12]);
+
+  env.XOR(t[17], t[4], t[14]);
+  env.XOR(t[18], t[6], t[16]);
+  env.XOR(t[19], t[9], t[14]);
+
+  env.XOR(t[20], t[11], t[16]);
+  env.XOR(t[21], t[17], y[20]);
+  env.XOR(t[22], t[18], y[19]);
+
+  env.XOR(t[23], t[19], y[21]);
+  env.XOR(t[24], t[20], y[18]);
 
   // Middle Non-Linear Transform, Box 2
-  t[25] = env.XOR(t[21], t[22]);
-  t[26] = env.AND(t[21], t[23]);
-  t[27] = env.XOR(t[24], t[26]);
-
-  t[28] = env.AND(t[25], t[27]);
-  t[29] = env.XOR(t[28], t[22]);
-  t[30] = env.XOR(t[23], t[24]);
+  env.XOR(t[25], t[21], t[22]);
+  env.AND(t[26], t[21], t[23]);
+  env.XOR(t[27], t[24], t[26]);
 
-  t[31] = env.XOR(t[22], t[26]);
-  t[32] = env.AND(t[31], t[30]);
-  t[33] = env.XOR(t[32], t[24]);
+  env.XOR(t[30], t[23], t[24]);
+  env.XOR(t[31], t[22], t[26]);
+  const ANDGate box2[] = {{t[28], t[25], t[27]}, {t[32], t[31], t[30]}};
+  env.ANDLayer(box2);
+  env.XOR(t[29], t[28], t[22]);
+  env.XOR(t[33], t[32], t[24]);
 
-  t[34] = env.XOR(t[23], t[33]);
-  t[35] = env.XOR(t[27], t[33]);
-  t[36] = env.AND(t[24], t[35]);
+  env.XOR(t[34], t[23], t[33]);
+  env.XOR(t[35], t[27], t[33]);
+  env.AND(t[36], t[24], t[35]);
 
-  t[37] = env.XOR(t[36], t[34]);
-  t[38] = env.XOR(t[27], t[36]);
-  t[39] = env.AND(t[29], t[38]);
+  env.XOR(t[37], t[36], t[34]);
+  env.XOR(t[38], t[27], t[36]);
+  env.AND(t[39], t[29], t[38]);
 
-  t[40] = env.XOR(t[25], t[39]);
+  env.XOR(t[40], t[25], t[39]);
 
   // Middle Non-Linear Transform, Box 3
-  t[41] = env.XOR(t[40], t[37]);
-  t[42] = env.XOR(t[29], t[33]);
-  t[43] = env.XOR(t[29], t[40]);
-
-  t[44] = env.XOR(t[33], t[37]);
-  t[45] = env.XOR(t[42], t[41]);
-  z[0] = env.AND(t[44], y[15]);
-
-  z[1] = env.AND(t[37], y[6]);
-  z[2] = env.AND(t[33], x[7]);
-  z[3] = env.AND(t[43], y[16]);
-
-  z[4] = env.AND(t[40], y[1]);
-  z[5] = env.AND(t[29], y[7]);
-  z[6] = env.AND(t[42], y[11]);
-
-  z[7] = env.AND(t[45], y[17]);
-  z[8] = env.AND(t[41], y[10]);
-  z[9] = env.AND(t[44], y[12]);
-
-  z[10] = env.AND(t[37], y[3]);
-  z[11] = env.AND(t[33], y[4]);
-  z[12] = env.AND(t[43], y[13]);
-
-  z[13] = env.AND(t[40], y[5]);
-  z[14] = env.AND(t[29], y[2]);
-  z[15] = env.AND(t[42], y[9]);
-
-  z[16] = env.AND(t[45], y[14]);
-  z[17] = env.AND(t[41], y[8]);
+  env.XOR(t[41], t[40], t[37]);
+  env.XOR(t[42], t[29], t[33]);
+  env.XOR(t[43], t[29], t[40]);
+
+  env.XOR(t[44], t[33], t[37]);
+  env.XOR(t[45], t[42], t[41]);
+  const ANDGate box3[] = {
+      {z[0], t[44], y[15]},  {z[1], t[37], y[6]},   {z[2], t[33], x[7]},
+      {z[3], t[43], y[16]},  {z[4], t[40], y[1]},   {z[5], t[29], y[7]},
+      {z[6], t[42], y[11]},  {z[7], t[45], y[17]},  {z[8], t[41], y[10]},
+      {z[9], t[44], y[12]},  {z[10], t[37], y[3]},  {z[11], t[33], y[4]},
+      {z[12], t[43], y[13]}, {z[13], t[40], y[5]},  {z[14], t[29], y[2]},
+      {z[15], t[42], y[9]},  {z[16], t[45], y[14]}, {z[17], t[41], y[8]}};
+  env.ANDLayer(box3);
 
   // Bottom Non-Linear Transform
-  t[46] = env.XOR(z[15], z[16]);
-  t[47] = env.XOR(z[10], z[11]);
-  t[48] = env.XOR(z[5], z[13]);
-
-  t[49] = env.XOR(z[9], z[10]);
-  t[50] = env.XOR(z[2], z[12]);
-  t[51] = env.XOR(z[2], z[5]);
-
-  t[52] = env.XOR(z[7], z[8]);
-  t[53] = env.XOR(z[0], z[3]);
-  t[54] = env.XOR(z[6], z[7]);
-
-  t[55] = env.XOR(z[16], z[17]);
-  t[56] = env.XOR(z[12], t[48]);
-  t[57] = env.XOR(t[50], t[53]);
-
-  t[58] = env.XOR(z[4], t[46]);
-  t[59] = env.XOR(z[3], t[54]);
-  t[60] = env.XOR(t[46], t[57]);
-
-  t[61] = env.XOR(z[14], t[57]);
-  t[62] = env.XOR(t[52], t[58]);
-  t[63] = env.XOR(t[49], t[58]);
-
-  t[64] = env.XOR(z[4], t[59]);
-  t[65] = env.XOR(t[61], t[62]);
-  t[66] = env.XOR(z[1], t[63]);
-
-  s[0] = env.XOR(t[59], t[63]);
-  s[6] = env.XOR(t[56], env.NOT(t[62]));
-  s[7] = env.XOR(t[48], env.NOT(t[60]));
-
-  t[67] = env.XOR(t[64], t[65]);
-  s[3] = env.XOR(t[53], t[66]);
-  s[4] = env.XOR(t[51], t[66]);
-
-  s[5] = env.XOR(t[47], t[65]);
-  s[1] = env.XOR(t[64], env.NOT(s[3]));
-  s[2] = env.XOR(t[55], env.NOT(t[67]));
-
-  for (uint32_t i = 0; i < out.size(); i++) {
-    out[i] = s[7 - i];
-  }
-
-  return out;
+  env.XOR(t[46], z[15], z[16]);
+  env.XOR(t[47], z[10], z[11]);
+  env.XOR(t[48], z[5], z[13]);
+
+  env.XOR(t[49], z[9], z[10]);
+  env.XOR(t[50], z[2], z[12]);
+  env.XOR(t[51], z[2], z[5]);
+
+  env.XOR(t[52], z[7], z[8]);
+  env.XOR(t[53], z[0], z[3]);
+  env.XOR(t[54], z[6], z[7]);
+
+  env.XOR(t[55], z[16], z[17]);
+  env.XOR(t[56], z[12], t[48]);
+  env.XOR(t[57], t[50], t[53]);
+
+  env.XOR(t[58], z[4], t[46]);
+  env.XOR(t[59], z[3], t[54]);
+  env.XOR(t[60], t[46], t[57]);
+
+  env.XOR(t[61], z[14], t[57]);
+  env.XOR(t[62], t[52], t[58]);
+  env.XOR(t[63], t[49], t[58]);
+
+  env.XOR(t[64], z[4], t[59]);
+  env.XOR(t[65], t[61], t[62]);
+  env.XOR(t[66], z[1], t[63]);
+
+  env.XOR(s[0], t[59], t[63]);
+  env.NOT(s[6], t[62]);
+  env.XOR(s[6], t[56], s[6]);
+  env.NOT(s[7], t[60]);
+  env.XOR(s[7], t[48], s[7]);
+
+  env.XOR(t[67], t[64], t[65]);
+  env.XOR(s[3], t[53], t[66]);
+  env.XOR(s[4], t[51], t[66]);
+
+  env.XOR(s[5], t[47], t[65]);
+  env.NOT(s[1], s[3]);
+  env.XOR(s[1], t[64], s[1]);
+  env.NOT(s[2], t[67]);
+  env.XOR(s[2], t[55], s[2]);
 }
 
-// Phased Circuit
-std::vector<SIMDWireLabel> SIMDAESCircuitPhases::computeFunction(
+std::vector<SIMDWireLabel> SIMDAESCircuit::computeFunction(
     const std::vector<WireLabel> &key, const std::vector<SIMDWireLabel> &pt,
     SIMDGCEnv &env) {
-  vector<vector<vector<SIMDWireLabel> > > state(
-      AES_STATE_COLS);  // the state is treated as a matrix
-  vector<vector<vector<SIMDWireLabel> > > state_temp(
-      AES_STATE_COLS);  // the state is treated as a matrix
-  vector<SIMDWireLabel> outputs(128);
-  uint32_t round, i, j, k;
-
-  for (i = 0; i < AES_STATE_COLS; i++) {
-    state[i].resize(AES_STATE_ROWS);
-    state_temp[i].resize(AES_STATE_ROWS);
-
-    for (j = 0; j < AES_STATE_ROWS; j++) {
-      state[i][j].resize(8);
-      state_temp[i][j].resize(8);
-
-      for (k = 0; k < 8; k++) {
-        state[i][j][k] = pt[((i * AES_STATE_COLS) + j) * 8 + k];
-      }
-    }
-  }
-
-  for (round = 0; round < AES_ROUNDS; round++) {
-    for (i = 0; i < AES_STATE_COLS; i++) {
-      for (j = 0; j < AES_STATE_ROWS; j++) {
-        state[i][j] = AddAESRoundKey(
-            state[i][j], key,
-            (round * AES_STATE_SIZE + (i * AES_STATE_COLS) + j) * 8,
-            env);  // ARK
-        state_temp[(i - j) & 0x3][j] = PutAESSBoxGate(state[i][j], env);
-      }
-    }
-
-    for (i = 0; i < AES_STATE_COLS; i++) {
-      if (round < 9)
-        state[i] = PutAESMixColumnGate(state_temp[i], env);  // MixColumns
-      else
-        state = state_temp;
-    }
-  }
-
-  for (i = 0; i < AES_STATE_COLS; i++) {
-    for (j = 0; j < AES_STATE_ROWS; j++) {
-      state[i][j] = AddAESRoundKey(
-          state[i][j], key,
-          (AES_ROUNDS * AES_STATE_SIZE + (i * AES_STATE_COLS) + j) * 8, env);
-      for (k = 0; k < 8; k++) {
-        outputs[(i * AES_STATE_ROWS + j) * 8 + k] = state[i][j][k];
-      }
-    }
-  }
-  return outputs;
+  return mAES.compute(key, pt, env);
 }
 
-vector<SIMDWireLabel> SIMDAESCircuitPhases::AddAESRoundKey(
-    const vector<SIMDWireLabel> &val, const vector<WireLabel> &key,
-    size_t keyaddr, SIMDGCEnv &env) {
-  vector<SIMDWireLabel> out(8);
-  for (uint32_t i = 0; i < 8; i++) {
-    out[i] = env.XOR(val[i], key[keyaddr + i]);
-  }
-  return out;
-}
-
-// Pretty straight - forward, shift by 1 to the left and if input_msb is 1, then
-// XOR with 0x1b
-vector<SIMDWireLabel> SIMDAESCircuitPhases::Mul2(vector<SIMDWireLabel> &element,
-                                                 SIMDGCEnv &env) {
-  vector<SIMDWireLabel> out(8);
-  out[0] = element[7];
-  out[1] = env.XOR(element[0], element[7]);
-  out[2] = element[1];
-  out[3] = env.XOR(element[2], element[7]);
-  out[4] = env.XOR(element[3], element[7]);
-  out[5] = element[4];
-  out[6] = element[5];
-  out[7] = element[6];
-  return out;
-}
-
-vector<vector<SIMDWireLabel> > SIMDAESCircuitPhases::PutAESMixColumnGate(
-    vector<vector<SIMDWireLabel> > &rows, SIMDGCEnv &env) {
-  uint32_t i, j;
-  SIMDWireLabel temp;
-  vector<vector<SIMDWireLabel> > out(4);
-  vector<vector<SIMDWireLabel> > temp_mul2(4);
-
-  assert(rows.size() == 4);
-
-  for (j = 0; j < 4; j++) {
-    out[j].resize(8);
-    temp_mul2[j].resize(8);
-    temp_mul2[j] = Mul2(rows[j], env);
-  }
-  for (j = 0; j < 4; j++) {
-    for (i = 0; i < 8; i++) {
-      temp = env.XOR(temp_mul2[j][i], temp_mul2[(j + 1) % 4][i]);
-      temp = env.XOR(temp, rows[(j + 1) % 4][i]);
-      temp = env.XOR(temp, rows[(j + 2) % 4][i]);
-      out[j][i] = env.XOR(temp, rows[(j + 3) % 4][i]);
-    }
-  }
-
-  return out;
+// Phased Circuit
+void SIMDAESCircuitPhases::reserveWorkers(size_t numWorkers) {
+  while (mAES.size() < numWorkers) mAES.emplace_back(new SIMDAESState());
 }
 
-// The Boyar-Peralta size optimized SBox circuit (32 AND gates, Depth 6)
-vector<SIMDWireLabel> SIMDAESCircuitPhases::PutAESSBoxGate(
-    vector<SIMDWireLabel> &input, SIMDGCEnv &env) {
-  vector<SIMDWireLabel> x(8);
-  vector<SIMDWireLabel> y(22);
-  vector<SIMDWireLabel> t(68);
-  vector<SIMDWireLabel> s(8);
-  vector<SIMDWireLabel> z(18);
-  vector<SIMDWireLabel> out(8);
-
-  for (uint32_t i = 0; i < x.size(); i++) {
-    x[i] = input[7 - i];
-  }
-
-  // Top linear transform
-  y[14] = env.XOR(x[3], x[5]);
-  y[13] = env.XOR(x[0], x[6]);
-  y[9] = env.XOR(x[0], x[3]);
-
-  y[8] = env.XOR(x[0], x[5]);
-  t[0] = env.XOR(x[1], x[2]);
-  y[1] = env.XOR(t[0], x[7]);
-
-  y[4] = env.XOR(y[1], x[3]);
-  y[12] = env.XOR(y[13], y[14]);
-  y[2] = env.XOR(y[1], x[0]);
-
-  y[5] = env.XOR(y[1], x[6]);
-  y[3] = env.XOR(y[5], y[8]);
-  t[1] = env.XOR(x[4], y[12]);
-
-  y[15] = env.XOR(t[1], x[5]);
-  y[20] = env.XOR(t[1], x[1]);
-  y[6] = env.XOR(y[15], x[7]);
-
-  y[10] = env.XOR(y[15], t[0]);
-  y[11] = env.XOR(y[20], y[9]);
-  y[7] = env.XOR(x[7], y[11]);
-
-  y[17] = env.XOR(y[10], y[11]);
-  y[19] = env.XOR(y[10], y[8]);
-  y[16] = env.XOR(t[0], y[11]);
-
-  y[21] = env.XOR(y[13], y[16]);
-  y[18] = env.XOR(x[0], y[16]);
-
-  // Middle Non-Linear Transform, Box 1
-  t[2] = env.AND(y[12], y[15]);
-  t[3] = env.AND(y[3], y[6]);
-  t[4] = env.XOR(t[3], t[2]);
-
-  t[5] = env.AND(y[4], x[7]);
-  t[6] = env.XOR(t[5], t[2]);
-  t[7] = env.AND(y[13], y[16]);
-
-  t[8] = env.AND(y[5], y[1]);
-  t[9] = env.XOR(t[8], t[7]);
-  t[10] = env.AND(y[2], y[7]);
-
-  t[11] = env.XOR(t[10], t[7]);
-  t[12] = env.AND(y[9], y[11]);
-  t[13] = env.AND(y[14], y[17]);
-
-  t[14] = env.XOR(t[13], t[12]);
-  t[15] = env.AND(y[8], y[10]);
-  t[16] = env.XOR(t[15], t[12]);
-
-  t[17] = env.XOR(t[4], t[14]);
-  t[18] = env.XOR(t[6], t[16]);
-  t[19] = env.XOR(t[9], t[14]);
-
-  t[20] = env.XOR(t[11], t[16]);
-  t[21] = env.XOR(t[17], y[20]);
-  t[22] = env.XOR(t[18], y[19]);
-
-  t[23] = env.XOR(t[19], y[21]);
-  t[24] = env.XOR(t[20], y[18]);
-
-  // Middle Non-Linear Transform, Box 2
-  t[25] = env.XOR(t[21], t[22]);
-  t[26] = env.AND(t[21], t[23]);
-  t[27] = env.XOR(t[24], t[26]);
-
-  t[28] = env.AND(t[25], t[27]);
-  t[29] = env.XOR(t[28], t[22]);
-  t[30] = env.XOR(t[23], t[24]);
-
-  t[31] = env.XOR(t[22], t[26]);
-  t[32] = env.AND(t[31], t[30]);
-  t[33] = env.XOR(t[32], t[24]);
-
-  t[34] = env.XOR(t[23], t[33]);
-  t[35] = env.XOR(t[27], t[33]);
-  t[36] = env.AND(t[24], t[35]);
-
-  t[37] = env.XOR(t[36], t[34]);
-  t[38] = env.XOR(t[27], t[36]);
-  t[39] = env.AND(t[29], t[38]);
-
-  t[40] = env.XOR(t[25], t[39]);
-
-  // Middle Non-Linear Transform, Box 3
-  t[41] = env.XOR(t[40], t[37]);
-  t[42] = env.XOR(t[29], t[33]);
-  t[43] = env.XOR(t[29], t[40]);
-
-  t[44] = env.XOR(t[33], t[37]);
-  t[45] = env.XOR(t[42], t[41]);
-  z[0] = env.AND(t[44], y[15]);
-
-  z[1] = env.AND(t[37], y[6]);
-  z[2] = env.AND(t[33], x[7]);
-  z[3] = env.AND(t[43], y[16]);
-
-  z[4] = env.AND(t[40], y[1]);
-  z[5] = env.AND(t[29], y[7]);
-  z[6] = env.AND(t[42], y[11]);
-
-  z[7] = env.AND(t[45], y[17]);
-  z[8] = env.AND(t[41], y[10]);
-  z[9] = env.AND(t[44], y[12]);
-
-  z[10] = env.AND(t[37], y[3]);
-  z[11] = env.AND(t[33], y[4]);
-  z[12] = env.AND(t[43], y[13]);
-
-  z[13] = env.AND(t[40], y[5]);
-  z[14] = env.AND(t[29], y[2]);
-  z[15] = env.AND(t[42], y[9]);
-
-  z[16] = env.AND(t[45], y[14]);
-  z[17] = env.AND(t[41], y[8]);
-
-  // Bottom Non-Linear Transform
-  t[46] = env.XOR(z[15], z[16]);
-  t[47] = env.XOR(z[10], z[11]);
-  t[48] = env.XOR(z[5], z[13]);
-
-  t[49] = env.XOR(z[9], z[10]);
-  t[50] = env.XOR(z[2], z[12]);
-  t[51] = env.XOR(z[2], z[5]);
-
-  t[52] = env.XOR(z[7], z[8]);
-  t[53] = env.XOR(z[0], z[3]);
-  t[54] = env.XOR(z[6], z[7]);
-
-  t[55] = env.XOR(z[16], z[17]);
-  t[56] = env.XOR(z[12], t[48]);
-  t[57] = env.XOR(t[50], t[53]);
-
-  t[58] = env.XOR(z[4], t[46]);
-  t[59] = env.XOR(z[3], t[54]);
-  t[60] = env.XOR(t[46], t[57]);
-
-  t[61] = env.XOR(z[14], t[57]);
-  t[62] = env.XOR(t[52], t[58]);
-  t[63] = env.XOR(t[49], t[58]);
-
-  t[64] = env.XOR(z[4], t[59]);
-  t[65] = env.XOR(t[61], t[62]);
-  t[66] = env.XOR(z[1], t[63]);
-
-  s[0] = env.XOR(t[59], t[63]);
-  s[6] = env.XOR(t[56], env.NOT(t[62]));
-  s[7] = env.XOR(t[48], env.NOT(t[60]));
-
-  t[67] = env.XOR(t[64], t[65]);
-  s[3] = env.XOR(t[53], t[66]);
-  s[4] = env.XOR(t[51], t[66]);
-
-  s[5] = env.XOR(t[47], t[65]);
-  s[1] = env.XOR(t[64], env.NOT(s[3]));
-  s[2] = env.XOR(t[55], env.NOT(t[67]));
-
-  for (uint32_t i = 0; i < out.size(); i++) {
-    out[i] = s[7 - i];
-  }
-
-  return out;
+std::vector<SIMDWireLabel> SIMDAESCircuitPhases::computeFunction(
+    const std::vector<WireLabel> &key, const std::vector<SIMDWireLabel> &pt,
+    SIMDGCEnv &env, size_t worker) {
+  return mAES[worker]->compute(key, pt, env);
 }
 }  // namespace droidCrypto
 
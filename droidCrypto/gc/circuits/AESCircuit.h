@@ -28,6 +28,27 @@ namespace droidCrypto {
 
     };
 
+    // AES on a WireLabelMatrix, shared by the SIMD circuits. The state and the
+    // gate temporaries are kept between calls, so after the first one the
+    // circuit runs without allocating per gate.
+    class SIMDAESState {
+        public:
+            std::vector<SIMDWireLabel> compute(const std::vector<WireLabel>& key, const std::vector<SIMDWireLabel>& pt, SIMDGCEnv& env);
+
+        private:
+            // temporaries y, t and z of the S-box, then 3 per row for Mul2
+            static constexpr size_t sboxWires = 22 + 68 + 18;
+            static constexpr size_t mixColumnWires = 4 * 3;
+
+            void AddAESRoundKey(size_t val, const std::vector<WireLabel>& key, size_t keyaddr, SIMDGCEnv& env);
+            void PutAESMixColumnGate(uint32_t col, SIMDGCEnv& env);
+            void PutAESSBoxGate(size_t in, size_t out, SIMDGCEnv& env);
+
+            WireLabelMatrix mState;
+            WireLabelMatrix mStateTemp;
+            WireLabelMatrix mScratch;
+    };
+
     class SIMDAESCircuit : public SIMDCircuit{
         public:
             SIMDAESCircuit(ChannelWrapper& chan) : SIMDCircuit(chan, 1408, 128, 128) {}
@@ -35,25 +56,21 @@ namespace droidCrypto {
         protected:
 
             std::vector<SIMDWireLabel> computeFunction(const std::vector<WireLabel>& inputA, const std::vector<SIMDWireLabel>& inputB, SIMDGCEnv& env) override;
-            std::vector<SIMDWireLabel> AddAESRoundKey(const std::vector<SIMDWireLabel>& val, const std::vector<WireLabel>& key, size_t keyaddr, SIMDGCEnv& env);
-            std::vector<SIMDWireLabel> Mul2(std::vector<SIMDWireLabel>& element, SIMDGCEnv& env);
-            std::vector<std::vector<SIMDWireLabel> > PutAESMixColumnGate(std::vector<std::vector<SIMDWireLabel> >& rows, SIMDGCEnv& env);
-            std::vector<SIMDWireLabel> PutAESSBoxGate(std::vector<SIMDWireLabel>& input, SIMDGCEnv& env);
 
+            SIMDAESState mAES;
     };
 
     class SIMDAESCircuitPhases : public SIMDCircuitPhases{
     public:
-        SIMDAESCircuitPhases(ChannelWrapper& chan) : SIMDCircuitPhases(chan, 1408, 128, 128) {}
+        SIMDAESCircuitPhases(ChannelWrapper& chan) : SIMDCircuitPhases(chan, 1408, 128, 128) { reserveWorkers(1); }
 
     protected:
 
-        std::vector<SIMDWireLabel> computeFunction(const std::vector<WireLabel>& inputA, const std::vector<SIMDWireLabel>& inputB, SIMDGCEnv& env) override;
-        std::vector<SIMDWireLabel> AddAESRoundKey(const std::vector<SIMDWireLabel>& val, const std::vector<WireLabel>& key, size_t keyaddr, SIMDGCEnv& env);
-        std::vector<SIMDWireLabel> Mul2(std::vector<SIMDWireLabel>& element, SIMDGCEnv& env);
-        std::vector<std::vector<SIMDWireLabel> > PutAESMixColumnGate(std::vector<std::vector<SIMDWireLabel> >& rows, SIMDGCEnv& env);
-        std::vector<SIMDWireLabel> PutAESSBoxGate(std::vector<SIMDWireLabel>& input, SIMDGCEnv& env);
+        void reserveWorkers(size_t numWorkers) override;
+        std::vector<SIMDWireLabel> computeFunction(const std::vector<WireLabel>& inputA, const std::vector<SIMDWireLabel>& inputB, SIMDGCEnv& env, size_t worker) override;
 
+        // one per worker
+        std::vector<std::unique_ptr<SIMDAESState>> mAES;
     };
 }
 
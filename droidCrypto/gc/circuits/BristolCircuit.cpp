@@ -0,0 +1,396 @@
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/SHAKE128.h>
+#include <droidCrypto/gc/HalfGate.h>
+#include <droidCrypto/gc/circuits/BristolCircuit.h>
+#include <droidCrypto/utils/Log.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+namespace {
+const uint32_t noWire = UINT32_MAX;
+
+size_t readCount(std::istream &in, const std::string &name) {
+  long long v;
+  if (!(in >> v) || v < 0 || v > UINT32_MAX)
+    throw std::runtime_error("malformed Bristol circuit: " + name);
+  return (size_t)v;
+}
+
+// the bit sizes of the input or output values, which cannot have more bits
+// than the circuit has wires
+std::vector<size_t> readSizes(std::istream &in, const std::string &name,
+                              size_t numWires) {
+  const size_t numValues = readCount(in, name);
+  if (numValues > numWires)
+    throw std::runtime_error("malformed Bristol circuit: " + name);
+  std::vector<size_t> sizes;
+  size_t total = 0;
+  for (size_t i = 0; i < numValues; i++) {
+    sizes.push_back(readCount(in, name));
+    total += sizes.back();
+    if (total > numWires)
+      throw std::runtime_error("malformed Bristol circuit: " + name);
+  }
+  return sizes;
+}
+
+size_t sum(const std::vector<size_t> &sizes) {
+  size_t s = 0;
+  for (size_t v : sizes) s += v;
+  return s;
+}
+}  // namespace
+
+BristolCircuit BristolCircuit::parse(std::istream &in,
+                                     const std::string &name) {
+  BristolCircuit c;
+  c.name_ = name;
+  // every wire but the inputs is written by exactly one gate, so the counts
+  // of the file are checked against the wires left to write, and memory only
+  // grows with the gates actually read
+  const size_t numGates = readCount(in, name);
+  c.numWires_ = readCount(in, name);
+  c.inputSizes_ = readSizes(in, name, c.numWires_);
+  c.outputSizes_ = readSizes(in, name, c.numWires_);
+  size_t unwritten = c.numWires_ - sum(c.inputSizes_);
+
+  std::vector<uint32_t> wires;
+  std::string op;
+  for (size_t k = 0; k < numGates; k++) {
+    const size_t numIn = readCount(in, name), numOut = readCount(in, name);
+    // no gate has more than two inputs per output
+    if (numOut == 0 || numOut > unwritten || numIn > 2 * numOut)
+      throw std::runtime_error("malformed Bristol circuit: " + name);
+    unwritten -= numOut;
+    wires.clear();
+    for (size_t j = 0; j < numIn + numOut; j++)
+      wires.push_back((uint32_t)readCount(in, name));
+    if (!(in >> op)) throw std::runtime_error("truncated Bristol circuit: " + name);
+    if (op == "MAND" && numIn == 2 * numOut) {
+      // a1..an b1..bn o1..on
+      for (size_t j = 0; j < numOut; j++)
+        c.gates_.push_back({AND, wires[numIn + j], wires[j], wires[numOut + j]});
+    } else if ((op == "XOR" || op == "AND") && numIn == 2 && numOut == 1) {
+      c.gates_.push_back({op == "XOR" ? XOR : AND, wires[2], wires[0], wires[1]});
+    } else if ((op == "INV" || op == "NOT" || op == "EQW") && numIn == 1 &&
+               numOut == 1) {
+      c.gates_.push_back({op == "EQW" ? EQW : INV, wires[1], wires[0], 0});
+    } else if (op == "EQ" && numIn == 1 && numOut == 1 && wires[0] <= 1) {
+      c.gates_.push_back({EQ, wires[1], wires[0], 0});
+    } else {
+      throw std::runtime_error("unsupported gate " + op + " in Bristol circuit " + name);
+    }
+  }
+  if (unwritten != 0)
+    throw std::runtime_error("Bristol circuit has wires no gate writes: " + name);
+  c.finish();
+  return c;
+}
+
+BristolCircuit BristolCircuit::load(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) throw std::runtime_error("cannot open Bristol circuit: " + path);
+  return parse(in, path.substr(path.find_last_of('/') + 1));
+}
+
+void BristolCircuit::write(std::ostream &out) const {
+  out << gates_.size() << " " << numWires_ << "\n" << inputSizes_.size();
+  for (size_t s : inputSizes_) out << " " << s;
+  out << "\n" << outputSizes_.size();
+  for (size_t s : outputSizes_) out << " " << s;
+  out << "\n\n";
+  for (const Gate &g : gates_) {
+    switch (g.op) {
+      case XOR:
+      case AND:
+        out << "2 1 " << g.a << " " << g.b << " " << g.out
+            << (g.op == XOR ? " XOR\n" : " AND\n");
+        break;
+      case INV:
+        out << "1 1 " << g.a << " " << g.out << " INV\n";
+        break;
+      case EQW:
+        out << "1 1 " << g.a << " " << g.out << " EQW\n";
+        break;
+      case EQ:
+        out << "1 1 " << g.a << " " << g.out << " EQ\n";
+        break;
+    }
+  }
+}
+
+void BristolCircuit::save(const std::string &path) const {
+  std::ofstream out(path);
+  write(out);
+  out.close();
+  if (!out) throw std::runtime_error("cannot write Bristol circuit: " + path);
+}
+
+void BristolCircuit::finish() {
+  if (inputSizes_.empty() || outputSizes_.empty())
+    throw std::runtime_error("Bristol circuit without inputs or outputs: " + name_);
+  inputA_size_ = inputSizes_.size() > 1 ? inputSizes_[0] : 0;
+  inputB_size_ = sum(inputSizes_) - inputA_size_;
+  output_size_ = sum(outputSizes_);
+  const size_t numInputs = inputA_size_ + inputB_size_;
+  if (numInputs + output_size_ > numWires_)
+    throw std::runtime_error("Bristol circuit has too few wires: " + name_);
+
+  // AND depth of every wire, noWire while it is unwritten
+  std::vector<uint32_t> depth(numWires_, noWire);
+  std::fill(depth.begin(), depth.begin() + numInputs, 0);
+  auto read = [&](uint32_t w) {
+    if (w >= numWires_ || depth[w] == noWire)
+      throw std::runtime_error("wire read before it is written in Bristol circuit " + name_);
+    return depth[w];
+  };
+  numANDs_ = numXORs_ = numINVs_ = 0;
+  levels_.assign(1, Level());
+  for (size_t k = 0; k < gates_.size(); k++) {
+    const Gate &g = gates_[k];
+    uint32_t d = 0;
+    switch (g.op) {
+      case AND:
+        d = std::max(read(g.a), read(g.b)) + 1;
+        numANDs_++;
+        break;
+      case XOR:
+        d = std::max(read(g.a), read(g.b));
+        numXORs_++;
+        break;
+      case INV:
+        d = read(g.a);
+        numINVs_++;
+        break;
+      case EQW:
+        d = read(g.a);
+        break;
+      case EQ:
+        break;
+    }
+    if (g.out >= numWires_ || depth[g.out] != noWire)
+      throw std::runtime_error("wire written twice in Bristol circuit " + name_);
+    depth[g.out] = d;
+    if (d >= levels_.size()) levels_.resize(d + 1);
+    if (g.op == AND)
+      levels_[d].ands.push_back(k);
+    else
+      levels_[d].linear.push_back(k);
+  }
+  for (size_t w = numWires_ - output_size_; w < numWires_; w++) read(w);
+
+  std::ostringstream out;
+  write(out);
+  const std::string text = out.str();
+  SHAKE128 h(sizeof(block));
+  h.Update(text.data(), text.size());
+  h.Final((uint8_t *)&hash_);
+}
+
+std::string BristolCircuit::info() const {
+  std::ostringstream s;
+  s << name_ << ": " << gates_.size() << " gates (" << numANDs_ << " AND, "
+    << numXORs_ << " XOR, " << numINVs_ << " INV), " << numWires_
+    << " wires, AND depth " << depth() << ", inputs " << inputA_size_ << "+"
+    << inputB_size_ << " bits, output " << output_size_ << " bits";
+  return s.str();
+}
+
+BristolCircuit BristolCircuit::fromGateList(const GateList &list,
+                                            const std::string &name) {
+  BristolCircuit c;
+  c.name_ = name;
+  const size_t sizeA = list.inputA_size_, sizeB = list.inputRows_.size();
+  if (sizeA > 0) c.inputSizes_.push_back(sizeA);
+  c.inputSizes_.push_back(sizeB);
+  c.outputSizes_.push_back(list.outputRows_.size());
+
+  uint32_t next = sizeA + sizeB;
+  auto emit = [&](Op op, uint32_t a, uint32_t b) {
+    c.gates_.push_back({op, next, a, b});
+    return next++;
+  };
+
+  // scalar 0 is the constant 1, it only turns XORs into INVs
+  std::vector<uint32_t> scalarWire(list.numScalars_, noWire);
+  for (size_t i = 0; i < sizeA; i++) scalarWire[1 + i] = i;
+  for (const GateList::ScalarGate &g : list.scalarGates_) {
+    if (g.a == 0 || g.b == 0)
+      scalarWire[g.out] = emit(INV, scalarWire[g.a == 0 ? g.b : g.a], 0);
+    else
+      scalarWire[g.out] = emit(XOR, scalarWire[g.a], scalarWire[g.b]);
+  }
+
+  // the wire each row holds at the current gate
+  std::vector<uint32_t> rowWire(list.numRows_, noWire);
+  for (size_t i = 0; i < sizeB; i++) {
+    if (list.inputRows_[i] != GateList::noRow)
+      rowWire[list.inputRows_[i]] = sizeA + i;
+  }
+  for (const GateList::Gate &g : list.gates_) {
+    switch (g.op) {
+      case GateList::XOR:
+        rowWire[g.out] = emit(XOR, rowWire[g.a], rowWire[g.b]);
+        break;
+      case GateList::XOR_ONE:
+        if (g.b == 0)
+          rowWire[g.out] = emit(INV, rowWire[g.a], 0);
+        else
+          rowWire[g.out] = emit(XOR, rowWire[g.a], scalarWire[g.b]);
+        break;
+      case GateList::ZERO:
+        rowWire[g.out] = emit(EQ, 0, 0);
+        break;
+      case GateList::AND_LAYER:
+        // its outputs never share a row with its inputs
+        break;
+      case GateList::AND:
+        rowWire[g.out] = emit(AND, rowWire[g.a], rowWire[g.b]);
+        break;
+    }
+  }
+  // the outputs have to be the last wires
+  for (uint32_t row : list.outputRows_) emit(EQW, rowWire[row], 0);
+  c.numWires_ = next;
+  c.finish();
+  return c;
+}
+
+std::vector<uint64_t> BristolCircuit::evaluate(
+    const BitVector &inputA, const std::vector<uint64_t> &inputB) const {
+  if (inputA.size() != inputA_size_ || inputB.size() != inputB_size_)
+    throw std::runtime_error("wrong input size for Bristol circuit " + name_);
+  std::vector<uint64_t> w(numWires_);
+  for (size_t i = 0; i < inputA_size_; i++) w[i] = inputA[i] ? ~0ULL : 0;
+  std::copy(inputB.begin(), inputB.end(), w.begin() + inputA_size_);
+  for (const Gate &g : gates_) {
+    switch (g.op) {
+      case XOR:
+        w[g.out] = w[g.a] ^ w[g.b];
+        break;
+      case AND:
+        w[g.out] = w[g.a] & w[g.b];
+        break;
+      case INV:
+        w[g.out] = ~w[g.a];
+        break;
+      case EQW:
+        w[g.out] = w[g.a];
+        break;
+      case EQ:
+        w[g.out] = g.a ? ~0ULL : 0;
+        break;
+    }
+  }
+  return std::vector<uint64_t>(w.end() - output_size_, w.end());
+}
+
+std::vector<SIMDWireLabel> BristolCircuit::compute(
+    const std::vector<WireLabel> &inputA,
+    const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env) const {
+  if (inputA.size() != inputA_size_ || inputB.size() != inputB_size_)
+    throw std::runtime_error("wrong input size for Bristol circuit " + name_);
+  enum : uint8_t { kRow = 1, kScalar = 2 };
+  WireLabelMatrix rows(numWires_, env.SIMDInputs);
+  std::vector<WireLabel> scalars(numWires_);
+  std::vector<uint8_t> kind(numWires_, 0);
+  for (size_t i = 0; i < inputA_size_; i++) {
+    scalars[i] = inputA[i];
+    kind[i] = kScalar;
+  }
+  for (size_t i = 0; i < inputB_size_; i++) {
+    rows.set(inputA_size_ + i, inputB[i]);
+    kind[inputA_size_ + i] = kRow;
+  }
+  // the row of a wire, a scalar is spread over all lanes once it is needed
+  auto row = [&](uint32_t w) {
+    if (!(kind[w] & kRow)) {
+      rows.setZero(w);
+      env.XOR(rows[w], rows[w], scalars[w]);
+      kind[w] |= kRow;
+    }
+    return rows[w];
+  };
+
+  std::vector<ANDGate> layer;
+  for (const Level &level : levels_) {
+    layer.clear();
+    for (uint32_t k : level.ands) {
+      const Gate &g = gates_[k];
+      layer.push_back({rows[g.out], row(g.a), row(g.b)});
+      kind[g.out] = kRow;
+    }
+    if (!layer.empty())
+      env.ANDLayer(span<const ANDGate>(layer.data(), layer.size()));
+
+    for (uint32_t k : level.linear) {
+      const Gate &g = gates_[k];
+      const bool sa = kind[g.a] & kScalar, sb = g.op == XOR && (kind[g.b] & kScalar);
+      kind[g.out] = kRow;
+      switch (g.op) {
+        case XOR:
+          if (sa && sb) {
+            scalars[g.out] = env.XOR(scalars[g.a], scalars[g.b]);
+            kind[g.out] = kScalar;
+          } else if (sa) {
+            env.XOR(rows[g.out], rows[g.b], scalars[g.a]);
+          } else if (sb) {
+            env.XOR(rows[g.out], rows[g.a], scalars[g.b]);
+          } else {
+            env.XOR(rows[g.out], rows[g.a], rows[g.b]);
+          }
+          break;
+        case INV:
+          if (sa) {
+            scalars[g.out] = env.NOT(scalars[g.a]);
+            kind[g.out] = kScalar;
+          } else {
+            env.NOT(rows[g.out], rows[g.a]);
+          }
+          break;
+        case EQW:
+          if (sa) {
+            scalars[g.out] = scalars[g.a];
+            kind[g.out] = kScalar;
+          } else {
+            rows.copy(g.out, rows[g.a]);
+          }
+          break;
+        case EQ:
+          scalars[g.out] = g.a ? env.NOT(WireLabel(ZeroBlock)) : WireLabel(ZeroBlock);
+          kind[g.out] = kScalar;
+          break;
+        case AND:
+          break;
+      }
+    }
+  }
+
+  std::vector<SIMDWireLabel> outputs;
+  outputs.reserve(output_size_);
+  for (size_t w = numWires_ - output_size_; w < numWires_; w++) {
+    row(w);
+    outputs.push_back(rows.get(w));
+  }
+  return outputs;
+}
+
+SIMDBristolCircuitPhases::SIMDBristolCircuitPhases(
+    ChannelWrapper &chan, std::shared_ptr<const BristolCircuit> circuit)
+    : SIMDCircuitPhases(chan, circuit->inputA_size(), circuit->inputB_size(),
+                        circuit->output_size()),
+      circuit_(std::move(circuit)) {
+  Log::v("GC", "%s", circuit_->info().c_str());
+  compile();
+}
+
+std::vector<SIMDWireLabel> SIMDBristolCircuitPhases::computeFunction(
+    const std::vector<WireLabel> &inputA,
+    const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env, size_t worker) {
+  return circuit_->compute(inputA, inputB, env);
+}
+}  // namespace droidCrypto
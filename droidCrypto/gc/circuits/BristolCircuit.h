@@ -0,0 +1,126 @@
+#pragma once
+
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/gc/GateList.h>
+#include <droidCrypto/gc/circuits/Circuit.h>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace droidCrypto {
+
+// A boolean circuit in Bristol Fashion
+// (https://homes.esat.kuleuven.be/~nsmart/MPC/), with XOR, AND, INV, EQ, EQW
+// and MAND gates. Wires are numbered in topological order and the outputs are
+// the last wires.
+//
+// The first input value is Alice's, the garbler's key, all others are
+// concatenated to Bob's input. A circuit with a single input value has no
+// input of Alice. All output values are concatenated. Bit i of an input or
+// output is bit i % 8 of byte i / 8 of its BitVector.
+class BristolCircuit {
+ public:
+  enum Op : uint8_t {
+    XOR,  // out = a ^ b
+    AND,  // out = a & b
+    INV,  // out = !a
+    EQW,  // out = a
+    EQ    // out = constant a
+  };
+
+  struct Gate {
+    Op op;
+    uint32_t out;
+    uint32_t a;
+    uint32_t b;
+  };
+
+  static BristolCircuit parse(std::istream &in, const std::string &name);
+  static BristolCircuit load(const std::string &path);
+
+  void write(std::ostream &out) const;
+  void save(const std::string &path) const;
+
+  // the circuit a compiled SIMD circuit runs, with one input value for Alice
+  // and one for Bob
+  static BristolCircuit fromGateList(const GateList &list,
+                                     const std::string &name);
+
+  // evaluates the circuit in plaintext on up to 64 inputs of Bob at once:
+  // bit j of inputB[i] is input bit i of instance j, the same for the
+  // returned outputs
+  std::vector<uint64_t> evaluate(const BitVector &inputA,
+                                 const std::vector<uint64_t> &inputB) const;
+
+  // garbles/evaluates the circuit on env, ANDs of the same depth are one
+  // layer. Gates on Alice's input alone stay scalar. Holds a row of labels
+  // for every wire, so it is meant to be traced into a GateList, see
+  // SIMDBristolCircuitPhases.
+  std::vector<SIMDWireLabel> compute(const std::vector<WireLabel> &inputA,
+                                     const std::vector<SIMDWireLabel> &inputB,
+                                     SIMDGCEnv &env) const;
+
+  const std::string &name() const { return name_; }
+  size_t inputA_size() const { return inputA_size_; }
+  size_t inputB_size() const { return inputB_size_; }
+  size_t output_size() const { return output_size_; }
+  size_t numWires() const { return numWires_; }
+  size_t numGates() const { return gates_.size(); }
+  size_t numANDs() const { return numANDs_; }
+  size_t numXORs() const { return numXORs_; }
+  size_t numINVs() const { return numINVs_; }
+  size_t depth() const { return levels_.empty() ? 0 : levels_.size() - 1; }
+  // SHAKE128 of the circuit as write prints it, the same for a file and the
+  // circuit written from it
+  const block &hash() const { return hash_; }
+
+  // one line of gate counts for logs
+  std::string info() const;
+
+ private:
+  // checks that every wire is written once before it is read and sorts the
+  // gates into levels by AND depth
+  void finish();
+
+  // the gates of one AND depth: the ANDs of that depth first, as one layer,
+  // then the other gates that depend on them
+  struct Level {
+    std::vector<uint32_t> ands;
+    std::vector<uint32_t> linear;
+  };
+
+  std::string name_;
+  std::vector<size_t> inputSizes_;
+  std::vector<size_t> outputSizes_;
+  std::vector<Gate> gates_;
+  std::vector<Level> levels_;
+  size_t inputA_size_ = 0;
+  size_t inputB_size_ = 0;
+  size_t output_size_ = 0;
+  size_t numWires_ = 0;
+  size_t numANDs_ = 0;
+  size_t numXORs_ = 0;
+  size_t numINVs_ = 0;
+  block hash_ = ZeroBlock;
+};
+
+// A Bristol circuit as a phased SIMD circuit. It is compiled on construction,
+// so the rows of its wires are reused like those of the built-in circuits.
+class SIMDBristolCircuitPhases : public SIMDCircuitPhases {
+ public:
+  SIMDBristolCircuitPhases(ChannelWrapper &chan,
+                           std::shared_ptr<const BristolCircuit> circuit);
+
+  const BristolCircuit &circuit() const { return *circuit_; }
+
+ protected:
+  std::vector<SIMDWireLabel> computeFunction(
+      const std::vector<WireLabel> &inputA,
+      const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env,
+      size_t worker) override;
+
+  std::shared_ptr<const BristolCircuit> circuit_;
+};
+}  // namespace droidCrypto
@@ -1,4 +1,6 @@
 #include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/SecureRandom.h>
+#include <droidCrypto/gc/GCPool.h>
 #include <droidCrypto/gc/HalfGate.h>
 #include <droidCrypto/gc/WireLabel.h>
 #include <droidCrypto/gc/circuits/Circuit.h>
@@ -6,7 +8,9 @@
 #include <assert.h>
 #include <droidCrypto/utils/Log.h>
 #include <endian.h>
+#include <algorithm>
 #include <chrono>
+#include <stdexcept>
 
 namespace droidCrypto {
 
@@ -32,6 +36,7 @@ void Circuit::garble(const BitVector &inputA) {
   timeEval = time4 - time3;
 
   g.outputToBob(outputs);
+  channel.flush();
   auto time5 = std::chrono::high_resolution_clock::now();
   timeOutput = time5 - time4;
 
@@ -94,6 +99,7 @@ void SIMDCircuit::garble(const BitVector &inputA, const size_t SIMDvalues) {
   timeEval = time4 - time3;
 
   g.outputToBob(outputs);
+  channel.flush();
   auto time5 = std::chrono::high_resolution_clock::now();
   timeOutput = time5 - time4;
 
@@ -125,6 +131,7 @@ void SIMDCircuit::garbleSIMD(const std::vector<BitVector> &inputA) {
   timeEval = time4 - time3;
 
   g.outputToBob(outputs);
+  channel.flush();
   auto time5 = std::chrono::high_resolution_clock::now();
   timeOutput = time5 - time4;
 
@@ -229,35 +236,85 @@ std::vector<BitVector> SIMDCircuit::evaluateSIMD(
 
 //----------------------------------------------------------------------------------------------------------------------
 
+void SIMDCircuitPhases::setNumThreads(size_t numThreads) {
+  numThreads_ = std::max<size_t>(numThreads, 1);
+}
+
+void SIMDCircuitPhases::setBaseOtCache(std::shared_ptr<BaseOtCache> cache,
+                                       const std::string &peer /* = "" */) {
+  baseOtCache_ = std::move(cache);
+  baseOtPeer_ = peer;
+}
+
+void SIMDCircuitPhases::garblerBaseOTs() {
+  baseOtEntry_ = g->performBaseOTs(baseOtCache_.get(), 128, numThreads_);
+}
+
+void SIMDCircuitPhases::evaluatorBaseOTs() {
+  baseOtEntry_ =
+      e->performBaseOTs(baseOtCache_.get(), baseOtPeer_, 128, numThreads_);
+}
+
+void SIMDCircuitPhases::compile() {
+  auto time0 = std::chrono::high_resolution_clock::now();
+  gateList_.reset(new GateList(GateList::trace(
+      mInputA_size, mInputB_size,
+      [this](const std::vector<WireLabel> &inputA,
+             const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env) {
+        return computeFunction(inputA, inputB, env, 0);
+      })));
+  auto time1 = std::chrono::high_resolution_clock::now();
+  Log::v("GC",
+         "compiled circuit: %zu gates, %zu ANDs in %zu layers, %zu rows, "
+         "%zu scalar gates in %fsec",
+         gateList_->numGates(), gateList_->numANDs(), gateList_->numLayers(),
+         gateList_->numRows(), gateList_->numScalarGates(),
+         std::chrono::duration<double>(time1 - time0).count());
+}
+
+void SIMDCircuitPhases::prepareWorkers(size_t numWorkers) {
+  if (gateList_) {
+    if (workspaces_.size() < numWorkers) workspaces_.resize(numWorkers);
+  } else {
+    reserveWorkers(numWorkers);
+  }
+}
+
+std::vector<SIMDWireLabel> SIMDCircuitPhases::compute(
+    const std::vector<WireLabel> &inputA,
+    const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env, size_t worker) {
+  if (gateList_) return gateList_->run(inputA, inputB, env, workspaces_[worker]);
+  return computeFunction(inputA, inputB, env, worker);
+}
+
 void SIMDCircuitPhases::garbleBase(const BitVector &inputA,
                                    const size_t SIMDvalues) {
   g = new SIMDGarblerPhases(channel, SIMDvalues);
   auto time1 = std::chrono::high_resolution_clock::now();
 
-  g->performBaseOTs();
+  garblerBaseOTs();
   auto time2 = std::chrono::high_resolution_clock::now();
   timeBaseOT = time2 - time1;
-  g->doOTPhase(mInputB_size * SIMDvalues);
+  g->doOTPhase(mInputB_size * SIMDvalues, baseOtEntry_.threads());
   auto time3 = std::chrono::high_resolution_clock::now();
   timeOT = time3 - time2;
 
   assert(inputA.size() == mInputA_size);
-  // build GC into bufChan
+  // build GC into bufChan, full chunks are streamed out while garbling
   std::vector<WireLabel> aliceInput = g->inputOfAlice(inputA);
   std::vector<SIMDWireLabel> bobInput = g->inputOfBobOffline(mInputB_size);
-  std::vector<SIMDWireLabel> outputs =
-      computeFunction(aliceInput, bobInput, *g);
+  prepareWorkers(numThreads_);
+  std::vector<SIMDWireLabel> outputs = g->garbleParallel(
+      bobInput, numThreads_,
+      [&](const std::vector<SIMDWireLabel> &lanes, SIMDGCEnv &env,
+          size_t worker) {
+        return compute(aliceInput, lanes, env, worker);
+      });
   g->outputToBob(outputs);
   auto time4 = std::chrono::high_resolution_clock::now();
   timeEval = time4 - time3;
 
-  std::vector<uint8_t> gcs = g->bufChan.getBuffer();
-  uint64_t gc_size = gcs.size();
-  size_t transfer;
-  transfer = htobe64(gc_size);
-  channel.send((uint8_t *)&transfer, sizeof(transfer));
-  time4 = std::chrono::high_resolution_clock::now();
-  channel.send(gcs.data(), gc_size);
+  uint64_t gc_size = g->flushGC(true);
 
   Log::v("GC", "Base comm: %fMiB sent, %fMiB recv",
          channel.getBytesSent() / 1024.0 / 1024.0,
@@ -272,9 +329,79 @@ void SIMDCircuitPhases::garbleBase(const BitVector &inputA,
          std::chrono::duration<double>(time5 - time1).count());
 }
 
+void SIMDCircuitPhases::garbleSpool(const BitVector &inputA,
+                                    const size_t SIMDvalues,
+                                    const std::string &path) {
+  assert(inputA.size() == mInputA_size);
+  SecureRandom rnd;
+  block delta = rnd.randBlock();
+  delta[0] |= 1;
+
+  // garbled like garbleBase but without the OTs, Bob's 0-labels are drawn
+  // first so they can go to the spool ahead of the GC
+  std::vector<SIMDWireLabel> bobInput;
+  bobInput.reserve(mInputB_size);
+  for (size_t idx = 0; idx < mInputB_size; idx++) {
+    bobInput.emplace_back(rnd.randBlocks(SIMDvalues));
+  }
+  GCSpoolWriter spool(path, SIMDvalues, mInputA_size, mInputB_size,
+                      mOutput_size, delta, bobInput);
+  SIMDGarblerPhases garbler(spool, SIMDvalues, delta);
+  std::vector<WireLabel> aliceInput = garbler.inputOfAlice(inputA);
+  prepareWorkers(numThreads_);
+  std::vector<SIMDWireLabel> outputs = garbler.garbleParallel(
+      bobInput, numThreads_,
+      [&](const std::vector<SIMDWireLabel> &lanes, SIMDGCEnv &env,
+          size_t worker) {
+        return compute(aliceInput, lanes, env, worker);
+      });
+  garbler.outputToBob(outputs);
+  garbler.flushGC(true);
+  spool.commit();
+}
+
+void SIMDCircuitPhases::garbleBase(const GCSpool &spool) {
+  if (spool.inputASize() != mInputA_size ||
+      spool.inputBSize() != mInputB_size ||
+      spool.outputSize() != mOutput_size) {
+    throw std::runtime_error("GC spool was garbled for a different circuit");
+  }
+  delete g;
+  g = new SIMDGarblerPhases(channel, spool.lanes(), spool.delta());
+  auto time1 = std::chrono::high_resolution_clock::now();
+
+  garblerBaseOTs();
+  auto time2 = std::chrono::high_resolution_clock::now();
+  timeBaseOT = time2 - time1;
+  g->doOTPhase(mInputB_size * spool.lanes(), baseOtEntry_.threads());
+  auto time3 = std::chrono::high_resolution_clock::now();
+  timeOT = time3 - time2;
+
+  g->setBobInputLabels(spool.bobInputLabels());
+  timeEval = std::chrono::duration<double>::zero();
+  // already framed like flushGC does, including the end of the stream
+  span<const uint8_t> gc = spool.gcStream();
+  channel.send(const_cast<uint8_t *>(gc.data()), gc.size());
+  channel.flush();
+
+  Log::v("GC", "Base comm: %fMiB sent, %fMiB recv",
+         channel.getBytesSent() / 1024.0 / 1024.0,
+         channel.getBytesRecv() / 1024.0 / 1024.0);
+  Log::v("GC", "size of spooled GCs: %zu bytes", gc.size());
+  channel.clearStats();
+  auto time4 = std::chrono::high_resolution_clock::now();
+  timeSendGC = time4 - time3;
+  Log::v("GC", "Base phase: %fsec, send: %fsec, total %fsec",
+         std::chrono::duration<double>(time3 - time1).count(),
+         timeSendGC.count(),
+         std::chrono::duration<double>(time4 - time1).count());
+}
+
 void SIMDCircuitPhases::garbleOnline() {
   auto time1 = std::chrono::high_resolution_clock::now();
   g->inputOfBobOnline();
+  channel.flush();
+  baseOtEntry_.commit();
   auto time2 = std::chrono::high_resolution_clock::now();
   timeOnline = time2 - time1;
 
@@ -287,26 +414,19 @@ void SIMDCircuitPhases::evaluateBase(size_t SIMDvalues) {
   e = new SIMDEvaluatorPhases(channel, SIMDvalues);
   auto time1 = std::chrono::high_resolution_clock::now();
 
-  e->performBaseOTs();
+  evaluatorBaseOTs();
   auto time2 = std::chrono::high_resolution_clock::now();
   timeBaseOT = time2 - time1;
 
   PRNG p = PRNG::getTestPRNG();
   randChoices_.reset(SIMDvalues * mInputB_size);
   randChoices_.randomize(p);
-  e->doOTPhase(randChoices_);
+  e->doOTPhase(randChoices_, baseOtEntry_.threads());
   //        Log::v("GC", "baseOTs done");
   auto time3 = std::chrono::high_resolution_clock::now();
   timeOT = time3 - time2;
 
-  size_t transfer;
-  channel.recv((uint8_t *)&transfer, sizeof(transfer));
-  time3 = std::chrono::high_resolution_clock::now();
-  uint64_t gc_size = be64toh(transfer);
-
-  std::vector<uint8_t> gcs(gc_size);
-  channel.recv(gcs.data(), gcs.size());
-  e->bufChan.setBuffer(gcs);
+  e->recvGC();
 
   auto time4 = std::chrono::high_resolution_clock::now();
   timeSendGC = time4 - time3;
@@ -325,17 +445,102 @@ std::vector<BitVector> SIMDCircuitPhases::evaluateOnline(
 
   //        Log::v("GC", "inputB done");
 
-  std::vector<SIMDWireLabel> outputs =
-      computeFunction(aliceInput, bobInput, *e);
+  prepareWorkers(numThreads_);
+  std::vector<SIMDWireLabel> outputs = e->evaluateParallel(
+      bobInput, numThreads_,
+      [&](const std::vector<SIMDWireLabel> &lanes, SIMDGCEnv &env,
+          size_t worker) {
+        return compute(aliceInput, lanes, env, worker);
+      });
 
   //        Log::v("GC", "compute done");
 
   std::vector<BitVector> output = e->outputToBob(outputs);
   //        Log::v("GC", "output done");
+  baseOtEntry_.commit();
 
   auto time5 = std::chrono::high_resolution_clock::now();
   timeEval = time5 - time4;
 
   return output;
 }
+
+void SIMDCircuitPhases::garbleStreaming(const BitVector &inputA,
+                                        const size_t SIMDvalues) {
+  g = new SIMDGarblerPhases(channel, SIMDvalues);
+  auto time1 = std::chrono::high_resolution_clock::now();
+
+  garblerBaseOTs();
+  auto time2 = std::chrono::high_resolution_clock::now();
+  timeBaseOT = time2 - time1;
+  g->doOTPhase(mInputB_size * SIMDvalues, baseOtEntry_.threads());
+  auto time3 = std::chrono::high_resolution_clock::now();
+  timeOT = time3 - time2;
+
+  assert(inputA.size() == mInputA_size);
+  std::vector<WireLabel> aliceInput = g->inputOfAlice(inputA);
+  std::vector<SIMDWireLabel> bobInput = g->inputOfBobOffline(mInputB_size);
+  // Bob's labels go out before the first chunk of the GC is flushed
+  g->inputOfBobOnline();
+  channel.flush();
+  auto time4 = std::chrono::high_resolution_clock::now();
+  timeOnline = time4 - time3;
+
+  prepareWorkers(numThreads_);
+  std::vector<SIMDWireLabel> outputs = g->garbleParallel(
+      bobInput, numThreads_,
+      [&](const std::vector<SIMDWireLabel> &lanes, SIMDGCEnv &env,
+          size_t worker) {
+        return compute(aliceInput, lanes, env, worker);
+      });
+  g->outputToBob(outputs);
+  uint64_t gc_size = g->flushGC(true);
+  baseOtEntry_.commit();
+  auto time5 = std::chrono::high_resolution_clock::now();
+  timeEval = time5 - time4;
+
+  Log::v("GC", "Streaming comm: %fMiB sent, %fMiB recv",
+         channel.getBytesSent() / 1024.0 / 1024.0,
+         channel.getBytesRecv() / 1024.0 / 1024.0);
+  Log::v("GC", "size of GCs: %zu bytes", gc_size);
+  channel.clearStats();
+}
+
+std::vector<BitVector> SIMDCircuitPhases::evaluateStreaming(
+    const std::vector<BitVector> &inputB) {
+  const size_t SIMDvalues = inputB.size();
+  e = new SIMDEvaluatorPhases(channel, SIMDvalues);
+  auto time1 = std::chrono::high_resolution_clock::now();
+
+  evaluatorBaseOTs();
+  auto time2 = std::chrono::high_resolution_clock::now();
+  timeBaseOT = time2 - time1;
+
+  PRNG p = PRNG::getTestPRNG();
+  randChoices_.reset(SIMDvalues * mInputB_size);
+  randChoices_.randomize(p);
+  e->doOTPhase(randChoices_, baseOtEntry_.threads());
+  auto time3 = std::chrono::high_resolution_clock::now();
+  timeOT = time3 - time2;
+
+  assert(inputB.front().size() == mInputB_size);
+  std::vector<SIMDWireLabel> bobInput =
+      e->inputOfBobOnline(inputB, randChoices_);
+  auto time4 = std::chrono::high_resolution_clock::now();
+  timeOnline = time4 - time3;
+
+  // every read of the GC pulls the chunks it needs from the channel
+  std::vector<WireLabel> aliceInput = e->inputOfAlice(mInputA_size);
+  prepareWorkers(1);
+  std::vector<SIMDWireLabel> outputs = compute(aliceInput, bobInput, *e, 0);
+  std::vector<BitVector> output = e->outputToBob(outputs);
+  uint64_t gc_size = e->recvGC();
+  baseOtEntry_.commit();
+  auto time5 = std::chrono::high_resolution_clock::now();
+  timeEval = time5 - time4;
+
+  Log::v("GC", "streamed %zu GC bytes, at most %zu buffered", gc_size,
+         e->getMaxBuffered());
+  return output;
+}
 }  // namespace droidCrypto
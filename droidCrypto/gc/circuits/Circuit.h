@@ -4,14 +4,18 @@
 #include <droidCrypto/Defines.h>
 #include <droidCrypto/gc/WireLabel.h>
 
+#include <droidCrypto/gc/GateList.h>
 #include <droidCrypto/gc/HalfGate.h>
 #include <cassert>
 #include <chrono>
+#include <memory>
+#include <string>
 
 namespace droidCrypto {
 class ChannelWrapper;
 class GCEnv;
 class SIMDGCEnv;
+class GCSpool;
 
 class Circuit {
  public:
@@ -105,11 +109,47 @@ class SIMDCircuitPhases {
     delete e;
   }
 
+  // garbleBase and evaluateOnline split the lanes over numThreads threads,
+  // garbler and evaluator may use different numbers. The OT extension of the
+  // base phase runs on as many threads as both have, they tell each other
+  // with the base OTs.
+  void setNumThreads(size_t numThreads);
+
+  // the base OTs of all phases resume an earlier session from cache if
+  // garbler and evaluator both have one, see BaseOtCache. peer names the
+  // garbler on the evaluator's side. The entry for the next session is
+  // committed at the end of the online phase.
+  void setBaseOtCache(std::shared_ptr<BaseOtCache> cache,
+                      const std::string &peer = "");
+
+  // traces computeFunction once into a GateList, which is run instead of the
+  // circuit code from then on. The list keeps every AND in its traced order,
+  // so garbler and evaluator produce the same GC either way and only one of
+  // them needs to compile.
+  void compile();
+  // the compiled gate list, null before compile
+  const GateList *gateList() const { return gateList_.get(); }
+
   void garbleBase(const BitVector &inputA, const size_t SIMDvalues);
   void garbleOnline();
+
+  // garbles a GC for SIMDvalues lanes before any client is connected and
+  // writes it with the garbler state garbleOnline needs to a GCSpool at path
+  void garbleSpool(const BitVector &inputA, const size_t SIMDvalues,
+                   const std::string &path);
+  // garbleBase for a GC from garbleSpool: only the OTs are run with the
+  // client before the spooled GC is sent. garbleOnline follows as usual.
+  void garbleBase(const GCSpool &spool);
   void evaluateBase(size_t SIMDvalues);
   std::vector<BitVector> evaluateOnline(const std::vector<BitVector> &inputB);
 
+  // online-only alternative to the phases above: Bob's input is transferred
+  // before the GC, which is then evaluated gate by gate as its chunks arrive
+  // instead of being buffered as a whole. Evaluation runs on one thread.
+  void garbleStreaming(const BitVector &inputA, const size_t SIMDvalues);
+  std::vector<BitVector> evaluateStreaming(
+      const std::vector<BitVector> &inputB);
+
   std::chrono::duration<double> timeBaseOT;
   std::chrono::duration<double> timeOT;
   std::chrono::duration<double> timeEval;
@@ -117,17 +157,36 @@ class SIMDCircuitPhases {
   std::chrono::duration<double> timeOnline;
 
  protected:
+  // computeFunction runs on up to numWorkers threads at once, circuits that
+  // keep state between calls need one per worker
+  virtual void reserveWorkers(size_t numWorkers) {}
   virtual std::vector<SIMDWireLabel> computeFunction(
       const std::vector<WireLabel> &inputA,
-      const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env) {
+      const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env,
+      size_t worker) {
     assert(false);
     return std::vector<SIMDWireLabel>();
   };
 
+  // computeFunction or, once compiled, a run of the gate list
+  void prepareWorkers(size_t numWorkers);
+  std::vector<SIMDWireLabel> compute(const std::vector<WireLabel> &inputA,
+                                     const std::vector<SIMDWireLabel> &inputB,
+                                     SIMDGCEnv &env, size_t worker);
+  // performBaseOTs of g and e, through the cache if there is one
+  void garblerBaseOTs();
+  void evaluatorBaseOTs();
+
   ChannelWrapper &channel;
   SIMDGarblerPhases *g;
   SIMDEvaluatorPhases *e;
   BitVector randChoices_;
+  size_t numThreads_ = 1;
+  std::shared_ptr<BaseOtCache> baseOtCache_;
+  std::string baseOtPeer_;
+  BaseOtCache::Pending baseOtEntry_;
+  std::unique_ptr<GateList> gateList_;
+  std::vector<GateList::Workspace> workspaces_;
   const size_t mInputA_size;
   const size_t mInputB_size;
   const size_t mOutput_size;
@@ -44,7 +44,10 @@
 #include <droidCrypto/gc/WireLabel.h>
 #include <droidCrypto/gc/circuits/LowMCCircuit.h>
 #include <droidCrypto/utils/Log.h>
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <mutex>
 
 #define ceil_divide(x, y) ((((x) + (y)-1) / (y)))
 
@@ -187,355 +190,169 @@ namespace droidCrypto {
 
 //----------------------------------------------------------------------------------------------
 // SIMD
-SIMDLowMCCircuit::SIMDLowMCCircuit(ChannelWrapper &chan)
-    : SIMDCircuit(chan, params->n, params->n, params->n),
-      mGrayCode(FOUR_RUSSIAN_WINDOW_SIZE) {}
-
-std::vector<SIMDWireLabel> SIMDLowMCCircuit::computeFunction(
-    const std::vector<WireLabel> &keyRev, const std::vector<SIMDWireLabel> &pt,
-    SIMDGCEnv &env) {
-  uint32_t round, i;
-  const uint32_t statesize = params->n;
-  const uint32_t nrounds = params->r;
-
-  std::vector<SIMDWireLabel> state(statesize);
-  std::vector<SIMDWireLabel> result(statesize);
-
-  // copy the input to the current state, fixing memory representation
-  for (i = 0; i < statesize; i++)
-    state[(i / 8) * 8 + 7 - i % 8] = pt[statesize - 1 - i];
-  // fix key memory representation
-  std::vector<WireLabel> key(keyRev.size());
-  for (i = 0; i < keyRev.size(); i++)
-    key[(i / 8) * 8 + 7 - i % 8] = keyRev[keyRev.size() - 1 - i];
-
-#if defined(REDUCED_LINEAR_LAYER) && defined(REDUCED_LINEAR_LAYER_NEXT)
-  LowMCXORConstant(state, params->precomputed_constant_linear, env);
-  LowMCAddRoundKeyMult(state, key, params->k0_matrix, env);
-  std::vector<WireLabel> nl_part = LowMCPrecomputeNLPart(key, env);
-  for (round = 0; round < nrounds - 1; round++) {
-    LowMCPutSBoxLayer(state, env);
-    LowMCAddRRK(state, nl_part, round, env);
-    LowMCRLLMult(state, round, env);
-  }
-  LowMCPutSBoxLayer(state, env);
-  LowMCAddRRK(state, nl_part, round, env);
-  FourRussiansMatrixMult(state, params->zr_matrix, env);
-//        LowMCMult(state, params->zr_matrix, env);
-#else
-  LowMCAddRoundKeyMult(state, key, params->k0_matrix, env);  // ARK
-  for (round = 1; round <= nrounds; round++) {
-    // substitution via 3-bit SBoxes
-    LowMCPutSBoxLayer(state, env);
-
-    // multiply state with GF2Matrix
-    FourRussiansMatrixMult(
-        state, params->rounds[round - 1].l_matrix,
-        env);  // 4 Russians version of the state multiplication
-    //            LowMCMult(state, params->rounds[round-1].l_matrix, env);//4
-    //            Russians version of the state multiplication
-
-    // XOR constants
-    LowMCXORConstant(state, params->rounds[round - 1].constant, env);
-
-    // XOR with multiplied key
-    LowMCAddRoundKeyMult(state, key, params->rounds[round - 1].k_matrix, env);
-  }
-
-#endif
-  for (i = 0; i < statesize; i++)
-    result[(i / 8) * 8 + 7 - i % 8] = state[statesize - 1 - i];
-  return result;
-}
-
-void SIMDLowMCCircuit::LowMCAddRoundKeyMult(std::vector<SIMDWireLabel> &val,
-                                            const std::vector<WireLabel> &key,
-                                            const mzd_local_t *keymat,
-                                            SIMDGCEnv &env) {
-  std::vector<WireLabel> tmp(val.size(), WireLabel::getZEROLabel());
-  for (uint32_t i = 0; i < params->n; i++) {
-    const word *k = CONST_ROW(keymat, i);
-    for (uint32_t j = 0; j < params->n; j++) {
-      if (READ_BIT(k, j)) {
-        tmp[j] = env.XOR(tmp[j], key[i]);
-      }
+namespace {
+// outputs of a dense linear layer that may share terms
+constexpr size_t denseGroupSize = 16;
+
+// the inputs of each output bit of a linear layer, output j of the state is
+// the XOR of the inputs i with bit j set in row i of mat
+std::vector<std::vector<uint32_t>> matrixRows(const mzd_local_t *mat,
+                                              uint32_t n) {
+  std::vector<std::vector<uint32_t>> rows(n);
+  for (uint32_t i = 0; i < n; i++) {
+    const word *row = CONST_ROW(mat, i);
+    for (uint32_t j = 0; j < n; j++) {
+      if (READ_BIT(row, j)) rows[j].push_back(i);
     }
   }
-  for (uint32_t i = 0; i < params->n; i++) {
-    val[i] = env.XOR(val[i], tmp[i]);
-  }
-}
-
-void SIMDLowMCCircuit::LowMCAddRoundKey(std::vector<SIMDWireLabel> &val,
-                                        const std::vector<WireLabel> &key,
-                                        uint32_t lowmcstatesize, uint32_t round,
-                                        SIMDGCEnv &env) {
-  for (uint32_t i = 0; i < lowmcstatesize; i++) {
-    val[i] = env.XOR(val[i], key[i + (round)*lowmcstatesize]);
-  }
+  return rows;
 }
 
-void SIMDLowMCCircuit::LowMCXORConstant(std::vector<SIMDWireLabel> &state,
-                                        const mzd_local_t *constant,
-                                        SIMDGCEnv &env) {
-  const word *c = CONST_FIRST_ROW(constant);
-  for (uint32_t i = 0; i < params->n; i++) {
-    if (READ_BIT(c, i)) {
-      state[i] = env.NOT(state[i]);
-    }
-  }
-}
-
-void SIMDLowMCCircuit::LowMCPutSBoxLayer(std::vector<SIMDWireLabel> &input,
-                                         SIMDGCEnv &env) {
-  for (uint32_t i = 0; i < params->m * 3; i += 3) {
-    LowMCPutSBox(input[params->n - 1 - (i + 2)], input[params->n - 1 - (i + 1)],
-                 input[params->n - 1 - (i + 0)], env);
-  }
-}
-
-void SIMDLowMCCircuit::LowMCPutSBox(SIMDWireLabel &o1, SIMDWireLabel &o2,
-                                    SIMDWireLabel &o3, SIMDGCEnv &env) {
-  SIMDWireLabel i1 = o1;
-  SIMDWireLabel i2 = o2;
-  SIMDWireLabel i3 = o3;
-
-  SIMDWireLabel ni1 = env.NOT(i1);
-  SIMDWireLabel ni2 = env.NOT(i2);
-  SIMDWireLabel ni3 = env.NOT(i3);
-
-  // C = B * C + A
-  o1 = env.XOR(env.AND(i2, i3), i1);
-
-  // E = A * (NOT C) + B
-  o2 = env.XOR(env.AND(i1, ni3), i2);
-
-  // F = (NOT ((NOT B) * (NOT A))) + C
-  o3 = env.XOR(env.NOT(env.AND(ni2, ni1)), i3);
-}
-
-void SIMDLowMCCircuit::LowMCAddRRK(std::vector<SIMDWireLabel> &val,
-                                   const std::vector<WireLabel> &nl_part,
-                                   uint32_t round, SIMDGCEnv &env) {
-  for (uint32_t i = 0; i < 3 * params->m; i++) {
-    val[params->n - 3 * params->m + i] = env.XOR(
-        val[params->n - 3 * params->m + i], nl_part[3 * params->m * round + i]);
-  }
-}
-
-void SIMDLowMCCircuit::LowMCRLLMult(std::vector<SIMDWireLabel> &val,
-                                    uint32_t round, SIMDGCEnv &env) {
 #if defined(REDUCED_LINEAR_LAYER_NEXT)
-  std::vector<SIMDWireLabel> tmpstate(
-      val.size(), SIMDWireLabel::getZEROLabel(env.SIMDInputs));
-  std::swap(val, tmpstate);
-
-  // calculate tmp*Z
-  SIMDWireLabel tmp;
-  for (uint32_t i = 0; i < 3 * params->m; i++) {
-    const word *z = CONST_ROW(params->rounds[round].z_matrix, i);
-    tmp = SIMDWireLabel::getZEROLabel(env.SIMDInputs);
-    for (uint32_t j = 0; j < params->n; j++) {
-      if (READ_BIT(z, j)) {
-        tmp = env.XOR(tmp, tmpstate[j]);
-      }
+// the reduced linear layer of a round: the last 3m bits are multiplied with
+// Z, the others are the remaining state bits reordered by r_cols plus the
+// last 3m ones multiplied with R
+std::vector<std::vector<uint32_t>> reducedRows(const lowmc_t *params,
+                                               uint32_t round) {
+  const uint32_t n = params->n, nl = 3 * params->m;
+  const lowmc_round_t &rnd = params->rounds[round];
+  std::vector<uint32_t> perm(n);
+  for (uint32_t i = 0; i < n; i++) perm[i] = i;
+  for (unsigned j = rnd.num_fixes; j; j--) {
+    for (unsigned k = rnd.r_cols[j - 1]; k < n - 1 - (nl - j); k++) {
+      std::swap(perm[k], perm[k + 1]);
     }
-    val[params->n - 3 * params->m + i] = tmp;
   }
-  // Reorder tmp base on rcols
-  for (unsigned j = params->rounds[round].num_fixes; j; j--) {
-    for (unsigned k = params->rounds[round].r_cols[j - 1];
-         k < params->n - 1 - (3 * params->m - j); k++) {
-      std::swap(tmpstate[k], tmpstate[k + 1]);
-      //                SIMDWireLabel t = tmpstate[k];
-      //                tmpstate[k] = tmpstate[k+1];
-      //                tmpstate[k+1] = t;
+
+  std::vector<std::vector<uint32_t>> rows(n);
+  for (uint32_t i = 0; i < nl; i++) {
+    const word *z = CONST_ROW(rnd.z_matrix, i);
+    for (uint32_t j = 0; j < n; j++) {
+      if (READ_BIT(z, j)) rows[n - nl + i].push_back(j);
     }
   }
-  // calculate tmp*R
-  for (uint32_t i = 0; i < 3 * params->m; i++) {
-    const word *z = CONST_ROW(params->rounds[round].r_matrix, i);
-    for (uint32_t j = 0; j < params->n - 3 * params->m; j++) {
-      if (READ_BIT(z, j)) {
-        val[j] = env.XOR(val[j], tmpstate[params->n - 3 * params->m + i]);
-      }
+  for (uint32_t i = 0; i < nl; i++) {
+    const word *r = CONST_ROW(rnd.r_matrix, i);
+    for (uint32_t j = 0; j < n - nl; j++) {
+      if (READ_BIT(r, j)) rows[j].push_back(perm[n - nl + i]);
     }
   }
-  for (uint32_t i = 0; i < params->n - 3 * params->m; i++) {
-    val[i] = env.XOR(val[i], tmpstate[i]);
-  }
-#endif
+  for (uint32_t i = 0; i < n - nl; i++) rows[i].push_back(perm[i]);
+  return rows;
 }
+#endif
+}  // namespace
 
-void SIMDLowMCCircuit::FourRussiansMatrixMult(std::vector<SIMDWireLabel> &state,
-                                              const mzd_local_t *mat,
-                                              SIMDGCEnv &env) {
-  // round to nearest square for optimal window size
-  constexpr uint32_t wsize =
-      FOUR_RUSSIAN_WINDOW_SIZE;  // floor_log2(lowmcstatesize);
-
-  // will only work if the statesize is a multiple of the window size
-  assert(params->n % wsize == 0);
-  SIMDWireLabel *lut = new SIMDWireLabel[(1 << wsize)];
-  uint32_t i, j;
-  uint8_t tmp = 0;
-
-  lut[0] = SIMDWireLabel::getZEROLabel(
-      env.SIMDInputs);  // circ->PutConstantGate(0, 1);
-
-  std::vector<SIMDWireLabel> tmpstate(ceil_divide(params->n, wsize) * wsize,
-                                      lut[0]);
-  // pad the state to a multiple of the window size and fill with zeros
-  std::vector<SIMDWireLabel> state_pad(ceil_divide(params->n, wsize) * wsize,
-                                       lut[0]);
-  for (i = 0; i < params->n; i++) state_pad[i] = state[i];
-
-  for (i = 0; i < ceil_divide(params->n, wsize);
-       i++) {  // for each column-window
-    for (j = 1; j < (1U << wsize); j++) {
-      lut[mGrayCode.ord[j]] =
-          env.XOR(lut[mGrayCode.ord[j - 1]],
-                  state_pad[i * wsize + mGrayCode.inc[j - 1]]);
-    }
-
-    for (j = 0; j < params->n; j++) {
-      tmp = READ_BIT(CONST_ROW(mat, i * wsize + 0), j) << 0;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 1), j) << 1;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 2), j) << 2;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 3), j) << 3;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 4), j) << 4;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 5), j) << 5;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 6), j) << 6;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 7), j) << 7;
-      tmpstate[j] = env.XOR(tmpstate[j], lut[tmp]);
-    }
+LowMCLinearLayers::LowMCLinearLayers(const lowmc_t *params) {
+  auto start = std::chrono::high_resolution_clock::now();
+#if defined(REDUCED_LINEAR_LAYER) && defined(REDUCED_LINEAR_LAYER_NEXT)
+  for (uint32_t round = 0; round < params->r - 1; round++)
+    rounds.push_back(XORNetwork::paar(params->n, reducedRows(params, round)));
+  // dense, terms are only shared within groups of outputs so the scratch
+  // rows stay below those of the Four Russians table this replaces
+  final = XORNetwork::paar(params->n, matrixRows(params->zr_matrix, params->n),
+                           denseGroupSize);
+#else
+  for (uint32_t round = 0; round < params->r; round++) {
+    rounds.push_back(XORNetwork::paar(
+        params->n, matrixRows(params->rounds[round].l_matrix, params->n),
+        denseGroupSize));
   }
+#endif
+  std::chrono::duration<double> time =
+      std::chrono::high_resolution_clock::now() - start;
+  Log::v("GC",
+         "LowMC n=%u m=%u r=%u linear layers: %zu XORs, %zu without "
+         "shared terms, generated in %fsec",
+         params->n, params->m, params->r, numXORs(), numNaiveXORs(),
+         time.count());
+}
 
-  for (i = 0; i < params->n; i++) state[i] = tmpstate[i];
-
-  delete[] lut;
+std::shared_ptr<const LowMCLinearLayers> LowMCLinearLayers::get(
+    const lowmc_t *params) {
+  static std::mutex lock;
+  static std::map<const lowmc_t *, std::shared_ptr<const LowMCLinearLayers>>
+      cache;
+  std::lock_guard<std::mutex> guard(lock);
+  std::shared_ptr<const LowMCLinearLayers> &layers = cache[params];
+  if (!layers) layers.reset(new LowMCLinearLayers(params));
+  return layers;
 }
 
-std::vector<WireLabel> SIMDLowMCCircuit::LowMCPrecomputeNLPart(
-    std::vector<WireLabel> &key, SIMDGCEnv &env) {
-  uint64_t nl_part_size = (params->r * 3 * params->m);
-  std::vector<WireLabel> nl_part(nl_part_size, WireLabel::getZEROLabel());
-#if defined(REDUCED_LINEAR_LAYER_NEXT)
-  if (params->m == 1) {
-    for (unsigned i = 0; i < params->n; i++) {
-      const word *k = CONST_ROW(params->precomputed_non_linear_part_matrix, i);
-      for (uint32_t j = 0; j < nl_part_size; j++) {
-        if (READ_BIT(k, 1 + (j / 63) + j)) {
-          nl_part[j] = env.XOR(nl_part[j], key[i]);
-        }
-      }
-    }
-    const word *c = CONST_FIRST_ROW(params->precomputed_constant_non_linear);
-    for (unsigned i = 0; i < nl_part_size; i++) {
-      if (READ_BIT(c, 1 + (i / 63) + i)) {
-        nl_part[i] = env.NOT(nl_part[i]);
-      }
-    }
-  } else if (params->m == 10) {
-    for (unsigned i = 0; i < params->n; i++) {
-      const word *k = CONST_ROW(params->precomputed_non_linear_part_matrix, i);
-      for (uint32_t j = 0; j < nl_part_size; j++) {
-        if (READ_BIT(k, 2 + 2 * (j / 30) + j)) {
-          nl_part[j] = env.XOR(nl_part[j], key[i]);
-        }
-      }
-    }
-    const word *c = CONST_FIRST_ROW(params->precomputed_constant_non_linear);
-    for (unsigned i = 0; i < nl_part_size; i++) {
-      if (READ_BIT(c, 2 + 2 * (i / 30) + i)) {
-        nl_part[i] = env.NOT(nl_part[i]);
-      }
-    }
-  } else {
-    throw std::runtime_error("Only implemented for 10 and 1 atm");
-  }
-#endif
-  return nl_part;
+size_t LowMCLinearLayers::numXORs() const {
+  size_t sum = final.numXORs();
+  for (const XORNetwork &layer : rounds) sum += layer.numXORs();
+  return sum;
 }
 
-void SIMDLowMCCircuit::LowMCMult(std::vector<SIMDWireLabel> &val,
-                                 const mzd_local_t *mat, SIMDGCEnv &env) {
-  std::vector<SIMDWireLabel> tmp(val.size(),
-                                 SIMDWireLabel::getZEROLabel(env.SIMDInputs));
-  std::swap(tmp, val);
-  for (uint32_t i = 0; i < params->n; i++) {
-    const word *k = CONST_ROW(mat, i);
-    for (uint32_t j = 0; j < params->n; j++) {
-      if (READ_BIT(k, j)) {
-        val[j] = env.XOR(val[j], tmp[i]);
-      }
-    }
-  }
+size_t LowMCLinearLayers::numNaiveXORs() const {
+  size_t sum = final.numNaiveXORs();
+  for (const XORNetwork &layer : rounds) sum += layer.numNaiveXORs();
+  return sum;
 }
-//----------------------------------------------------------------------------------------------------------------------
-// Phased Circuit
-SIMDLowMCCircuitPhases::SIMDLowMCCircuitPhases(ChannelWrapper &chan)
-    : SIMDCircuitPhases(chan, params->n, params->n, params->n),
-      mGrayCode(FOUR_RUSSIAN_WINDOW_SIZE) {}
 
-std::vector<SIMDWireLabel> SIMDLowMCCircuitPhases::computeFunction(
+SIMDLowMCState::SIMDLowMCState(const lowmc_t *params)
+    : params(params), mLinear(LowMCLinearLayers::get(params)) {}
+
+std::vector<SIMDWireLabel> SIMDLowMCState::compute(
     const std::vector<WireLabel> &keyRev, const std::vector<SIMDWireLabel> &pt,
     SIMDGCEnv &env) {
   uint32_t round, i;
   const uint32_t statesize = params->n;
   const uint32_t nrounds = params->r;
 
-  std::vector<SIMDWireLabel> state(statesize);
-  std::vector<SIMDWireLabel> result(statesize);
+  // all buffers keep their memory between calls, only the first one allocates
+  mState.resize(statesize, env.SIMDInputs);
+  mTmpState.resize(statesize, env.SIMDInputs);
+  mScratch.resize(5 * params->m, env.SIMDInputs);
+  mGates.reserve(3 * params->m);
 
   // copy the input to the current state, fixing memory representation
   for (i = 0; i < statesize; i++)
-    state[(i / 8) * 8 + 7 - i % 8] = pt[statesize - 1 - i];
+    mState.set((i / 8) * 8 + 7 - i % 8, pt[statesize - 1 - i]);
   // fix key memory representation
   std::vector<WireLabel> key(keyRev.size());
   for (i = 0; i < keyRev.size(); i++)
     key[(i / 8) * 8 + 7 - i % 8] = keyRev[keyRev.size() - 1 - i];
 
 #if defined(REDUCED_LINEAR_LAYER) && defined(REDUCED_LINEAR_LAYER_NEXT)
-  LowMCXORConstant(state, params->precomputed_constant_linear, env);
-  LowMCAddRoundKeyMult(state, key, params->k0_matrix, env);
+  LowMCXORConstant(params->precomputed_constant_linear, env);
+  LowMCAddRoundKeyMult(key, params->k0_matrix, env);
   std::vector<WireLabel> nl_part = LowMCPrecomputeNLPart(key, env);
   for (round = 0; round < nrounds - 1; round++) {
-    LowMCPutSBoxLayer(state, env);
-    LowMCAddRRK(state, nl_part, round, env);
-    LowMCRLLMult(state, round, env);
+    LowMCPutSBoxLayer(env);
+    LowMCAddRRK(nl_part, round, env);
+    LowMCLinearLayer(mLinear->rounds[round], env);
   }
-  LowMCPutSBoxLayer(state, env);
-  LowMCAddRRK(state, nl_part, round, env);
-  FourRussiansMatrixMult(state, params->zr_matrix, env);
-//        LowMCMult(state, params->zr_matrix, env);
+  LowMCPutSBoxLayer(env);
+  LowMCAddRRK(nl_part, round, env);
+  LowMCLinearLayer(mLinear->final, env);
 #else
-  LowMCAddRoundKeyMult(state, key, params->k0_matrix, env);  // ARK
+  LowMCAddRoundKeyMult(key, params->k0_matrix, env);  // ARK
   for (round = 1; round <= nrounds; round++) {
     // substitution via 3-bit SBoxes
-    LowMCPutSBoxLayer(state, env);
+    LowMCPutSBoxLayer(env);
 
     // multiply state with GF2Matrix
-    FourRussiansMatrixMult(
-        state, params->rounds[round - 1].l_matrix,
-        env);  // 4 Russians version of the state multiplication
+    LowMCLinearLayer(mLinear->rounds[round - 1], env);
 
     // XOR constants
-    LowMCXORConstant(state, params->rounds[round - 1].constant, env);
+    LowMCXORConstant(params->rounds[round - 1].constant, env);
 
     // XOR with multiplied key
-    LowMCAddRoundKeyMult(state, key, params->rounds[round - 1].k_matrix, env);
+    LowMCAddRoundKeyMult(key, params->rounds[round - 1].k_matrix, env);
   }
 #endif
+  std::vector<SIMDWireLabel> result(statesize);
   for (i = 0; i < statesize; i++)
-    result[(i / 8) * 8 + 7 - i % 8] = state[statesize - 1 - i];
+    result[(i / 8) * 8 + 7 - i % 8] = mState.get(statesize - 1 - i);
   return result;
 }
 
-void SIMDLowMCCircuitPhases::LowMCAddRoundKeyMult(
-    std::vector<SIMDWireLabel> &val, const std::vector<WireLabel> &key,
-    const mzd_local_t *keymat, SIMDGCEnv &env) {
-  std::vector<WireLabel> tmp(val.size(), WireLabel::getZEROLabel());
+void SIMDLowMCState::LowMCAddRoundKeyMult(const std::vector<WireLabel> &key,
+                                          const mzd_local_t *keymat,
+                                          SIMDGCEnv &env) {
+  std::vector<WireLabel> tmp(params->n, WireLabel::getZEROLabel());
   for (uint32_t i = 0; i < params->n; i++) {
     const word *k = CONST_ROW(keymat, i);
     for (uint32_t j = 0; j < params->n; j++) {
@@ -545,159 +362,76 @@ void SIMDLowMCCircuitPhases::LowMCAddRoundKeyMult(
     }
   }
   for (uint32_t i = 0; i < params->n; i++) {
-    val[i] = env.XOR(val[i], tmp[i]);
-  }
-}
-
-void SIMDLowMCCircuitPhases::LowMCAddRoundKey(std::vector<SIMDWireLabel> &val,
-                                              const std::vector<WireLabel> &key,
-                                              uint32_t lowmcstatesize,
-                                              uint32_t round, SIMDGCEnv &env) {
-  for (uint32_t i = 0; i < lowmcstatesize; i++) {
-    val[i] = env.XOR(val[i], key[i + (round)*lowmcstatesize]);
+    env.XOR(mState[i], mState[i], tmp[i]);
   }
 }
 
-void SIMDLowMCCircuitPhases::LowMCXORConstant(std::vector<SIMDWireLabel> &state,
-                                              const mzd_local_t *constant,
-                                              SIMDGCEnv &env) {
+void SIMDLowMCState::LowMCXORConstant(const mzd_local_t *constant,
+                                      SIMDGCEnv &env) {
   const word *c = CONST_FIRST_ROW(constant);
   for (uint32_t i = 0; i < params->n; i++) {
     if (READ_BIT(c, i)) {
-      state[i] = env.NOT(state[i]);
+      env.NOT(mState[i], mState[i]);
     }
   }
 }
 
-void SIMDLowMCCircuitPhases::LowMCPutSBoxLayer(
-    std::vector<SIMDWireLabel> &input, SIMDGCEnv &env) {
+// the S-boxes of a layer are independent, so all their AND gates are garbled
+// as one AND layer
+void SIMDLowMCState::LowMCPutSBoxLayer(SIMDGCEnv &env) {
+  mGates.clear();
   for (uint32_t i = 0; i < params->m * 3; i += 3) {
-    LowMCPutSBox(input[params->n - 1 - (i + 2)], input[params->n - 1 - (i + 1)],
-                 input[params->n - 1 - (i + 0)], env);
+    LowMCPutSBox(mState[params->n - 1 - (i + 2)],
+                 mState[params->n - 1 - (i + 1)],
+                 mState[params->n - 1 - (i + 0)], 5 * (i / 3), env);
+  }
+  env.ANDLayer(span<const ANDGate>(mGates.data(), mGates.size()));
+  for (uint32_t i = 0; i < params->m * 3; i += 3) {
+    LowMCFinishSBox(mState[params->n - 1 - (i + 2)],
+                    mState[params->n - 1 - (i + 1)],
+                    mState[params->n - 1 - (i + 0)], 5 * (i / 3), env);
   }
 }
 
-void SIMDLowMCCircuitPhases::LowMCPutSBox(SIMDWireLabel &o1, SIMDWireLabel &o2,
-                                          SIMDWireLabel &o3, SIMDGCEnv &env) {
-  SIMDWireLabel i1 = o1;
-  SIMDWireLabel i2 = o2;
-  SIMDWireLabel i3 = o3;
-
-  SIMDWireLabel ni1 = env.NOT(i1);
-  SIMDWireLabel ni2 = env.NOT(i2);
-  SIMDWireLabel ni3 = env.NOT(i3);
-
+// queues the ANDs of one S-box, its temporaries are the 5 scratch rows from t
+void SIMDLowMCState::LowMCPutSBox(block *o1, block *o2, block *o3, size_t t,
+                                  SIMDGCEnv &env) {
   // C = B * C + A
-  o1 = env.XOR(env.AND(i2, i3), i1);
+  mGates.push_back({mScratch[t + 0], o2, o3});
 
   // E = A * (NOT C) + B
-  o2 = env.XOR(env.AND(i1, ni3), i2);
+  env.NOT(mScratch[t + 3], o3);
+  mGates.push_back({mScratch[t + 1], o1, mScratch[t + 3]});
 
   // F = (NOT ((NOT B) * (NOT A))) + C
-  o3 = env.XOR(env.NOT(env.AND(ni2, ni1)), i3);
+  env.NOT(mScratch[t + 4], o2);
+  env.NOT(mScratch[t + 2], o1);
+  mGates.push_back({mScratch[t + 2], mScratch[t + 4], mScratch[t + 2]});
 }
 
-void SIMDLowMCCircuitPhases::LowMCAddRRK(std::vector<SIMDWireLabel> &val,
-                                         const std::vector<WireLabel> &nl_part,
-                                         uint32_t round, SIMDGCEnv &env) {
-  for (uint32_t i = 0; i < 3 * params->m; i++) {
-    val[params->n - 3 * params->m + i] = env.XOR(
-        val[params->n - 3 * params->m + i], nl_part[3 * params->m * round + i]);
-  }
+void SIMDLowMCState::LowMCFinishSBox(block *o1, block *o2, block *o3,
+                                     size_t t, SIMDGCEnv &env) {
+  env.NOT(mScratch[t + 2], mScratch[t + 2]);
+  env.XOR(o1, mScratch[t + 0], o1);
+  env.XOR(o2, mScratch[t + 1], o2);
+  env.XOR(o3, mScratch[t + 2], o3);
 }
 
-void SIMDLowMCCircuitPhases::LowMCRLLMult(std::vector<SIMDWireLabel> &val,
-                                          uint32_t round, SIMDGCEnv &env) {
-#if defined(REDUCED_LINEAR_LAYER_NEXT)
-  std::vector<SIMDWireLabel> tmpstate(
-      val.size(), SIMDWireLabel::getZEROLabel(env.SIMDInputs));
-  std::swap(val, tmpstate);
-
-  // calculate tmp*Z
-  SIMDWireLabel tmp;
-  for (uint32_t i = 0; i < 3 * params->m; i++) {
-    const word *z = CONST_ROW(params->rounds[round].z_matrix, i);
-    tmp = SIMDWireLabel::getZEROLabel(env.SIMDInputs);
-    for (uint32_t j = 0; j < params->n; j++) {
-      if (READ_BIT(z, j)) {
-        tmp = env.XOR(tmp, tmpstate[j]);
-      }
-    }
-    val[params->n - 3 * params->m + i] = tmp;
-  }
-  // Reorder tmp base on rcols
-  for (unsigned j = params->rounds[round].num_fixes; j; j--) {
-    for (unsigned k = params->rounds[round].r_cols[j - 1];
-         k < params->n - 1 - (3 * params->m - j); k++) {
-      std::swap(tmpstate[k], tmpstate[k + 1]);
-      //                SIMDWireLabel t = tmpstate[k];
-      //                tmpstate[k] = tmpstate[k+1];
-      //                tmpstate[k+1] = t;
-    }
-  }
-  // calculate tmp*R
+void SIMDLowMCState::LowMCAddRRK(const std::vector<WireLabel> &nl_part,
+                                 uint32_t round, SIMDGCEnv &env) {
   for (uint32_t i = 0; i < 3 * params->m; i++) {
-    const word *z = CONST_ROW(params->rounds[round].r_matrix, i);
-    for (uint32_t j = 0; j < params->n - 3 * params->m; j++) {
-      if (READ_BIT(z, j)) {
-        val[j] = env.XOR(val[j], tmpstate[params->n - 3 * params->m + i]);
-      }
-    }
-  }
-  for (uint32_t i = 0; i < params->n - 3 * params->m; i++) {
-    val[i] = env.XOR(val[i], tmpstate[i]);
+    block *row = mState[params->n - 3 * params->m + i];
+    env.XOR(row, row, nl_part[3 * params->m * round + i]);
   }
-#endif
 }
 
-void SIMDLowMCCircuitPhases::FourRussiansMatrixMult(
-    std::vector<SIMDWireLabel> &state, const mzd_local_t *mat, SIMDGCEnv &env) {
-  // round to nearest square for optimal window size
-  uint32_t wsize = FOUR_RUSSIAN_WINDOW_SIZE;
-
-  // will only work if the statesize is a multiple of the window size
-  assert(params->n % wsize == 0);
-  SIMDWireLabel *lut = new SIMDWireLabel[(1 << wsize)];
-  uint32_t i, j;
-  uint8_t tmp = 0;
-
-  lut[0] = SIMDWireLabel::getZEROLabel(
-      env.SIMDInputs);  // circ->PutConstantGate(0, 1);
-
-  std::vector<SIMDWireLabel> tmpstate(ceil_divide(params->n, wsize) * wsize,
-                                      lut[0]);
-  // pad the state to a multiple of the window size and fill with zeros
-  std::vector<SIMDWireLabel> state_pad(ceil_divide(params->n, wsize) * wsize,
-                                       lut[0]);
-  for (i = 0; i < params->n; i++) state_pad[i] = state[i];
-
-  for (i = 0; i < ceil_divide(params->n, wsize);
-       i++) {  // for each column-window
-    for (j = 1; j < (1U << wsize); j++) {
-      lut[mGrayCode.ord[j]] =
-          env.XOR(lut[mGrayCode.ord[j - 1]],
-                  state_pad[i * wsize + mGrayCode.inc[j - 1]]);
-    }
-
-    for (j = 0; j < params->n; j++) {
-      tmp = READ_BIT(CONST_ROW(mat, i * wsize + 0), j) << 0;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 1), j) << 1;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 2), j) << 2;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 3), j) << 3;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 4), j) << 4;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 5), j) << 5;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 6), j) << 6;
-      tmp |= READ_BIT(CONST_ROW(mat, i * wsize + 7), j) << 7;
-      tmpstate[j] = env.XOR(tmpstate[j], lut[tmp]);
-    }
-  }
-
-  for (i = 0; i < params->n; i++) state[i] = tmpstate[i];
-
-  delete[] lut;
+void SIMDLowMCState::LowMCLinearLayer(const XORNetwork &layer,
+                                      SIMDGCEnv &env) {
+  layer.apply(mState, mTmpState, mXORTmp, env);
+  std::swap(mState, mTmpState);
 }
 
-std::vector<WireLabel> SIMDLowMCCircuitPhases::LowMCPrecomputeNLPart(
+std::vector<WireLabel> SIMDLowMCState::LowMCPrecomputeNLPart(
     std::vector<WireLabel> &key, SIMDGCEnv &env) {
   uint64_t nl_part_size = (params->r * 3 * params->m);
   std::vector<WireLabel> nl_part(nl_part_size, WireLabel::getZEROLabel());
@@ -739,19 +473,32 @@ std::vector<WireLabel> SIMDLowMCCircuitPhases::LowMCPrecomputeNLPart(
   return nl_part;
 }
 
-void SIMDLowMCCircuitPhases::LowMCMult(std::vector<SIMDWireLabel> &val,
-                                       const mzd_local_t *mat, SIMDGCEnv &env) {
-  std::vector<SIMDWireLabel> tmp(val.size(),
-                                 SIMDWireLabel::getZEROLabel(env.SIMDInputs));
-  std::swap(tmp, val);
-  for (uint32_t i = 0; i < params->n; i++) {
-    const word *k = CONST_ROW(mat, i);
-    for (uint32_t j = 0; j < params->n; j++) {
-      if (READ_BIT(k, j)) {
-        val[j] = env.XOR(val[j], tmp[i]);
-      }
-    }
-  }
+
+SIMDLowMCCircuit::SIMDLowMCCircuit(ChannelWrapper &chan)
+    : SIMDCircuit(chan, params->n, params->n, params->n), mLowMC(params) {}
+
+std::vector<SIMDWireLabel> SIMDLowMCCircuit::computeFunction(
+    const std::vector<WireLabel> &keyRev, const std::vector<SIMDWireLabel> &pt,
+    SIMDGCEnv &env) {
+  return mLowMC.compute(keyRev, pt, env);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Phased Circuit
+SIMDLowMCCircuitPhases::SIMDLowMCCircuitPhases(ChannelWrapper &chan)
+    : SIMDCircuitPhases(chan, params->n, params->n, params->n) {
+  reserveWorkers(1);
+}
+
+void SIMDLowMCCircuitPhases::reserveWorkers(size_t numWorkers) {
+  while (mLowMC.size() < numWorkers)
+    mLowMC.emplace_back(new SIMDLowMCState(params));
+}
+
+std::vector<SIMDWireLabel> SIMDLowMCCircuitPhases::computeFunction(
+    const std::vector<WireLabel> &keyRev, const std::vector<SIMDWireLabel> &pt,
+    SIMDGCEnv &env, size_t worker) {
+  return mLowMC[worker]->compute(keyRev, pt, env);
 }
 }  // namespace droidCrypto
 
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <droidCrypto/gc/circuits/Circuit.h>
-#include <droidCrypto/utils/graycode.h>
+#include <droidCrypto/gc/XORNetwork.h>
 #include <jni.h>
 
 extern "C" {
@@ -17,8 +17,6 @@ extern "C" {
 }
 
 namespace droidCrypto {
-// round to nearest square for optimal window size
-constexpr uint32_t FOUR_RUSSIAN_WINDOW_SIZE = 8;
 class GCEnv;
 
 //    class LowMCCircuit : public Circuit{
@@ -64,6 +62,61 @@ class GCEnv;
 //            BitVector m_linlayer;
 //    };
 
+// XOR programs of the linear layers of a LowMC instance: the state matrix of
+// each round, the reduced one with REDUCED_LINEAR_LAYER_NEXT, and the final
+// combined matrix. Generated on first use and shared by all circuits of the
+// instance.
+class LowMCLinearLayers {
+ public:
+  static std::shared_ptr<const LowMCLinearLayers> get(const lowmc_t *params);
+
+  std::vector<XORNetwork> rounds;
+  XORNetwork final;
+
+  // XOR gates of all layers, and of computing every output bit on its own
+  size_t numXORs() const;
+  size_t numNaiveXORs() const;
+
+ private:
+  explicit LowMCLinearLayers(const lowmc_t *params);
+};
+
+// LowMC on a WireLabelMatrix, shared by the SIMD circuits. The state and the
+// scratch rows are kept between calls, so after the first one the circuit
+// runs without allocating per gate. Each S-box layer is garbled as one AND
+// layer, the linear layers run the XOR programs of LowMCLinearLayers.
+class SIMDLowMCState {
+ public:
+  SIMDLowMCState(const lowmc_t *params);
+
+  std::vector<SIMDWireLabel> compute(const std::vector<WireLabel> &keyRev,
+                                     const std::vector<SIMDWireLabel> &pt,
+                                     SIMDGCEnv &env);
+
+ private:
+  void LowMCLinearLayer(const XORNetwork &layer, SIMDGCEnv &env);
+  void LowMCPutSBoxLayer(SIMDGCEnv &env);
+  void LowMCPutSBox(block *o1, block *o2, block *o3, size_t t,
+                    SIMDGCEnv &env);
+  void LowMCFinishSBox(block *o1, block *o2, block *o3, size_t t,
+                       SIMDGCEnv &env);
+  void LowMCAddRoundKeyMult(const std::vector<WireLabel> &key,
+                            const mzd_local_t *keymat, SIMDGCEnv &env);
+  void LowMCXORConstant(const mzd_local_t *constant, SIMDGCEnv &env);
+  std::vector<WireLabel> LowMCPrecomputeNLPart(std::vector<WireLabel> &key,
+                                               SIMDGCEnv &env);
+  void LowMCAddRRK(const std::vector<WireLabel> &nl_part, uint32_t round,
+                   SIMDGCEnv &env);
+
+  const lowmc_t *params;
+  std::shared_ptr<const LowMCLinearLayers> mLinear;
+  WireLabelMatrix mState;
+  WireLabelMatrix mTmpState;
+  WireLabelMatrix mXORTmp;
+  WireLabelMatrix mScratch;
+  std::vector<ANDGate> mGates;
+};
+
 class SIMDLowMCCircuit : public SIMDCircuit {
  public:
   // params_{sboxes}_{datacomplexity}
@@ -84,32 +137,7 @@ class SIMDLowMCCircuit : public SIMDCircuit {
       const std::vector<WireLabel> &inputA,
       const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env) override;
 
-  void LowMCAddRoundKey(std::vector<SIMDWireLabel> &val,
-                        const std::vector<WireLabel> &key,
-                        uint32_t locmcstatesize, uint32_t round,
-                        SIMDGCEnv &env);
-  void FourRussiansMatrixMult(std::vector<SIMDWireLabel> &state,
-                              const mzd_local_t *mat, SIMDGCEnv &env);
-  void LowMCMult(std::vector<SIMDWireLabel> &val, const mzd_local_t *mat,
-                 SIMDGCEnv &env);
-
-  void LowMCPutSBoxLayer(std::vector<SIMDWireLabel> &input, SIMDGCEnv &env);
-  void LowMCPutSBox(SIMDWireLabel &o1, SIMDWireLabel &o2, SIMDWireLabel &o3,
-                    SIMDGCEnv &env);
-  void LowMCAddRoundKeyMult(std::vector<SIMDWireLabel> &val,
-                            const std::vector<WireLabel> &key,
-                            const mzd_local_t *keymat, SIMDGCEnv &env);
-  void LowMCXORConstant(std::vector<SIMDWireLabel> &state,
-                        const mzd_local_t *constant, SIMDGCEnv &env);
-  std::vector<WireLabel> LowMCPrecomputeNLPart(std::vector<WireLabel> &key,
-                                               SIMDGCEnv &env);
-  void LowMCAddRRK(std::vector<SIMDWireLabel> &val,
-                   const std::vector<WireLabel> &nl_part, uint32_t round,
-                   SIMDGCEnv &env);
-  void LowMCRLLMult(std::vector<SIMDWireLabel> &val, uint32_t round,
-                    SIMDGCEnv &env);
-
-  GrayCode mGrayCode;
+  SIMDLowMCState mLowMC;
 };
 
 class SIMDLowMCCircuitPhases : public SIMDCircuitPhases {
@@ -128,35 +156,14 @@ class SIMDLowMCCircuitPhases : public SIMDCircuitPhases {
   SIMDLowMCCircuitPhases(ChannelWrapper &chan);
 
  protected:
+  void reserveWorkers(size_t numWorkers) override;
   std::vector<SIMDWireLabel> computeFunction(
       const std::vector<WireLabel> &inputA,
-      const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env) override;
-  void LowMCAddRoundKey(std::vector<SIMDWireLabel> &val,
-                        const std::vector<WireLabel> &key,
-                        uint32_t locmcstatesize, uint32_t round,
-                        SIMDGCEnv &env);
-  void FourRussiansMatrixMult(std::vector<SIMDWireLabel> &state,
-                              const mzd_local_t *mat, SIMDGCEnv &env);
-  void LowMCMult(std::vector<SIMDWireLabel> &val, const mzd_local_t *mat,
-                 SIMDGCEnv &env);
-
-  void LowMCPutSBoxLayer(std::vector<SIMDWireLabel> &input, SIMDGCEnv &env);
-  void LowMCPutSBox(SIMDWireLabel &o1, SIMDWireLabel &o2, SIMDWireLabel &o3,
-                    SIMDGCEnv &env);
-  void LowMCAddRoundKeyMult(std::vector<SIMDWireLabel> &val,
-                            const std::vector<WireLabel> &key,
-                            const mzd_local_t *keymat, SIMDGCEnv &env);
-  void LowMCXORConstant(std::vector<SIMDWireLabel> &state,
-                        const mzd_local_t *constant, SIMDGCEnv &env);
-  std::vector<WireLabel> LowMCPrecomputeNLPart(std::vector<WireLabel> &key,
-                                               SIMDGCEnv &env);
-  void LowMCAddRRK(std::vector<SIMDWireLabel> &val,
-                   const std::vector<WireLabel> &nl_part, uint32_t round,
-                   SIMDGCEnv &env);
-  void LowMCRLLMult(std::vector<SIMDWireLabel> &val, uint32_t round,
-                    SIMDGCEnv &env);
+      const std::vector<SIMDWireLabel> &inputB, SIMDGCEnv &env,
+      size_t worker) override;
 
-  GrayCode mGrayCode;
+  // one per worker
+  std::vector<std::unique_ptr<SIMDLowMCState>> mLowMC;
 };
 }  // namespace droidCrypto
 
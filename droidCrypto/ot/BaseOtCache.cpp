@@ -0,0 +1,460 @@
+#include <droidCrypto/AES.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/PRNG.h>
+#include <droidCrypto/SHAKE128.h>
+#include <droidCrypto/SecureRandom.h>
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/ot/VerifiedSimplestOT.h>
+#include <droidCrypto/utils/Log.h>
+#include <droidCrypto/utils/MappedFile.h>
+#include <dirent.h>
+#include <endian.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+namespace {
+const char cacheMagic[8] = {'D', 'C', 'B', 'A', 'S', 'E', 'O', 'T'};
+const uint32_t cacheVersion = 1;
+
+// domain separation of the SHAKE128 calls
+const char encLabel[] = "BaseOtCache enc";
+const char macLabel[] = "BaseOtCache mac";
+const char peerLabel[] = "BaseOtCache peer";
+const char ticketLabel[] = "BaseOtCache ticket";
+const char sessionLabel[] = "BaseOtCache session";
+const char ratchetLabel[] = "BaseOtCache ratchet";
+const char linkLabel[] = "BaseOtCache link";
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numOTs;
+  // seconds since the epoch
+  int64_t created;
+  uint64_t payload_blocks;
+  uint8_t ticket[16];
+  uint8_t iv[16];
+};
+
+block hashBlocks(const char *label, size_t labelLen,
+                 std::initializer_list<block> in) {
+  SHAKE128 h(sizeof(block));
+  h.Update(label, labelLen);
+  for (const block &b : in) h.Update(b);
+  block out;
+  h.Final((uint8_t *)&out);
+  return out;
+}
+
+block tagOf(const block &key, const CacheHeader &hdr, const block *ct,
+            const std::string &name) {
+  SHAKE128 h(sizeof(block));
+  h.Update(macLabel, sizeof(macLabel));
+  h.Update(key);
+  h.Update(hdr);
+  h.Update(ct, hdr.payload_blocks);
+  h.Update(name.data(), name.size());
+  block out;
+  h.Final((uint8_t *)&out);
+  return out;
+}
+
+// AES-CTR under a key of its own per IV, encryption and decryption alike
+void cryptPayload(const block &key, const block &iv, const block *in,
+                  block *out, size_t numBlocks) {
+  AES aes(hashBlocks(encLabel, sizeof(encLabel), {key, iv}));
+  aes.encryptCTR(0, numBlocks, out);
+  for (size_t i = 0; i < numBlocks; i++) out[i] = out[i] ^ in[i];
+}
+
+bool tagsEqual(const block &a, const block &b) {
+  const uint8_t *x = (const uint8_t *)&a;
+  const uint8_t *y = (const uint8_t *)&b;
+  uint8_t diff = 0;
+  for (size_t i = 0; i < sizeof(block); i++) diff |= x[i] ^ y[i];
+  return diff == 0;
+}
+
+std::string hex(const block &b) {
+  static const char digits[] = "0123456789abcdef";
+  const uint8_t *bytes = (const uint8_t *)&b;
+  std::string out;
+  for (size_t i = 0; i < sizeof(block); i++) {
+    out += digits[bytes[i] >> 4];
+    out += digits[bytes[i] & 15];
+  }
+  return out;
+}
+
+int64_t secondsSinceEpoch(std::chrono::system_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch())
+      .count();
+}
+
+size_t choiceBlocks(size_t numOTs) { return (numOTs + 127) / 128; }
+
+// what a session derives from the master OTs: its base OTs are
+// AES(master).E(session), those of the next session AES(master).E(ratchet)
+struct Derived {
+  block session;
+  block ratchet;
+  block ticket;
+  block link;
+};
+
+Derived derive(const block &link, const block &ticket, const block &nonceC,
+               const block &nonceS) {
+  std::initializer_list<block> in = {link, ticket, nonceC, nonceS};
+  Derived d;
+  d.session = hashBlocks(sessionLabel, sizeof(sessionLabel), in);
+  d.ratchet = hashBlocks(ratchetLabel, sizeof(ratchetLabel), in);
+  d.ticket = hashBlocks(ticketLabel, sizeof(ticketLabel), in);
+  d.link = hashBlocks(linkLabel, sizeof(linkLabel), in);
+  return d;
+}
+
+// how the server answers the client: without a cache on both ends the base
+// OTs run as usual, with them they are resumed or run for a new entry
+const uint8_t modePlain = 0;
+const uint8_t modeFresh = 1;
+const uint8_t modeResumed = 2;
+
+// the thread counts of the OT extension follow the first byte of both ends,
+// big-endian
+void sendThreads(ChannelWrapper &chan, size_t numThreads) {
+  uint32_t threads = htobe32(
+      uint32_t(std::min<size_t>(std::max<size_t>(numThreads, 1), UINT32_MAX)));
+  chan.send((uint8_t *)&threads, sizeof(threads));
+}
+
+size_t recvThreads(ChannelWrapper &chan) {
+  uint32_t threads;
+  chan.recv((uint8_t *)&threads, sizeof(threads));
+  return std::max<size_t>(be32toh(threads), 1);
+}
+}  // namespace
+
+void BaseOtCache::Pending::commit() {
+  if (file_) file_->commit();
+  file_.reset();
+}
+
+BaseOtCache::BaseOtCache(const std::string &dir, const block &storageKey,
+                         std::chrono::seconds maxAge)
+    : dir_(dir), storage_key_(storageKey), max_age_(maxAge) {}
+
+BaseOtCache::Pending BaseOtCache::receive(BaseOtCache *cache,
+                                          BitVector &choices,
+                                          span<block> messages,
+                                          ChannelWrapper &chan,
+                                          size_t numThreads /* = 1 */) {
+  uint8_t clientCache;
+  chan.recv(&clientCache, 1);
+  const size_t threads =
+      std::min(recvThreads(chan), std::max<size_t>(numThreads, 1));
+  if (clientCache && cache) {
+    return cache->receiveCached(choices, messages, chan, threads);
+  }
+  if (clientCache) {
+    // the client's ticket and nonce
+    block unused;
+    chan.recv(unused);
+    chan.recv(unused);
+  }
+  if (clientCache || cache) {
+    Log::e("BaseOtCache", "only one end has a base OT cache, running base OTs");
+  }
+  uint8_t mode = modePlain;
+  chan.send(&mode, 1);
+  sendThreads(chan, threads);
+
+  SecureRandom rnd;
+  PRNG prng(rnd.randBlock());
+  choices.resize(messages.size());
+  choices.randomize(prng);
+  VerifiedSimplestOT ot;
+  ot.receive(choices, messages, prng, chan);
+  Pending pending;
+  pending.threads_ = threads;
+  return pending;
+}
+
+BaseOtCache::Pending BaseOtCache::send(BaseOtCache *cache,
+                                       span<std::array<block, 2>> messages,
+                                       ChannelWrapper &chan,
+                                       const std::string &peer,
+                                       size_t numThreads /* = 1 */) {
+  if (cache) return cache->sendCached(messages, chan, peer, numThreads);
+  uint8_t clientCache = 0;
+  uint8_t mode;
+  chan.send(&clientCache, 1);
+  sendThreads(chan, numThreads);
+  chan.recv(&mode, 1);
+  Pending pending;
+  pending.threads_ = recvThreads(chan);
+  if (mode != modePlain) {
+    throw std::runtime_error("server resumed base OTs without a cache");
+  }
+  sendPlain(messages, chan);
+  return pending;
+}
+
+void BaseOtCache::sendPlain(span<std::array<block, 2>> messages,
+                            ChannelWrapper &chan) {
+  SecureRandom rnd;
+  PRNG prng(rnd.randBlock());
+  VerifiedSimplestOT ot;
+  ot.send(messages, prng, chan);
+}
+
+BaseOtCache::Pending BaseOtCache::receiveCached(BitVector &choices,
+                                                span<block> messages,
+                                                ChannelWrapper &chan,
+                                                size_t threads) {
+  const size_t numOTs = messages.size();
+  const size_t offset = choiceBlocks(numOTs);
+  SecureRandom rnd;
+  block ticket, nonceC;
+  chan.recv(ticket);
+  chan.recv(nonceC);
+  const block nonceS = rnd.randBlock();
+
+  // choice bits, the OT of each choice and the link key
+  std::vector<block> master;
+  auto created = std::chrono::system_clock::now();
+  bool resume = false;
+  if (neq(ticket, ZeroBlock)) {
+    const std::string name = "srv-" + hex(ticket);
+    block stored;
+    std::chrono::system_clock::time_point storedCreated;
+    if (load(name, stored, storedCreated, master, numOTs,
+             offset + numOTs + 1)) {
+      auto age = created - storedCreated;
+      resume = eq(stored, ticket) && age >= std::chrono::seconds(0) &&
+               age <= max_age_;
+      if (resume) created = storedCreated;
+      // single use, resumed or not
+      unlink((dir_ + "/" + name).c_str());
+    }
+  }
+  uint8_t mode = resume ? modeResumed : modeFresh;
+  chan.send(&mode, 1);
+  sendThreads(chan, threads);
+  chan.send(nonceS);
+  chan.flush();
+
+  choices.resize(numOTs);
+  if (resume) {
+    memcpy(choices.data(), master.data(), choices.sizeBytes());
+  } else {
+    // the last OT is the link key, its choice bit is sent along
+    PRNG prng(rnd.randBlock());
+    BitVector allChoices(numOTs + 1);
+    allChoices.randomize(prng);
+    std::vector<block> ots(numOTs + 1);
+    VerifiedSimplestOT ot;
+    ot.receive(allChoices, ots, prng, chan);
+    uint8_t linkChoice = allChoices[numOTs];
+    chan.send(&linkChoice, 1);
+
+    choices.copy(allChoices, 0, numOTs);
+    master.assign(offset + numOTs + 1, ZeroBlock);
+    memcpy(master.data(), choices.data(), choices.sizeBytes());
+    std::copy(ots.begin(), ots.end(), master.begin() + offset);
+    ticket = ZeroBlock;
+  }
+
+  const Derived d = derive(master.back(), ticket, nonceC, nonceS);
+  std::vector<block> next(master);
+  for (size_t i = 0; i < numOTs; i++) {
+    AES aes(master[offset + i]);
+    messages[i] = aes.encryptECB(d.session);
+    next[offset + i] = aes.encryptECB(d.ratchet);
+  }
+  next.back() = d.link;
+
+  Pending pending;
+  pending.resumed_ = resume;
+  pending.threads_ = threads;
+  pending.file_ =
+      write("srv-" + hex(d.ticket), d.ticket, created, next, numOTs);
+  return pending;
+}
+
+BaseOtCache::Pending BaseOtCache::sendCached(
+    span<std::array<block, 2>> messages, ChannelWrapper &chan,
+    const std::string &peer, size_t numThreads) {
+  const size_t numOTs = messages.size();
+  SecureRandom rnd;
+  SHAKE128 h(sizeof(block));
+  h.Update(peerLabel, sizeof(peerLabel));
+  h.Update(peer.data(), peer.size());
+  block peerHash;
+  h.Final((uint8_t *)&peerHash);
+  const std::string name = "cli-" + hex(peerHash);
+
+  // both OTs of each base OT and the link key
+  std::vector<block> master;
+  block ticket;
+  std::chrono::system_clock::time_point created;
+  const bool loaded =
+      load(name, ticket, created, master, numOTs, 2 * numOTs + 1);
+  if (!loaded) ticket = ZeroBlock;
+  uint8_t clientCache = 1;
+  const block nonceC = rnd.randBlock();
+  chan.send(&clientCache, 1);
+  sendThreads(chan, numThreads);
+  chan.send(ticket);
+  chan.send(nonceC);
+  uint8_t mode;
+  chan.recv(&mode, 1);
+  Pending pending;
+  pending.threads_ = recvThreads(chan);
+  if (mode == modePlain) {
+    // the entry stays for a server with a cache
+    Log::e("BaseOtCache", "only one end has a base OT cache, running base OTs");
+    sendPlain(messages, chan);
+    return pending;
+  }
+  // single use, the server removed its entry as well
+  if (loaded) unlink((dir_ + "/" + name).c_str());
+  block nonceS;
+  chan.recv(nonceS);
+
+  const bool resume = mode == modeResumed;
+  if (resume && !loaded) {
+    throw std::runtime_error("server resumed base OTs without a ticket");
+  }
+  if (!resume) {
+    PRNG prng(rnd.randBlock());
+    std::vector<std::array<block, 2>> ots(numOTs + 1);
+    VerifiedSimplestOT ot;
+    ot.send(ots, prng, chan);
+    uint8_t linkChoice;
+    chan.recv(&linkChoice, 1);
+
+    master.resize(2 * numOTs + 1);
+    for (size_t i = 0; i < numOTs; i++) {
+      master[2 * i] = ots[i][0];
+      master[2 * i + 1] = ots[i][1];
+    }
+    master.back() = ots[numOTs][linkChoice & 1];
+    ticket = ZeroBlock;
+  }
+
+  const Derived d = derive(master.back(), ticket, nonceC, nonceS);
+  std::vector<block> next(master.size());
+  for (size_t i = 0; i < 2 * numOTs; i++) {
+    AES aes(master[i]);
+    messages[i / 2][i % 2] = aes.encryptECB(d.session);
+    next[i] = aes.encryptECB(d.ratchet);
+  }
+  next.back() = d.link;
+
+  pending.resumed_ = resume;
+  // the client does not check the age, the time is not used
+  pending.file_ = write(name, d.ticket, std::chrono::system_clock::now(), next,
+                        numOTs);
+  return pending;
+}
+
+void BaseOtCache::prune() {
+  DIR *d = opendir(dir_.c_str());
+  if (!d) return;
+  const auto now = std::chrono::system_clock::now();
+  while (struct dirent *ent = readdir(d)) {
+    const std::string path = dir_ + "/" + ent->d_name;
+    struct stat st;
+    if (strncmp(ent->d_name, "srv-", 4) != 0 || stat(path.c_str(), &st) != 0)
+      continue;
+    if (now - std::chrono::system_clock::from_time_t(st.st_mtime) > max_age_) {
+      unlink(path.c_str());
+    }
+  }
+  closedir(d);
+}
+
+bool BaseOtCache::load(const std::string &name, block &ticket,
+                       std::chrono::system_clock::time_point &created,
+                       std::vector<block> &payload, size_t numOTs,
+                       size_t payloadBlocks) {
+  const std::string path = dir_ + "/" + name;
+  if (access(path.c_str(), F_OK) != 0) return false;
+  try {
+    MappedFile file(path);
+    CacheHeader hdr;
+    if (file.size() < sizeof(hdr)) {
+      throw std::runtime_error("base OT cache entry truncated: " + path);
+    }
+    memcpy(&hdr, file.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, cacheMagic, sizeof(hdr.magic)) != 0) {
+      throw std::runtime_error("not a base OT cache entry: " + path);
+    }
+    if (hdr.version != cacheVersion) {
+      throw std::runtime_error("unsupported base OT cache version: " + path);
+    }
+    if (hdr.payload_blocks > file.size() / sizeof(block) ||
+        file.size() !=
+            sizeof(hdr) + (hdr.payload_blocks + 1) * sizeof(block)) {
+      throw std::runtime_error("base OT cache entry corrupted: " + path);
+    }
+    std::vector<block> ct(hdr.payload_blocks);
+    block tag;
+    memcpy(ct.data(), file.data() + sizeof(hdr), ct.size() * sizeof(block));
+    memcpy(&tag, file.data() + sizeof(hdr) + ct.size() * sizeof(block),
+           sizeof(tag));
+    if (!tagsEqual(tag, tagOf(storage_key_, hdr, ct.data(), name))) {
+      throw std::runtime_error("base OT cache entry not authentic: " + path);
+    }
+
+    // a valid entry for a different number of base OTs stays
+    if (hdr.numOTs != numOTs || hdr.payload_blocks != payloadBlocks) {
+      return false;
+    }
+    payload.resize(ct.size());
+    cryptPayload(storage_key_, toBlock(hdr.iv), ct.data(), payload.data(),
+                 ct.size());
+    ticket = toBlock(hdr.ticket);
+    created = std::chrono::system_clock::time_point(
+        std::chrono::seconds(hdr.created));
+    return true;
+  } catch (const std::runtime_error &e) {
+    Log::e("BaseOtCache", "%s, running base OTs", e.what());
+    unlink(path.c_str());
+    return false;
+  }
+}
+
+std::unique_ptr<AtomicFileWriter> BaseOtCache::write(
+    const std::string &name, const block &ticket,
+    std::chrono::system_clock::time_point created,
+    const std::vector<block> &payload, size_t numOTs) {
+  SecureRandom rnd;
+  CacheHeader hdr;
+  memcpy(hdr.magic, cacheMagic, sizeof(hdr.magic));
+  hdr.version = cacheVersion;
+  hdr.numOTs = numOTs;
+  hdr.created = secondsSinceEpoch(created);
+  hdr.payload_blocks = payload.size();
+  const block iv = rnd.randBlock();
+  memcpy(hdr.ticket, &ticket, sizeof(hdr.ticket));
+  memcpy(hdr.iv, &iv, sizeof(hdr.iv));
+
+  std::vector<block> ct(payload.size());
+  cryptPayload(storage_key_, iv, payload.data(), ct.data(), ct.size());
+  const block tag = tagOf(storage_key_, hdr, ct.data(), name);
+
+  std::unique_ptr<AtomicFileWriter> file(
+      new AtomicFileWriter(dir_ + "/" + name));
+  file->write(&hdr, sizeof(hdr));
+  file->write(ct.data(), ct.size() * sizeof(block));
+  file->write(&tag, sizeof(tag));
+  return file;
+}
+}  // namespace droidCrypto
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/Defines.h>
+#include <droidCrypto/utils/MappedFile.h>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace droidCrypto {
+class ChannelWrapper;
+
+// Resumable base OTs for clients that come back to the same server. The
+// first session runs VerifiedSimplestOT with one more OT, whose choice bit
+// the server reveals: that OT is a link key only the two ends know. Both ends
+// keep the OTs as the master OTs of a ticket. A later session exchanges the
+// ticket and a fresh nonce per side, both ends then derive the base OTs of
+// the session from the master OTs with one AES call each:
+// m = AES(master).E(H(link key, ticket, nonces)).
+//
+// Tickets are single use. A session removes the entry it resumed and leaves
+// a new one for the next session, with a ticket and master OTs derived from
+// the old ones, the link key and the nonces, so someone watching the
+// connection cannot link the sessions of a client. The new entry is written
+// aside and only takes effect once Pending::commit is called after the
+// session finished; if the session fails, a failed check of the extension
+// included, no entry is left and the next session runs the base OTs again.
+// The server's choice bits, the delta of the extension, stay the same over
+// resumed sessions, so a client probing them has to succeed every time to
+// keep them. maxAge bounds how long they are used from the first session on.
+//
+// The entries hold the master OTs encrypted with AES-CTR under a key derived
+// from storageKey and a random IV per file, and a SHAKE128 tag over the file
+// and its name, so a changed, renamed or truncated entry is dropped. Files
+// are written with mode 0600 through AtomicFileWriter.
+//
+// The first message of each end also carries the number of threads it
+// extends OTs with, Pending::threads is the smaller one. The extensions of
+// the session use it, see otExtSendParallel, and need no round of their own.
+//
+// Nonces, IVs and the randomness of the base OTs come from SecureRandom, not
+// from the protocols' PRNGs, repeating a nonce would repeat the OTs.
+class BaseOtCache {
+ public:
+  // The entry a session leaves for the next one. It is removed when the
+  // Pending is destroyed without commit, commit does nothing if no cache was
+  // used.
+  class Pending {
+   public:
+    bool resumed() const { return resumed_; }
+    // the OT extension threads both ends agreed on
+    size_t threads() const { return threads_; }
+    // throws std::runtime_error if the entry cannot be written
+    void commit();
+
+   private:
+    friend class BaseOtCache;
+    std::unique_ptr<AtomicFileWriter> file_;
+    bool resumed_ = false;
+    size_t threads_ = 1;
+  };
+
+  // dir has to exist, the server runs the base OTs again for entries older
+  // than maxAge
+  BaseOtCache(const std::string &dir, const block &storageKey,
+              std::chrono::seconds maxAge = std::chrono::hours(24 * 30));
+
+  // Server side, the base-OT receiver of the extension: sets choices, which
+  // is resized to messages.size(), and messages. The client says whether it
+  // has a cache with its first message, cache may be null and the base OTs
+  // are only resumed if both have one. One cache serves all clients, an
+  // entry per ticket. numThreads is what this end would extend OTs with.
+  static Pending receive(BaseOtCache *cache, BitVector &choices,
+                         span<block> messages, ChannelWrapper &chan,
+                         size_t numThreads = 1);
+
+  // client side, the base-OT sender: keeps one entry per server, peer names
+  // the server
+  static Pending send(BaseOtCache *cache, span<std::array<block, 2>> messages,
+                      ChannelWrapper &chan, const std::string &peer,
+                      size_t numThreads = 1);
+
+  // removes the entries of the server not written for maxAge, those of
+  // clients that lost theirs are never asked for again
+  void prune();
+
+ private:
+  // receive and send with a cache on this end
+  Pending receiveCached(BitVector &choices, span<block> messages,
+                        ChannelWrapper &chan, size_t threads);
+  Pending sendCached(span<std::array<block, 2>> messages, ChannelWrapper &chan,
+                     const std::string &peer, size_t numThreads);
+  static void sendPlain(span<std::array<block, 2>> messages,
+                        ChannelWrapper &chan);
+
+  // reads and authenticates the entry at name, false if there is none or it
+  // was rejected; a rejected entry is removed
+  bool load(const std::string &name, block &ticket,
+            std::chrono::system_clock::time_point &created,
+            std::vector<block> &payload, size_t numOTs, size_t payloadBlocks);
+  // the entry at name, left to Pending to move into place
+  std::unique_ptr<AtomicFileWriter> write(
+      const std::string &name, const block &ticket,
+      std::chrono::system_clock::time_point created,
+      const std::vector<block> &payload, size_t numOTs);
+
+  std::string dir_;
+  block storage_key_;
+  std::chrono::seconds max_age_;
+};
+}  // namespace droidCrypto
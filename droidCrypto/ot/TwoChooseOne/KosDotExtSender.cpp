@@ -10,6 +10,8 @@ namespace droidCrypto {
 
 std::unique_ptr<OtExtSender> KosDotExtSender::split() {
   auto dot = new KosDotExtSender();
+  // the splits extend OTs with the same delta, e.g. the R of a garbler
+  dot->mDelta = mDelta;
   std::unique_ptr<OtExtSender> ret(dot);
   std::vector<block> baseRecvOts(mGens.size());
   for (uint64_t i = 0; i < mGens.size(); ++i)
@@ -40,7 +42,12 @@ void KosDotExtSender::send(span<std::array<block, 2>> messages, PRNG &prng,
 
   // a temp that will be used to transpose the sender's matrix
   Matrix<uint8_t> t(mGens.size(), superBlkSize * sizeof(block));
-  std::vector<std::array<block, superBlkSize>> u(mGens.size() * commStepSize);
+  // two buffers for u, the next step is received while this one is processed
+  std::array<std::vector<std::array<block, superBlkSize>>, 2> u;
+  u[0].resize(mGens.size() * commStepSize);
+  u[1].resize(mGens.size() * commStepSize);
+  size_t uIdx = 0;
+  std::future<void> uNext;
 
   std::vector<block> choiceMask(mBaseChoiceBits.size());
   std::array<block, 2> delta{ZeroBlock, ZeroBlock};
@@ -65,16 +72,29 @@ void KosDotExtSender::send(span<std::array<block, 2>> messages, PRNG &prng,
       messages.end() - std::min<uint64_t>(128 * superBlkSize, messages.size());
 
   // set uIter = to the end so that it gets loaded on the first loop.
-  block *uIter = (block *)u.data() + superBlkSize * mGens.size() * commStepSize;
+  block *uIter = nullptr;
   block *uEnd = uIter;
 
   for (uint64_t superBlkIdx = 0; superBlkIdx < numSuperBlocks; ++superBlkIdx) {
     if (uIter == uEnd) {
       uint64_t step = std::min<uint64_t>(numSuperBlocks - superBlkIdx,
                                          (uint64_t)commStepSize);
-      chl.recv((uint8_t *)u.data(),
-               step * superBlkSize * mGens.size() * sizeof(block));
-      uIter = (block *)u.data();
+      if (!uNext.valid())
+        uNext = chl.recvAsync((uint8_t *)u[uIdx].data(),
+                              step * superBlkSize * mGens.size() * sizeof(block));
+      uNext.get();
+      uIter = (block *)u[uIdx].data();
+      uEnd = uIter + superBlkSize * mGens.size() * commStepSize;
+
+      uint64_t nextIdx = superBlkIdx + step;
+      if (nextIdx < numSuperBlocks) {
+        uint64_t nextStep = std::min<uint64_t>(numSuperBlocks - nextIdx,
+                                               (uint64_t)commStepSize);
+        uNext =
+            chl.recvAsync((uint8_t *)u[uIdx ^ 1].data(),
+                          nextStep * superBlkSize * mGens.size() * sizeof(block));
+      }
+      uIdx ^= 1;
     }
 
     block *cIter = choiceMask.data();
@@ -186,8 +206,10 @@ void KosDotExtSender::send(span<std::array<block, 2>> messages, PRNG &prng,
 
     uint64_t i = 0, dd = doneIdx;
     for (; dd < stop0; ++dd, ++i) {
-      Utils::mul256(messages[dd][0], messages[dd][1], challenges[i],
-                    challenges2[i], qi1, qi2, qi3, qi4);
+      // only the low block was transposed into, the high one still holds
+      // whatever the caller's buffer did
+      Utils::mul256(messages[dd][0], ZeroBlock, challenges[i], challenges2[i],
+                    qi1, qi2, qi3, qi4);
 
       q1 = q1 ^ qi1;
       q2 = q2 ^ qi2;
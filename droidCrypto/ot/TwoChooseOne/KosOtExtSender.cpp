@@ -52,7 +52,12 @@ namespace droidCrypto
 
         // a temp that will be used to transpose the sender's matrix
         std::array<std::array<block, superBlkSize>, 128> t;
-        std::vector<std::array<block, superBlkSize>> u(128 * commStepSize);
+        // two buffers for u, the next step is received while this one is processed
+        std::array<std::vector<std::array<block, superBlkSize>>, 2> u;
+        u[0].resize(128 * commStepSize);
+        u[1].resize(128 * commStepSize);
+        size_t uIdx = 0;
+        std::future<void> uNext;
 
         std::array<block, 128> choiceMask;
         block delta = *(block*)mBaseChoiceBits.data();
@@ -72,7 +77,7 @@ namespace droidCrypto
 
         auto mIter = messages.begin();
 
-        block * uIter = (block*)u.data() + superBlkSize * 128 * commStepSize;
+        block * uIter = nullptr;
         block * uEnd = uIter;
 
         for (uint64_t superBlkIdx = 0; superBlkIdx < numSuperBlocks; ++superBlkIdx)
@@ -85,8 +90,19 @@ namespace droidCrypto
             {
                 uint64_t step = std::min<uint64_t>(numSuperBlocks - superBlkIdx,(uint64_t) commStepSize);
 
-                chl.recv((uint8_t*)u.data(), step * superBlkSize * 128 * sizeof(block));
-                uIter = (block*)u.data();
+                if (!uNext.valid())
+                    uNext = chl.recvAsync((uint8_t*)u[uIdx].data(), step * superBlkSize * 128 * sizeof(block));
+                uNext.get();
+                uIter = (block*)u[uIdx].data();
+                uEnd = uIter + superBlkSize * 128 * commStepSize;
+
+                uint64_t nextIdx = superBlkIdx + step;
+                if (nextIdx < numSuperBlocks)
+                {
+                    uint64_t nextStep = std::min<uint64_t>(numSuperBlocks - nextIdx,(uint64_t) commStepSize);
+                    uNext = chl.recvAsync((uint8_t*)u[uIdx ^ 1].data(), nextStep * superBlkSize * 128 * sizeof(block));
+                }
+                uIdx ^= 1;
             }
 
             // transpose 128 columns at at time. Each column will be 128 * superBlkSize = 1024 bits long.
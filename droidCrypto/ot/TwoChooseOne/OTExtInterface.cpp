@@ -0,0 +1,22 @@
+#include <droidCrypto/ot/TwoChooseOne/OTExtInterface.h>
+#include <droidCrypto/ot/TwoChooseOne/KosOtExtReceiver.h>
+#include <droidCrypto/ot/TwoChooseOne/KosOtExtSender.h>
+#include <droidCrypto/ot/TwoChooseOne/SoftSpokenOtExt.h>
+
+namespace droidCrypto {
+
+std::unique_ptr<OtExtSender> newOtExtSender(
+    size_t softSpokenK /*=OT_EXT_SOFTSPOKEN_K*/) {
+  if (softSpokenK == 0)
+    return std::unique_ptr<OtExtSender>(new KosOtExtSender());
+  return std::unique_ptr<OtExtSender>(new SoftSpokenOtExtSender(softSpokenK));
+}
+
+std::unique_ptr<OtExtReceiver> newOtExtReceiver(
+    size_t softSpokenK /*=OT_EXT_SOFTSPOKEN_K*/) {
+  if (softSpokenK == 0)
+    return std::unique_ptr<OtExtReceiver>(new KosOtExtReceiver());
+  return std::unique_ptr<OtExtReceiver>(
+      new SoftSpokenOtExtReceiver(softSpokenK));
+}
+}  // namespace droidCrypto
@@ -59,4 +59,15 @@ class OtExtSender : public OtSender {
   virtual std::unique_ptr<OtExtSender> split() = 0;
 };
 
+// The OT extension for protocols that work with any: KOS for 0, SoftSpoken
+// with that many field bits otherwise. Both ends have to use the same, the
+// default is set at compile time by OT_EXT_SOFTSPOKEN_K.
+#ifndef OT_EXT_SOFTSPOKEN_K
+#define OT_EXT_SOFTSPOKEN_K 0
+#endif
+std::unique_ptr<OtExtSender> newOtExtSender(
+    size_t softSpokenK = OT_EXT_SOFTSPOKEN_K);
+std::unique_ptr<OtExtReceiver> newOtExtReceiver(
+    size_t softSpokenK = OT_EXT_SOFTSPOKEN_K);
+
 }  // namespace droidCrypto
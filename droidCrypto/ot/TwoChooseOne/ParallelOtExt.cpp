@@ -0,0 +1,99 @@
+#include <droidCrypto/ot/TwoChooseOne/ParallelOtExt.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/PRNG.h>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace droidCrypto {
+
+namespace {
+// the number of splits for numOTs OTs, the same on both ends
+size_t numSplits(size_t numThreads, size_t numOTs) {
+  return std::max<size_t>(
+      std::min<size_t>(numThreads, numOTs / gOtExtMinSplitSize), 1);
+}
+
+// first OT of split i out of splits, on a multiple of 128
+size_t splitBegin(size_t numOTs, size_t i, size_t splits) {
+  return std::min<size_t>(roundUpTo((numOTs + splits - 1) / splits, 128) * i,
+                          numOTs);
+}
+
+// runs extend(split, begin, end, chan) for every split, the first on the
+// calling thread
+void runSplits(size_t numOTs, size_t splits, ChannelWrapper &chan,
+               const std::function<void(size_t, size_t, size_t,
+                                        ChannelWrapper &)> &extend) {
+  ChannelMux mux(chan, splits);
+  std::vector<std::exception_ptr> errors(splits);
+  auto work = [&](size_t i) {
+    try {
+      extend(i, splitBegin(numOTs, i, splits),
+             splitBegin(numOTs, i + 1, splits), mux.stream(i));
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < splits; i++) threads.emplace_back(work, i);
+  work(0);
+  for (std::thread &t : threads) t.join();
+  for (std::exception_ptr &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+}
+}  // namespace
+
+void otExtSendParallel(OtExtSender &sender,
+                       span<std::array<block, 2>> messages, PRNG &prng,
+                       ChannelWrapper &chan, size_t numThreads) {
+  const size_t numOTs = messages.size();
+  const size_t splits = numSplits(numThreads, numOTs);
+  if (splits == 1) {
+    sender.send(messages, prng, chan);
+    return;
+  }
+
+  // splits and their PRNGs are made up front, split() is not thread safe
+  std::vector<std::unique_ptr<OtExtSender>> senders;
+  std::vector<PRNG> prngs;
+  for (size_t i = 0; i < splits; i++) {
+    senders.push_back(sender.split());
+    prngs.emplace_back(prng.get<block>());
+  }
+  runSplits(numOTs, splits, chan,
+            [&](size_t i, size_t begin, size_t end, ChannelWrapper &stream) {
+              senders[i]->send(messages.subspan(begin, end - begin), prngs[i],
+                               stream);
+            });
+}
+
+void otExtReceiveParallel(OtExtReceiver &receiver, const BitVector &choices,
+                          span<block> messages, PRNG &prng,
+                          ChannelWrapper &chan, size_t numThreads) {
+  const size_t numOTs = messages.size();
+  const size_t splits = numSplits(numThreads, numOTs);
+  if (splits == 1) {
+    receiver.receive(choices, messages, prng, chan);
+    return;
+  }
+
+  std::vector<std::unique_ptr<OtExtReceiver>> receivers;
+  std::vector<PRNG> prngs;
+  for (size_t i = 0; i < splits; i++) {
+    receivers.push_back(receiver.split());
+    prngs.emplace_back(prng.get<block>());
+  }
+  runSplits(numOTs, splits, chan,
+            [&](size_t i, size_t begin, size_t end, ChannelWrapper &stream) {
+              BitVector c;
+              c.copy(choices, begin, end - begin);
+              receivers[i]->receive(c, messages.subspan(begin, end - begin),
+                                    prngs[i], stream);
+            });
+}
+}  // namespace droidCrypto
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <droidCrypto/ot/TwoChooseOne/OTExtInterface.h>
+#include <array>
+
+namespace droidCrypto {
+
+// every split extends at least this many OTs, smaller ones are not worth a
+// thread and another 128 OTs for the consistency check
+const uint64_t gOtExtMinSplitSize(1 << 16);
+
+// Extends messages.size() OTs as independent extensions on several threads:
+// the extender is split() once per thread and each split extends a
+// contiguous range of the messages on its own stream of a ChannelMux over
+// chan. Nothing is exchanged to split them, the other end has to call
+// otExtReceiveParallel with the same number of OTs and numThreads, like the
+// threads both ends agreed on with BaseOtCache. With a single split the
+// extender itself runs on chan, as the plain extension.
+void otExtSendParallel(OtExtSender &sender,
+                       span<std::array<block, 2>> messages, PRNG &prng,
+                       ChannelWrapper &chan, size_t numThreads);
+
+void otExtReceiveParallel(OtExtReceiver &receiver, const BitVector &choices,
+                          span<block> messages, PRNG &prng,
+                          ChannelWrapper &chan, size_t numThreads);
+}  // namespace droidCrypto
@@ -0,0 +1,504 @@
+#include <droidCrypto/ot/TwoChooseOne/SoftSpokenOtExt.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/Commit.h>
+#include <droidCrypto/PRNG.h>
+#include <droidCrypto/utils/Utils.h>
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+namespace {
+size_t numFields(size_t k) { return (gOtExtBaseOtCount + k - 1) / k; }
+
+// bits of field f, the last one may be smaller
+size_t fieldSize(size_t k, size_t f) {
+  return std::min<size_t>(k, gOtExtBaseOtCount - f * k);
+}
+
+void checkFieldBits(size_t k) {
+  if (k < 1 || k > 8)
+    throw std::runtime_error("SoftSpoken field bits have to be 1 to 8");
+}
+
+// the two children of a GGM tree node
+void expand(const block &node, block *children) {
+  AES(node).encryptCTR(0, 2, children);
+}
+
+// r holds superBlkSize blocks of the expansion of each of the 2^bits seeds.
+// Writes v[l] = XOR of the expansions of seeds with bit l set, for each l,
+// and leaves the XOR of all in r[0], with about 2^(bits+1) XORs of rows.
+void sumSeeds(block *r, size_t bits, block *v) {
+  const size_t n = size_t(1) << bits;
+  for (size_t l = 0; l < bits; l++) {
+    const size_t step = size_t(1) << l;
+    block *out = v + l * superBlkSize;
+    for (size_t j = 0; j < superBlkSize; j++) out[j] = ZeroBlock;
+    // r[i] holds the sum of the seeds i..i + step, with bit l set for odd
+    // i / step
+    for (size_t i = 0; i < n; i += 2 * step) {
+      block *a = r + i * superBlkSize;
+      const block *b = r + (i + step) * superBlkSize;
+      for (size_t j = 0; j < superBlkSize; j++) {
+        out[j] = out[j] ^ b[j];
+        a[j] = a[j] ^ b[j];
+      }
+    }
+  }
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+// SoftSpokenOtExtSender
+//----------------------------------------------------------------------------------------------------------------------
+SoftSpokenOtExtSender::SoftSpokenOtExtSender(size_t k /*=4*/) : mK(k) {
+  checkFieldBits(k);
+}
+
+std::unique_ptr<OtExtSender> SoftSpokenOtExtSender::split() {
+  auto ret = new SoftSpokenOtExtSender(mK);
+  ret->mBaseChoiceBits = mBaseChoiceBits;
+  if (mSeeds.empty()) {
+    // no trees yet, the split gets new base OTs and its own trees
+    for (size_t i = 0; i < gOtExtBaseOtCount; i++)
+      AES(mBaseOts[i]).encryptCTR(mBlockIdx, 1, &ret->mBaseOts[i]);
+    mBlockIdx++;
+    return std::unique_ptr<OtExtSender>(ret);
+  }
+  ret->mSeeds.resize(mSeeds.size());
+  // the seeds the receiver derives as well, the punctured one stays unknown
+  for (size_t f = 0; f < mSeeds.size(); f++) {
+    const size_t p = punctured(f);
+    ret->mSeeds[f].resize(mSeeds[f].size());
+    for (size_t x = 0; x < mSeeds[f].size(); x++) {
+      if (x == p) continue;
+      block seed;
+      mSeeds[f][x].encryptCTR(mBlockIdx, 1, &seed);
+      ret->mSeeds[f][x].setKey(seed);
+    }
+  }
+  mBlockIdx++;
+  return std::unique_ptr<OtExtSender>(ret);
+}
+
+size_t SoftSpokenOtExtSender::punctured(size_t f) const {
+  size_t p = 0;
+  for (size_t l = 0; l < fieldSize(mK, f); l++)
+    p |= size_t(mBaseChoiceBits[f * mK + l]) << l;
+  return p;
+}
+
+void SoftSpokenOtExtSender::setBaseOts(span<block> baseRecvOts,
+                                       const BitVector &choices) {
+  if (baseRecvOts.size() != gOtExtBaseOtCount ||
+      choices.size() != gOtExtBaseOtCount)
+    throw std::runtime_error("not supported/implemented");
+
+  mBaseChoiceBits = choices;
+  std::copy(baseRecvOts.begin(), baseRecvOts.end(), mBaseOts.begin());
+  mSeeds.clear();
+  mBlockIdx = 0;
+}
+
+void SoftSpokenOtExtSender::recvTrees(ChannelWrapper &chan) {
+  std::vector<block> sums(2 * gOtExtBaseOtCount);
+  chan.recv(sums);
+
+  mSeeds.resize(numFields(mK));
+  for (size_t f = 0; f < mSeeds.size(); f++) {
+    const size_t bits = fieldSize(mK, f);
+    const size_t p = punctured(f);
+
+    // nodes of depth d are at their d low bits, all but the one on the path
+    // to p are known
+    std::vector<block> nodes(size_t(1) << bits, ZeroBlock);
+    for (size_t d = 0; d < bits; d++) {
+      const size_t width = size_t(1) << d;
+      const size_t path = p & (width - 1);
+      const size_t pd = (p >> d) & 1;
+      const size_t base = f * mK + d;
+      // the sum of the children off the path side, from the base OT
+      block sibling = sums[2 * base + (pd ^ 1)] ^ mBaseOts[base];
+      for (size_t i = 0; i < width; i++) {
+        if (i == path) continue;
+        std::array<block, 2> children;
+        expand(nodes[i], children.data());
+        nodes[i] = children[0];
+        nodes[i | width] = children[1];
+        sibling = sibling ^ children[pd ^ 1];
+      }
+      nodes[path | ((pd ^ 1) << d)] = sibling;
+    }
+    mSeeds[f].resize(nodes.size());
+    for (size_t x = 0; x < nodes.size(); x++) {
+      if (x != p) mSeeds[f][x].setKey(nodes[x]);
+    }
+  }
+}
+
+void SoftSpokenOtExtSender::send(span<std::array<block, 2>> messages,
+                                 PRNG &prng, ChannelWrapper &chan) {
+  if (!hasBaseOts()) throw std::runtime_error("rt error at " LOCATION);
+  if (mSeeds.empty()) recvTrees(chan);
+
+  const size_t fields = mSeeds.size();
+  // round up, with at least 128 extra OTs for the check
+  uint64_t numOtExt = roundUpTo(messages.size(), 128);
+  uint64_t numSuperBlocks = (numOtExt / 128 + superBlkSize) / superBlkSize;
+
+  // the columns of q, the correlations of the fields fill consecutive rows
+  std::array<std::array<block, superBlkSize>, 128> t;
+  // expansions of the seeds of one field, shifted by the punctured index
+  std::vector<block> r((size_t(1) << mK) * superBlkSize);
+  // two buffers for the corrections of u, the next step is received while
+  // this one is processed
+  std::array<std::vector<block>, 2> u;
+  u[0].resize(fields * superBlkSize * commStepSize);
+  u[1].resize(fields * superBlkSize * commStepSize);
+  size_t uIdx = 0;
+  std::future<void> uNext;
+
+  std::array<block, 128> choiceMask;
+  block delta = *(block *)mBaseChoiceBits.data();
+  for (uint64_t i = 0; i < 128; ++i)
+    choiceMask[i] = mBaseChoiceBits[i] ? AllOneBlock : ZeroBlock;
+
+  std::array<block, 128> extraBlocks;
+  block *xIter = extraBlocks.data();
+
+  Commit theirSeedComm;
+  chan.recv(theirSeedComm.data(), theirSeedComm.size());
+
+  auto mIter = messages.begin();
+  block *uIter = nullptr;
+  block *uEnd = uIter;
+
+  for (uint64_t superBlkIdx = 0; superBlkIdx < numSuperBlocks; ++superBlkIdx) {
+    if (uIter == uEnd) {
+      uint64_t step = std::min<uint64_t>(numSuperBlocks - superBlkIdx,
+                                         (uint64_t)commStepSize);
+      if (!uNext.valid())
+        uNext = chan.recvAsync((uint8_t *)u[uIdx].data(),
+                               step * fields * superBlkSize * sizeof(block));
+      uNext.get();
+      uIter = u[uIdx].data();
+      uEnd = uIter + step * fields * superBlkSize;
+
+      uint64_t nextIdx = superBlkIdx + step;
+      if (nextIdx < numSuperBlocks) {
+        uint64_t nextStep = std::min<uint64_t>(numSuperBlocks - nextIdx,
+                                               (uint64_t)commStepSize);
+        uNext = chan.recvAsync(
+            (uint8_t *)u[uIdx ^ 1].data(),
+            nextStep * fields * superBlkSize * sizeof(block));
+      }
+      uIdx ^= 1;
+    }
+
+    for (size_t f = 0; f < fields; f++) {
+      const size_t bits = fieldSize(mK, f);
+      const size_t p = punctured(f);
+
+      // seed x ^ p goes to y, so the unknown seed p gets coefficient 0
+      for (size_t j = 0; j < superBlkSize; j++) r[j] = ZeroBlock;
+      for (size_t y = 1; y < (size_t(1) << bits); y++)
+        mSeeds[f][y ^ p].encryptCTR(mBlockIdx, superBlkSize,
+                                    &r[y * superBlkSize]);
+      block *w = t[f * mK].data();
+      sumSeeds(r.data(), bits, w);
+
+      // w_l = v_l ^ delta_l * u_f, the correction turns u_f into u
+      for (size_t l = 0; l < bits; l++) {
+        const block &mask = choiceMask[f * mK + l];
+        for (size_t j = 0; j < superBlkSize; j++)
+          w[l * superBlkSize + j] =
+              w[l * superBlkSize + j] ^ (uIter[j] & mask);
+      }
+      uIter += superBlkSize;
+    }
+    mBlockIdx += superBlkSize;
+
+    // transpose our 128 columns of 1024 bits. We will have 1024 rows,
+    // each 128 bits wide.
+    Utils::transpose128x1024(t);
+
+    auto mEnd = mIter + std::min<uint64_t>(128 * superBlkSize,
+                                           messages.end() - mIter);
+    // the rows not used for messages go to the extra blocks of the check
+    uint64_t unusedCount = (mIter - mEnd + 128 * superBlkSize);
+    block *xEnd = std::min(xIter + unusedCount, extraBlocks.data() + 128);
+
+    block *tIter = (block *)t.data();
+    block *tEnd = (block *)t.data() + 128 * superBlkSize;
+    while (mIter != mEnd) {
+      while (mIter != mEnd && tIter < tEnd) {
+        (*mIter)[0] = *tIter;
+        (*mIter)[1] = *tIter ^ delta;
+        tIter += superBlkSize;
+        mIter += 1;
+      }
+      tIter = tIter - 128 * superBlkSize + 1;
+    }
+    if (tIter < (block *)t.data()) tIter = tIter + 128 * superBlkSize - 1;
+    while (xIter != xEnd) {
+      while (xIter != xEnd && tIter < tEnd) {
+        *xIter = *tIter;
+        tIter += superBlkSize;
+        xIter += 1;
+      }
+      tIter = tIter - 128 * superBlkSize + 1;
+    }
+  }
+
+  // the KOS check that the receiver used the same u for all fields
+  block seed = prng.get<block>();
+  chan.send((uint8_t *)&seed, sizeof(block));
+  block theirSeed;
+  chan.recv((uint8_t *)&theirSeed, sizeof(block));
+  if (Commit(theirSeed) != theirSeedComm)
+    throw std::runtime_error("bad commit " LOCATION);
+  PRNG commonPrng(seed ^ theirSeed);
+
+  block qi, qi2;
+  block q1 = ZeroBlock, q2 = ZeroBlock;
+  uint64_t doneIdx = 0;
+  std::array<block, 128> challenges;
+  uint64_t bb = (messages.size() + 127) / 128;
+  for (uint64_t blockIdx = 0; blockIdx < bb; ++blockIdx) {
+    commonPrng.mAes.encryptCTR(doneIdx, 128, challenges.data());
+    uint64_t stop = std::min<uint64_t>(messages.size(), doneIdx + 128);
+    for (uint64_t i = 0, dd = doneIdx; dd < stop; ++dd, ++i) {
+      Utils::mul128(messages[dd][0], challenges[i], qi, qi2);
+      q1 = q1 ^ qi;
+      q2 = q2 ^ qi2;
+    }
+    mAesFixedKey.hashBlocks(messages[doneIdx].data(), 2 * (stop - doneIdx),
+                            messages[doneIdx].data());
+    doneIdx = stop;
+  }
+  for (block &blk : extraBlocks) {
+    block chii = commonPrng.get<block>();
+    Utils::mul128(blk, chii, qi, qi2);
+    q1 = q1 ^ qi;
+    q2 = q2 ^ qi2;
+  }
+
+  std::vector<block> data(3);
+  chan.recv(data);
+  // check t = x * Delta + q
+  block t1, t2;
+  Utils::mul128(data[0], delta, t1, t2);
+  t1 = t1 ^ q1;
+  t2 = t2 ^ q2;
+  if (neq(t1, data[1]) || neq(t2, data[2]))
+    throw std::runtime_error("SoftSpoken correlation check failed");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// SoftSpokenOtExtReceiver
+//----------------------------------------------------------------------------------------------------------------------
+SoftSpokenOtExtReceiver::SoftSpokenOtExtReceiver(size_t k /*=4*/) : mK(k) {
+  checkFieldBits(k);
+}
+
+std::unique_ptr<OtExtReceiver> SoftSpokenOtExtReceiver::split() {
+  auto ret = new SoftSpokenOtExtReceiver(mK);
+  ret->mHasBase = true;
+  if (mSeeds.empty()) {
+    // no trees yet, the split gets new base OTs and its own trees
+    for (size_t i = 0; i < gOtExtBaseOtCount; i++) {
+      for (size_t b = 0; b < 2; b++)
+        AES(mBaseOts[i][b]).encryptCTR(mBlockIdx, 1, &ret->mBaseOts[i][b]);
+    }
+    mBlockIdx++;
+    return std::unique_ptr<OtExtReceiver>(ret);
+  }
+  ret->mSeeds.resize(mSeeds.size());
+  for (size_t f = 0; f < mSeeds.size(); f++) {
+    ret->mSeeds[f].resize(mSeeds[f].size());
+    for (size_t x = 0; x < mSeeds[f].size(); x++) {
+      block seed;
+      mSeeds[f][x].encryptCTR(mBlockIdx, 1, &seed);
+      ret->mSeeds[f][x].setKey(seed);
+    }
+  }
+  mBlockIdx++;
+  return std::unique_ptr<OtExtReceiver>(ret);
+}
+
+void SoftSpokenOtExtReceiver::setBaseOts(
+    span<std::array<block, 2>> baseSendOts) {
+  if (baseSendOts.size() != gOtExtBaseOtCount)
+    throw std::runtime_error(LOCATION);
+  std::copy(baseSendOts.begin(), baseSendOts.end(), mBaseOts.begin());
+  mSeeds.clear();
+  mBlockIdx = 0;
+  mHasBase = true;
+}
+
+void SoftSpokenOtExtReceiver::sendTrees(PRNG &prng, ChannelWrapper &chan) {
+  std::vector<block> sums(2 * gOtExtBaseOtCount);
+
+  mSeeds.resize(numFields(mK));
+  for (size_t f = 0; f < mSeeds.size(); f++) {
+    const size_t bits = fieldSize(mK, f);
+    // nodes of depth d are at their d low bits
+    std::vector<block> nodes(size_t(1) << bits);
+    nodes[0] = prng.get<block>();
+    for (size_t d = 0; d < bits; d++) {
+      const size_t width = size_t(1) << d;
+      const size_t base = f * mK + d;
+      std::array<block, 2> levelSums = {ZeroBlock, ZeroBlock};
+      for (size_t i = 0; i < width; i++) {
+        std::array<block, 2> children;
+        expand(nodes[i], children.data());
+        nodes[i] = children[0];
+        nodes[i | width] = children[1];
+        levelSums[0] = levelSums[0] ^ children[0];
+        levelSums[1] = levelSums[1] ^ children[1];
+      }
+      // the sender learns the sum of the side it does not choose
+      sums[2 * base] = levelSums[0] ^ mBaseOts[base][1];
+      sums[2 * base + 1] = levelSums[1] ^ mBaseOts[base][0];
+    }
+    mSeeds[f].resize(nodes.size());
+    for (size_t x = 0; x < nodes.size(); x++) mSeeds[f][x].setKey(nodes[x]);
+  }
+  chan.send(sums);
+}
+
+void SoftSpokenOtExtReceiver::receive(const BitVector &choices,
+                                      span<block> messages, PRNG &prng,
+                                      ChannelWrapper &chan) {
+  if (!mHasBase) throw std::runtime_error("rt error at " LOCATION);
+  if (mSeeds.empty()) sendTrees(prng, chan);
+
+  const size_t fields = mSeeds.size();
+  // we are going to process OTs in blocks of 128 * superBlkSize messages.
+  uint64_t numOtExt = roundUpTo(choices.size(), 128);
+  uint64_t numSuperBlocks = (numOtExt / 128 + superBlkSize) / superBlkSize;
+  uint64_t numBlocks = numSuperBlocks * superBlkSize;
+
+  // commit to a seed for the challenges of the check
+  block seed = prng.get<block>();
+  Commit myComm(seed);
+  chan.send(myComm.data(), myComm.size());
+
+  // the choices as blocks, with random ones for the extra OTs of the check
+  BitVector choices2(numBlocks * 128);
+  choices2 = choices;
+  choices2.resize(numBlocks * 128);
+  for (uint64_t i = 0; i < 128; ++i) choices2[choices.size() + i] = prng.getBit();
+  auto choiceBlocks = choices2.getSpan<block>();
+
+  // the columns of t, the correlations of the fields fill consecutive rows
+  std::array<std::array<block, superBlkSize>, 128> t0;
+  // expansions of the seeds of one field
+  std::vector<block> r((size_t(1) << mK) * superBlkSize);
+
+  std::array<block, 128> extraBlocks;
+  block *xIter = extraBlocks.data();
+  auto mIter = messages.begin();
+
+  uint64_t step = std::min<uint64_t>(numSuperBlocks, (uint64_t)commStepSize);
+  std::vector<block> uBuff(step * fields * superBlkSize);
+  block *uIter = uBuff.data();
+  block *uEnd = uIter + uBuff.size();
+
+  for (uint64_t superBlkIdx = 0; superBlkIdx < numSuperBlocks; ++superBlkIdx) {
+    const block *cIter = choiceBlocks.data() + superBlkSize * superBlkIdx;
+
+    for (size_t f = 0; f < fields; f++) {
+      const size_t bits = fieldSize(mK, f);
+      for (size_t x = 0; x < (size_t(1) << bits); x++)
+        mSeeds[f][x].encryptCTR(mBlockIdx, superBlkSize, &r[x * superBlkSize]);
+      sumSeeds(r.data(), bits, t0[f * mK].data());
+      // u_f is the sum of all expansions, send its correction to u
+      for (size_t j = 0; j < superBlkSize; j++) uIter[j] = r[j] ^ cIter[j];
+      uIter += superBlkSize;
+    }
+    mBlockIdx += superBlkSize;
+
+    if (uIter == uEnd) {
+      chan.send(uBuff);
+      uint64_t step = std::min<uint64_t>(numSuperBlocks - superBlkIdx - 1,
+                                         (uint64_t)commStepSize);
+      if (step) {
+        uBuff.resize(step * fields * superBlkSize);
+        uIter = uBuff.data();
+        uEnd = uIter + uBuff.size();
+      }
+    }
+
+    // transpose our 128 columns of 1024 bits. We will have 1024 rows,
+    // each 128 bits wide.
+    Utils::transpose128x1024(t0);
+
+    auto mEnd = mIter + std::min<uint64_t>(128 * superBlkSize,
+                                           messages.end() - mIter);
+    // the rows not used for messages go to the extra blocks of the check
+    uint64_t unusedCount = mIter - mEnd + 128 * superBlkSize;
+    block *xEnd =
+        std::min<block *>(xIter + unusedCount, extraBlocks.data() + 128);
+
+    block *tIter = (block *)t0.data();
+    block *tEnd = (block *)t0.data() + 128 * superBlkSize;
+    while (mIter != mEnd) {
+      while (mIter != mEnd && tIter < tEnd) {
+        (*mIter) = *tIter;
+        tIter += superBlkSize;
+        mIter += 1;
+      }
+      tIter = tIter - 128 * superBlkSize + 1;
+    }
+    if (tIter < (block *)t0.data()) tIter = tIter + 128 * superBlkSize - 1;
+    while (xIter != xEnd) {
+      while (xIter != xEnd && tIter < tEnd) {
+        *xIter = *tIter;
+        tIter += superBlkSize;
+        xIter += 1;
+      }
+      tIter = tIter - 128 * superBlkSize + 1;
+    }
+  }
+
+  // the KOS check: x = sum chi_i u_i, t = sum chi_i t_i
+  block theirSeed;
+  chan.recv((uint8_t *)&theirSeed, sizeof(block));
+  chan.send((uint8_t *)&seed, sizeof(block));
+  PRNG commonPrng(seed ^ theirSeed);
+
+  std::vector<block> correlationData(3, ZeroBlock);
+  block &x = correlationData[0];
+  block &t = correlationData[1];
+  block &t2 = correlationData[2];
+  block ti, ti2;
+  uint64_t doneIdx = 0;
+  std::array<block, 128> challenges;
+  uint64_t bb = (messages.size() + 127) / 128;
+  for (uint64_t blockIdx = 0; blockIdx < bb; ++blockIdx) {
+    commonPrng.mAes.encryptCTR(doneIdx, 128, challenges.data());
+    uint64_t stop = std::min<uint64_t>(messages.size(), doneIdx + 128);
+    for (uint64_t i = 0, dd = doneIdx; dd < stop; ++dd, ++i) {
+      if (choices2[dd]) x = x ^ challenges[i];
+      Utils::mul128(messages[dd], challenges[i], ti, ti2);
+      t = t ^ ti;
+      t2 = t2 ^ ti2;
+    }
+    mAesFixedKey.hashBlocks(messages.data() + doneIdx, stop - doneIdx,
+                            messages.data() + doneIdx);
+    doneIdx = stop;
+  }
+  for (block &blk : extraBlocks) {
+    block chij = commonPrng.get<block>();
+    if (choices2[doneIdx++]) x = x ^ chij;
+    Utils::mul128(blk, chij, ti, ti2);
+    t = t ^ ti;
+    t2 = t2 ^ ti2;
+  }
+  chan.send(correlationData);
+}
+}  // namespace droidCrypto
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <droidCrypto/AES.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ot/TwoChooseOne/OTExtInterface.h>
+#include <array>
+#include <vector>
+
+namespace droidCrypto {
+
+// SoftSpoken OT extension (Roy, CRYPTO 2022) with the repetition code: the
+// 128 base OTs are grouped into fields of k bits and every field becomes a
+// small VOLE over GF(2^k). The receiver knows all 2^k seeds of a field, the
+// sender all but the one at its k bits of delta, punctured from a GGM tree.
+// Summing the seeds' expansions gives both the IKNP correlation
+// q = t ^ u * delta for the field's bits, at the cost of one correction of
+// u per field. The receiver sends 128 / k bits per OT instead of the 128 of
+// KOS, and each side expands about 2^k / k AES blocks per OT instead of 1-2.
+// k = 1 is IKNP. The outputs are checked and hashed as in KOS.
+//
+// The GGM trees are sent by the first receive(): 256 blocks that are masked
+// with the base OTs. split() derives new seeds once they exist, so those
+// splits need no trees of their own.
+class SoftSpokenOtExtSender : public OtExtSender {
+ public:
+  explicit SoftSpokenOtExtSender(size_t k = 4);
+
+  bool hasBaseOts() const override { return mBaseChoiceBits.size() > 0; }
+
+  std::unique_ptr<OtExtSender> split() override;
+
+  void setBaseOts(span<block> baseRecvOts, const BitVector &choices) override;
+
+  void send(span<std::array<block, 2>> messages, PRNG &prng,
+            ChannelWrapper &chan) override;
+
+  size_t fieldBits() const { return mK; }
+
+ private:
+  // rebuilds the seeds of the fields from the punctured GGM trees
+  void recvTrees(ChannelWrapper &chan);
+  // the seed of field f the sender does not know, its bits of delta
+  size_t punctured(size_t f) const;
+
+  size_t mK;
+  BitVector mBaseChoiceBits;
+  std::array<block, gOtExtBaseOtCount> mBaseOts;
+  // per field the AES of every seed but the punctured one, empty before the
+  // trees were received
+  std::vector<std::vector<AES>> mSeeds;
+  uint64_t mBlockIdx = 0;
+};
+
+class SoftSpokenOtExtReceiver : public OtExtReceiver {
+ public:
+  explicit SoftSpokenOtExtReceiver(size_t k = 4);
+
+  bool hasBaseOts() const override { return mHasBase; }
+
+  std::unique_ptr<OtExtReceiver> split() override;
+
+  void setBaseOts(span<std::array<block, 2>> baseSendOts) override;
+
+  void receive(const BitVector &choices, span<block> messages, PRNG &prng,
+               ChannelWrapper &chan) override;
+
+  size_t fieldBits() const { return mK; }
+
+ private:
+  // picks the GGM trees and sends their level sums under the base OTs
+  void sendTrees(PRNG &prng, ChannelWrapper &chan);
+
+  size_t mK;
+  bool mHasBase = false;
+  std::array<std::array<block, 2>, gOtExtBaseOtCount> mBaseOts;
+  // per field the AES of all its seeds, empty before the trees were sent
+  std::vector<std::vector<AES>> mSeeds;
+  uint64_t mBlockIdx = 0;
+};
+}  // namespace droidCrypto
@@ -0,0 +1,46 @@
+#include <droidCrypto/ot/TwoChooseOne/StreamingOtExt.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ot/TwoChooseOne/ParallelOtExt.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace droidCrypto {
+namespace {
+void checkWindow(size_t window) {
+  if (window == 0 || window % 128 != 0)
+    throw std::runtime_error("OT window is not a multiple of 128");
+}
+}  // namespace
+
+void otExtSendStreaming(OtExtSender &sender, size_t numOTs, PRNG &prng,
+                        ChannelWrapper &chan, const OtSendConsumer &consume,
+                        size_t window /* = gOtExtStreamWindow */,
+                        size_t numThreads /* = 1 */) {
+  checkWindow(window);
+  std::vector<std::array<block, 2>> buf(std::min(window, numOTs));
+  for (size_t begin = 0; begin < numOTs; begin += window) {
+    span<std::array<block, 2>> messages(buf.data(),
+                                        std::min(window, numOTs - begin));
+    otExtSendParallel(sender, messages, prng, chan, numThreads);
+    consume(begin, messages);
+  }
+}
+
+void otExtReceiveStreaming(OtExtReceiver &receiver, const BitVector &choices,
+                           PRNG &prng, ChannelWrapper &chan,
+                           const OtRecvConsumer &consume,
+                           size_t window /* = gOtExtStreamWindow */,
+                           size_t numThreads /* = 1 */) {
+  checkWindow(window);
+  const size_t numOTs = choices.size();
+  std::vector<block> buf(std::min(window, numOTs));
+  for (size_t begin = 0; begin < numOTs; begin += window) {
+    span<block> messages(buf.data(), std::min(window, numOTs - begin));
+    BitVector c;
+    c.copy(choices, begin, messages.size());
+    otExtReceiveParallel(receiver, c, messages, prng, chan, numThreads);
+    consume(begin, messages);
+  }
+}
+}  // namespace droidCrypto
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <droidCrypto/ot/TwoChooseOne/OTExtInterface.h>
+#include <array>
+#include <functional>
+
+namespace droidCrypto {
+
+// OTs per window of the streaming extension, 32MiB of sender messages. Each
+// window costs a round for the consistency check, consume uses chan between
+// the windows so they cannot overlap.
+const uint64_t gOtExtStreamWindow(1 << 20);
+
+using OtSendConsumer =
+    std::function<void(size_t begin, span<std::array<block, 2>> messages)>;
+using OtRecvConsumer =
+    std::function<void(size_t begin, span<block> messages)>;
+
+// Extends numOTs OTs window by window and hands each window to consume,
+// with the index of its first OT, before the next one is extended, so only
+// one window of OTs is ever in memory. Every window is an extension of its
+// own with otExtSendParallel on up to numThreads threads. consume may use
+// chan as long as the other end does the same in the same order. The other
+// end has to call otExtReceiveStreaming with the same numOTs, numThreads
+// and window. Throws std::runtime_error if window is not a non-zero multiple
+// of 128, the consistency checks work on blocks of 128 OTs.
+void otExtSendStreaming(OtExtSender &sender, size_t numOTs, PRNG &prng,
+                        ChannelWrapper &chan, const OtSendConsumer &consume,
+                        size_t window = gOtExtStreamWindow,
+                        size_t numThreads = 1);
+
+// choices holds the choice bits of all numOTs = choices.size() OTs
+void otExtReceiveStreaming(OtExtReceiver &receiver, const BitVector &choices,
+                           PRNG &prng, ChannelWrapper &chan,
+                           const OtRecvConsumer &consume,
+                           size_t window = gOtExtStreamWindow,
+                           size_t numThreads = 1);
+}  // namespace droidCrypto
@@ -12,6 +12,10 @@ extern "C" {
 
 #include <droidCrypto/BitVector.h>
 #include <droidCrypto/ChannelWrapper.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
 
 namespace droidCrypto {
 static rand_source makeRandSource(PRNG &prng) {
@@ -25,68 +29,113 @@ static rand_source makeRandSource(PRNG &prng) {
   return rand;
 }
 
+// runs work(worker, begin, end) on numThreads ranges of the n OTs, the
+// first on the calling thread
+static void parallelFor(
+    size_t n, size_t numThreads,
+    const std::function<void(size_t, size_t, size_t)> &work) {
+  std::vector<std::thread> threads;
+  for (size_t w = 1; w < numThreads; w++) {
+    threads.emplace_back(work, w, n * w / numThreads,
+                         n * (w + 1) / numThreads);
+  }
+  work(0, 0, n / numThreads);
+  for (std::thread &t : threads) t.join();
+}
+
+static size_t clampThreads(uint64_t numThreads, size_t n) {
+  return std::max<size_t>(std::min<size_t>(numThreads, n), 1);
+}
+
+uint64_t VerifiedSimplestOT::defaultNumThreads() {
+  return std::min<uint64_t>(
+      std::max(std::thread::hardware_concurrency(), 1u), gBaseOtMaxThreads);
+}
+
 void VerifiedSimplestOT::receive(const BitVector &choices, span<block> msg,
-                                 PRNG &prng, ChannelWrapper &chl) {
+                                 PRNG &prng, ChannelWrapper &chl,
+                                 uint64_t numThreads) {
+  const size_t n = msg.size();
+  numThreads = clampThreads(numThreads, n);
   RECEIVER receiver;
 
-  uint8_t Rs_pack[SIMPLEST_OT_PACKBYTES];
-  uint8_t keys[SIMPLEST_OT_HASHBYTES];
-  uint8_t cs;
   uint8_t temp[2][SIMPLEST_OT_HASHBYTES];
   std::pair<std::vector<std::array<uint8_t, SIMPLEST_OT_HASHBYTES>>,
             std::vector<std::array<uint8_t, SIMPLEST_OT_HASHBYTES>>>
       challenges;
-  challenges.first.resize(msg.size());
-  challenges.second.resize(msg.size());
-
-  chl.recv(receiver.S_pack, sizeof(receiver.S_pack));
-  chl.recv(receiver.A_pack, sizeof(receiver.A_pack));
-  chl.recv(receiver.z, sizeof(receiver.z));
+  challenges.first.resize(n);
+  challenges.second.resize(n);
+
+  {
+    std::array<uint8_t, sizeof(receiver.S_pack) + sizeof(receiver.A_pack) +
+                            sizeof(receiver.z)>
+        buf;
+    chl.recv(buf.data(), buf.size());
+    memcpy(receiver.S_pack, buf.data(), sizeof(receiver.S_pack));
+    memcpy(receiver.A_pack, buf.data() + sizeof(receiver.S_pack),
+           sizeof(receiver.A_pack));
+    memcpy(receiver.z,
+           buf.data() + sizeof(receiver.S_pack) + sizeof(receiver.A_pack),
+           sizeof(receiver.z));
+  }
 
   receiver_procSandVerify(&receiver);
 
-  auto rand = makeRandSource(prng);
-
-  for (uint32_t i = 0; i < msg.size(); i++) {
-    cs = choices[i];
-
-    receiver_rsgen(&receiver, Rs_pack, cs, rand);
-
-    chl.send(Rs_pack, sizeof(Rs_pack));
-
-    receiver_keygen(&receiver, keys);
-
-    memcpy(&msg[i], keys, sizeof(block));
-  }
+  // every OT keeps its secret in a RECEIVER of its own, every worker draws
+  // them from a PRNG of its own
+  std::vector<RECEIVER> receivers(n, receiver);
+  std::vector<PRNG> prngs;
+  for (size_t w = 0; w < numThreads; w++) prngs.emplace_back(prng.get<block>());
+  std::vector<uint8_t> Rs_packs(n * SIMPLEST_OT_PACKBYTES);
+  parallelFor(n, numThreads, [&](size_t w, size_t begin, size_t end) {
+    auto rand = makeRandSource(prngs[w]);
+    for (size_t i = begin; i < end; i++) {
+      receiver_rsgen(&receivers[i], &Rs_packs[i * SIMPLEST_OT_PACKBYTES],
+                     choices[i], rand);
+    }
+  });
+  chl.send(Rs_packs.data(), Rs_packs.size());
+
+  // the keys are derived while the sender does the same
+  parallelFor(n, numThreads, [&](size_t w, size_t begin, size_t end) {
+    uint8_t keys[SIMPLEST_OT_HASHBYTES];
+    for (size_t i = begin; i < end; i++) {
+      receiver_keygen(&receivers[i], keys);
+      memcpy(&msg[i], keys, sizeof(block));
+    }
+  });
 
   // additional verification step
   // receive Xi values
-  for (uint32_t i = 0; i < msg.size(); i++) {
+  for (uint32_t i = 0; i < n; i++) {
     crypto_hash(challenges.first[i].data(), (uint8_t *)&msg[i], sizeof(block));
   }
-  chl.recv(challenges.second[0].data(), SIMPLEST_OT_HASHBYTES * msg.size());
-  // send response
-  for (uint32_t i = 0; i < msg.size(); i++) {
+  chl.recv(challenges.second[0].data(), SIMPLEST_OT_HASHBYTES * n);
+  // send all responses at once
+  std::vector<std::array<uint8_t, SIMPLEST_OT_HASHBYTES>> responses(n);
+  for (uint32_t i = 0; i < n; i++) {
     // calculate response
-    crypto_hash(temp[0], challenges.first[i].data(), SIMPLEST_OT_HASHBYTES);
+    crypto_hash(responses[i].data(), challenges.first[i].data(),
+                SIMPLEST_OT_HASHBYTES);
     uint8_t mask = (-choices[i]);
     for (uint32_t j = 0; j < SIMPLEST_OT_HASHBYTES; j++) {
-      temp[0][j] ^= mask & challenges.second[i][j];
+      responses[i][j] ^= mask & challenges.second[i][j];
     }
-    chl.send(temp[0], SIMPLEST_OT_HASHBYTES);
   }
+  chl.send(responses[0].data(), SIMPLEST_OT_HASHBYTES * n);
 
-  for (uint32_t i = 0; i < msg.size(); i++) {
-    // receive openings
-    chl.recv(temp[0], SIMPLEST_OT_HASHBYTES);
-    chl.recv(temp[1], SIMPLEST_OT_HASHBYTES);
+  // receive all openings
+  std::vector<std::array<std::array<uint8_t, SIMPLEST_OT_HASHBYTES>, 2>>
+      openings(n);
+  chl.recv(openings[0][0].data(), SIMPLEST_OT_HASHBYTES * 2 * n);
+  for (uint32_t i = 0; i < n; i++) {
     // verify openings
-    if (memcmp(temp[choices[i]], challenges.first[i].data(),
+    if (memcmp(openings[i][choices[i]].data(), challenges.first[i].data(),
                SIMPLEST_OT_HASHBYTES) != 0) {
       throw std::runtime_error("bad sender response " LOCATION);
     }
-    crypto_hash(temp[0], temp[0], SIMPLEST_OT_HASHBYTES);
-    crypto_hash(temp[1], temp[1], SIMPLEST_OT_HASHBYTES);
+    crypto_hash(temp[0], openings[i][0].data(), SIMPLEST_OT_HASHBYTES);
+    crypto_hash(temp[1], openings[i][1].data(), SIMPLEST_OT_HASHBYTES);
     for (uint32_t j = 0; j < SIMPLEST_OT_HASHBYTES; j++) {
       temp[0][j] ^= temp[1][j];
     }
@@ -98,58 +147,70 @@ void VerifiedSimplestOT::receive(const BitVector &choices, span<block> msg,
 }
 
 void VerifiedSimplestOT::send(span<std::array<block, 2>> msg, PRNG &prng,
-                              ChannelWrapper &chl) {
+                              ChannelWrapper &chl, uint64_t numThreads) {
+  const size_t n = msg.size();
+  numThreads = clampThreads(numThreads, n);
   SENDER sender;
 
-  uint8_t S_pack[SIMPLEST_OT_PACKBYTES];
-  uint8_t Rs_pack[SIMPLEST_OT_PACKBYTES];
   uint8_t keys[2][SIMPLEST_OT_HASHBYTES];
   std::vector<std::array<std::array<uint8_t, SIMPLEST_OT_HASHBYTES>, 2>>
       challenges;
-  challenges.resize(msg.size());
+  challenges.resize(n);
 
   auto rand = makeRandSource(prng);
 
-  sender_genSandProof(&sender, S_pack, rand);
-
-  chl.send(S_pack, sizeof(S_pack));
-  chl.send(sender.A_pack, sizeof(sender.A_pack));
-  chl.send(sender.z, sizeof(sender.z));
-
-  for (uint32_t i = 0; i < msg.size(); i++) {
-    chl.recv(Rs_pack, sizeof(Rs_pack));
-
-    sender_keygen(&sender, Rs_pack, keys);
-
-    memcpy(&msg[i][0], keys[0], sizeof(block));
-    memcpy(&msg[i][1], keys[1], sizeof(block));
+  {
+    std::array<uint8_t, SIMPLEST_OT_PACKBYTES + sizeof(sender.A_pack) +
+                            sizeof(sender.z)>
+        buf;
+    sender_genSandProof(&sender, buf.data(), rand);
+    memcpy(buf.data() + SIMPLEST_OT_PACKBYTES, sender.A_pack,
+           sizeof(sender.A_pack));
+    memcpy(buf.data() + SIMPLEST_OT_PACKBYTES + sizeof(sender.A_pack),
+           sender.z, sizeof(sender.z));
+    chl.send(buf.data(), buf.size());
   }
 
-  // calculate challenges Xi
-  for (uint32_t i = 0; i < msg.size(); i++) {
+  // all receiver points come in one message, sender_keygen only reads the
+  // SENDER and writes the point it is given
+  std::vector<uint8_t> Rs_packs(n * SIMPLEST_OT_PACKBYTES);
+  chl.recv(Rs_packs.data(), Rs_packs.size());
+  parallelFor(n, numThreads, [&](size_t w, size_t begin, size_t end) {
+    uint8_t keys[2][SIMPLEST_OT_HASHBYTES];
+    for (size_t i = begin; i < end; i++) {
+      sender_keygen(&sender, &Rs_packs[i * SIMPLEST_OT_PACKBYTES], keys);
+
+      memcpy(&msg[i][0], keys[0], sizeof(block));
+      memcpy(&msg[i][1], keys[1], sizeof(block));
+    }
+  });
+
+  // calculate challenges Xi and send them at once
+  std::vector<std::array<uint8_t, SIMPLEST_OT_HASHBYTES>> xis(n);
+  for (uint32_t i = 0; i < n; i++) {
     // calculate xi based on the two msg
     crypto_hash(challenges[i][0].data(), (uint8_t *)&msg[i][0], sizeof(block));
     crypto_hash(challenges[i][1].data(), (uint8_t *)&msg[i][1], sizeof(block));
-    // reuse key buffer for this
-    crypto_hash(keys[0], challenges[i][0].data(), SIMPLEST_OT_HASHBYTES);
+    crypto_hash(xis[i].data(), challenges[i][0].data(), SIMPLEST_OT_HASHBYTES);
     crypto_hash(keys[1], challenges[i][1].data(), SIMPLEST_OT_HASHBYTES);
     for (uint32_t j = 0; j < SIMPLEST_OT_HASHBYTES; j++) {
-      keys[0][j] ^= keys[1][j];
+      xis[i][j] ^= keys[1][j];
     }
-
-    chl.send(keys[0], SIMPLEST_OT_HASHBYTES);
   }
-  // receive and verify answers
-  for (uint32_t i = 0; i < msg.size(); i++) {
+  chl.send(xis[0].data(), SIMPLEST_OT_HASHBYTES * n);
+
+  // receive and verify all answers
+  std::vector<std::array<uint8_t, SIMPLEST_OT_HASHBYTES>> answers(n);
+  chl.recv(answers[0].data(), SIMPLEST_OT_HASHBYTES * n);
+  for (uint32_t i = 0; i < n; i++) {
     crypto_hash(keys[0], challenges[i][0].data(), SIMPLEST_OT_HASHBYTES);
-    chl.recv(keys[1], SIMPLEST_OT_HASHBYTES);
 
-    if (memcmp(keys[0], keys[1], SIMPLEST_OT_HASHBYTES) != 0) {
+    if (memcmp(keys[0], answers[i].data(), SIMPLEST_OT_HASHBYTES) != 0) {
       throw std::runtime_error("bad response " LOCATION);
     }
   }
   // open challenge to satisfy verifier
-  chl.send(challenges[0][0].data(), SIMPLEST_OT_HASHBYTES * 2 * msg.size());
+  chl.send(challenges[0][0].data(), SIMPLEST_OT_HASHBYTES * 2 * n);
 }
 
 }  // namespace droidCrypto
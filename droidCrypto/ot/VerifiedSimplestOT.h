@@ -11,23 +11,34 @@
 
 namespace droidCrypto {
 
+// Without a thread count the base OTs run on up to this many threads, the
+// 128 of an extension do not keep more of them busy.
+const uint64_t gBaseOtMaxThreads(4);
+
+// All base OTs are done in a constant number of messages: the receiver's
+// points go out in one, and so do the challenges, responses and openings of
+// the verification. The curve operations of both sides are spread over
+// numThreads threads.
 class VerifiedSimplestOT : public OtReceiver, public OtSender {
  public:
   void receive(const BitVector &choices, span<block> messages, PRNG &prng,
-               ChannelWrapper &chl, uint64_t numThreads) {
-    receive(choices, messages, prng, chl);
-  }
+               ChannelWrapper &chl, uint64_t numThreads);
 
   void send(span<std::array<block, 2>> messages, PRNG &prng,
-            ChannelWrapper &chl, uint64_t numThreads) {
-    send(messages, prng, chl);
-  }
+            ChannelWrapper &chl, uint64_t numThreads);
 
   void receive(const BitVector &choices, span<block> messages, PRNG &prng,
-               ChannelWrapper &chl) override;
+               ChannelWrapper &chl) override {
+    receive(choices, messages, prng, chl, defaultNumThreads());
+  }
 
   void send(span<std::array<block, 2>> messages, PRNG &prng,
-            ChannelWrapper &chl) override;
+            ChannelWrapper &chl) override {
+    send(messages, prng, chl, defaultNumThreads());
+  }
+
+ private:
+  static uint64_t defaultNumThreads();
 };
 }  // namespace droidCrypto
 
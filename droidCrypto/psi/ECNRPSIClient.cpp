@@ -4,8 +4,8 @@
 #include <droidCrypto/RCurve.h>
 #include <droidCrypto/SHA1.h>
 #include <droidCrypto/SHAKE128.h>
-#include <droidCrypto/ot/TwoChooseOne/KosOtExtReceiver.h>
-#include <droidCrypto/ot/VerifiedSimplestOT.h>
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/ot/TwoChooseOne/StreamingOtExt.h>
 #include <droidCrypto/psi/ECNRPSIClient.h>
 #include <droidCrypto/utils/Log.h>
 #include <endian.h>
@@ -13,8 +13,8 @@
 
 namespace droidCrypto {
 
-ECNRPSIClient::ECNRPSIClient(ChannelWrapper &chan)
-    : PhasedPSIClient(chan), cf_(nullptr) {}
+ECNRPSIClient::ECNRPSIClient(ChannelWrapper &chan, size_t num_threads /*=1*/)
+    : PhasedPSIClient(chan), num_threads_(num_threads), cf_(nullptr) {}
 
 void ECNRPSIClient::Setup() {
   uint64_t num_server_elements;
@@ -59,22 +59,18 @@ void ECNRPSIClient::Base(size_t num_elements) {
   size_t num_client_elements = htobe64(num_elements);
   channel_.send((uint8_t *)&num_client_elements, sizeof(num_client_elements));
 
-  VerifiedSimplestOT ot;
-
   size_t numBaseOTs = 128;
   std::vector<std::array<block, 2>> baseOTs;
   baseOTs.resize(numBaseOTs);
   PRNG p = PRNG::getTestPRNG();
   span<std::array<block, 2>> baseOTsSpan(baseOTs.data(), baseOTs.size());
-  ot.send(baseOTsSpan, p, channel_);
+  base_ot_entry_ = BaseOtCache::send(base_ot_cache_.get(), baseOTsSpan,
+                                     channel_, base_ot_peer_, num_threads_);
 
-  KosOtExtReceiver OTeRecv;
-  OTeRecv.setBaseOts(baseOTsSpan);
+  ot_ext_recv_ = newOtExtReceiver();
+  ot_ext_recv_->setBaseOts(baseOTsSpan);
   ot_choices_.resize(num_elements * 128);
   ot_choices_.randomize(p);
-  ots_.resize(num_elements * 128);
-  span<block> otSpan(ots_.data(), ots_.size());
-  OTeRecv.receive(ot_choices_, otSpan, p, channel_);
 }
 
 std::vector<size_t> ECNRPSIClient::Online(std::vector<block> &elements) {
@@ -83,44 +79,52 @@ std::vector<size_t> ECNRPSIClient::Online(std::vector<block> &elements) {
   PRNG p = PRNG::getTestPRNG();
 
   auto time4 = std::chrono::high_resolution_clock::now();
-  block *choices = (block *)ot_choices_.data();
+  // the random choices stay for the extension, the server gets them masked
+  BitVector masked(ot_choices_);
+  block *choices = (block *)masked.data();
   for (auto i = 0; i < elements.size(); i++) {
     choices[i] ^= elements[i];
   }
   auto time5 = std::chrono::high_resolution_clock::now();
-  channel_.send(ot_choices_.data(), elements.size() * 128 / 8);
+  channel_.send(masked.data(), elements.size() * 128 / 8);
   REllipticCurve curve;
   std::vector<std::array<uint8_t, 33>> prfOut;
   prfOut.reserve(elements.size());
-  for (auto i = 0; i < elements.size(); i++) {
-    BitVector bv;
-    bv.assign(elements[i]);
-    REccNumber r(curve, 1);
-    REccNumber rj(curve, 0);
-    std::array<uint8_t, 33> buf{};
-    std::array<uint8_t, 128 * 32 + 33> buf1{};
-    channel_.recv(buf1.data(), buf1.size());
-
-    for (auto j = 0; j < 128; j++) {
-      PRNG p_rj(ots_[i * 128 + j], 2);
-      p_rj.get(buf.data(), 32);
-      rj.fromBytes(buf.data());
-      rj.toBytes(buf.data());
-      if (bv[j]) {
-        for (auto k = 0; k < 32; k++) {
-          buf[k] ^= buf1[j * 32 + k];
+  // the OTs are extended with the server a window of elements at a time
+  auto oprf = [&](size_t begin, span<block> ots) {
+    for (size_t k = 0; k < (size_t)ots.size(); k += 128) {
+      const size_t i = (begin + k) / 128;
+      BitVector bv;
+      bv.assign(elements[i]);
+      REccNumber r(curve, 1);
+      REccNumber rj(curve, 0);
+      std::array<uint8_t, 33> buf{};
+      std::array<uint8_t, 128 * 32 + 33> buf1{};
+      channel_.recv(buf1.data(), buf1.size());
+
+      for (auto j = 0; j < 128; j++) {
+        PRNG p_rj(ots[k + j], 2);
+        p_rj.get(buf.data(), 32);
+        rj.fromBytes(buf.data());
+        rj.toBytes(buf.data());
+        if (bv[j]) {
+          for (auto l = 0; l < 32; l++) {
+            buf[l] ^= buf1[j * 32 + l];
+          }
         }
+        rj.fromBytes(buf.data());
+        r *= rj;
       }
-      rj.fromBytes(buf.data());
-      r *= rj;
+      REccPoint gT(curve);
+      gT.fromBytes(buf1.data() + 128 * 32);
+      gT = gT * r;
+      // std::cout << gT << "\n";
+      gT.toBytes(buf.data());
+      prfOut.push_back(buf);
     }
-    REccPoint gT(curve);
-    gT.fromBytes(buf1.data() + 128 * 32);
-    gT = gT * r;
-    // std::cout << gT << "\n";
-    gT.toBytes(buf.data());
-    prfOut.push_back(buf);
-  }
+  };
+  otExtReceiveStreaming(*ot_ext_recv_, ot_choices_, p, channel_, oprf,
+                        gOtExtStreamWindow, base_ot_entry_.threads());
   auto time6 = std::chrono::high_resolution_clock::now();
 
   std::chrono::duration<double> send = time5 - time4;
@@ -132,11 +136,19 @@ std::vector<size_t> ECNRPSIClient::Online(std::vector<block> &elements) {
   droidCrypto::Log::v("ECNR", "Sent: %zu, Recv: %zu", channel_.getBytesSent(),
                       channel_.getBytesRecv());
 
+  base_ot_entry_.commit();
+
   auto inter_start = std::chrono::high_resolution_clock::now();
   std::vector<size_t> res;
   // do intersection
+  std::vector<const uint64_t *> keys(prfOut.size());
+  for (size_t i = 0; i < prfOut.size(); i++) {
+    keys[i] = (const uint64_t *)prfOut[i].data();
+  }
+  BitVector found;
+  cf_->ContainBatch(span<const uint64_t *>(keys.data(), keys.size()), found);
   for (size_t i = 0; i < prfOut.size(); i++) {
-    if (cf_->Contain((uint64_t *)prfOut[i].data()) == cuckoofilter::Ok) {
+    if (found[i]) {
       Log::v("PSI", "Intersection C%d", i);
       res.push_back(i);
     }
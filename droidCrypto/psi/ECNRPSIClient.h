@@ -1,6 +1,8 @@
 #pragma once
 
 #include <droidCrypto/BitVector.h>
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/ot/TwoChooseOne/OTExtInterface.h>
 #include <droidCrypto/psi/PhasedPSIClient.h>
 #include "cuckoofilter/cuckoofilter.h"
 
@@ -8,7 +10,7 @@ namespace droidCrypto {
 
 class ECNRPSIClient : public PhasedPSIClient {
  public:
-  ECNRPSIClient(ChannelWrapper &chan);
+  ECNRPSIClient(ChannelWrapper &chan, size_t num_threads = 1);
 
   virtual ~ECNRPSIClient();
 
@@ -17,7 +19,11 @@ class ECNRPSIClient : public PhasedPSIClient {
   std::vector<size_t> Online(std::vector<block> &elements) override;
 
  private:
-  std::vector<block> ots_;
+  size_t num_threads_;
+  // set up by Base, extends the OTs for Online window by window
+  std::unique_ptr<OtExtReceiver> ot_ext_recv_;
+  // committed at the end of Online
+  BaseOtCache::Pending base_ot_entry_;
   BitVector ot_choices_;
   typedef cuckoofilter::CuckooFilter<
       uint64_t *, 32, cuckoofilter::SingleTable,
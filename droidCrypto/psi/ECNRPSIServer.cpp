@@ -3,8 +3,8 @@
 #include <droidCrypto/PRNG.h>
 #include <droidCrypto/SHA1.h>
 #include <droidCrypto/SHAKE128.h>
-#include <droidCrypto/ot/TwoChooseOne/KosOtExtSender.h>
-#include <droidCrypto/ot/VerifiedSimplestOT.h>
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/ot/TwoChooseOne/StreamingOtExt.h>
 #include <droidCrypto/psi/ECNRPSIServer.h>
 #include <droidCrypto/utils/Log.h>
 #include <endian.h>
@@ -63,11 +63,12 @@ void ECNRPSIServer::Setup(std::vector<block> &elements) {
   CuckooFilter cf(num_server_elements);
 
   auto time1 = std::chrono::high_resolution_clock::now();
-  for (size_t i = 0; i < num_server_elements; i++) {
-    auto success = cf.Add((uint64_t *)prfOut[i].data());
-    (void)success;
-    assert(success == cuckoofilter::Ok);
-  }
+  auto success = cf.AddParallel(
+      num_server_elements,
+      [&prfOut](size_t i) { return (uint64_t *)prfOut[i].data(); },
+      num_threads_);
+  (void)success;
+  assert(success == cuckoofilter::Ok);
   auto time2 = std::chrono::high_resolution_clock::now();
   Log::v("PSI", "Built CF");
   prfOut.clear();  // free some memory
@@ -119,30 +120,31 @@ void ECNRPSIServer::Base() {
   size_t numBaseOTs = 128;
   std::vector<block> baseOTs;
   BitVector baseChoices(numBaseOTs);
-  baseChoices.randomize(prng_);
   baseOTs.resize(numBaseOTs);
   span<block> baseOTsSpan(baseOTs.data(), baseOTs.size());
 
-  VerifiedSimplestOT ot;
-  ot.receive(baseChoices, baseOTsSpan, prng_, channel_);
-  KosOtExtSender otExtSender;
-  otExtSender.setBaseOts(baseOTsSpan, baseChoices);
-
-  ots_.resize(num_client_elements_ * 128);
-  span<std::array<block, 2>> otSpan(ots_.data(), ots_.size());
-  otExtSender.send(otSpan, prng_, channel_);
+  base_ot_entry_ = BaseOtCache::receive(base_ot_cache_.get(), baseChoices,
+                                        baseOTsSpan, channel_, num_threads_);
+  ot_ext_sender_ = newOtExtSender();
+  ot_ext_sender_->setBaseOts(baseOTsSpan, baseChoices);
 }
 
 void ECNRPSIServer::Online() {
-  std::vector<std::array<uint8_t, 32>> prfInOut;
   BitVector bv(128 * num_client_elements_);
 
   channel_.recv(bv.data(), num_client_elements_ * 128 / 8);
-  for (auto i = 0; i < num_client_elements_; i++) {
-    BitVector c;
-    c.copy(bv, 128 * i, 128);
-    span<std::array<block, 2>> otSpan(&ots_[i * 128], 128);
-    prf_.oprf(c, otSpan, channel_);
-  }
+  // the 128 OTs of every element are extended a window of elements at a
+  // time, right before their OPRFs
+  otExtSendStreaming(
+      *ot_ext_sender_, num_client_elements_ * 128, prng_, channel_,
+      [&](size_t begin, span<std::array<block, 2>> ots) {
+        for (size_t i = 0; i < (size_t)ots.size(); i += 128) {
+          BitVector c;
+          c.copy(bv, begin + i, 128);
+          prf_.oprf(c, ots.subspan(i, 128), channel_);
+        }
+      },
+      gOtExtStreamWindow, base_ot_entry_.threads());
+  base_ot_entry_.commit();
 }
 }  // namespace droidCrypto
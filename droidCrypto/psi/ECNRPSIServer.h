@@ -1,5 +1,7 @@
 #pragma once
 
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/ot/TwoChooseOne/OTExtInterface.h>
 #include <droidCrypto/psi/PhasedPSIServer.h>
 #include <droidCrypto/psi/tools/ECNRPRF.h>
 
@@ -18,6 +20,9 @@ class ECNRPSIServer : public PhasedPSIServer {
   PRNG prng_;
   ECNRPRF prf_;
   size_t num_client_elements_;
-  std::vector<std::array<block, 2>> ots_;
+  // set up by Base, extends the OTs for Online window by window
+  std::unique_ptr<OtExtSender> ot_ext_sender_;
+  // committed at the end of Online
+  BaseOtCache::Pending base_ot_entry_;
 };
 }  // namespace droidCrypto
@@ -2,23 +2,23 @@
 
 #include <droidCrypto/psi/PhasedPSIClient.h>
 #include <droidCrypto/gc/circuits/AESCircuit.h>
-#include "cuckoofilter/cuckoofilter.h"
+#include <droidCrypto/psi/PSISetupSync.h>
 
 namespace droidCrypto {
     class OPRFAESPSIClient : public PhasedPSIClient {
     public:
-        OPRFAESPSIClient(ChannelWrapper& chan);
-
-        virtual ~OPRFAESPSIClient();
+        // the circuit is evaluated with num_threads threads. filter holds the
+        // server's cuckoo filter from a previous session to sync from, it is
+        // updated by Setup. Without one the full filter is transferred.
+        OPRFAESPSIClient(ChannelWrapper& chan, size_t num_threads = 1,
+                         std::shared_ptr<PSIClientFilter> filter = nullptr);
 
         void Setup() override;
         void Base(size_t num_elements) override;
         std::vector<size_t> Online(std::vector<block> &elements) override;
 
     private:
-        typedef cuckoofilter::CuckooFilter<uint64_t*, 32, cuckoofilter::SingleTable,
-                cuckoofilter::TwoIndependentMultiplyShift128> CuckooFilter;
-        CuckooFilter* cf_;
+        std::shared_ptr<PSIClientFilter> filter_;
         SIMDAESCircuitPhases circ_;
     };
 }
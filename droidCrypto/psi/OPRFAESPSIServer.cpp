@@ -1,37 +1,34 @@
 #include <assert.h>
 #include <droidCrypto/AES.h>
 #include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/gc/GCPool.h>
 #include <droidCrypto/gc/circuits/AESCircuit.h>
 #include <droidCrypto/psi/OPRFAESPSIServer.h>
+#include <droidCrypto/psi/PSISetupSync.h>
 #include <droidCrypto/utils/Log.h>
 #include <endian.h>
 #include <thread>
-#include "cuckoofilter/cuckoofilter.h"
 
 namespace droidCrypto {
 
 OPRFAESPSIServer::OPRFAESPSIServer(ChannelWrapper &chan,
                                    size_t num_threads /*=1*/)
-    : PhasedPSIServer(chan, num_threads), circ_(chan) {}
-
-void OPRFAESPSIServer::Setup(std::vector<block> &elements) {
-  typedef cuckoofilter::CuckooFilter<
-      uint64_t *, 32, cuckoofilter::SingleTable,
-      cuckoofilter::TwoIndependentMultiplyShift128>
-      CuckooFilter;
-
-  auto time0 = std::chrono::high_resolution_clock::now();
-  size_t num_server_elements = elements.size();
+    : PhasedPSIServer(chan, num_threads), circ_(chan) {
+  circ_.setNumThreads(num_threads);
+  circ_.compile();
+}
 
+void OPRFAESPSIServer::Encrypt(const std::vector<uint8_t> &key,
+                               std::vector<block> &elements,
+                               size_t num_threads) {
   // MT-bounds
-  size_t elements_per_thread = num_server_elements / num_threads_;
-  Log::v("PSI", "%zu threads, %zu elements each", num_threads_,
+  size_t elements_per_thread = elements.size() / num_threads;
+  Log::v("PSI", "%zu threads, %zu elements each", num_threads,
          elements_per_thread);
-  uint8_t AES_TEST_KEY[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
   AES a;
-  a.setKey(AES_TEST_KEY);
+  a.setKey(key.data());
   std::vector<std::thread> threads;
-  for (size_t thrd = 0; thrd < num_threads_ - 1; thrd++) {
+  for (size_t thrd = 0; thrd < num_threads - 1; thrd++) {
     auto t = std::thread([aes = a, &elements, elements_per_thread, idx = thrd] {
       aes.encryptECBBlocks(elements.data() + idx * elements_per_thread,
                            elements_per_thread,
@@ -41,61 +38,81 @@ void OPRFAESPSIServer::Setup(std::vector<block> &elements) {
   }
   // rest in main thread
   a.encryptECBBlocks(
-      elements.data() + (num_threads_ - 1) * elements_per_thread,
-      num_server_elements - (num_threads_ - 1) * elements_per_thread,
-      elements.data() + (num_threads_ - 1) * elements_per_thread);
-  for (size_t thrd = 0; thrd < num_threads_ - 1; thrd++) {
+      elements.data() + (num_threads - 1) * elements_per_thread,
+      elements.size() - (num_threads - 1) * elements_per_thread,
+      elements.data() + (num_threads - 1) * elements_per_thread);
+  for (size_t thrd = 0; thrd < num_threads - 1; thrd++) {
     threads[thrd].join();
   }
+}
+
+std::shared_ptr<const PSIServerSetup> OPRFAESPSIServer::Precompute(
+    std::vector<block> &elements, size_t num_threads /*=1*/) {
+  auto time0 = std::chrono::high_resolution_clock::now();
+  size_t num_server_elements = elements.size();
+  std::shared_ptr<PSIServerSetup> setup = std::make_shared<PSIServerSetup>();
+  setup->oprf = PSIServerSetup::AES;
+  setup->num_elements = num_server_elements;
+  setup->db_id = newDatabaseId();
+
+  uint8_t AES_TEST_KEY[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  setup->key.assign(AES_TEST_KEY, AES_TEST_KEY + sizeof(AES_TEST_KEY));
+  Encrypt(setup->key, elements, num_threads);
 
   auto time1 = std::chrono::high_resolution_clock::now();
-  CuckooFilter cf(num_server_elements);
+  setup->cf.reset(new OPRFCuckooFilter(num_server_elements));
+  OPRFCuckooFilter &cf = *setup->cf;
 
-  for (size_t i = 0; i < num_server_elements; i++) {
-    auto success = cf.Add((uint64_t *)&elements[i]);
-    (void)success;
-    assert(success == cuckoofilter::Ok);
-  }
+  auto success = cf.AddParallel(
+      num_server_elements,
+      [&elements](size_t i) { return (uint64_t *)&elements[i]; }, num_threads);
+  (void)success;
+  assert(success == cuckoofilter::Ok);
   auto time2 = std::chrono::high_resolution_clock::now();
   Log::v("PSI", "Built CF");
   elements.clear();  // free some memory
   Log::v("CF", "%s", cf.Info().c_str());
-  auto time3 = std::chrono::high_resolution_clock::now();
 
-  num_server_elements = htobe64(num_server_elements);
-  channel_.send((uint8_t *)&num_server_elements, sizeof(num_server_elements));
+  setup->setup_msg_buf = serializeSetupMsg(cf, num_server_elements);
+  setup->setup_msg = span<const uint8_t>(setup->setup_msg_buf.data(),
+                                         setup->setup_msg_buf.size());
+  auto time3 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> enc_time = time1 - time0;
+  std::chrono::duration<double> cf_time = time2 - time1;
+  std::chrono::duration<double> ser_time = time3 - time2;
+  Log::v("PSI",
+         "Precompute Time:\n\t%fsec ENC, %fsec CF, %fsec Serialize,\n\t%fsec "
+         "Setup\n",
+         enc_time.count(), cf_time.count(), ser_time.count(),
+         (enc_time + cf_time + ser_time).count());
+  return setup;
+}
 
-  // send cuckoofilter in steps to save memory
-  const uint64_t size_in_tags = cf.SizeInTags();
-  const uint64_t step = (1 << 16);
-  uint64_t uint64_send;
-  uint64_send = htobe64(size_in_tags);
-  channel_.send((uint8_t *)&uint64_send, sizeof(uint64_send));
-  uint64_send = htobe64(step);
-  channel_.send((uint8_t *)&uint64_send, sizeof(uint64_send));
+std::shared_ptr<const PSIServerSetup> OPRFAESPSIServer::Update(
+    const PSIServerSetup &prev, std::vector<block> &added,
+    std::vector<block> &removed, size_t num_threads /*=1*/) {
+  Encrypt(prev.key, added, num_threads);
+  Encrypt(prev.key, removed, num_threads);
+  return applySetupUpdate(prev, added, removed);
+}
 
-  for (uint64_t i = 0; i < size_in_tags; i += step) {
-    std::vector<uint8_t> cf_ser = cf.serialize(step, i);
-    uint64_t cfsize = cf_ser.size();
-    uint64_send = htobe64(cfsize);
-    channel_.send((uint8_t *)&uint64_send, sizeof(uint64_send));
-    channel_.send(cf_ser.data(), cfsize);
-  }
+void OPRFAESPSIServer::Setup(std::vector<block> &elements) {
+  SetupPrecomputed(Precompute(elements, num_threads_));
+}
 
-  std::vector<unsigned __int128> hash_params =
-      cf.GetTwoIndependentMultiplyShiftParams();
-  for (auto &par : hash_params) {
-    channel_.send((uint8_t *)&par, sizeof(par));
+void OPRFAESPSIServer::SetupPrecomputed(
+    std::shared_ptr<const PSIServerSetup> setup) {
+  if (setup->oprf != PSIServerSetup::AES) {
+    throw std::runtime_error("setup was not precomputed for AES");
   }
-
-  auto time4 = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> enc_time = time1 - time0;
-  std::chrono::duration<double> cf_time = time2 - time1;
-  std::chrono::duration<double> trans_time = time4 - time3;
+  setup_ = setup;
+  auto time0 = std::chrono::high_resolution_clock::now();
+  sendSetupSync(channel_, *setup_);
+  auto time1 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> trans_time = time1 - time0;
   Log::v("PSI",
-         "Setup Time:\n\t%fsec ENC, %fsec CF,\n\t%fsec Setup,\n\t%fsec "
-         "Trans,\n\t Setup Comm: %fMiB sent, %fMiB recv\n",
-         enc_time.count(), cf_time.count(), (enc_time + cf_time).count(),
+         "Setup Time:\n\t%fsec Trans,\n\t Setup Comm: %fMiB sent, %fMiB "
+         "recv\n",
          trans_time.count(), channel_.getBytesSent() / 1024.0 / 1024.0,
          channel_.getBytesRecv() / 1024.0 / 1024.0);
   channel_.clearStats();
@@ -123,7 +140,14 @@ void OPRFAESPSIServer::Base() {
       0x4c, 0x66, 0x49, 0x41, 0xb4, 0xef, 0x5b, 0xcb, 0x3e, 0x92, 0xe2, 0x11,
       0x23, 0xe9, 0x51, 0xcf, 0x6f, 0x8f, 0x18, 0x8e};
   droidCrypto::BitVector key_bits(AES_TEST_EXPANDED_KEY, AES_EXP_KEY_BITS);
-  circ_.garbleBase(key_bits, num_client_elements);
+  circ_.setBaseOtCache(base_ot_cache_);
+  std::unique_ptr<GCSpool> spool;
+  if (gc_pool_ && key_bits == gc_pool_->getInputA())
+    spool = gc_pool_->take(num_client_elements);
+  if (spool)
+    circ_.garbleBase(*spool);
+  else
+    circ_.garbleBase(key_bits, num_client_elements);
 }
 
 void OPRFAESPSIServer::Online() {
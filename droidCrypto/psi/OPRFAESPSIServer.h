@@ -1,6 +1,7 @@
 #pragma once
 
 #include <droidCrypto/psi/PhasedPSIServer.h>
+#include <droidCrypto/psi/PSIServerSetup.h>
 #include <droidCrypto/gc/circuits/AESCircuit.h>
 
 namespace droidCrypto {
@@ -8,14 +9,34 @@ namespace droidCrypto {
     public:
         OPRFAESPSIServer(ChannelWrapper& chan, size_t num_threads = 1);
 
+        // encrypts elements under the AES key and builds the cuckoo filter
+        // for them, can be shared by all sessions. Clears elements.
+        static std::shared_ptr<const PSIServerSetup> Precompute(std::vector<block> &elements,
+                                                                size_t num_threads = 1);
+
+        // next version of prev with added and removed elements, clients that
+        // synced to one of the last versions only receive the changed slots.
+        // Encrypts added and removed in place.
+        static std::shared_ptr<const PSIServerSetup> Update(const PSIServerSetup &prev,
+                                                            std::vector<block> &added,
+                                                            std::vector<block> &removed,
+                                                            size_t num_threads = 1);
+
         void Setup(std::vector<block> &elements) override;
 
+        void SetupPrecomputed(std::shared_ptr<const PSIServerSetup> setup) override;
+
         void Base() override;
 
         void Online() override;
 
     private:
+        // encrypts elements in place under the AES key
+        static void Encrypt(const std::vector<uint8_t> &key, std::vector<block> &elements,
+                            size_t num_threads);
+
         SIMDAESCircuitPhases circ_;
+        std::shared_ptr<const PSIServerSetup> setup_;
     };
 }
 
@@ -0,0 +1,108 @@
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/psi/OPRFBristolPSIClient.h>
+#include <droidCrypto/utils/Log.h>
+#include <endian.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+void checkOPRFCircuit(const BristolCircuit &circuit) {
+  if (circuit.inputB_size() > 128 || circuit.output_size() > 128) {
+    throw std::runtime_error(
+        "OPRF circuit " + circuit.name() +
+        " needs an input and output of at most 128 bits");
+  }
+  // fewer outputs collide within the database and the cuckoo filter
+  if (circuit.output_size() < 64) {
+    throw std::runtime_error("OPRF circuit " + circuit.name() +
+                             " needs an output of at least 64 bits");
+  }
+}
+
+OPRFBristolPSIClient::OPRFBristolPSIClient(
+    ChannelWrapper &chan, std::shared_ptr<const BristolCircuit> circuit,
+    size_t num_threads /*=1*/,
+    std::shared_ptr<PSIClientFilter> filter /*=nullptr*/)
+    : PhasedPSIClient(chan),
+      filter_(filter ? filter : std::make_shared<PSIClientFilter>()),
+      circuit_(circuit),
+      circ_(chan, circuit) {
+  checkOPRFCircuit(*circuit_);
+  circ_.setNumThreads(num_threads);
+}
+
+void OPRFBristolPSIClient::Setup() {
+  auto time1 = std::chrono::high_resolution_clock::now();
+  recvSetupSync(channel_, *filter_);
+  auto time2 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> trans = time2 - time1;
+  Log::v("CF", "%s", filter_->cf->Info().c_str());
+  Log::v("PSI", "CF Sync: %fsec to db version %llu", trans.count(),
+         (unsigned long long)filter_->db_version);
+}
+
+void OPRFBristolPSIClient::Base(size_t num_elements) {
+  size_t num_client_elements = htobe64(num_elements);
+  channel_.send((uint8_t *)&num_client_elements, sizeof(num_client_elements));
+  circ_.setBaseOtCache(base_ot_cache_, base_ot_peer_);
+  circ_.evaluateBase(num_elements);
+}
+
+std::vector<size_t> OPRFBristolPSIClient::Online(
+    std::vector<block> &elements) {
+  size_t num_client_elements = elements.size();
+  // do GC evaluation
+
+  std::vector<BitVector> bit_elements;
+  bit_elements.reserve(elements.size());
+  for (size_t i = 0; i < elements.size(); i++) {
+    bit_elements.emplace_back((uint8_t *)(&elements[i]),
+                              circuit_->inputB_size());
+  }
+  channel_.clearStats();
+  std::vector<BitVector> result = circ_.evaluateOnline(bit_elements);
+
+  std::string time = "Time (" + circuit_->name() + "):";
+  time += "\n\t OT:   " + std::to_string(circ_.timeBaseOT.count());
+  time += ",\n\t OTe:  " + std::to_string(circ_.timeOT.count());
+  time += ",\n\t Send: " + std::to_string(circ_.timeSendGC.count());
+  time += ",\n\t Eval: " + std::to_string(circ_.timeEval.count());
+  time += ";\n\t Total:" + std::to_string((circ_.timeBaseOT + circ_.timeOT +
+                                           circ_.timeEval + circ_.timeSendGC)
+                                              .count());
+  Log::v("GC", "%s", time.c_str());
+  Log::v("GC", "Sent: %zu, Recv: %zu", channel_.getBytesSent(),
+         channel_.getBytesRecv());
+
+  auto inter_start = std::chrono::high_resolution_clock::now();
+  // the outputs zero padded to 128 bits, as the server inserted them
+  std::vector<block> outputs(num_client_elements, ZeroBlock);
+  for (size_t i = 0; i < num_client_elements; i++) {
+    uint8_t *bytes = (uint8_t *)&outputs[i];
+    for (size_t j = 0; j < circuit_->output_size(); j++)
+      bytes[j / 8] |= (uint8_t)result[i][j] << (j % 8);
+  }
+  std::vector<size_t> res;
+  // do intersection
+  std::vector<const uint64_t *> keys(num_client_elements);
+  for (size_t i = 0; i < num_client_elements; i++) {
+    keys[i] = (const uint64_t *)&outputs[i];
+  }
+  BitVector found;
+  filter_->cf->ContainBatch(span<const uint64_t *>(keys.data(), keys.size()),
+                            found);
+  for (size_t i = 0; i < num_client_elements; i++) {
+    if (found[i]) {
+      Log::v("PSI", "Intersection C%d", i);
+      res.push_back(i);
+    }
+  }
+  auto inter_end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> inter_time = inter_end - inter_start;
+  Log::v("PSI", "inter: %fsec", inter_time.count());
+
+  return res;
+}
+}  // namespace droidCrypto
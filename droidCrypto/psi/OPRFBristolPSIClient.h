@@ -0,0 +1,32 @@
+#pragma once
+
+#include <droidCrypto/gc/circuits/BristolCircuit.h>
+#include <droidCrypto/psi/PSISetupSync.h>
+#include <droidCrypto/psi/PhasedPSIClient.h>
+
+namespace droidCrypto {
+// client of OPRFBristolPSIServer, both have to load the same circuit
+class OPRFBristolPSIClient : public PhasedPSIClient {
+ public:
+  // the circuit is evaluated with num_threads threads. filter holds the
+  // server's cuckoo filter from a previous session to sync from, it is
+  // updated by Setup. Without one the full filter is transferred.
+  OPRFBristolPSIClient(ChannelWrapper &chan,
+                       std::shared_ptr<const BristolCircuit> circuit,
+                       size_t num_threads = 1,
+                       std::shared_ptr<PSIClientFilter> filter = nullptr);
+
+  void Setup() override;
+  void Base(size_t num_elements) override;
+  std::vector<size_t> Online(std::vector<block> &elements) override;
+
+ private:
+  std::shared_ptr<PSIClientFilter> filter_;
+  std::shared_ptr<const BristolCircuit> circuit_;
+  SIMDBristolCircuitPhases circ_;
+};
+
+// throws unless circuit fits OPRFBristolPSIServer and -Client: at most 128
+// input bits of the client, 64 to 128 output bits
+void checkOPRFCircuit(const BristolCircuit &circuit);
+}  // namespace droidCrypto
@@ -0,0 +1,176 @@
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/SecureRandom.h>
+#include <droidCrypto/gc/GCPool.h>
+#include <droidCrypto/psi/OPRFBristolPSIClient.h>
+#include <droidCrypto/psi/OPRFBristolPSIServer.h>
+#include <droidCrypto/psi/PSISetupSync.h>
+#include <droidCrypto/utils/Log.h>
+#include <endian.h>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace droidCrypto {
+
+OPRFBristolPSIServer::OPRFBristolPSIServer(
+    ChannelWrapper &chan, std::shared_ptr<const BristolCircuit> circuit,
+    size_t num_threads /*=1*/)
+    : PhasedPSIServer(chan, num_threads),
+      circuit_(circuit),
+      circ_(chan, circuit) {
+  checkOPRFCircuit(*circuit_);
+  circ_.setNumThreads(num_threads);
+}
+
+void OPRFBristolPSIServer::Encrypt(const BristolCircuit &circuit,
+                                   const std::vector<uint8_t> &key,
+                                   std::vector<block> &elements,
+                                   size_t num_threads) {
+  // the circuit is evaluated on 64 elements at once, bitsliced
+  const size_t num_batches = (elements.size() + 63) / 64;
+  size_t batches_per_thread = num_batches / num_threads;
+  Log::v("PSI", "%zu threads, %zu elements each", num_threads,
+         batches_per_thread * 64);
+  BitVector key_bits(const_cast<uint8_t *>(key.data()), circuit.inputA_size());
+  auto encrypt = [&circuit, &key_bits, &elements](size_t begin, size_t end) {
+    std::vector<uint64_t> slices(circuit.inputB_size());
+    for (size_t batch = begin; batch < end; batch++) {
+      block *el = elements.data() + batch * 64;
+      const size_t n = std::min<size_t>(64, elements.size() - batch * 64);
+      std::fill(slices.begin(), slices.end(), 0);
+      for (size_t j = 0; j < n; j++) {
+        const uint8_t *bytes = (const uint8_t *)&el[j];
+        for (size_t i = 0; i < slices.size(); i++)
+          slices[i] |= (uint64_t)((bytes[i / 8] >> (i % 8)) & 1) << j;
+      }
+      std::vector<uint64_t> out = circuit.evaluate(key_bits, slices);
+      for (size_t j = 0; j < n; j++) {
+        uint8_t bytes[sizeof(block)] = {0};
+        for (size_t i = 0; i < out.size(); i++)
+          bytes[i / 8] |= ((out[i] >> j) & 1) << (i % 8);
+        memcpy(&el[j], bytes, sizeof(block));
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t thrd = 0; thrd < num_threads - 1; thrd++) {
+    threads.emplace_back(encrypt, thrd * batches_per_thread,
+                         (thrd + 1) * batches_per_thread);
+  }
+  // rest in main thread
+  encrypt((num_threads - 1) * batches_per_thread, num_batches);
+  for (size_t thrd = 0; thrd < num_threads - 1; thrd++) {
+    threads[thrd].join();
+  }
+}
+
+std::shared_ptr<const PSIServerSetup> OPRFBristolPSIServer::Precompute(
+    const BristolCircuit &circuit, std::vector<block> &elements,
+    size_t num_threads /*=1*/) {
+  checkOPRFCircuit(circuit);
+  auto time0 = std::chrono::high_resolution_clock::now();
+  size_t num_server_elements = elements.size();
+  std::shared_ptr<PSIServerSetup> setup = std::make_shared<PSIServerSetup>();
+  setup->oprf = PSIServerSetup::Bristol;
+  setup->circuit_hash = circuit.hash();
+  setup->num_elements = num_server_elements;
+  setup->db_id = newDatabaseId();
+
+  // get a random key
+  setup->key.resize((circuit.inputA_size() + 7) / 8);
+  SecureRandom().randBytes(setup->key.data(), setup->key.size());
+  Encrypt(circuit, setup->key, elements, num_threads);
+
+  auto time1 = std::chrono::high_resolution_clock::now();
+  setup->cf.reset(new OPRFCuckooFilter(num_server_elements));
+  OPRFCuckooFilter &cf = *setup->cf;
+
+  auto success = cf.AddParallel(
+      num_server_elements,
+      [&elements](size_t i) { return (uint64_t *)&elements[i]; }, num_threads);
+  if (success != cuckoofilter::Ok) {
+    throw std::runtime_error("cuckoo filter full, the OPRF outputs of " +
+                             circuit.name() + " collide");
+  }
+  auto time2 = std::chrono::high_resolution_clock::now();
+  Log::v("PSI", "Built CF");
+  elements.clear();  // free some memory
+  Log::v("CF", "%s", cf.Info().c_str());
+
+  setup->setup_msg_buf = serializeSetupMsg(cf, num_server_elements);
+  setup->setup_msg = span<const uint8_t>(setup->setup_msg_buf.data(),
+                                         setup->setup_msg_buf.size());
+  auto time3 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> enc_time = time1 - time0;
+  std::chrono::duration<double> cf_time = time2 - time1;
+  std::chrono::duration<double> ser_time = time3 - time2;
+  Log::v("PSI",
+         "Precompute Time (%s):\n\t%fsec ENC, %fsec CF, %fsec Serialize,\n\t"
+         "%fsec Setup\n",
+         circuit.name().c_str(), enc_time.count(), cf_time.count(),
+         ser_time.count(), (enc_time + cf_time + ser_time).count());
+  return setup;
+}
+
+std::shared_ptr<const PSIServerSetup> OPRFBristolPSIServer::Update(
+    const BristolCircuit &circuit, const PSIServerSetup &prev,
+    std::vector<block> &added, std::vector<block> &removed,
+    size_t num_threads /*=1*/) {
+  if (prev.oprf != PSIServerSetup::Bristol ||
+      neq(prev.circuit_hash, circuit.hash())) {
+    throw std::runtime_error("setup was not precomputed for circuit " +
+                             circuit.name());
+  }
+  Encrypt(circuit, prev.key, added, num_threads);
+  Encrypt(circuit, prev.key, removed, num_threads);
+  return applySetupUpdate(prev, added, removed);
+}
+
+void OPRFBristolPSIServer::Setup(std::vector<block> &elements) {
+  SetupPrecomputed(Precompute(*circuit_, elements, num_threads_));
+}
+
+void OPRFBristolPSIServer::SetupPrecomputed(
+    std::shared_ptr<const PSIServerSetup> setup) {
+  if (setup->oprf != PSIServerSetup::Bristol ||
+      neq(setup->circuit_hash, circuit_->hash()) ||
+      setup->key.size() != (circuit_->inputA_size() + 7) / 8) {
+    throw std::runtime_error("setup was not precomputed for circuit " +
+                             circuit_->name());
+  }
+  setup_ = setup;
+  auto time0 = std::chrono::high_resolution_clock::now();
+  sendSetupSync(channel_, *setup_);
+  auto time1 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> trans_time = time1 - time0;
+  Log::v("PSI",
+         "Setup Time:\n\t%fsec Trans,\n\t Setup Comm: %fMiB sent, %fMiB "
+         "recv\n",
+         trans_time.count(), channel_.getBytesSent() / 1024.0 / 1024.0,
+         channel_.getBytesRecv() / 1024.0 / 1024.0);
+  channel_.clearStats();
+}
+
+void OPRFBristolPSIServer::Base() {
+  size_t num_client_elements;
+  channel_.recv((uint8_t *)&num_client_elements, sizeof(num_client_elements));
+  num_client_elements = be64toh(num_client_elements);
+
+  BitVector key_bits(const_cast<uint8_t *>(setup_->key.data()),
+                     circuit_->inputA_size());
+  circ_.setBaseOtCache(base_ot_cache_);
+  std::unique_ptr<GCSpool> spool;
+  if (gc_pool_ && key_bits == gc_pool_->getInputA())
+    spool = gc_pool_->take(num_client_elements);
+  if (spool)
+    circ_.garbleBase(*spool);
+  else
+    circ_.garbleBase(key_bits, num_client_elements);
+}
+
+void OPRFBristolPSIServer::Online() {
+  circ_.garbleOnline();
+  // done on server side
+}
+}  // namespace droidCrypto
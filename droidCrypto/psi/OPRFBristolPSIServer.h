@@ -0,0 +1,52 @@
+#pragma once
+
+#include <droidCrypto/gc/circuits/BristolCircuit.h>
+#include <droidCrypto/psi/PSIServerSetup.h>
+#include <droidCrypto/psi/PhasedPSIServer.h>
+
+namespace droidCrypto {
+// PSI with any Bristol circuit as OPRF: Alice's input is the server's key,
+// Bob's input the first inputB_size() bits of an element and the output, zero
+// padded to 128 bits, is what goes into the cuckoo filter. Inputs and output
+// may have at most 128 bits.
+class OPRFBristolPSIServer : public PhasedPSIServer {
+ public:
+  OPRFBristolPSIServer(ChannelWrapper &chan,
+                       std::shared_ptr<const BristolCircuit> circuit,
+                       size_t num_threads = 1);
+
+  // draws a random key, evaluates the circuit on elements under it and
+  // builds the cuckoo filter for them, can be shared by all sessions with
+  // the same circuit. Clears elements, throws std::runtime_error if the
+  // filter cannot take them.
+  static std::shared_ptr<const PSIServerSetup> Precompute(
+      const BristolCircuit &circuit, std::vector<block> &elements,
+      size_t num_threads = 1);
+
+  // next version of prev with added and removed elements, see
+  // OPRFLowMCPSIServer::Update. Evaluates added and removed in place.
+  static std::shared_ptr<const PSIServerSetup> Update(
+      const BristolCircuit &circuit, const PSIServerSetup &prev,
+      std::vector<block> &added, std::vector<block> &removed,
+      size_t num_threads = 1);
+
+  void Setup(std::vector<block> &elements) override;
+
+  // throws std::runtime_error if setup was precomputed for another circuit
+  void SetupPrecomputed(std::shared_ptr<const PSIServerSetup> setup) override;
+
+  void Base() override;
+
+  void Online() override;
+
+ private:
+  // replaces elements by the circuit's output under key
+  static void Encrypt(const BristolCircuit &circuit,
+                      const std::vector<uint8_t> &key,
+                      std::vector<block> &elements, size_t num_threads);
+
+  std::shared_ptr<const BristolCircuit> circuit_;
+  SIMDBristolCircuitPhases circ_;
+  std::shared_ptr<const PSIServerSetup> setup_;
+};
+}  // namespace droidCrypto
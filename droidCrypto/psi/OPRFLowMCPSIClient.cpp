@@ -4,53 +4,32 @@
 #include <droidCrypto/utils/Log.h>
 #include <assert.h>
 #include <endian.h>
-#include "cuckoofilter/cuckoofilter.h"
+#include <droidCrypto/psi/PSISetupSync.h>
 
 
 namespace droidCrypto {
 
-    OPRFLowMCPSIClient::OPRFLowMCPSIClient(ChannelWrapper& chan) : PhasedPSIClient(chan), cf_(nullptr), circ_(chan) {}
+    OPRFLowMCPSIClient::OPRFLowMCPSIClient(ChannelWrapper& chan, size_t num_threads /*=1*/,
+                                           std::shared_ptr<PSIClientFilter> filter /*=nullptr*/)
+        : PhasedPSIClient(chan), filter_(filter ? filter : std::make_shared<PSIClientFilter>()), circ_(chan) {
+        circ_.setNumThreads(num_threads);
+        circ_.compile();
+    }
 
     void OPRFLowMCPSIClient::Setup() {
-        uint64_t num_server_elements;
-        uint64_t cfsize;
-        channel_.recv((uint8_t*)&num_server_elements, sizeof(num_server_elements));
-        num_server_elements = be64toh(num_server_elements);
-
-        uint64_t size_in_tags, step;
-        channel_.recv((uint8_t*)&size_in_tags, sizeof(size_in_tags));
-        channel_.recv((uint8_t*)&step, sizeof(step));
-        size_in_tags = be64toh(size_in_tags);
-        step = be64toh(step);
         auto time1 = std::chrono::high_resolution_clock::now();
-        cf_ = new CuckooFilter(num_server_elements);
-        std::chrono::duration<double> deser = std::chrono::duration<double>::zero();
-
-        for(uint64_t i = 0; i < size_in_tags; i+=step) {
-            std::vector<uint8_t> tmp;
-            channel_.recv((uint8_t *) &cfsize, sizeof(cfsize));
-            cfsize = be64toh(cfsize);
-            tmp.resize(cfsize);
-            channel_.recv(tmp.data(), cfsize);
-            auto time_der1 = std::chrono::high_resolution_clock::now();
-            cf_->deserialize(tmp, i);
-            auto time_der2 = std::chrono::high_resolution_clock::now();
-            deser += (time_der2-time_der1);
-        }
-        std::vector<unsigned __int128> params(3);
-        for(auto& par : params) {
-            channel_.recv((uint8_t*)&par, sizeof(par));
-        }
-        cf_->SetTwoIndependentMultiplyShiftParams(params);
-        auto time3 = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> trans = time3-time1 - deser;
-        Log::v("CF", "%s", cf_->Info().c_str());
-        Log::v("PSI", "CF Trans: %fsec, CF deserialize: %fsec", trans.count(), deser.count());
+        recvSetupSync(channel_, *filter_);
+        auto time2 = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> trans = time2-time1;
+        Log::v("CF", "%s", filter_->cf->Info().c_str());
+        Log::v("PSI", "CF Sync: %fsec to db version %llu", trans.count(),
+               (unsigned long long)filter_->db_version);
     }
 
     void OPRFLowMCPSIClient::Base(size_t num_elements) {
         size_t num_client_elements = htobe64(num_elements);
         channel_.send((uint8_t*)&num_client_elements, sizeof(num_client_elements));
+        circ_.setBaseOtCache(base_ot_cache_, base_ot_peer_);
         circ_.evaluateBase(num_elements);
     }
 
@@ -78,8 +57,14 @@ namespace droidCrypto {
         auto inter_start = std::chrono::high_resolution_clock::now();
         std::vector<size_t> res;
         //do intersection
+        std::vector<const uint64_t*> keys(num_client_elements);
         for(size_t i = 0; i < num_client_elements; i++) {
-            if (cf_->Contain((uint64_t*)result[i].data()) == cuckoofilter::Ok){
+            keys[i] = (const uint64_t*)result[i].data();
+        }
+        BitVector found;
+        filter_->cf->ContainBatch(span<const uint64_t*>(keys.data(), keys.size()), found);
+        for(size_t i = 0; i < num_client_elements; i++) {
+            if (found[i]) {
                 Log::v("PSI", "Intersection C%d", i);
                 res.push_back(i);
             }
@@ -91,8 +76,4 @@ namespace droidCrypto {
         return res;
     }
 
-    OPRFLowMCPSIClient::~OPRFLowMCPSIClient() {
-        delete cf_;
-    }
-
 }
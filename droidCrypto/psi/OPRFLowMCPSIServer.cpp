@@ -1,11 +1,12 @@
 #include <droidCrypto/psi/OPRFLowMCPSIServer.h>
 #include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/gc/GCPool.h>
 #include <droidCrypto/gc/circuits/LowMCCircuit.h>
 #include <thread>
 #include <assert.h>
 #include <endian.h>
 #include <droidCrypto/utils/Log.h>
-#include "cuckoofilter/cuckoofilter.h"
+#include <droidCrypto/psi/PSISetupSync.h>
 
 extern "C" {
     #include <droidCrypto/lowmc/lowmc_pars.h>
@@ -20,29 +21,22 @@ namespace droidCrypto {
     OPRFLowMCPSIServer::OPRFLowMCPSIServer(ChannelWrapper& chan, size_t num_threads /*=1*/) :
         PhasedPSIServer(chan, num_threads), circ_(chan)
     {
+        circ_.setNumThreads(num_threads);
+        circ_.compile();
     }
 
-    void OPRFLowMCPSIServer::Setup(std::vector<block> &elements) {
-        auto time0 = std::chrono::high_resolution_clock::now();
-        size_t num_server_elements = elements.size();
-
-        typedef cuckoofilter::CuckooFilter<uint64_t*, 32, cuckoofilter::SingleTable,
-                cuckoofilter::TwoIndependentMultiplyShift128> CuckooFilter;
-
+    void OPRFLowMCPSIServer::Encrypt(const std::vector<uint8_t> &key_bytes, std::vector<block> &elements,
+                                     size_t num_threads) {
         //MT-bounds
-        size_t elements_per_thread = num_server_elements / num_threads_;
-        Log::v("PSI", "%zu threads, %zu elements each", num_threads_, elements_per_thread);
-        //LOWMC encryption
-        // get a random key
-        PRNG::getTestPRNG().get(lowmc_key_.data(), lowmc_key_.size());
-
+        size_t elements_per_thread = elements.size() / num_threads;
+        Log::v("PSI", "%zu threads, %zu elements each", num_threads, elements_per_thread);
         const lowmc_t* params = SIMDLowMCCircuitPhases::params;
         lowmc_key_t* key = mzd_local_init(1, params->k);
-        mzd_from_char_array(key, lowmc_key_.data(), (params->k)/8);
+        mzd_from_char_array(key, key_bytes.data(), (params->k)/8);
         expanded_key key_calc = lowmc_expand_key(params, key);
 
         std::vector<std::thread> threads;
-        for(size_t thrd = 0; thrd < num_threads_-1; thrd++) {
+        for(size_t thrd = 0; thrd < num_threads-1; thrd++) {
             auto t = std::thread([params, key_calc, &elements, elements_per_thread,idx=thrd]{
                 lowmc_key_t* pt = mzd_local_init(1, params->n);
                 for(size_t i = idx*elements_per_thread; i < (idx+1)*elements_per_thread; i++) {
@@ -56,62 +50,83 @@ namespace droidCrypto {
             threads.emplace_back(std::move(t));
         }
         lowmc_key_t* pt = mzd_local_init(1, params->n);
-        for(size_t i = (num_threads_-1)*elements_per_thread; i < num_server_elements; i++) {
+        for(size_t i = (num_threads-1)*elements_per_thread; i < elements.size(); i++) {
             mzd_from_char_array(pt, (uint8_t *) (&elements[i]), params->n / 8);
             mzd_local_t *ct = lowmc_call(params, key_calc, pt);
             mzd_to_char_array((uint8_t *) (&elements[i]), ct, (params->n) / 8);
             mzd_local_free(ct);
         }
         mzd_local_free(pt);
-        for(size_t thrd = 0; thrd < num_threads_ -1; thrd++) {
+        for(size_t thrd = 0; thrd < num_threads -1; thrd++) {
             threads[thrd].join();
         }
+    }
 
-        auto time1 = std::chrono::high_resolution_clock::now();
-        CuckooFilter cf(num_server_elements);
+    std::shared_ptr<const PSIServerSetup> OPRFLowMCPSIServer::Precompute(std::vector<block> &elements,
+                                                                         size_t num_threads /*=1*/) {
+        auto time0 = std::chrono::high_resolution_clock::now();
+        size_t num_server_elements = elements.size();
+        std::shared_ptr<PSIServerSetup> setup = std::make_shared<PSIServerSetup>();
+        setup->oprf = PSIServerSetup::LowMC;
+        setup->num_elements = num_server_elements;
+        setup->db_id = newDatabaseId();
 
-        for(size_t i = 0; i < num_server_elements; i++) {
-            auto success = cf.Add((uint64_t*)&elements[i]);
-            (void) success;
-            assert(success == cuckoofilter::Ok);
-        }
+        //LOWMC encryption
+        // get a random key
+        setup->key.resize(16);
+        PRNG::getTestPRNG().get(setup->key.data(), setup->key.size());
+
+        Encrypt(setup->key, elements, num_threads);
+
+        auto time1 = std::chrono::high_resolution_clock::now();
+        setup->cf.reset(new OPRFCuckooFilter(num_server_elements));
+        OPRFCuckooFilter& cf = *setup->cf;
+
+        auto success = cf.AddParallel(num_server_elements, [&elements](size_t i) {
+            return (uint64_t*)&elements[i];
+        }, num_threads);
+        (void) success;
+        assert(success == cuckoofilter::Ok);
         auto time2 = std::chrono::high_resolution_clock::now();
         Log::v("PSI", "Built CF");
         elements.clear(); // free some memory
         Log::v("CF", "%s", cf.Info().c_str());
+
+        setup->setup_msg_buf = serializeSetupMsg(cf, num_server_elements);
+        setup->setup_msg = span<const uint8_t>(setup->setup_msg_buf.data(), setup->setup_msg_buf.size());
         auto time3 = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> enc_time = time1-time0;
+        std::chrono::duration<double> cf_time = time2-time1;
+        std::chrono::duration<double> ser_time = time3-time2;
+        Log::v("PSI", "Precompute Time:\n\t%fsec ENC, %fsec CF, %fsec Serialize,\n\t%fsec Setup\n",
+               enc_time.count(), cf_time.count(), ser_time.count(), (enc_time+cf_time+ser_time).count());
+        return setup;
+    }
 
-        num_server_elements = htobe64(num_server_elements);
-        channel_.send((uint8_t*)&num_server_elements, sizeof(num_server_elements));
-
-        //send cuckoofilter in steps to save memory
-        const uint64_t size_in_tags = cf.SizeInTags();
-        const uint64_t step = (1<<16);
-        uint64_t uint64_send;
-        uint64_send = htobe64(size_in_tags);
-        channel_.send((uint8_t *) &uint64_send, sizeof(uint64_send));
-        uint64_send = htobe64(step);
-        channel_.send((uint8_t *) &uint64_send, sizeof(uint64_send));
-
-        for(uint64_t i = 0; i < size_in_tags; i+=step) {
-            std::vector<uint8_t> cf_ser = cf.serialize(step, i);
-            uint64_t cfsize = cf_ser.size();
-            uint64_send = htobe64(cfsize);
-            channel_.send((uint8_t *) &uint64_send, sizeof(uint64_send));
-            channel_.send(cf_ser.data(), cfsize);
-        }
+    std::shared_ptr<const PSIServerSetup> OPRFLowMCPSIServer::Update(const PSIServerSetup &prev,
+                                                                     std::vector<block> &added,
+                                                                     std::vector<block> &removed,
+                                                                     size_t num_threads /*=1*/) {
+        Encrypt(prev.key, added, num_threads);
+        Encrypt(prev.key, removed, num_threads);
+        return applySetupUpdate(prev, added, removed);
+    }
 
-        std::vector<unsigned __int128> hash_params = cf.GetTwoIndependentMultiplyShiftParams();
-        for(auto& par : hash_params) {
-            channel_.send((uint8_t*)&par, sizeof(par));
-        }
+    void OPRFLowMCPSIServer::Setup(std::vector<block> &elements) {
+        SetupPrecomputed(Precompute(elements, num_threads_));
+    }
 
-        auto time4 = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> enc_time = time1-time0;
-        std::chrono::duration<double> cf_time = time2-time1;
-        std::chrono::duration<double> trans_time = time4-time3;
-        Log::v("PSI", "Setup Time:\n\t%fsec ENC, %fsec CF,\n\t%fsec Setup,\n\t%fsec Trans,\n\t Setup Comm: %fMiB sent, %fMiB recv\n",
-               enc_time.count(), cf_time.count(), (enc_time+cf_time).count(), trans_time.count(), channel_.getBytesSent()/1024.0/1024.0, channel_.getBytesRecv()/1024.0/1024.0);
+    void OPRFLowMCPSIServer::SetupPrecomputed(std::shared_ptr<const PSIServerSetup> setup) {
+        if(setup->oprf != PSIServerSetup::LowMC) {
+            throw std::runtime_error("setup was not precomputed for LowMC");
+        }
+        setup_ = setup;
+        auto time0 = std::chrono::high_resolution_clock::now();
+        sendSetupSync(channel_, *setup_);
+        auto time1 = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> trans_time = time1-time0;
+        Log::v("PSI", "Setup Time:\n\t%fsec Trans,\n\t Setup Comm: %fMiB sent, %fMiB recv\n",
+               trans_time.count(), channel_.getBytesSent()/1024.0/1024.0, channel_.getBytesRecv()/1024.0/1024.0);
         channel_.clearStats();
     }
 
@@ -120,9 +135,16 @@ namespace droidCrypto {
         channel_.recv((uint8_t*)&num_client_elements, sizeof(num_client_elements));
         num_client_elements = be64toh(num_client_elements);
 
-        droidCrypto::BitVector key_bits(lowmc_key_.data(),
+        droidCrypto::BitVector key_bits(const_cast<uint8_t*>(setup_->key.data()),
                                         droidCrypto::SIMDLowMCCircuitPhases::params->n);
-        circ_.garbleBase(key_bits, num_client_elements);
+        circ_.setBaseOtCache(base_ot_cache_);
+        std::unique_ptr<GCSpool> spool;
+        if(gc_pool_ && key_bits == gc_pool_->getInputA())
+            spool = gc_pool_->take(num_client_elements);
+        if(spool)
+            circ_.garbleBase(*spool);
+        else
+            circ_.garbleBase(key_bits, num_client_elements);
     }
 
     void OPRFLowMCPSIServer::Online() {
@@ -0,0 +1,118 @@
+#include <droidCrypto/psi/PSIServerDaemon.h>
+#include <droidCrypto/utils/Log.h>
+#include <chrono>
+
+namespace droidCrypto {
+
+PSIServerDaemon::PSIServerDaemon(uint16_t port, ServerFactory factory,
+                                 std::shared_ptr<const PSIServerSetup> setup,
+                                 size_t num_workers /*= 4*/)
+    : listener_(port),
+      factory_(factory),
+      setup_(setup),
+      num_workers_(num_workers),
+      stop_(false),
+      num_sessions_(0),
+      num_failed_(0) {}
+
+PSIServerDaemon::~PSIServerDaemon() { Stop(); }
+
+void PSIServerDaemon::Run(size_t max_clients /*= 0*/) {
+  {
+    // a previous Run with max_clients stopped the workers, after Stop() the
+    // listener is closed and accept() returns right away
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = false;
+  }
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_workers_; i++) {
+    workers.emplace_back(&PSIServerDaemon::Worker, this);
+  }
+
+  size_t num_clients = 0;
+  while (max_clients == 0 || num_clients < max_clients) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (stop_) break;
+    }
+    std::unique_ptr<CSocketChannel> chan = listener_.accept();
+    if (!chan) break;
+    std::unique_lock<std::mutex> lock(mtx_);
+    // leave further clients in the listen backlog while all workers are busy
+    cv_.wait(lock, [this] { return stop_ || pending_.size() < num_workers_; });
+    if (stop_) {
+      // the workers may be gone already, turn the client away instead of
+      // queueing it for nobody
+      lock.unlock();
+      chan.reset();
+      Log::v("PSI", "Daemon stopped, closed a client accepted meanwhile");
+      break;
+    }
+    pending_.push_back(std::move(chan));
+    num_clients++;
+    cv_.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (std::thread &t : workers) t.join();
+  Log::v("PSI", "Daemon done: %zu sessions, %zu failed", num_sessions_.load(),
+         num_failed_.load());
+}
+
+void PSIServerDaemon::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  listener_.close();
+}
+
+void PSIServerDaemon::UpdateSetup(std::shared_ptr<const PSIServerSetup> setup) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  setup_ = setup;
+}
+
+std::shared_ptr<const PSIServerSetup> PSIServerDaemon::GetSetup() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return setup_;
+}
+
+void PSIServerDaemon::Worker() {
+  while (true) {
+    std::unique_ptr<CSocketChannel> chan;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      // queued clients are still served after Stop()
+      cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+      if (pending_.empty()) return;
+      chan = std::move(pending_.front());
+      pending_.pop_front();
+    }
+    cv_.notify_all();
+    Session(std::move(chan));
+  }
+}
+
+void PSIServerDaemon::Session(std::unique_ptr<CSocketChannel> chan) {
+  size_t id = num_sessions_++;
+  auto time0 = std::chrono::high_resolution_clock::now();
+  try {
+    std::unique_ptr<PhasedPSIServer> server = factory_(*chan);
+    server->SetupPrecomputed(GetSetup());
+    server->Base();
+    server->Online();
+  } catch (const std::exception &e) {
+    num_failed_++;
+    Log::e("PSI", "Session %zu failed: %s", id, e.what());
+    return;
+  }
+  auto time1 = std::chrono::high_resolution_clock::now();
+  Log::v("PSI", "Session %zu done: %fsec", id,
+         std::chrono::duration<double>(time1 - time0).count());
+}
+}  // namespace droidCrypto
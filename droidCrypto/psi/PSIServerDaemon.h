@@ -0,0 +1,59 @@
+#pragma once
+
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/psi/PSIServerSetup.h>
+#include <droidCrypto/psi/PhasedPSIServer.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace droidCrypto {
+
+// Serves many clients from one precomputed PSIServerSetup. Accepted
+// connections are queued and handled by a fixed number of workers, each
+// running Setup/Base/Online with its own server instance and channel.
+class PSIServerDaemon {
+ public:
+  typedef std::function<std::unique_ptr<PhasedPSIServer>(ChannelWrapper &)>
+      ServerFactory;
+
+  PSIServerDaemon(uint16_t port, ServerFactory factory,
+                  std::shared_ptr<const PSIServerSetup> setup,
+                  size_t num_workers = 4);
+  ~PSIServerDaemon();
+
+  // accepts clients until Stop() is called or max_clients sessions were
+  // started (0: no limit), returns once all started sessions are done.
+  // Can be called again after max_clients sessions to serve more clients.
+  void Run(size_t max_clients = 0);
+  void Stop();
+
+  // sessions started afterwards use setup, running ones keep their old one
+  void UpdateSetup(std::shared_ptr<const PSIServerSetup> setup);
+  std::shared_ptr<const PSIServerSetup> GetSetup();
+
+  size_t getNumSessions() const { return num_sessions_; }
+  size_t getNumFailed() const { return num_failed_; }
+
+ private:
+  void Worker();
+  void Session(std::unique_ptr<CSocketChannel> chan);
+
+  CSocketListener listener_;
+  ServerFactory factory_;
+  std::shared_ptr<const PSIServerSetup> setup_;
+  const size_t num_workers_;
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<CSocketChannel>> pending_;
+  bool stop_;
+  std::atomic<size_t> num_sessions_;
+  std::atomic<size_t> num_failed_;
+};
+}  // namespace droidCrypto
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/Defines.h>
+#include <droidCrypto/utils/MappedFile.h>
+#include <endian.h>
+#include <memory>
+#include <vector>
+#include "cuckoofilter/cuckoofilter.h"
+
+namespace droidCrypto {
+
+typedef cuckoofilter::CuckooFilter<uint64_t *, 32, cuckoofilter::SingleTable,
+                                   cuckoofilter::TwoIndependentMultiplyShift128>
+    OPRFCuckooFilter;
+
+// Client independent part of a PSI server's Setup: the OPRF key and the
+// cuckoo filter of the encrypted database that every client receives. Built
+// once per database (or loaded from a snapshot, see PSIServerSnapshot.h) and
+// shared read-only between sessions.
+struct PSIServerSetup {
+  enum OPRF : uint32_t { LowMC = 1, AES = 2, Bristol = 3 };
+
+  PSIServerSetup() = default;
+  PSIServerSetup(const PSIServerSetup &) = delete;
+  PSIServerSetup &operator=(const PSIServerSetup &) = delete;
+
+  OPRF oprf;
+  std::vector<uint8_t> key;
+  // BristolCircuit::hash of the circuit of a Bristol OPRF, ZeroBlock for the
+  // others
+  block circuit_hash = ZeroBlock;
+  uint64_t num_elements;
+  // identifies the database across updates, changes when it is rebuilt
+  uint64_t db_id = 0;
+  uint64_t db_version = 0;
+  // slots written by the most recent updates, the last entry lead from
+  // db_version - 1 to db_version (see applySetupUpdate in PSISetupSync.h)
+  std::vector<std::shared_ptr<const std::vector<uint64_t>>> change_log;
+
+  // backing file of cf's table and setup_msg when loaded from a snapshot
+  std::shared_ptr<MappedFile> mapping;
+  std::unique_ptr<OPRFCuckooFilter> cf;
+  // cf serialized as the clients' Setup expects it, points into
+  // setup_msg_buf or mapping
+  span<const uint8_t> setup_msg;
+  std::vector<uint8_t> setup_msg_buf;
+};
+
+// serializes cf in the format the clients' Setup expects
+template <typename CuckooFilter>
+std::vector<uint8_t> serializeSetupMsg(CuckooFilter &cf,
+                                       uint64_t num_elements) {
+  BufferChannel buf;
+  uint64_t uint64_send = htobe64(num_elements);
+  buf.send((uint8_t *)&uint64_send, sizeof(uint64_send));
+
+  // cuckoofilter is serialized in steps to save memory
+  const uint64_t size_in_tags = cf.SizeInTags();
+  const uint64_t step = (1 << 16);
+  uint64_send = htobe64(size_in_tags);
+  buf.send((uint8_t *)&uint64_send, sizeof(uint64_send));
+  uint64_send = htobe64(step);
+  buf.send((uint8_t *)&uint64_send, sizeof(uint64_send));
+
+  for (uint64_t i = 0; i < size_in_tags; i += step) {
+    std::vector<uint8_t> cf_ser = cf.serialize(step, i);
+    uint64_t cfsize = cf_ser.size();
+    uint64_send = htobe64(cfsize);
+    buf.send((uint8_t *)&uint64_send, sizeof(uint64_send));
+    buf.send(cf_ser.data(), cfsize);
+  }
+
+  std::vector<unsigned __int128> hash_params =
+      cf.GetTwoIndependentMultiplyShiftParams();
+  for (auto &par : hash_params) {
+    buf.send((uint8_t *)&par, sizeof(par));
+  }
+  return buf.getBuffer();
+}
+}  // namespace droidCrypto
@@ -0,0 +1,188 @@
+#include <droidCrypto/psi/PSIServerSnapshot.h>
+#include <droidCrypto/utils/Log.h>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+namespace {
+const char snapshotMagic[8] = {'D', 'C', 'P', 'S', 'I', 'S', 'R', 'V'};
+const uint32_t snapshotVersion = 3;
+const uint64_t snapshotAlign = 4096;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t oprf;
+  uint8_t circuit_hash[16];
+  uint64_t db_id;
+  uint64_t db_version;
+  uint64_t num_elements;
+  uint64_t num_items;
+  uint64_t num_buckets;
+  uint64_t victim_index;
+  uint32_t victim_tag;
+  uint32_t victim_used;
+  uint64_t key_len;
+  uint64_t num_hash_params;
+  uint64_t table_offset;
+  uint64_t table_len;
+  uint64_t setup_msg_offset;
+  uint64_t setup_msg_len;
+  // change log: per entry the number of slots and the slots
+  uint64_t num_log_entries;
+  uint64_t log_offset;
+  uint64_t log_len;
+};
+
+uint64_t alignUp(uint64_t val) {
+  return (val + snapshotAlign - 1) / snapshotAlign * snapshotAlign;
+}
+
+}  // namespace
+
+void saveSnapshot(const std::string &path, const PSIServerSetup &setup) {
+  const OPRFCuckooFilter &cf = *setup.cf;
+  std::vector<unsigned __int128> hash_params =
+      cf.GetTwoIndependentMultiplyShiftParams();
+
+  SnapshotHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, snapshotMagic, sizeof(hdr.magic));
+  hdr.version = snapshotVersion;
+  hdr.oprf = setup.oprf;
+  memcpy(hdr.circuit_hash, &setup.circuit_hash, sizeof(hdr.circuit_hash));
+  hdr.db_id = setup.db_id;
+  hdr.db_version = setup.db_version;
+  hdr.num_elements = setup.num_elements;
+  hdr.num_items = cf.Size();
+  hdr.num_buckets = cf.NumBuckets();
+  size_t victim_index;
+  uint32_t victim_tag;
+  hdr.victim_used = cf.GetVictim(victim_index, victim_tag);
+  hdr.victim_index = victim_index;
+  hdr.victim_tag = victim_tag;
+  hdr.key_len = setup.key.size();
+  hdr.num_hash_params = hash_params.size();
+  hdr.table_offset = alignUp(sizeof(hdr) + hdr.key_len +
+                             hdr.num_hash_params * sizeof(unsigned __int128));
+  hdr.table_len = OPRFCuckooFilter::TableAllocSize(setup.num_elements);
+  hdr.setup_msg_offset = alignUp(hdr.table_offset + hdr.table_len);
+  hdr.setup_msg_len = setup.setup_msg.size();
+  hdr.num_log_entries = setup.change_log.size();
+  hdr.log_offset = hdr.setup_msg_offset + hdr.setup_msg_len;
+  hdr.log_len = 0;
+  for (auto &entry : setup.change_log) {
+    hdr.log_len += (1 + entry->size()) * sizeof(uint64_t);
+  }
+
+  AtomicFileWriter f(path);
+  f.write(&hdr, sizeof(hdr));
+  f.write(setup.key.data(), setup.key.size());
+  f.write(hash_params.data(), hash_params.size() * sizeof(unsigned __int128));
+  f.padTo(hdr.table_offset);
+  f.write(cf.TableData(), hdr.table_len);
+  f.padTo(hdr.setup_msg_offset);
+  f.write(setup.setup_msg.data(), setup.setup_msg.size());
+  for (auto &entry : setup.change_log) {
+    uint64_t num_slots = entry->size();
+    f.write(&num_slots, sizeof(num_slots));
+    f.write(entry->data(), num_slots * sizeof(uint64_t));
+  }
+  f.commit();
+  Log::v("PSI", "saved snapshot of db version %llu to %s",
+         (unsigned long long)setup.db_version, path.c_str());
+}
+
+std::shared_ptr<const PSIServerSetup> loadSnapshot(const std::string &path) {
+  auto time0 = std::chrono::high_resolution_clock::now();
+  std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>(path);
+  const uint8_t *base = mapping->data();
+  const uint64_t file_size = mapping->size();
+
+  SnapshotHeader hdr;
+  if (file_size < sizeof(hdr)) {
+    throw std::runtime_error("snapshot truncated: " + path);
+  }
+  memcpy(&hdr, base, sizeof(hdr));
+  if (memcmp(hdr.magic, snapshotMagic, sizeof(hdr.magic)) != 0) {
+    throw std::runtime_error("not a PSI server snapshot: " + path);
+  }
+  if (hdr.version != snapshotVersion) {
+    throw std::runtime_error("unsupported snapshot version: " + path);
+  }
+  if (hdr.oprf != PSIServerSetup::LowMC && hdr.oprf != PSIServerSetup::AES &&
+      hdr.oprf != PSIServerSetup::Bristol) {
+    throw std::runtime_error("unknown OPRF in snapshot: " + path);
+  }
+  const uint64_t params_len = hdr.num_hash_params * sizeof(unsigned __int128);
+  // key and hash parameters follow the header and end before the table
+  if (hdr.num_hash_params != 3 || file_size < sizeof(hdr) + params_len ||
+      hdr.key_len > file_size - sizeof(hdr) - params_len ||
+      hdr.table_offset < sizeof(hdr) + hdr.key_len + params_len ||
+      hdr.num_buckets != OPRFCuckooFilter::NumBuckets(hdr.num_elements) ||
+      hdr.table_len != OPRFCuckooFilter::TableAllocSize(hdr.num_elements) ||
+      hdr.table_offset % snapshotAlign != 0 ||
+      hdr.table_offset > file_size ||
+      hdr.table_len > file_size - hdr.table_offset ||
+      hdr.setup_msg_offset > file_size ||
+      hdr.setup_msg_len > file_size - hdr.setup_msg_offset ||
+      hdr.log_offset != hdr.setup_msg_offset + hdr.setup_msg_len ||
+      hdr.log_len > file_size - hdr.log_offset ||
+      (hdr.victim_used && hdr.victim_index >= hdr.num_buckets)) {
+    throw std::runtime_error("snapshot corrupted: " + path);
+  }
+
+  std::shared_ptr<PSIServerSetup> setup = std::make_shared<PSIServerSetup>();
+  setup->oprf = (PSIServerSetup::OPRF)hdr.oprf;
+  memcpy(&setup->circuit_hash, hdr.circuit_hash, sizeof(hdr.circuit_hash));
+  setup->db_id = hdr.db_id;
+  setup->db_version = hdr.db_version;
+  setup->num_elements = hdr.num_elements;
+  const uint8_t *key = base + sizeof(hdr);
+  setup->key.assign(key, key + hdr.key_len);
+
+  std::vector<unsigned __int128> hash_params(hdr.num_hash_params);
+  memcpy(hash_params.data(), key + hdr.key_len, params_len);
+  setup->cf.reset(new OPRFCuckooFilter(hdr.num_elements,
+                                       mapping->data() + hdr.table_offset));
+  setup->cf->SetTwoIndependentMultiplyShiftParams(hash_params);
+  setup->cf->SetNumItems(hdr.num_items);
+  setup->cf->SetVictim(hdr.victim_index, hdr.victim_tag, hdr.victim_used);
+
+  setup->setup_msg =
+      span<const uint8_t>(base + hdr.setup_msg_offset, hdr.setup_msg_len);
+
+  const uint8_t *log = base + hdr.log_offset;
+  const uint8_t *log_end = log + hdr.log_len;
+  const uint64_t size_in_tags = setup->cf->SizeInTags();
+  for (uint64_t i = 0; i < hdr.num_log_entries; i++) {
+    uint64_t num_slots;
+    if ((uint64_t)(log_end - log) < sizeof(num_slots)) {
+      throw std::runtime_error("snapshot corrupted: " + path);
+    }
+    memcpy(&num_slots, log, sizeof(num_slots));
+    log += sizeof(num_slots);
+    if (num_slots > (uint64_t)(log_end - log) / sizeof(uint64_t)) {
+      throw std::runtime_error("snapshot corrupted: " + path);
+    }
+    auto entry = std::make_shared<std::vector<uint64_t>>(num_slots);
+    memcpy(entry->data(), log, num_slots * sizeof(uint64_t));
+    log += num_slots * sizeof(uint64_t);
+    for (uint64_t slot : *entry) {
+      if (slot >= size_in_tags) {
+        throw std::runtime_error("snapshot corrupted: " + path);
+      }
+    }
+    setup->change_log.push_back(entry);
+  }
+  setup->mapping = mapping;
+  auto time1 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> load_time = time1 - time0;
+  Log::v("PSI", "loaded snapshot of db version %llu (%llu elements) in %fsec",
+         (unsigned long long)hdr.db_version,
+         (unsigned long long)hdr.num_elements, load_time.count());
+  return setup;
+}
+}  // namespace droidCrypto
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <droidCrypto/psi/PSIServerSetup.h>
+#include <memory>
+#include <string>
+
+namespace droidCrypto {
+
+// Persistent snapshot of a PSIServerSetup, so a server restart does not have
+// to encrypt the database and rebuild the cuckoo filter again.
+//
+// The file holds a versioned header with the hash of a Bristol OPRF's
+// circuit, the OPRF key, the hash parameters, the raw bucket table of the
+// filter, the serialized Setup message and the change log for delta syncs.
+// Table and message are page aligned: loading maps the file instead of
+// reading it, the filter works directly on the mapped table and
+// SetupPrecomputed sends the message straight from the mapped pages.
+//
+// The snapshot contains the OPRF key and is created with mode 0600.
+// It is in host byte order and only meant to be loaded on the same platform.
+
+// writes setup to path, atomically replacing an existing file.
+// throws std::runtime_error on I/O errors
+void saveSnapshot(const std::string &path, const PSIServerSetup &setup);
+
+// maps a snapshot written by saveSnapshot, throws std::runtime_error if the
+// file is missing, truncated or of a different format version
+std::shared_ptr<const PSIServerSetup> loadSnapshot(const std::string &path);
+}  // namespace droidCrypto
@@ -0,0 +1,344 @@
+#include <droidCrypto/SecureRandom.h>
+#include <droidCrypto/psi/PSISetupSync.h>
+#include <droidCrypto/utils/Log.h>
+#include <endian.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace droidCrypto {
+
+namespace {
+enum SyncMode : uint64_t { FullSync = 0, DeltaSync = 1, CurrentSync = 2 };
+
+// be64 slot + be32 tag
+const size_t deltaSlotBytes = 12;
+// slots per message when sending or receiving a delta
+const size_t deltaChunkSlots = 1 << 16;
+// updates a client can fall behind before it gets the full filter again
+const size_t maxChangeLogEntries = 64;
+
+const char cacheMagic[8] = {'D', 'C', 'P', 'S', 'I', 'C', 'L', 'F'};
+const uint32_t cacheVersion = 1;
+const uint64_t cacheTableOffset = 4096;
+
+struct ClientCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t victim_used;
+  uint64_t db_id;
+  uint64_t db_version;
+  uint64_t num_elements;
+  uint64_t num_items;
+  uint64_t num_buckets;
+  uint64_t victim_index;
+  uint64_t victim_tag;
+  unsigned __int128 hash_params[3];
+  uint64_t table_len;
+};
+
+void sendBe64(ChannelWrapper &chan, uint64_t val) {
+  val = htobe64(val);
+  chan.send((uint8_t *)&val, sizeof(val));
+}
+
+uint64_t recvBe64(ChannelWrapper &chan) {
+  uint64_t val;
+  chan.recv((uint8_t *)&val, sizeof(val));
+  return be64toh(val);
+}
+
+void recvFullSetup(ChannelWrapper &chan, PSIClientFilter &filter) {
+  filter.num_elements = recvBe64(chan);
+  uint64_t size_in_tags = recvBe64(chan);
+  uint64_t step = recvBe64(chan);
+  filter.cf.reset(new OPRFCuckooFilter(filter.num_elements));
+  filter.mapping.reset();
+  if (size_in_tags != filter.cf->SizeInTags()) {
+    throw std::runtime_error("cuckoo filter size mismatch");
+  }
+
+  std::vector<uint8_t> tmp;
+  for (uint64_t i = 0; i < size_in_tags; i += step) {
+    uint64_t cfsize = recvBe64(chan);
+    tmp.resize(cfsize);
+    chan.recv(tmp.data(), cfsize);
+    filter.cf->deserialize(tmp, i);
+  }
+  std::vector<unsigned __int128> params(3);
+  for (auto &par : params) {
+    chan.recv((uint8_t *)&par, sizeof(par));
+  }
+  filter.cf->SetTwoIndependentMultiplyShiftParams(params);
+}
+
+void recvDeltaSetup(ChannelWrapper &chan, PSIClientFilter &filter) {
+  uint64_t num_items = recvBe64(chan);
+  uint64_t num_slots = recvBe64(chan);
+  const uint64_t size_in_tags = filter.cf->SizeInTags();
+
+  std::vector<uint8_t> tmp;
+  for (uint64_t i = 0; i < num_slots; i += deltaChunkSlots) {
+    size_t chunk = std::min<uint64_t>(deltaChunkSlots, num_slots - i);
+    tmp.resize(chunk * deltaSlotBytes);
+    chan.recv(tmp.data(), tmp.size());
+    for (size_t j = 0; j < chunk; j++) {
+      uint64_t slot;
+      uint32_t tag;
+      memcpy(&slot, &tmp[j * deltaSlotBytes], sizeof(slot));
+      memcpy(&tag, &tmp[j * deltaSlotBytes + 8], sizeof(tag));
+      slot = be64toh(slot);
+      if (slot >= size_in_tags) {
+        throw std::runtime_error("cuckoo filter delta out of range");
+      }
+      filter.cf->WriteSlot(slot, be32toh(tag));
+    }
+  }
+  filter.cf->SetNumItems(num_items);
+}
+}  // namespace
+
+void sendSetupSync(ChannelWrapper &chan, const PSIServerSetup &setup) {
+  uint64_t client_id = recvBe64(chan);
+  uint64_t client_version = recvBe64(chan);
+
+  if (client_id != 0 && client_id == setup.db_id &&
+      client_version == setup.db_version) {
+    sendBe64(chan, setup.db_id);
+    sendBe64(chan, setup.db_version);
+    sendBe64(chan, CurrentSync);
+    chan.flush();
+    Log::v("PSI", "Setup sync: client has current version %llu",
+           (unsigned long long)setup.db_version);
+    return;
+  }
+
+  bool delta = client_id != 0 && client_id == setup.db_id &&
+               client_version < setup.db_version &&
+               setup.db_version - client_version <= setup.change_log.size();
+  std::vector<uint64_t> slots;
+  if (delta) {
+    for (size_t i = setup.change_log.size() -
+                    (setup.db_version - client_version);
+         i < setup.change_log.size(); i++) {
+      slots.insert(slots.end(), setup.change_log[i]->begin(),
+                   setup.change_log[i]->end());
+    }
+    std::sort(slots.begin(), slots.end());
+    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+    // beyond half the size of the full message the delta is not worth it
+    if (slots.size() * deltaSlotBytes > (size_t)setup.setup_msg.size() / 2) {
+      delta = false;
+    }
+  }
+
+  sendBe64(chan, setup.db_id);
+  sendBe64(chan, setup.db_version);
+  sendBe64(chan, delta ? DeltaSync : FullSync);
+  if (delta) {
+    sendBe64(chan, setup.cf->Size());
+    sendBe64(chan, slots.size());
+    std::vector<uint8_t> tmp;
+    for (size_t i = 0; i < slots.size(); i += deltaChunkSlots) {
+      size_t chunk = std::min(deltaChunkSlots, slots.size() - i);
+      tmp.resize(chunk * deltaSlotBytes);
+      for (size_t j = 0; j < chunk; j++) {
+        uint64_t slot = htobe64(slots[i + j]);
+        uint32_t tag = htobe32(setup.cf->ReadSlot(slots[i + j]));
+        memcpy(&tmp[j * deltaSlotBytes], &slot, sizeof(slot));
+        memcpy(&tmp[j * deltaSlotBytes + 8], &tag, sizeof(tag));
+      }
+      chan.send(tmp.data(), tmp.size());
+    }
+  } else {
+    chan.send(const_cast<uint8_t *>(setup.setup_msg.data()),
+              setup.setup_msg.size());
+  }
+
+  size_t victim_index;
+  uint32_t victim_tag;
+  bool victim_used = setup.cf->GetVictim(victim_index, victim_tag);
+  sendBe64(chan, victim_used);
+  sendBe64(chan, victim_index);
+  victim_tag = htobe32(victim_tag);
+  chan.send((uint8_t *)&victim_tag, sizeof(victim_tag));
+  chan.flush();
+
+  if (delta) {
+    Log::v("PSI", "Setup sync: delta of %zu slots from version %llu to %llu",
+           slots.size(), (unsigned long long)client_version,
+           (unsigned long long)setup.db_version);
+  } else {
+    Log::v("PSI", "Setup sync: full filter of version %llu",
+           (unsigned long long)setup.db_version);
+  }
+}
+
+bool recvSetupSync(ChannelWrapper &chan, PSIClientFilter &filter) {
+  if (!filter.cf) {
+    filter.db_id = 0;
+  }
+  sendBe64(chan, filter.db_id);
+  sendBe64(chan, filter.db_version);
+
+  uint64_t db_id = recvBe64(chan);
+  uint64_t db_version = recvBe64(chan);
+  uint64_t mode = recvBe64(chan);
+  bool known = filter.cf && db_id == filter.db_id;
+  if (mode == CurrentSync && known && db_version == filter.db_version) {
+    return false;
+  } else if (mode == FullSync) {
+    recvFullSetup(chan, filter);
+  } else if (mode == DeltaSync && known) {
+    recvDeltaSetup(chan, filter);
+  } else {
+    throw std::runtime_error("unexpected setup sync mode");
+  }
+
+  bool victim_used = recvBe64(chan);
+  uint64_t victim_index = recvBe64(chan);
+  uint32_t victim_tag;
+  chan.recv((uint8_t *)&victim_tag, sizeof(victim_tag));
+  if (victim_used && victim_index >= filter.cf->NumBuckets()) {
+    throw std::runtime_error("cuckoo filter victim out of range");
+  }
+  filter.cf->SetVictim(victim_index, be32toh(victim_tag), victim_used);
+  filter.db_id = db_id;
+  filter.db_version = db_version;
+  if (!filter.cache_path.empty()) {
+    saveClientFilter(filter.cache_path, filter);
+  }
+  return true;
+}
+
+std::shared_ptr<PSIClientFilter> loadClientFilter(const std::string &path) {
+  std::shared_ptr<PSIClientFilter> filter = std::make_shared<PSIClientFilter>();
+  filter->cache_path = path;
+  std::shared_ptr<MappedFile> mapping;
+  try {
+    mapping = std::make_shared<MappedFile>(path);
+  } catch (const std::runtime_error &) {
+    return filter;
+  }
+
+  ClientCacheHeader hdr;
+  if (mapping->size() < sizeof(hdr)) {
+    return filter;
+  }
+  memcpy(&hdr, mapping->data(), sizeof(hdr));
+  if (memcmp(hdr.magic, cacheMagic, sizeof(hdr.magic)) != 0 ||
+      hdr.version != cacheVersion || hdr.db_id == 0 ||
+      hdr.num_buckets != OPRFCuckooFilter::NumBuckets(hdr.num_elements) ||
+      hdr.table_len != OPRFCuckooFilter::TableAllocSize(hdr.num_elements) ||
+      mapping->size() < cacheTableOffset ||
+      hdr.table_len > mapping->size() - cacheTableOffset ||
+      (hdr.victim_used && hdr.victim_index >= hdr.num_buckets)) {
+    Log::e("PSI", "ignoring invalid filter cache %s", path.c_str());
+    return filter;
+  }
+
+  filter->cf.reset(new OPRFCuckooFilter(
+      hdr.num_elements, mapping->data() + cacheTableOffset));
+  filter->cf->SetTwoIndependentMultiplyShiftParams(std::vector<unsigned __int128>(
+      hdr.hash_params, hdr.hash_params + 3));
+  filter->cf->SetNumItems(hdr.num_items);
+  filter->cf->SetVictim(hdr.victim_index, hdr.victim_tag, hdr.victim_used);
+  filter->db_id = hdr.db_id;
+  filter->db_version = hdr.db_version;
+  filter->num_elements = hdr.num_elements;
+  filter->mapping = mapping;
+  Log::v("PSI", "loaded filter cache of db version %llu",
+         (unsigned long long)hdr.db_version);
+  return filter;
+}
+
+void saveClientFilter(const std::string &path, const PSIClientFilter &filter) {
+  const OPRFCuckooFilter &cf = *filter.cf;
+  ClientCacheHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, cacheMagic, sizeof(hdr.magic));
+  hdr.version = cacheVersion;
+  hdr.db_id = filter.db_id;
+  hdr.db_version = filter.db_version;
+  hdr.num_elements = filter.num_elements;
+  hdr.num_items = cf.Size();
+  hdr.num_buckets = cf.NumBuckets();
+  size_t victim_index;
+  uint32_t victim_tag;
+  hdr.victim_used = cf.GetVictim(victim_index, victim_tag);
+  hdr.victim_index = victim_index;
+  hdr.victim_tag = victim_tag;
+  std::vector<unsigned __int128> params =
+      cf.GetTwoIndependentMultiplyShiftParams();
+  std::copy(params.begin(), params.end(), hdr.hash_params);
+  hdr.table_len = OPRFCuckooFilter::TableAllocSize(filter.num_elements);
+
+  // the old file may still be mapped by filter, the rename leaves it intact
+  AtomicFileWriter f(path);
+  f.write(&hdr, sizeof(hdr));
+  f.padTo(cacheTableOffset);
+  f.write(cf.TableData(), hdr.table_len);
+  f.commit();
+}
+
+uint64_t newDatabaseId() {
+  SecureRandom rnd;
+  uint64_t id;
+  do {
+    id = rnd.rand();
+  } while (id == 0);
+  return id;
+}
+
+std::shared_ptr<const PSIServerSetup> applySetupUpdate(
+    const PSIServerSetup &prev, const std::vector<block> &added,
+    const std::vector<block> &removed) {
+  auto time0 = std::chrono::high_resolution_clock::now();
+  std::shared_ptr<PSIServerSetup> setup = std::make_shared<PSIServerSetup>();
+  setup->oprf = prev.oprf;
+  setup->key = prev.key;
+  setup->circuit_hash = prev.circuit_hash;
+  setup->num_elements = prev.num_elements;
+  setup->db_id = prev.db_id;
+  setup->db_version = prev.db_version + 1;
+  setup->cf.reset(new OPRFCuckooFilter(prev.num_elements));
+  OPRFCuckooFilter &cf = *setup->cf;
+  cf.CopyFrom(*prev.cf);
+
+  std::shared_ptr<std::vector<uint64_t>> slots =
+      std::make_shared<std::vector<uint64_t>>();
+  cf.SetWriteLog(slots.get());
+  size_t num_removed = 0;
+  for (const block &elem : removed) {
+    if (cf.Delete((uint64_t *)&elem) == cuckoofilter::Ok) {
+      num_removed++;
+    }
+  }
+  for (const block &elem : added) {
+    if (cf.Add((uint64_t *)&elem) != cuckoofilter::Ok) {
+      throw std::runtime_error("cuckoo filter full, rebuild the database");
+    }
+  }
+  cf.SetWriteLog(nullptr);
+  std::sort(slots->begin(), slots->end());
+  slots->erase(std::unique(slots->begin(), slots->end()), slots->end());
+  slots->shrink_to_fit();
+
+  size_t keep = std::min(prev.change_log.size(), maxChangeLogEntries - 1);
+  setup->change_log.assign(prev.change_log.end() - keep,
+                           prev.change_log.end());
+  setup->change_log.push_back(slots);
+
+  setup->setup_msg_buf = serializeSetupMsg(cf, setup->num_elements);
+  setup->setup_msg = span<const uint8_t>(setup->setup_msg_buf.data(),
+                                         setup->setup_msg_buf.size());
+  auto time1 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> update_time = time1 - time0;
+  Log::v("PSI",
+         "Updated db to version %llu: %zu added, %zu of %zu removed, %zu "
+         "slots changed, %fsec",
+         (unsigned long long)setup->db_version, added.size(), num_removed,
+         removed.size(), slots->size(), update_time.count());
+  return setup;
+}
+}  // namespace droidCrypto
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/psi/PSIServerSetup.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace droidCrypto {
+
+// Setup transfer with delta sync for returning clients.
+//
+// The client announces the database id and version of the filter it already
+// holds (id 0 if none). The server replies with its own id and version and
+// either the full Setup message or, if the client's version is still covered
+// by the change log of the setup, only the changed slots:
+//
+//   client: be64 db_id, be64 db_version
+//   server: be64 db_id, be64 db_version, be64 mode
+//     current: nothing else, the client's filter is up to date
+//     full:    Setup message (see serializeSetupMsg)
+//     delta:   be64 num_items, be64 num_slots,
+//              num_slots * (be64 slot, be32 tag)
+//   server (full and delta): be64 victim used, be64 victim index,
+//                            be32 victim tag
+
+// cuckoo filter of a server database as a client received it, kept between
+// sessions so only changes have to be transferred again
+struct PSIClientFilter {
+  uint64_t db_id = 0;
+  uint64_t db_version = 0;
+  uint64_t num_elements = 0;
+  // file the filter is persisted to after every change, may be empty
+  std::string cache_path;
+  // backing file of cf's table when loaded from cache_path
+  std::shared_ptr<MappedFile> mapping;
+  std::unique_ptr<OPRFCuckooFilter> cf;
+};
+
+// Maps the filter cached in path by a previous session. The table is used
+// directly from the mapped pages, delta syncs only copy the pages they touch.
+// Returns an empty filter if path does not exist or holds no valid cache, in
+// both cases the filter is persisted to path after the next sync.
+std::shared_ptr<PSIClientFilter> loadClientFilter(const std::string &path);
+
+// writes filter to path, atomically replacing an existing file.
+// throws std::runtime_error on I/O errors
+void saveClientFilter(const std::string &path, const PSIClientFilter &filter);
+
+// server side of the sync, answers the client's request from setup
+void sendSetupSync(ChannelWrapper &chan, const PSIServerSetup &setup);
+
+// client side of the sync, brings filter up to the server's version. Returns
+// false if filter already was, true if it was changed
+bool recvSetupSync(ChannelWrapper &chan, PSIClientFilter &filter);
+
+// returns a new database id for a freshly built setup
+uint64_t newDatabaseId();
+
+// Creates the next version of prev with the already OPRF-encrypted elements
+// added and removed. prev stays untouched, so sessions still using it are not
+// affected. Only remove elements that are in the database, removing others
+// may drop a colliding element instead. Throws std::runtime_error if the
+// filter is too full for the additions, then the database has to be rebuilt.
+std::shared_ptr<const PSIServerSetup> applySetupUpdate(
+    const PSIServerSetup &prev, const std::vector<block> &added,
+    const std::vector<block> &removed);
+}  // namespace droidCrypto
@@ -2,9 +2,12 @@
 
 #include <droidCrypto/Defines.h>
 #include <chrono>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace droidCrypto {
+class BaseOtCache;
 class ChannelWrapper;
 
 class PhasedPSIClient {
@@ -22,8 +25,18 @@ class PhasedPSIClient {
   virtual void Base(size_t num_elements) = 0;
   virtual std::vector<size_t> Online(std::vector<block> &elements) = 0;
 
+  // Base resumes the base OTs of an earlier session with the server called
+  // server from cache if the server has a cache as well, see BaseOtCache
+  void setBaseOtCache(std::shared_ptr<BaseOtCache> cache,
+                      const std::string &server) {
+    base_ot_cache_ = std::move(cache);
+    base_ot_peer_ = server;
+  }
+
  protected:
   ChannelWrapper &channel_;
+  std::shared_ptr<BaseOtCache> base_ot_cache_;
+  std::string base_ot_peer_;
   std::chrono::duration<double> time_setup;
   std::chrono::duration<double> time_base;
   std::chrono::duration<double> time_online;
@@ -2,10 +2,15 @@
 
 #include <droidCrypto/Defines.h>
 #include <chrono>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace droidCrypto {
 class ChannelWrapper;
+class BaseOtCache;
+class GCPool;
+struct PSIServerSetup;
 
 class PhasedPSIServer {
  public:
@@ -24,12 +29,28 @@ class PhasedPSIServer {
   }
 
   virtual void Setup(std::vector<block> &elements) = 0;
+  // sends a setup precomputed once for many sessions instead of building it
+  virtual void SetupPrecomputed(std::shared_ptr<const PSIServerSetup> setup) {
+    throw std::runtime_error("precomputed setup not supported");
+  }
   virtual void Base() = 0;
   virtual void Online() = 0;
 
+  // Base sends a GC from pool if it has one garbled under this server's key
+  // for the client's number of elements, otherwise it garbles on demand
+  void setGCPool(std::shared_ptr<GCPool> pool) { gc_pool_ = std::move(pool); }
+
+  // Base resumes the base OTs of a client's earlier session from cache if the
+  // client has a cache as well and a ticket for them, see BaseOtCache
+  void setBaseOtCache(std::shared_ptr<BaseOtCache> cache) {
+    base_ot_cache_ = std::move(cache);
+  }
+
  protected:
   ChannelWrapper &channel_;
   size_t num_threads_;
+  std::shared_ptr<GCPool> gc_pool_;
+  std::shared_ptr<BaseOtCache> base_ot_cache_;
   std::chrono::duration<double> time_setup;
   std::chrono::duration<double> time_base;
   std::chrono::duration<double> time_online;
@@ -15,6 +15,10 @@
  *  Modified by Daniel Kales, 2019
  *  * added serialize/deserialize functions
  *  * added interface to get hasher parameters
+ *  * added filters on external table memory and victim/size accessors
+ *  * added CopyFrom(), slot access and logging of written slots
+ *  * added AddParallel()
+ *  * added ContainBatch()
  */
 #ifndef CUCKOO_FILTER_CUCKOO_FILTER_H_
 #define CUCKOO_FILTER_CUCKOO_FILTER_H_
@@ -22,6 +26,8 @@
 #include <assert.h>
 #include <sys/param.h>
 #include <algorithm>
+#include <thread>
+#include <vector>
 
 #include "debug.h"
 #include "hashutil.h"
@@ -105,8 +111,7 @@ class CuckooFilter {
   double BitsPerItem() const { return 8.0 * table_->SizeInBytes() / Size(); }
 
  public:
-  explicit CuckooFilter(const size_t max_num_keys)
-      : num_items_(0), victim_(), hasher_() {
+  static size_t NumBuckets(const size_t max_num_keys) {
     size_t assoc = 3;
     size_t num_buckets =
         upperpower2(std::max<uint64_t>(1, max_num_keys / assoc));
@@ -114,8 +119,25 @@ class CuckooFilter {
     if (frac > 0.96) {
       num_buckets <<= 1;
     }
+    return num_buckets;
+  }
+
+  explicit CuckooFilter(const size_t max_num_keys)
+      : num_items_(0), victim_(), hasher_() {
     victim_.used = false;
-    table_ = new TableType<bits_per_item>(num_buckets);
+    table_ = new TableType<bits_per_item>(NumBuckets(max_num_keys));
+  }
+
+  // filter on table memory owned by the caller, which has to hold
+  // TableAllocSize(max_num_keys) bytes and outlive the filter
+  CuckooFilter(const size_t max_num_keys, void *table_data)
+      : num_items_(0), victim_(), hasher_() {
+    victim_.used = false;
+    table_ = new TableType<bits_per_item>(NumBuckets(max_num_keys), table_data);
+  }
+
+  static size_t TableAllocSize(const size_t max_num_keys) {
+    return TableType<bits_per_item>::AllocSize(NumBuckets(max_num_keys));
   }
 
   ~CuckooFilter() { delete table_; }
@@ -124,15 +146,31 @@ class CuckooFilter {
       std::vector<unsigned __int128> params) {
     hasher_.setParams(params);
   }
-  std::vector<unsigned __int128> GetTwoIndependentMultiplyShiftParams() {
+  std::vector<unsigned __int128> GetTwoIndependentMultiplyShiftParams() const {
     return hasher_.getParams();
   };
   // Add an item to the filter.
   Status Add(const ItemType &item);
 
+  // Add item_at(0), ..., item_at(n-1) to the filter using num_threads
+  // threads. The threads place each tag into a free slot of one of its two
+  // buckets with compare-and-swap, only items whose buckets are both full
+  // are added afterwards by the sequential Add() with cuckoo kicks. The
+  // result is a regular filter, but slot positions depend on scheduling.
+  // Must not run concurrently with any other method.
+  template <typename ItemAt>
+  Status AddParallel(size_t n, ItemAt item_at, size_t num_threads);
+
   // Report if the item is inserted, with false positive rate.
   Status Contain(const ItemType &item) const;
 
+  // Contain() for many items: sets bit k of out (which is reset to
+  // items.size() bits, bit 0 is the LSB of out.data()[0]) if items[k] is
+  // contained. Hashes a group of items and prefetches all their buckets
+  // before comparing tags, so the cache misses of the group overlap.
+  template <typename ItemSpan, typename BitOut>
+  void ContainBatch(const ItemSpan &items, BitOut &out) const;
+
   // Delete an key from the filter
   Status Delete(const ItemType &item);
 
@@ -153,6 +191,39 @@ class CuckooFilter {
 
   // size of the filter in tags.
   size_t SizeInTags() const { return table_->SizeInTags(); }
+
+  // raw table and state, for storing a filter outside of serialize()
+  const void *TableData() const { return table_->Data(); }
+  size_t NumBuckets() const { return table_->NumBuckets(); }
+  void SetNumItems(size_t num_items) { num_items_ = num_items; }
+  bool GetVictim(size_t &index, uint32_t &tag) const {
+    index = victim_.index;
+    tag = victim_.tag;
+    return victim_.used;
+  }
+  void SetVictim(size_t index, uint32_t tag, bool used) {
+    victim_.index = index;
+    victim_.tag = tag;
+    victim_.used = used;
+  }
+
+  // copies table, size, victim and hash parameters of a filter with the same
+  // number of buckets
+  void CopyFrom(const CuckooFilter &other) {
+    assert(NumBuckets() == other.NumBuckets());
+    table_->SetData(other.table_->Data(),
+                    TableType<bits_per_item>::AllocSize(NumBuckets()));
+    num_items_ = other.num_items_;
+    victim_ = other.victim_;
+    hasher_ = other.hasher_;
+  }
+
+  // slots are numbered bucket by bucket, SizeInTags() in total
+  uint32_t ReadSlot(uint64_t slot) const { return table_->ReadSlot(slot); }
+  void WriteSlot(uint64_t slot, uint32_t tag) { table_->WriteSlot(slot, tag); }
+
+  // while set, Add and Delete append every slot they write to log
+  void SetWriteLog(std::vector<uint64_t> *log) { table_->SetWriteLog(log); }
 };
 
 template <typename ItemType, size_t bits_per_item,
@@ -170,6 +241,57 @@ Status CuckooFilter<ItemType, bits_per_item, TableType, HashFamily>::Add(
   return AddImpl(i, tag);
 }
 
+template <typename ItemType, size_t bits_per_item,
+          template <size_t> class TableType, typename HashFamily>
+template <typename ItemAt>
+Status CuckooFilter<ItemType, bits_per_item, TableType, HashFamily>::AddParallel(
+    size_t n, ItemAt item_at, size_t num_threads) {
+  if (victim_.used) {
+    return NotEnoughSpace;
+  }
+  num_threads = std::max<size_t>(1, std::min(num_threads, n / 1024));
+
+  // items that found both buckets full, per thread
+  std::vector<std::vector<size_t>> deferred(num_threads);
+  auto insert_range = [this, &item_at, &deferred](size_t thrd, size_t begin,
+                                                  size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      size_t i1;
+      uint32_t tag;
+      GenerateIndexTagHash(item_at(k), &i1, &tag);
+      if (!table_->InsertTagToBucketAtomic(i1, tag) &&
+          !table_->InsertTagToBucketAtomic(AltIndex(i1, tag), tag)) {
+        deferred[thrd].push_back(k);
+      }
+    }
+  };
+  size_t per_thread = n / num_threads;
+  std::vector<std::thread> threads;
+  for (size_t thrd = 0; thrd < num_threads - 1; thrd++) {
+    threads.emplace_back(insert_range, thrd, thrd * per_thread,
+                         (thrd + 1) * per_thread);
+  }
+  insert_range(num_threads - 1, (num_threads - 1) * per_thread, n);
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  size_t num_deferred = 0;
+  for (auto &d : deferred) {
+    num_deferred += d.size();
+  }
+  num_items_ += n - num_deferred;
+  for (auto &d : deferred) {
+    for (size_t k : d) {
+      Status status = Add(item_at(k));
+      if (status != Ok) {
+        return status;
+      }
+    }
+  }
+  return Ok;
+}
+
 template <typename ItemType, size_t bits_per_item,
           template <size_t> class TableType, typename HashFamily>
 Status CuckooFilter<ItemType, bits_per_item, TableType, HashFamily>::AddImpl(
@@ -220,6 +342,39 @@ Status CuckooFilter<ItemType, bits_per_item, TableType, HashFamily>::Contain(
   }
 }
 
+template <typename ItemType, size_t bits_per_item,
+          template <size_t> class TableType, typename HashFamily>
+template <typename ItemSpan, typename BitOut>
+void CuckooFilter<ItemType, bits_per_item, TableType, HashFamily>::ContainBatch(
+    const ItemSpan &items, BitOut &out) const {
+  // enough independent loads in flight to cover the memory latency
+  const size_t kGroup = 16;
+  size_t i1[kGroup], i2[kGroup];
+  uint32_t tags[kGroup];
+
+  const size_t n = items.size();
+  out.reset(n);
+  uint8_t *bits = out.data();
+  for (size_t g = 0; g < n; g += kGroup) {
+    const size_t m = std::min(kGroup, n - g);
+    for (size_t k = 0; k < m; k++) {
+      const uint64_t hash = hasher_(items[g + k]);
+      i1[k] = IndexHash(hash >> 32);
+      tags[k] = TagHash(hash);
+      i2[k] = AltIndex(i1[k], tags[k]);
+      table_->PrefetchBucket(i1[k]);
+      table_->PrefetchBucket(i2[k]);
+    }
+    for (size_t k = 0; k < m; k++) {
+      bool found = victim_.used && (tags[k] == victim_.tag) &&
+                   (i1[k] == victim_.index || i2[k] == victim_.index);
+      if (found || table_->FindTagInBuckets(i1[k], i2[k], tags[k])) {
+        bits[(g + k) / 8] |= 1 << ((g + k) % 8);
+      }
+    }
+  }
+}
+
 template <typename ItemType, size_t bits_per_item,
           template <size_t> class TableType, typename HashFamily>
 Status CuckooFilter<ItemType, bits_per_item, TableType, HashFamily>::Delete(
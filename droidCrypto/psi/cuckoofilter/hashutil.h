@@ -15,6 +15,7 @@
  *  Modified by Daniel Kales, 2019
  *  * added Variants of TwoIndependantMultiplyShift for 128 and 256 bit inputs
  *  * added Setter/Getter for TwowIndependantMultiplyShift parameters
+ *  * hash const keys
  */
 #ifndef CUCKOO_FILTER_HASHUTIL_H_
 #define CUCKOO_FILTER_HASHUTIL_H_
@@ -111,7 +112,7 @@ class TwoIndependentMultiplyShift128 {
     }
   }
 
-  uint64_t operator()(uint64_t *key) const {
+  uint64_t operator()(const uint64_t *key) const {
     return (add_ + multiply0_ * static_cast<decltype(multiply0_)>(key[0]) +
             multiply1_ * static_cast<decltype(multiply1_)>(key[1])) >>
            64;
@@ -149,7 +150,7 @@ class TwoIndependentMultiplyShift256 {
     }
   }
 
-  uint64_t operator()(uint64_t *key) const {
+  uint64_t operator()(const uint64_t *key) const {
     return (add_ + multiply0_ * static_cast<decltype(multiply0_)>(key[0]) +
             multiply1_ * static_cast<decltype(multiply1_)>(key[1]) +
             multiply2_ * static_cast<decltype(multiply2_)>(key[2]) +
@@ -14,13 +14,24 @@
  *
  *  Modified by Daniel Kales, 2019
  *  * added Data() and SetData() for serialization
+ *  * added tables on externally owned memory (e.g. mmap)
+ *  * added slot access and an optional log of written slots
+ *  * added InsertTagToBucketAtomic() for concurrent construction
+ *  * added PrefetchBucket() and a SIMD lookup for 32 bit tags
  */
 #ifndef CUCKOO_FILTER_SINGLE_TABLE_H_
 #define CUCKOO_FILTER_SINGLE_TABLE_H_
 
 #include <assert.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #include <sstream>
+#include <vector>
 
 #include "bitsutil.h"
 #include "debug.h"
@@ -47,14 +58,31 @@ class SingleTable {
   // using a pointer adds one more indirection
   Bucket *buckets_;
   size_t num_buckets_;
+  bool owns_buckets_;
+  // if set, WriteTag appends the slot of every write
+  std::vector<uint64_t> *write_log_;
 
  public:
-  explicit SingleTable(const size_t num) : num_buckets_(num) {
+  explicit SingleTable(const size_t num)
+      : num_buckets_(num), owns_buckets_(true), write_log_(nullptr) {
     buckets_ = new Bucket[num_buckets_ + kPaddingBuckets];
     memset(buckets_, 0, kBytesPerBucket * (num_buckets_ + kPaddingBuckets));
   }
 
-  ~SingleTable() { delete[] buckets_; }
+  // uses data, which has to hold AllocSize(num) bytes and outlive the table
+  SingleTable(const size_t num, void *data)
+      : buckets_((Bucket *)data),
+        num_buckets_(num),
+        owns_buckets_(false),
+        write_log_(nullptr) {}
+
+  ~SingleTable() {
+    if (owns_buckets_) delete[] buckets_;
+  }
+
+  static size_t AllocSize(const size_t num) {
+    return kBytesPerBucket * (num + kPaddingBuckets);
+  }
 
   size_t NumBuckets() const { return num_buckets_; }
 
@@ -65,6 +93,16 @@ class SingleTable {
   void *Data() const { return buckets_; }
   void SetData(void *data, size_t len) { memcpy(buckets_, data, len); }
 
+  void SetWriteLog(std::vector<uint64_t> *log) { write_log_ = log; }
+
+  // slot = bucket index * kTagsPerBucket + position in the bucket
+  inline uint32_t ReadSlot(const uint64_t slot) const {
+    return ReadTag(slot / kTagsPerBucket, slot % kTagsPerBucket);
+  }
+  inline void WriteSlot(const uint64_t slot, const uint32_t tag) {
+    WriteTag(slot / kTagsPerBucket, slot % kTagsPerBucket, tag);
+  }
+
   std::string Info() const {
     std::stringstream ss;
     ss << "SingleHashtable with tag size: " << bits_per_tag << " bits \n";
@@ -103,6 +141,7 @@ class SingleTable {
   inline void WriteTag(const size_t i, const size_t j, const uint32_t t) {
     char *p = buckets_[i].bits_;
     uint32_t tag = t & kTagMask;
+    if (write_log_) write_log_->push_back(i * kTagsPerBucket + j);
     /* following code only works for little-endian */
     if (bits_per_tag == 2) {
       *((uint8_t *)p) |= tag << (2 * j);
@@ -133,11 +172,37 @@ class SingleTable {
     }
   }
 
+  // a bucket may straddle two cache lines
+  inline void PrefetchBucket(const size_t i) const {
+    __builtin_prefetch(buckets_[i].bits_);
+    __builtin_prefetch(buckets_[i].bits_ + kBytesPerBucket - 1);
+  }
+
   inline bool FindTagInBuckets(const size_t i1, const size_t i2,
                                const uint32_t tag) const {
     const char *p1 = buckets_[i1].bits_;
     const char *p2 = buckets_[i2].bits_;
 
+    // compare all three 32 bit tags of both buckets at once, the padding
+    // bucket keeps the 16 byte load of the last bucket inside the table
+#if defined(__SSE2__)
+    if (bits_per_tag == 32 && kTagsPerBucket == 3) {
+      __m128i t = _mm_set1_epi32(tag);
+      __m128i eq = _mm_or_si128(
+          _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)p1), t),
+          _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)p2), t));
+      return (_mm_movemask_epi8(eq) & 0xfff) != 0;
+    }
+#elif defined(__aarch64__)
+    if (bits_per_tag == 32 && kTagsPerBucket == 3) {
+      uint32x4_t t = vdupq_n_u32(tag);
+      uint32x4_t eq = vorrq_u32(vceqq_u32(vld1q_u32((const uint32_t *)p1), t),
+                                vceqq_u32(vld1q_u32((const uint32_t *)p2), t));
+      eq = vsetq_lane_u32(0, eq, 3);
+      return vmaxvq_u32(eq) != 0;
+    }
+#endif
+
     uint64_t v1 = *((uint64_t *)p1);
     uint64_t v2 = *((uint64_t *)p2);
 
@@ -215,6 +280,24 @@ class SingleTable {
     return false;
   }
 
+  // inserts tag into a free slot of bucket i with compare-and-swap, may run
+  // concurrently with itself but not with any other writer. Not recorded in
+  // the write log. 32 bit tags are 4 byte aligned as long as the table is.
+  inline bool InsertTagToBucketAtomic(const size_t i, const uint32_t tag) {
+    static_assert(bits_per_tag == 32,
+                  "atomic insert only implemented for 32 bit tags");
+    uint32_t *p = (uint32_t *)buckets_[i].bits_;
+    for (size_t j = 0; j < kTagsPerBucket; j++) {
+      uint32_t expected = 0;
+      if (__atomic_load_n(&p[j], __ATOMIC_RELAXED) == 0 &&
+          __atomic_compare_exchange_n(&p[j], &expected, tag, false,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   inline size_t NumTagsInBucket(const size_t i) const {
     size_t num = 0;
     for (size_t j = 0; j < kTagsPerBucket; j++) {
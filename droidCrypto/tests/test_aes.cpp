@@ -0,0 +1,96 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <droidCrypto/AES.h>
+#include <droidCrypto/PRNG.h>
+#include <droidCrypto/utils/Log.h>
+
+using namespace droidCrypto;
+
+static bool equal(const std::vector<block>& a, const std::vector<block>& b) {
+    return memcmp(a.data(), b.data(), a.size() * sizeof(block)) == 0;
+}
+
+// checks the batched functions of the current backend against encryptECB on single blocks
+static bool check(const AES& aes, const std::vector<block>& in, uint64_t baseIdx,
+                  const block& tweak, const block& offset) {
+    const size_t n = in.size();
+    std::vector<block> ecb(n), ctr(n), hash(n), ref(n);
+
+    aes.encryptECBBlocks(in.data(), n, ecb.data());
+    for(size_t i = 0; i < n; i++)
+        ref[i] = aes.encryptECB(in[i]);
+    if(!equal(ecb, ref)) {
+        Log::e("AES", "encryptECBBlocks differs for %zu blocks", n);
+        return false;
+    }
+
+    aes.encryptCTR(baseIdx, n, ctr.data());
+    for(size_t i = 0; i < n; i++)
+        ref[i] = aes.encryptECB(dupUint64(baseIdx + i));
+    if(!equal(ctr, ref)) {
+        Log::e("AES", "encryptCTR differs for %zu blocks", n);
+        return false;
+    }
+
+    aes.hashBlocks(in.data(), n, tweak, offset, hash.data());
+    for(size_t i = 0; i < n; i++) {
+        block kid = shiftBlock(in[i] ^ offset) ^ tweak;
+        ref[i] = aes.encryptECB(kid) ^ kid;
+    }
+    if(!equal(hash, ref)) {
+        Log::e("AES", "hashBlocks differs for %zu blocks", n);
+        return false;
+    }
+
+    // the same hashes from keys tweaked beforehand, in place
+    for(size_t i = 0; i < n; i++)
+        hash[i] = shiftBlock(in[i] ^ offset) ^ tweak;
+    aes.hashBlocks(hash.data(), n, hash.data());
+    if(!equal(hash, ref)) {
+        Log::e("AES", "hashBlocks of tweaked keys differs for %zu blocks", n);
+        return false;
+    }
+    return true;
+}
+
+static double blocksPerSec(const AES& aes, std::vector<block>& buf, size_t rounds) {
+    auto time0 = std::chrono::high_resolution_clock::now();
+    for(size_t r = 0; r < rounds; r++)
+        aes.hashBlocks(buf.data(), buf.size(), dupUint64(r), ZeroBlock, buf.data());
+    auto time1 = std::chrono::high_resolution_clock::now();
+    return rounds * buf.size() / std::chrono::duration<double>(time1 - time0).count();
+}
+
+int main(int argc, char** argv) {
+
+    PRNG prng = PRNG::getTestPRNG();
+    AES aes(prng.get<block>());
+    block tweak = prng.get<block>();
+    block offset = prng.get<block>();
+
+    std::vector<bool> backends = {false};
+    if(AES::vaesSupported())
+        backends.push_back(true);
+    else
+        Log::v("AES", "no VAES on this CPU, checking the AES-NI path only");
+
+    for(bool vaes : backends) {
+        AES::setVAES(vaes);
+        for(size_t n : {1, 7, 8, 15, 16, 17, 64, 1000, 1037}) {
+            std::vector<block> in(n);
+            prng.get(in.data(), n);
+            if(!check(aes, in, prng.get<uint64_t>(), tweak, offset)) {
+                Log::e("AES", "%s backend failed", vaes ? "VAES" : "AES-NI");
+                return 1;
+            }
+        }
+        std::vector<block> buf(256);
+        prng.get(buf.data(), buf.size());
+        Log::v("AES", "%s: %.2f M hashes/s", vaes ? "VAES" : "AES-NI",
+               blocksPerSec(aes, buf, 1 << 16) / 1e6);
+    }
+    AES::setVAES(true);
+
+    return 0;
+}
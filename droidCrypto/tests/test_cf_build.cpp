@@ -0,0 +1,92 @@
+#include <iostream>
+#include <thread>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/SecureRandom.h>
+#include <droidCrypto/psi/PSIServerSetup.h>
+#include <droidCrypto/utils/Log.h>
+
+
+int main(int argc, char** argv) {
+
+    if(argc != 2 && argc != 3) {
+        std::cout << "usage: " << argv[0] << " {log2(num_inputs)} [max_threads=64]" << std::endl;
+        return -1;
+    }
+    int exp = std::stoi(std::string(argv[1]));
+    if(0 > exp || exp > 32) {
+        std::cout << "log2(num_inputs) should be between 0 and 32" << std::endl;
+        return -1;
+    }
+    size_t num_inputs = 1ULL << exp;
+    size_t max_threads = argc == 3 ? std::stoul(std::string(argv[2])) : 64;
+
+    droidCrypto::SecureRandom rnd;
+    std::vector<droidCrypto::block> elements = rnd.randBlocks(num_inputs);
+
+    //sequential baseline
+    auto time0 = std::chrono::high_resolution_clock::now();
+    droidCrypto::OPRFCuckooFilter seq(num_inputs);
+    for(size_t i = 0; i < num_inputs; i++) {
+        if(seq.Add((uint64_t*)&elements[i]) != cuckoofilter::Ok) {
+            droidCrypto::Log::e("CF", "sequential Add failed");
+            return 1;
+        }
+    }
+    auto time1 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> seq_time = time1-time0;
+    droidCrypto::Log::v("CF", "Add:            %fsec", seq_time.count());
+
+    for(size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        droidCrypto::OPRFCuckooFilter cf(num_inputs);
+        cf.SetTwoIndependentMultiplyShiftParams(seq.GetTwoIndependentMultiplyShiftParams());
+        auto time2 = std::chrono::high_resolution_clock::now();
+        auto success = cf.AddParallel(num_inputs, [&elements](size_t i) {
+            return (uint64_t*)&elements[i];
+        }, num_threads);
+        auto time3 = std::chrono::high_resolution_clock::now();
+        if(success != cuckoofilter::Ok || cf.Size() != num_inputs) {
+            droidCrypto::Log::e("CF", "AddParallel with %zu threads failed", num_threads);
+            return 1;
+        }
+        for(size_t i = 0; i < num_inputs; i++) {
+            if(cf.Contain((uint64_t*)&elements[i]) != cuckoofilter::Ok) {
+                droidCrypto::Log::e("CF", "element %zu missing after AddParallel", i);
+                return 1;
+            }
+        }
+        std::chrono::duration<double> par_time = time3-time2;
+        droidCrypto::Log::v("CF", "AddParallel %2zu: %fsec, %.2fx", num_threads, par_time.count(),
+                            seq_time.count() / par_time.count());
+    }
+    droidCrypto::Log::v("CF", "hardware threads: %u", std::thread::hardware_concurrency());
+
+    //lookups of 2^12 client elements, half of them in the filter
+    size_t num_queries = std::min<size_t>(1 << 12, 2 * num_inputs);
+    std::vector<droidCrypto::block> queries = rnd.randBlocks(num_queries);
+    std::vector<const uint64_t*> keys(num_queries);
+    for(size_t i = 0; i < num_queries; i++) {
+        if(i % 2 == 0) {
+            queries[i] = elements[i / 2];
+        }
+        keys[i] = (const uint64_t*)&queries[i];
+    }
+    auto time4 = std::chrono::high_resolution_clock::now();
+    std::vector<bool> single(num_queries);
+    for(size_t i = 0; i < num_queries; i++) {
+        single[i] = seq.Contain((uint64_t*)&queries[i]) == cuckoofilter::Ok;
+    }
+    auto time5 = std::chrono::high_resolution_clock::now();
+    droidCrypto::BitVector batch;
+    seq.ContainBatch(droidCrypto::span<const uint64_t*>(keys.data(), keys.size()), batch);
+    auto time6 = std::chrono::high_resolution_clock::now();
+    for(size_t i = 0; i < num_queries; i++) {
+        if(single[i] != (bool)batch[i] || (i % 2 == 0 && !single[i])) {
+            droidCrypto::Log::e("CF", "ContainBatch differs from Contain at %zu", i);
+            return 1;
+        }
+    }
+    droidCrypto::Log::v("CF", "%zu lookups: Contain %fsec, ContainBatch %fsec", num_queries,
+                        std::chrono::duration<double>(time5-time4).count(),
+                        std::chrono::duration<double>(time6-time5).count());
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/SecureRandom.h>
+#include <droidCrypto/gc/HalfGate.h>
+#include <droidCrypto/gc/WireLabel.h>
+#include <droidCrypto/utils/Log.h>
+
+using namespace droidCrypto;
+
+// AND gates of one layer: out[k] = in[k] & in[width + k]
+static std::vector<ANDGate> makeLayer(WireLabelMatrix& wires, size_t width) {
+    std::vector<ANDGate> gates;
+    for(size_t k = 0; k < width; k++) {
+        gates.push_back({wires[2 * width + k], wires[k], wires[width + k]});
+    }
+    return gates;
+}
+
+static void fillRandom(WireLabelMatrix& wires, size_t first, size_t count, SecureRandom& rnd) {
+    for(size_t w = first; w < first + count; w++) {
+        std::vector<block> r = rnd.randBlocks(wires.lanes());
+        wires.copy(w, r.data());
+    }
+}
+
+static bool rowsEqual(const WireLabelMatrix& a, const WireLabelMatrix& b, size_t first, size_t count) {
+    for(size_t w = first; w < first + count; w++) {
+        if(memcmp(a[w], b[w], a.lanes() * sizeof(block)) != 0)
+            return false;
+    }
+    return true;
+}
+
+// drains the tables a garbler wrote to its bufChan
+static std::vector<uint8_t> takeTables(SIMDGarblerPhases& g) {
+    std::vector<uint8_t> tables(g.bufChan.size());
+    g.bufChan.recv(tables.data(), tables.size());
+    return tables;
+}
+
+int main(int argc, char** argv) {
+
+    if(argc > 4) {
+        std::cout << "usage: " << argv[0] << " [lanes=1024] [layer_width=30] [layers=256]" << std::endl;
+        return -1;
+    }
+    size_t lanes = argc > 1 ? std::stoul(std::string(argv[1])) : 1024;
+    size_t width = argc > 2 ? std::stoul(std::string(argv[2])) : 30;
+    size_t layers = argc > 3 ? std::stoul(std::string(argv[3])) : 256;
+
+    SecureRandom rnd;
+    block delta = rnd.randBlock();
+    BufferChannel chan;
+
+    WireLabelMatrix wiresGate(3 * width, lanes), wiresLayer(3 * width, lanes);
+    fillRandom(wiresGate, 0, 2 * width, rnd);
+    for(size_t w = 0; w < 2 * width; w++)
+        wiresLayer.copy(w, wiresGate[w]);
+    std::vector<ANDGate> gatesGate = makeLayer(wiresGate, width);
+    std::vector<ANDGate> gatesLayer = makeLayer(wiresLayer, width);
+    span<const ANDGate> layer(gatesLayer.data(), gatesLayer.size());
+
+    // both ways have to produce the same labels and garbled tables
+    SIMDGarblerPhases g1(chan, lanes, delta), g2(chan, lanes, delta);
+    for(const ANDGate& gate : gatesGate)
+        g1.AND(gate.out, gate.a, gate.b);
+    g2.ANDLayer(layer);
+    std::vector<uint8_t> tables = takeTables(g2);
+    if(!rowsEqual(wiresGate, wiresLayer, 2 * width, width) || takeTables(g1) != tables) {
+        Log::e("GC", "garbling an AND layer differs from garbling its gates");
+        return 1;
+    }
+
+    SIMDEvaluatorPhases e1(chan, lanes), e2(chan, lanes);
+    e1.bufChan.send(tables.data(), tables.size());
+    e2.bufChan.send(tables.data(), tables.size());
+    for(const ANDGate& gate : gatesGate)
+        e1.AND(gate.out, gate.a, gate.b);
+    e2.ANDLayer(layer);
+    if(!rowsEqual(wiresGate, wiresLayer, 2 * width, width)) {
+        Log::e("GC", "evaluating an AND layer differs from evaluating its gates");
+        return 1;
+    }
+
+    // throughput, in AND gates of single lanes per second
+    const double numANDs = (double) layers * width * lanes;
+    auto time0 = std::chrono::high_resolution_clock::now();
+    for(size_t l = 0; l < layers; l++) {
+        for(const ANDGate& gate : gatesGate)
+            g1.AND(gate.out, gate.a, gate.b);
+        g1.bufChan.consume(g1.bufChan.size());
+    }
+    auto time1 = std::chrono::high_resolution_clock::now();
+    for(size_t l = 0; l < layers; l++) {
+        g2.ANDLayer(layer);
+        g2.bufChan.consume(g2.bufChan.size());
+    }
+    auto time2 = std::chrono::high_resolution_clock::now();
+    for(size_t l = 0; l < layers; l++) {
+        e1.bufChan.send(tables.data(), tables.size());
+        for(const ANDGate& gate : gatesGate)
+            e1.AND(gate.out, gate.a, gate.b);
+    }
+    auto time3 = std::chrono::high_resolution_clock::now();
+    for(size_t l = 0; l < layers; l++) {
+        e2.bufChan.send(tables.data(), tables.size());
+        e2.ANDLayer(layer);
+    }
+    auto time4 = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> garble_gate = time1 - time0;
+    std::chrono::duration<double> garble_layer = time2 - time1;
+    std::chrono::duration<double> eval_gate = time3 - time2;
+    std::chrono::duration<double> eval_layer = time4 - time3;
+    Log::v("GC", "%zu lanes, %zu layers of %zu ANDs", lanes, layers, width);
+    Log::v("GC", "garble per gate:  %.2f M ANDs/s", numANDs / garble_gate.count() / 1e6);
+    Log::v("GC", "garble per layer: %.2f M ANDs/s", numANDs / garble_layer.count() / 1e6);
+    Log::v("GC", "eval per gate:    %.2f M ANDs/s", numANDs / eval_gate.count() / 1e6);
+    Log::v("GC", "eval per layer:   %.2f M ANDs/s", numANDs / eval_layer.count() / 1e6);
+
+    return 0;
+}
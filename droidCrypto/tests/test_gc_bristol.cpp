@@ -0,0 +1,246 @@
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <thread>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/SecureRandom.h>
+#include <droidCrypto/gc/circuits/AESCircuit.h>
+#include <droidCrypto/gc/circuits/BristolCircuit.h>
+#include <droidCrypto/gc/circuits/LowMCCircuit.h>
+#include <droidCrypto/psi/OPRFBristolPSIServer.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/utils/Log.h>
+
+using namespace droidCrypto;
+
+#define NUM_LANES 1024
+
+// out0 = (a0 ^ b0) & b1, out1 = !b0 & b1, out2 = 1
+static const char* SMALL_CIRCUIT =
+    "4 8\n"
+    "2 1 2\n"
+    "1 3\n"
+    "\n"
+    "2 1 0 1 3 XOR\n"
+    "1 1 1 4 INV\n"
+    "4 2 3 4 2 2 5 6 MAND\n"
+    "1 1 1 7 EQ\n";
+
+// the same function with the inputs of the XOR swapped
+static const char* SMALL_CIRCUIT_SWAPPED =
+    "4 8\n"
+    "2 1 2\n"
+    "1 3\n"
+    "\n"
+    "2 1 1 0 3 XOR\n"
+    "1 1 1 4 INV\n"
+    "4 2 3 4 2 2 5 6 MAND\n"
+    "1 1 1 7 EQ\n";
+
+// files whose counts do not fit their gates, parse has to reject them
+// before allocating for the counts
+static const char* MALFORMED_CIRCUITS[] = {
+    // more wires than the gates write
+    "1 4294967295\n1 2\n1 1\n\n2 1 0 1 2 AND\n",
+    // more input values than wires
+    "1 3\n4294967295 1 1\n1 1\n\n2 1 0 1 2 AND\n",
+    // a gate with more inputs and outputs than wires
+    "1 3\n1 2\n1 1\n\n4294967295 4294967295 0 1 2 AND\n",
+    // a MAND with more outputs than wires left to write
+    "1 4\n1 2\n1 2\n\n6 3 0 1 0 1 0 1 2 3 4 MAND\n",
+};
+
+// instance j of the plaintext evaluation as a BitVector
+static BitVector column(const std::vector<uint64_t>& slices, size_t j) {
+    BitVector bits(slices.size());
+    for(size_t i = 0; i < slices.size(); i++)
+        bits[i] = (slices[i] >> j) & 1;
+    return bits;
+}
+
+// exports a compiled built-in circuit and reads it back from a file
+template <typename CircuitT>
+static std::shared_ptr<const BristolCircuit> exportCircuit(const std::string& name) {
+    BufferChannel unused;
+    CircuitT circ(unused);
+    circ.compile();
+    BristolCircuit c = BristolCircuit::fromGateList(*circ.gateList(), name);
+    std::string path = "/tmp/" + name + ".txt";
+    c.save(path);
+    return std::make_shared<const BristolCircuit>(BristolCircuit::load(path));
+}
+
+// one phased session on port 8000 with lane i of Bob's input set to inputB[i % inputB.size()]
+static std::vector<BitVector> session(std::shared_ptr<const BristolCircuit> circuit, const BitVector& key,
+                                      const std::vector<BitVector>& inputB) {
+    double garbleTime = 0;
+    std::thread server([&]{
+        CSocketChannel chan("127.0.0.1", 8000, true);
+        SIMDBristolCircuitPhases circ(chan, circuit);
+        circ.garbleBase(key, NUM_LANES);
+        circ.garbleOnline();
+        garbleTime = circ.timeEval.count();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CSocketChannel chan("127.0.0.1", 8000, false);
+    SIMDBristolCircuitPhases circ(chan, circuit);
+    circ.evaluateBase(NUM_LANES);
+    std::vector<BitVector> lanes;
+    for(size_t i = 0; i < NUM_LANES; i++)
+        lanes.push_back(inputB[i % inputB.size()]);
+    std::vector<BitVector> out = circ.evaluateOnline(lanes);
+    server.join();
+    Log::v("GC", "%s: %zu lanes, garble %fsec, eval %fsec, %zu bytes recv", circuit->name().c_str(),
+           (size_t)NUM_LANES, garbleTime, circ.timeEval.count(), chan.getBytesRecv());
+    return out;
+}
+
+// compares a session on 64 random inputs of Bob against the plaintext evaluation
+static bool check(std::shared_ptr<const BristolCircuit> circuit, const BitVector& key) {
+    SecureRandom rnd;
+    std::vector<uint64_t> slices(circuit->inputB_size());
+    for(uint64_t& s : slices)
+        s = rnd.rand();
+    std::vector<BitVector> inputB;
+    for(size_t j = 0; j < 64; j++)
+        inputB.push_back(column(slices, j));
+    std::vector<uint64_t> expected = circuit->evaluate(key, slices);
+    std::vector<BitVector> out = session(circuit, key, inputB);
+    for(size_t i = 0; i < out.size(); i++) {
+        if(out[i] != column(expected, i % 64)) {
+            Log::e("GC", "%s: lane %zu differs from the plaintext result", circuit->name().c_str(), i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int ret = 0;
+
+    // parsing, MAND and the plaintext evaluation
+    std::istringstream small_in(SMALL_CIRCUIT);
+    auto small = std::make_shared<const BristolCircuit>(BristolCircuit::parse(small_in, "small"));
+    std::ostringstream small_out;
+    small->write(small_out);
+    std::istringstream small_again(small_out.str());
+    std::ostringstream small_out2;
+    BristolCircuit::parse(small_again, "small").write(small_out2);
+    if(small->numANDs() != 2 || small->depth() != 1 || small_out.str() != small_out2.str()) {
+        Log::e("GC", "small circuit parsed wrong");
+        ret = 1;
+    }
+    for(const char* text : MALFORMED_CIRCUITS) {
+        std::istringstream in(text);
+        try {
+            BristolCircuit::parse(in, "malformed");
+            Log::e("GC", "malformed circuit parsed: %s", text);
+            ret = 1;
+        } catch(const std::runtime_error&) {
+        }
+    }
+
+    // a setup only goes with the circuit it was precomputed for
+    std::istringstream written(small_out.str()), swapped_in(SMALL_CIRCUIT_SWAPPED);
+    BristolCircuit swapped = BristolCircuit::parse(swapped_in, "small");
+    if(neq(BristolCircuit::parse(written, "small").hash(), small->hash()) ||
+       eq(swapped.hash(), small->hash())) {
+        Log::e("GC", "circuit hashes do not identify the circuits");
+        ret = 1;
+    }
+    for(int a0 = 0; a0 < 2; a0++) {
+        BitVector key(1);
+        key[0] = a0;
+        // b0 in instance bit 0 and 1, b1 in bit 0 and 2
+        std::vector<uint64_t> out = small->evaluate(key, {0x3, 0x5});
+        for(size_t j = 0; j < 4; j++) {
+            uint64_t b0 = (0x3 >> j) & 1, b1 = (0x5 >> j) & 1;
+            if(((out[0] >> j) & 1) != ((a0 ^ b0) & b1) || ((out[1] >> j) & 1) != ((b0 ^ 1) & b1) ||
+               ((out[2] >> j) & 1) != 1) {
+                Log::e("GC", "small circuit: wrong plaintext result for a0=%d, instance %zu", a0, j);
+                ret = 1;
+            }
+        }
+        if(!check(small, key))
+            ret = 1;
+    }
+
+    // the built-in circuits exported and imported again
+    uint8_t LOWMC_TEST_KEY[16] = {  0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t LOWMC_TEST_INPUT[16] = {0xAB, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    BitVector lowmcKey(LOWMC_TEST_KEY, SIMDLowMCCircuitPhases::params->n);
+    BitVector lowmcInput(LOWMC_TEST_INPUT, 128);
+    auto lowmc = exportCircuit<SIMDLowMCCircuitPhases>("lowmc_128_128_208");
+    std::vector<BitVector> ct = session(lowmc, lowmcKey, {lowmcInput});
+    if(ct[0].hexREV() != "891f4b30abb0bfa160da4b098bb0b767") {
+        Log::e("GC", "LowMC: wrong result %s", ct[0].hexREV().c_str());
+        ret = 1;
+    }
+    if(!check(lowmc, lowmcKey))
+        ret = 1;
+
+    uint8_t AES_TEST_EXPANDED_KEY[AES_EXP_KEY_BYTES] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x62, 0x63, 0x63, 0x63,
+                                                         0x62, 0x63, 0x63, 0x63, 0x62, 0x63, 0x63, 0x63, 0x62, 0x63, 0x63, 0x63, 0x9b, 0x98, 0x98, 0xc9, 0xf9, 0xfb, 0xfb, 0xaa, 0x9b, 0x98, 0x98, 0xc9, 0xf9, 0xfb, 0xfb, 0xaa,
+                                                         0x90, 0x97, 0x34, 0x50, 0x69, 0x6c, 0xcf, 0xfa, 0xf2, 0xf4, 0x57, 0x33, 0x0b, 0x0f, 0xac, 0x99, 0xee, 0x06, 0xda, 0x7b, 0x87, 0x6a, 0x15, 0x81, 0x75, 0x9e, 0x42, 0xb2,
+                                                         0x7e, 0x91, 0xee, 0x2b, 0x7f, 0x2e, 0x2b, 0x88, 0xf8, 0x44, 0x3e, 0x09, 0x8d, 0xda, 0x7c, 0xbb, 0xf3, 0x4b, 0x92, 0x90, 0xec, 0x61, 0x4b, 0x85, 0x14, 0x25, 0x75, 0x8c,
+                                                         0x99, 0xff, 0x09, 0x37, 0x6a, 0xb4, 0x9b, 0xa7, 0x21, 0x75, 0x17, 0x87, 0x35, 0x50, 0x62, 0x0b, 0xac, 0xaf, 0x6b, 0x3c, 0xc6, 0x1b, 0xf0, 0x9b, 0x0e, 0xf9, 0x03, 0x33,
+                                                         0x3b, 0xa9, 0x61, 0x38, 0x97, 0x06, 0x0a, 0x04, 0x51, 0x1d, 0xfa, 0x9f, 0xb1, 0xd4, 0xd8, 0xe2, 0x8a, 0x7d, 0xb9, 0xda, 0x1d, 0x7b, 0xb3, 0xde, 0x4c, 0x66, 0x49, 0x41,
+                                                         0xb4, 0xef, 0x5b, 0xcb, 0x3e, 0x92, 0xe2, 0x11, 0x23, 0xe9, 0x51, 0xcf, 0x6f, 0x8f, 0x18, 0x8e };
+    uint8_t AES_TEST_INPUT[AES_BYTES] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    BitVector aesKey(AES_TEST_EXPANDED_KEY, AES_EXP_KEY_BITS);
+    BitVector aesInput(AES_TEST_INPUT, AES_BYTES * 8);
+    auto aes = exportCircuit<SIMDAESCircuitPhases>("aes_128");
+    ct = session(aes, aesKey, {aesInput});
+    if(ct[0].hex() != "c8a331ff8edd3db175e1545dbefb760b") {
+        Log::e("GC", "AES: wrong result %s", ct[0].hex().c_str());
+        ret = 1;
+    }
+
+    // a setup only goes with the circuit it was precomputed for, an OPRF
+    // needs a wide output
+    {
+        BufferChannel unused;
+        OPRFBristolPSIServer server(unused, lowmc);
+        std::vector<block> elements(100), none;
+        for(block& el : elements)
+            el = SecureRandom().randBlock();
+        std::vector<block> others(elements);
+        auto own = OPRFBristolPSIServer::Precompute(*lowmc, elements);
+        auto other = OPRFBristolPSIServer::Precompute(*aes, others);
+        // the own one syncs with a client, only updates are tried
+        OPRFBristolPSIServer::Update(*lowmc, *own, none, none);
+        int rejected = 0;
+        try {
+            server.SetupPrecomputed(other);
+        } catch(const std::runtime_error&) {
+            rejected++;
+        }
+        try {
+            OPRFBristolPSIServer::Update(*lowmc, *other, none, none);
+        } catch(const std::runtime_error&) {
+            rejected++;
+        }
+        try {
+            OPRFBristolPSIServer narrow(unused, small);
+        } catch(const std::runtime_error&) {
+            rejected++;
+        }
+        if(rejected != 3) {
+            Log::e("GC", "setup of another circuit or a narrow OPRF accepted");
+            ret = 1;
+        }
+    }
+
+    // further circuit files to benchmark, with a random key
+    for(int i = 1; i < argc; i++) {
+        auto circuit = std::make_shared<const BristolCircuit>(BristolCircuit::load(argv[i]));
+        std::vector<uint8_t> key_bytes((circuit->inputA_size() + 7) / 8);
+        SecureRandom().randBytes(key_bytes.data(), key_bytes.size());
+        BitVector key(key_bytes.data(), circuit->inputA_size());
+        if(!check(circuit, key))
+            ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/gc/circuits/AESCircuit.h>
+#include <droidCrypto/gc/circuits/LowMCCircuit.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/gc/GateList.h>
+#include <droidCrypto/utils/Log.h>
+
+using namespace droidCrypto;
+
+#define NUM_LANES 1024
+
+// one phased session on port 8000, either side may run the compiled gate list.
+// Both produce the same GC, so mixing them has to give the right result.
+template <typename CircuitT>
+static BitVector session(const BitVector& key, const BitVector& input, bool compileGarbler,
+                           bool compileEvaluator, double& garbleTime, double& evalTime) {
+    std::thread server([&]{
+        CSocketChannel chan("127.0.0.1", 8000, true);
+        CircuitT circ(chan);
+        if(compileGarbler)
+            circ.compile();
+        circ.garbleBase(key, NUM_LANES);
+        circ.garbleOnline();
+        garbleTime = circ.timeEval.count();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CSocketChannel chan("127.0.0.1", 8000, false);
+    CircuitT circ(chan);
+    if(compileEvaluator)
+        circ.compile();
+    circ.evaluateBase(NUM_LANES);
+    std::vector<BitVector> ct = circ.evaluateOnline(std::vector<BitVector>(NUM_LANES, input));
+    evalTime = circ.timeEval.count();
+    server.join();
+    for(size_t i = 1; i < ct.size(); i++) {
+        if(ct[i] != ct[0])
+            return BitVector();
+    }
+    return ct[0];
+}
+
+int main(int argc, char** argv) {
+
+    uint8_t LOWMC_TEST_KEY[16] = {  0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t LOWMC_TEST_INPUT[16] = {0xAB, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    BitVector lowmcKey(LOWMC_TEST_KEY, SIMDLowMCCircuitPhases::params->n);
+    BitVector lowmcInput(LOWMC_TEST_INPUT, 128);
+    const std::string lowmcExpected = "891f4b30abb0bfa160da4b098bb0b767";
+
+    uint8_t AES_TEST_EXPANDED_KEY[AES_EXP_KEY_BYTES] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x62, 0x63, 0x63, 0x63,
+                                                         0x62, 0x63, 0x63, 0x63, 0x62, 0x63, 0x63, 0x63, 0x62, 0x63, 0x63, 0x63, 0x9b, 0x98, 0x98, 0xc9, 0xf9, 0xfb, 0xfb, 0xaa, 0x9b, 0x98, 0x98, 0xc9, 0xf9, 0xfb, 0xfb, 0xaa,
+                                                         0x90, 0x97, 0x34, 0x50, 0x69, 0x6c, 0xcf, 0xfa, 0xf2, 0xf4, 0x57, 0x33, 0x0b, 0x0f, 0xac, 0x99, 0xee, 0x06, 0xda, 0x7b, 0x87, 0x6a, 0x15, 0x81, 0x75, 0x9e, 0x42, 0xb2,
+                                                         0x7e, 0x91, 0xee, 0x2b, 0x7f, 0x2e, 0x2b, 0x88, 0xf8, 0x44, 0x3e, 0x09, 0x8d, 0xda, 0x7c, 0xbb, 0xf3, 0x4b, 0x92, 0x90, 0xec, 0x61, 0x4b, 0x85, 0x14, 0x25, 0x75, 0x8c,
+                                                         0x99, 0xff, 0x09, 0x37, 0x6a, 0xb4, 0x9b, 0xa7, 0x21, 0x75, 0x17, 0x87, 0x35, 0x50, 0x62, 0x0b, 0xac, 0xaf, 0x6b, 0x3c, 0xc6, 0x1b, 0xf0, 0x9b, 0x0e, 0xf9, 0x03, 0x33,
+                                                         0x3b, 0xa9, 0x61, 0x38, 0x97, 0x06, 0x0a, 0x04, 0x51, 0x1d, 0xfa, 0x9f, 0xb1, 0xd4, 0xd8, 0xe2, 0x8a, 0x7d, 0xb9, 0xda, 0x1d, 0x7b, 0xb3, 0xde, 0x4c, 0x66, 0x49, 0x41,
+                                                         0xb4, 0xef, 0x5b, 0xcb, 0x3e, 0x92, 0xe2, 0x11, 0x23, 0xe9, 0x51, 0xcf, 0x6f, 0x8f, 0x18, 0x8e };
+    uint8_t AES_TEST_INPUT[AES_BYTES] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    BitVector aesKey(AES_TEST_EXPANDED_KEY, AES_EXP_KEY_BITS);
+    BitVector aesInput(AES_TEST_INPUT, AES_BYTES * 8);
+    const std::string aesExpected = "c8a331ff8edd3db175e1545dbefb760b";
+
+    int ret = 0;
+    // an AND whose output is unused or with a 0 input still sends a table,
+    // the unused XOR is dropped
+    GateList dead = GateList::trace(0, 3, [](const std::vector<WireLabel>&,
+                                             const std::vector<SIMDWireLabel>& b, SIMDGCEnv& env) {
+        block x, unused, dropped, zero, withZero;
+        std::vector<SIMDWireLabel> out(1, SIMDWireLabel(std::vector<block>(1)));
+        env.XOR(&x, b[0].bytes.data(), b[1].bytes.data());
+        env.AND(&unused, &x, b[2].bytes.data());
+        env.XOR(&dropped, &unused, b[0].bytes.data());
+        env.XOR(&zero, b[0].bytes.data(), b[0].bytes.data());
+        env.AND(&withZero, &zero, b[2].bytes.data());
+        env.AND(out[0].bytes.data(), b[0].bytes.data(), b[1].bytes.data());
+        return out;
+    });
+    if(dead.numANDs() != 3 || dead.numGates() != 8) {
+        Log::e("GC", "gate list: %zu ANDs in %zu gates", dead.numANDs(), dead.numGates());
+        ret = 1;
+    }
+    for(int mode = 0; mode < 3; mode++) {
+        // direct, compiled garbler with direct evaluator and the other way round
+        bool cg = mode == 1, ce = mode == 2;
+        double gt, et;
+        std::string tt = session<SIMDLowMCCircuitPhases>(lowmcKey, lowmcInput, cg, ce, gt, et).hexREV();
+        Log::v("GC", "LowMC garbler %s, evaluator %s: garble %fsec, eval %fsec", cg ? "compiled" : "direct",
+               ce ? "compiled" : "direct", gt, et);
+        if(tt != lowmcExpected) {
+            Log::e("GC", "LowMC: wrong result %s", tt.c_str());
+            ret = 1;
+        }
+        tt = session<SIMDAESCircuitPhases>(aesKey, aesInput, cg, ce, gt, et).hex();
+        Log::v("GC", "AES garbler %s, evaluator %s: garble %fsec, eval %fsec", cg ? "compiled" : "direct",
+               ce ? "compiled" : "direct", gt, et);
+        if(tt != aesExpected) {
+            Log::e("GC", "AES: wrong result %s", tt.c_str());
+            ret = 1;
+        }
+    }
+    return ret;
+}
@@ -26,7 +26,11 @@ int main(int argc, char** argv) {
 //    std::cout << time << std::endl;
 //    return 0;
 
-    std::thread server([]{
+    // garbler and evaluator threads, each works on a range of the lanes
+    size_t num_threads = argc > 1 ? std::stoul(std::string(argv[1])) : 1;
+    size_t num_eval_threads = argc > 2 ? std::stoul(std::string(argv[2])) : 1;
+
+    std::thread server([num_threads]{
         //server
         droidCrypto::CSocketChannel chan("127.0.0.1", 8000, true);
 
@@ -35,6 +39,7 @@ int main(int argc, char** argv) {
         droidCrypto::BitVector a(LOWMC_TEST_KEY,
                                  droidCrypto::SIMDLowMCCircuitPhases::params->n);
         droidCrypto::SIMDLowMCCircuitPhases circ(chan);
+        circ.setNumThreads(num_threads);
         circ.garbleBase(a, NUM_LOWMC);
         circ.garbleOnline();
         droidCrypto::Log::v("GC", "GARBLER: bytes sent: %zu, recv: %zu", chan.getBytesSent(), chan.getBytesRecv());
@@ -49,6 +54,7 @@ int main(int argc, char** argv) {
     std::vector<droidCrypto::BitVector> aa(NUM_LOWMC, a);
 
     droidCrypto::SIMDLowMCCircuitPhases circ(chan);
+    circ.setNumThreads(num_eval_threads);
 //    droidCrypto::BitVector ct = circ.evaluate(a);
     circ.evaluateBase(NUM_LOWMC);
     std::vector<droidCrypto::BitVector> ct = circ.evaluateOnline(aa);
@@ -60,9 +66,17 @@ int main(int argc, char** argv) {
 //    for(int i = 0; i < NUM_LOWMC; i++)
 //        droidCrypto::Log::v("GC", "tt: %s", ct[i].hexREV().c_str());
     droidCrypto::Log::v("GC", "tt: %s", ct[0].hexREV().c_str());
+    int ret = 0;
+    for(size_t i = 1; i < ct.size(); i++) {
+        if(ct[i] != ct[0]) {
+            droidCrypto::Log::e("GC", "lane %zu differs: %s", i, ct[i].hexREV().c_str());
+            ret = 1;
+            break;
+        }
+    }
 
     droidCrypto::Log::v("GC", "EVALUATOR: bytes sent: %zu, recv: %zu", chan.getBytesSent(), chan.getBytesRecv());
 
     server.join();
-    return 0;
+    return ret;
 }
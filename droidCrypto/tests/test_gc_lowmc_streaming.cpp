@@ -0,0 +1,59 @@
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/gc/circuits/LowMCCircuit.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/utils/Log.h>
+
+#define NUM_LOWMC 1024
+int main(int argc, char** argv) {
+
+    // the evaluator works on the GC while it is still arriving
+    size_t num_threads = argc > 1 ? std::stoul(std::string(argv[1])) : 1;
+    size_t num_lowmc = argc > 2 ? std::stoul(std::string(argv[2])) : NUM_LOWMC;
+
+    std::thread server([num_threads, num_lowmc]{
+        //server
+        droidCrypto::CSocketChannel chan("127.0.0.1", 8000, true);
+
+        uint8_t LOWMC_TEST_KEY[16] = {  0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+        droidCrypto::BitVector a(LOWMC_TEST_KEY,
+                                 droidCrypto::SIMDLowMCCircuitPhases::params->n);
+        droidCrypto::SIMDLowMCCircuitPhases circ(chan);
+        circ.setNumThreads(num_threads);
+        circ.garbleStreaming(a, num_lowmc);
+        droidCrypto::Log::v("GC", "GARBLER: bytes sent: %zu, recv: %zu", chan.getBytesSent(), chan.getBytesRecv());
+    });
+    //client
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    droidCrypto::CSocketChannel chan("127.0.0.1", 8000, false);
+
+    uint8_t LOWMC_TEST_INPUT[16] = {0xAB, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    droidCrypto::BitVector a(LOWMC_TEST_INPUT, 128);
+    std::vector<droidCrypto::BitVector> aa(num_lowmc, a);
+
+    droidCrypto::SIMDLowMCCircuitPhases circ(chan);
+    std::vector<droidCrypto::BitVector> ct = circ.evaluateStreaming(aa);
+    std::string time = "Time: " + std::to_string(circ.timeBaseOT.count());
+    time += ", " + std::to_string(circ.timeOT.count());
+    time += ", " + std::to_string(circ.timeOnline.count());
+    time += ", " + std::to_string(circ.timeEval.count());
+    droidCrypto::Log::v("GC", "%s", time.c_str());
+    droidCrypto::Log::v("GC", "tt: %s", ct[0].hexREV().c_str());
+    int ret = 0;
+    for(size_t i = 1; i < ct.size(); i++) {
+        if(ct[i] != ct[0]) {
+            droidCrypto::Log::e("GC", "lane %zu differs: %s", i, ct[i].hexREV().c_str());
+            ret = 1;
+            break;
+        }
+    }
+
+    droidCrypto::Log::v("GC", "EVALUATOR: bytes sent: %zu, recv: %zu", chan.getBytesSent(), chan.getBytesRecv());
+
+    server.join();
+    return ret;
+}
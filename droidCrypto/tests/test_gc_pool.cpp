@@ -0,0 +1,67 @@
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/gc/GCPool.h>
+#include <droidCrypto/gc/circuits/LowMCCircuit.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/utils/Log.h>
+
+#define NUM_LOWMC 1024
+int main(int argc, char** argv) {
+
+    // GCs are garbled into spool files in dir before the client connects
+    std::string dir = argc > 1 ? argv[1] : "/tmp";
+
+    uint8_t LOWMC_TEST_KEY[16] = {  0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    droidCrypto::BitVector key(LOWMC_TEST_KEY, droidCrypto::SIMDLowMCCircuitPhases::params->n);
+    droidCrypto::GCPool pool(dir, [](droidCrypto::ChannelWrapper& chan) {
+        return std::unique_ptr<droidCrypto::SIMDCircuitPhases>(new droidCrypto::SIMDLowMCCircuitPhases(chan));
+    }, key, {NUM_LOWMC}, 1);
+    pool.waitFull();
+    if(pool.getNumReady(NUM_LOWMC) != 1 || pool.take(NUM_LOWMC / 2) != nullptr) {
+        droidCrypto::Log::e("GC", "pool does not hold exactly the requested GCs");
+        return 1;
+    }
+
+    std::thread server([&pool]{
+        //server
+        droidCrypto::CSocketChannel chan("127.0.0.1", 8000, true);
+        droidCrypto::SIMDLowMCCircuitPhases circ(chan);
+        std::unique_ptr<droidCrypto::GCSpool> spool = pool.take(NUM_LOWMC);
+        circ.garbleBase(*spool);
+        circ.garbleOnline();
+        droidCrypto::Log::v("GC", "GARBLER: base %fsec, of it sending the GC %fsec",
+                            (circ.timeBaseOT + circ.timeOT + circ.timeSendGC).count(), circ.timeSendGC.count());
+    });
+    //client
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    droidCrypto::CSocketChannel chan("127.0.0.1", 8000, false);
+
+    uint8_t LOWMC_TEST_INPUT[16] = {0xAB, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    droidCrypto::BitVector a(LOWMC_TEST_INPUT, 128);
+    std::vector<droidCrypto::BitVector> aa(NUM_LOWMC, a);
+
+    droidCrypto::SIMDLowMCCircuitPhases circ(chan);
+    circ.evaluateBase(NUM_LOWMC);
+    std::vector<droidCrypto::BitVector> ct = circ.evaluateOnline(aa);
+    droidCrypto::Log::v("GC", "tt: %s", ct[0].hexREV().c_str());
+    int ret = 0;
+    for(size_t i = 1; i < ct.size(); i++) {
+        if(ct[i] != ct[0]) {
+            droidCrypto::Log::e("GC", "lane %zu differs: %s", i, ct[i].hexREV().c_str());
+            ret = 1;
+            break;
+        }
+    }
+    server.join();
+
+    // the pool refills what was taken
+    pool.waitFull();
+    droidCrypto::Log::v("GC", "pool: %zu taken, %zu missed, %zu ready", pool.getNumTaken(),
+                        pool.getNumMissed(), pool.getNumReady(NUM_LOWMC));
+    return ret;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <random>
+#include <droidCrypto/gc/XORNetwork.h>
+#include <droidCrypto/gc/circuits/LowMCCircuit.h>
+#include <droidCrypto/utils/Log.h>
+
+using namespace droidCrypto;
+
+// runs the program on 64 bitsliced instances and compares it with the rows
+static bool check(const XORNetwork& net, const std::vector<std::vector<uint32_t>>& rows, std::mt19937_64& rng) {
+    std::vector<uint64_t> in(net.numInputs()), tmp(net.numTemps()), out(net.numOutputs());
+    for(uint64_t& x : in)
+        x = rng();
+    auto value = [&](uint32_t x) {
+        return x < net.numInputs() ? in[x] : tmp[x - net.numInputs()];
+    };
+    for(const XORNetwork::Step& s : net.steps()) {
+        switch(s.op) {
+            case XORNetwork::TMP:
+                tmp[s.out - net.numInputs()] = value(s.a) ^ value(s.b);
+                break;
+            case XORNetwork::OUT:
+                out[s.out] = value(s.a) ^ (s.b == XORNetwork::none ? 0 : value(s.b));
+                break;
+            case XORNetwork::OUT_XOR:
+                out[s.out] ^= value(s.a);
+                break;
+            case XORNetwork::OUT_ZERO:
+                out[s.out] = 0;
+                break;
+        }
+    }
+    for(size_t r = 0; r < rows.size(); r++) {
+        uint64_t expected = 0;
+        for(uint32_t x : rows[r])
+            expected ^= in[x];
+        if(out[r] != expected)
+            return false;
+    }
+    return net.numXORs() <= net.numNaiveXORs();
+}
+
+int main(int argc, char** argv) {
+    std::mt19937_64 rng(1);
+    int ret = 0;
+
+    // random matrices of a few shapes and densities, with repeated inputs
+    // that cancel out and empty rows
+    for(size_t inputs : {1, 7, 64, 128}) {
+        for(size_t outputs : {1, 3, 65, 128}) {
+            for(unsigned density : {2, 16, 50}) {
+                std::vector<std::vector<uint32_t>> rows(outputs);
+                for(auto& row : rows) {
+                    for(uint32_t x = 0; x < inputs; x++) {
+                        if(rng() % 100 < density)
+                            row.push_back(x);
+                    }
+                    if(!row.empty() && rng() % 4 == 0) {
+                        row.push_back(row[0]);
+                        row.push_back(row[0]);
+                    }
+                }
+                for(size_t group : {0, 16}) {
+                    XORNetwork net = XORNetwork::paar(inputs, rows, group);
+                    if(!check(net, rows, rng)) {
+                        Log::e("GC", "wrong program for %zux%zu, density %u%%, groups of %zu", outputs, inputs,
+                               density, group);
+                        ret = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    // XOR counts of the linear layers of the LowMC instances
+    for(const lowmc_t* params : {SIMDLowMCCircuitPhases::params_10_32, SIMDLowMCCircuitPhases::params_10_64,
+                                 SIMDLowMCCircuitPhases::params_10_128, SIMDLowMCCircuitPhases::params_1_32,
+                                 SIMDLowMCCircuitPhases::params_1_64}) {
+        std::shared_ptr<const LowMCLinearLayers> layers = LowMCLinearLayers::get(params);
+        if(layers->numXORs() > layers->numNaiveXORs())
+            ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,170 @@
+#include <dirent.h>
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/utils/Log.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NUM_BASE_OTS 128
+#define PORT 1237
+
+// session 0 runs the base OTs, 1 resumes them, the entry of the client is
+// tampered with before 2 and the one of the server before 4, both have to run
+// the base OTs again. The server does not commit 6, so 7 cannot resume, and
+// has no cache in 8, which leaves the entries to 9.
+const bool expectResumed[] = {false, true,  false, true,  false,
+                              true,  true,  false, false, true};
+const size_t numSessions = sizeof(expectResumed) / sizeof(expectResumed[0]);
+
+std::vector<std::string> entries(const std::string &dir,
+                                 const std::string &prefix) {
+  std::vector<std::string> names;
+  DIR *d = opendir(dir.c_str());
+  struct dirent *ent;
+  while ((ent = readdir(d)) != nullptr) {
+    std::string name(ent->d_name);
+    // the entry of a session not committed yet ends in .tmp
+    if (name.compare(0, prefix.size(), prefix) == 0 &&
+        name.find(".tmp") == std::string::npos)
+      names.push_back(name);
+  }
+  closedir(d);
+  return names;
+}
+
+// flips a bit in the middle of the entries in dir starting with prefix
+void tamper(const std::string &dir, const std::string &prefix) {
+  for (const std::string &name : entries(dir, prefix)) {
+    std::fstream f(dir + "/" + name,
+                   std::ios::in | std::ios::out | std::ios::binary);
+    f.seekg(200);
+    char c = f.get();
+    f.seekp(200);
+    f.put(c ^ 1);
+  }
+}
+
+void removeAll(const std::string &dir) {
+  for (const std::string &name : entries(dir, "srv-")) {
+    unlink((dir + "/" + name).c_str());
+  }
+  for (const std::string &name : entries(dir, "cli-")) {
+    unlink((dir + "/" + name).c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+int main(int argc, char **argv) {
+  char tmpl[] = "/tmp/base_ot_cache_XXXXXX";
+  const std::string dir(mkdtemp(tmpl));
+  const droidCrypto::block key = droidCrypto::dupUint64(0x5eed);
+
+  bool serverOk = true;
+  std::thread server([&dir, &key, &serverOk] {
+    droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 1);
+    droidCrypto::BaseOtCache cache(dir, key);
+    std::set<std::string> tickets;
+    for (size_t s = 0; s < numSessions; s++) {
+      if (s == 4) tamper(dir, "srv-");
+      droidCrypto::BitVector choices;
+      std::array<droidCrypto::block, NUM_BASE_OTS> baseOT;
+      std::vector<std::string> before = entries(dir, "srv-");
+      droidCrypto::BaseOtCache::Pending entry =
+          droidCrypto::BaseOtCache::receive(s == 8 ? nullptr : &cache, choices,
+                                            baseOT, chan, 2);
+      if (s != 6) entry.commit();
+
+      // a ticket is used once: a resumed entry is replaced by one with a new
+      // ticket, a full run adds one. The entries of clients that lost theirs
+      // stay until they are pruned.
+      std::vector<std::string> after = entries(dir, "srv-");
+      size_t added = 0;
+      for (const std::string &name : after) {
+        if (tickets.insert(name).second) added++;
+      }
+      const size_t expectAdded = s == 6 || s == 8 ? 0 : 1;
+      // the tampered entry is dropped
+      const size_t expectSize =
+          before.size() + expectAdded -
+          ((expectResumed[s] && s != 8) || s == 4 ? 1 : 0);
+      if (added != expectAdded || after.size() != expectSize) {
+        droidCrypto::Log::e("BaseOT", "session %zu: %zu of %zu entries new", s,
+                            added, after.size());
+        serverOk = false;
+      }
+      // the client checks the OTs
+      uint8_t flag = entry.resumed();
+      uint8_t threads = entry.threads();
+      chan.send(&flag, 1);
+      chan.send(&threads, 1);
+      chan.send(choices.data(), choices.sizeBytes());
+      chan.send((uint8_t *)baseOT.data(), sizeof(baseOT));
+    }
+    // nothing is old enough yet
+    cache.prune();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 0);
+  droidCrypto::BaseOtCache cache(dir, key);
+
+  bool ok = true;
+  std::array<std::array<droidCrypto::block, 2>, NUM_BASE_OTS> last;
+  for (size_t s = 0; s < numSessions; s++) {
+    if (s == 2) tamper(dir, "cli-");
+    std::array<std::array<droidCrypto::block, 2>, NUM_BASE_OTS> baseOT;
+    auto time1 = std::chrono::high_resolution_clock::now();
+    droidCrypto::BaseOtCache::Pending entry =
+        droidCrypto::BaseOtCache::send(&cache, baseOT, chan, "127.0.0.1",
+                                       s % 3 + 1);
+    auto time2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> time = time2 - time1;
+    bool resumed = entry.resumed();
+
+    uint8_t flag, threads;
+    droidCrypto::BitVector choices(NUM_BASE_OTS);
+    std::array<droidCrypto::block, NUM_BASE_OTS> recvOT;
+    chan.recv(&flag, 1);
+    chan.recv(&threads, 1);
+    chan.recv(choices.data(), choices.sizeBytes());
+    chan.recv((uint8_t *)recvOT.data(), sizeof(recvOT));
+    entry.commit();
+
+    size_t wrong = 0, stale = 0;
+    for (size_t i = 0; i < NUM_BASE_OTS; i++) {
+      if (droidCrypto::neq(baseOT[i][uint8_t(choices[i])], recvOT[i])) wrong++;
+      // every session derives OTs of its own
+      if (s > 0 && (droidCrypto::eq(baseOT[i][0], last[i][0]) ||
+                    droidCrypto::eq(baseOT[i][1], last[i][1])))
+        stale++;
+    }
+    last = baseOT;
+    // the server has 2 threads for the extension
+    const size_t expectThreads = std::min<size_t>(s % 3 + 1, 2);
+    if (wrong || stale || resumed != (flag != 0) ||
+        resumed != expectResumed[s] || entry.threads() != expectThreads ||
+        threads != expectThreads) {
+      droidCrypto::Log::e("BaseOT",
+                          "session %zu: resumed %d/%d, %zu/%d threads, %zu "
+                          "wrong, %zu stale",
+                          s, resumed, flag, entry.threads(), threads, wrong,
+                          stale);
+      ok = false;
+    } else {
+      droidCrypto::Log::v("BaseOT", "session %zu: %s in %fsec, all OTs correct",
+                          s, resumed ? "resumed" : "full", time.count());
+    }
+  }
+  chan.flush();
+
+  server.join();
+  removeAll(dir);
+  return ok && serverOk ? 0 : 1;
+}
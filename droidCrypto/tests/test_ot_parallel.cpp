@@ -0,0 +1,118 @@
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/ot/BaseOtCache.h>
+#include <droidCrypto/ot/TwoChooseOne/KosDotExtReceiver.h>
+#include <droidCrypto/ot/TwoChooseOne/KosDotExtSender.h>
+#include <droidCrypto/ot/TwoChooseOne/KosOtExtReceiver.h>
+#include <droidCrypto/ot/TwoChooseOne/KosOtExtSender.h>
+#include <droidCrypto/ot/TwoChooseOne/ParallelOtExt.h>
+#include <droidCrypto/ot/TwoChooseOne/SoftSpokenOtExt.h>
+#include <droidCrypto/utils/Log.h>
+#include <chrono>
+#include <thread>
+
+#define NUM_OTE (4 * 1024 * 1024 + 77)
+#define PORT 1234
+
+// sends the extended OTs in the clear, for the receiver to check
+template <typename Sender>
+void extend(Sender &sender, droidCrypto::ChannelWrapper &chan, size_t threads) {
+  droidCrypto::PRNG p = droidCrypto::PRNG::getTestPRNG();
+  std::vector<std::array<droidCrypto::block, 2>> mesBuf(NUM_OTE);
+  droidCrypto::span<std::array<droidCrypto::block, 2>> mes(mesBuf.data(),
+                                                           mesBuf.size());
+  auto time1 = std::chrono::high_resolution_clock::now();
+  droidCrypto::otExtSendParallel(sender, mes, p, chan, threads);
+  auto time2 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> OTes = time2 - time1;
+  droidCrypto::Log::v("OTe", "SENDER: %zu threads: %fsec", threads,
+                      OTes.count());
+  chan.send((uint8_t *)mesBuf.data(), mesBuf.size() * sizeof(mesBuf[0]));
+}
+
+template <typename Receiver>
+bool check(Receiver &recv, droidCrypto::ChannelWrapper &chan, size_t threads,
+           bool correlated) {
+  droidCrypto::PRNG p = droidCrypto::PRNG::getTestPRNG();
+  droidCrypto::BitVector choizes(NUM_OTE);
+  choizes.randomize(p);
+  std::vector<droidCrypto::block> mesBuf(NUM_OTE);
+  droidCrypto::span<droidCrypto::block> mes(mesBuf.data(), mesBuf.size());
+  auto time1 = std::chrono::high_resolution_clock::now();
+  droidCrypto::otExtReceiveParallel(recv, choizes, mes, p, chan, threads);
+  auto time2 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> OTes = time2 - time1;
+  droidCrypto::Log::v("OTe", "RECVER: %zu threads: %fsec", threads,
+                      OTes.count());
+
+  std::vector<std::array<droidCrypto::block, 2>> buf(NUM_OTE);
+  chan.recv((uint8_t *)buf.data(), buf.size() * sizeof(buf[0]));
+  size_t wrong = 0;
+  for (size_t i = 0; i < NUM_OTE; i++) {
+    if (droidCrypto::neq(buf[i][uint8_t(choizes[i])], mesBuf[i])) wrong++;
+    if (correlated && droidCrypto::neq(buf[i][0] ^ buf[i][1],
+                                       droidCrypto::AllOneBlock))
+      wrong++;
+  }
+  if (wrong) {
+    droidCrypto::Log::e("OTe", "%zu threads: %zu wrong OTs!", threads, wrong);
+    return false;
+  }
+  droidCrypto::Log::v("OTe", "%zu threads: all OTs correct", threads);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  std::thread server([] {
+    droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 1);
+    droidCrypto::BitVector choizes;
+    std::array<droidCrypto::block, 128> baseOT;
+    // the client only has 2 threads, the base OTs tell
+    const size_t threads =
+        droidCrypto::BaseOtCache::receive(nullptr, choizes, baseOT, chan, 4)
+            .threads();
+    droidCrypto::KosOtExtSender sender;
+    sender.setBaseOts(baseOT, choizes);
+    // the same base OTs, this only checks the splits
+    droidCrypto::KosDotExtSender dotSender;
+    dotSender.setBaseOts(baseOT, choizes);
+    dotSender.setDelta(droidCrypto::AllOneBlock);
+
+    extend(sender, chan, 1);
+    extend(sender, chan, 4);
+    extend(sender, chan, threads);
+    extend(dotSender, chan, 4);
+    // splits before and after the GGM trees were sent
+    droidCrypto::SoftSpokenOtExtSender ssSender(4);
+    ssSender.setBaseOts(baseOT, choizes);
+    extend(ssSender, chan, 4);
+    extend(ssSender, chan, 1);
+    extend(ssSender, chan, 4);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 0);
+  std::array<std::array<droidCrypto::block, 2>, 128> baseOT;
+  const size_t threads =
+      droidCrypto::BaseOtCache::send(nullptr, baseOT, chan, "", 2).threads();
+  droidCrypto::KosOtExtReceiver recv;
+  recv.setBaseOts(baseOT);
+  droidCrypto::KosDotExtReceiver dotRecv;
+  dotRecv.setBaseOts(baseOT);
+
+  bool ok = check(recv, chan, 1, false);
+  ok &= check(recv, chan, 4, false);
+  if (threads != 2) {
+    droidCrypto::Log::e("OTe", "agreed on %zu threads instead of 2", threads);
+    ok = false;
+  }
+  ok &= check(recv, chan, threads, false);
+  ok &= check(dotRecv, chan, 4, true);
+  droidCrypto::SoftSpokenOtExtReceiver ssRecv(4);
+  ssRecv.setBaseOts(baseOT);
+  ok &= check(ssRecv, chan, 4, false);
+  ok &= check(ssRecv, chan, 1, false);
+  ok &= check(ssRecv, chan, 4, false);
+
+  server.join();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/ot/TwoChooseOne/OTExtInterface.h>
+#include <droidCrypto/ot/VerifiedSimplestOT.h>
+#include <droidCrypto/utils/Log.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+// communication vs. computation of SoftSpoken for k = 1 (IKNP) .. 8, with
+// KOS (k = 0) for comparison
+#define NUM_OTE (1024 * 1024)
+#define PORT 1235
+#define MAX_K 8
+
+int main(int argc, char **argv) {
+  size_t numOTs = argc > 1 ? 1ULL << std::stoi(argv[1]) : NUM_OTE;
+
+  std::thread server([numOTs] {
+    droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 1);
+    droidCrypto::PRNG p = droidCrypto::PRNG::getTestPRNG();
+    std::vector<std::array<droidCrypto::block, 2>> mesBuf(numOTs);
+    droidCrypto::span<std::array<droidCrypto::block, 2>> mes(mesBuf.data(),
+                                                             mesBuf.size());
+    for (size_t k = 0; k <= MAX_K; k++) {
+      droidCrypto::VerifiedSimplestOT baseOt;
+      droidCrypto::BitVector choizes(128);
+      choizes.randomize(p);
+      std::array<droidCrypto::block, 128> baseOT;
+      baseOt.receive(choizes, baseOT, p, chan);
+      std::unique_ptr<droidCrypto::OtExtSender> sender =
+          droidCrypto::newOtExtSender(k);
+      sender->setBaseOts(baseOT, choizes);
+
+      auto time1 = std::chrono::high_resolution_clock::now();
+      sender->send(mes, p, chan);
+      auto time2 = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> OTes = time2 - time1;
+      droidCrypto::Log::v("OTe", "SENDER k=%zu: %fsec", k, OTes.count());
+      // the receiver checks a sample
+      for (size_t i = 0; i < numOTs; i += 997) {
+        chan.send(mesBuf[i][0]);
+        chan.send(mesBuf[i][1]);
+      }
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 0);
+  droidCrypto::PRNG p = droidCrypto::PRNG::getTestPRNG();
+  std::vector<droidCrypto::block> mesBuf(numOTs);
+  droidCrypto::span<droidCrypto::block> mes(mesBuf.data(), mesBuf.size());
+  droidCrypto::BitVector choizes(numOTs);
+  choizes.randomize(p);
+  bool ok = true;
+  for (size_t k = 0; k <= MAX_K; k++) {
+    droidCrypto::VerifiedSimplestOT baseOt;
+    std::array<std::array<droidCrypto::block, 2>, 128> baseOT;
+    baseOt.send(baseOT, p, chan);
+    std::unique_ptr<droidCrypto::OtExtReceiver> recv =
+        droidCrypto::newOtExtReceiver(k);
+    recv->setBaseOts(baseOT);
+
+    chan.clearStats();
+    auto time1 = std::chrono::high_resolution_clock::now();
+    recv->receive(choizes, mes, p, chan);
+    auto time2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> OTes = time2 - time1;
+    double bits = chan.getBytesSent() * 8.0 / numOTs;
+    droidCrypto::Log::v("OTe", "RECVER k=%zu: %fsec, %.2f bits/OT sent", k,
+                        OTes.count(), bits);
+
+    size_t wrong = 0;
+    for (size_t i = 0; i < numOTs; i += 997) {
+      std::array<droidCrypto::block, 2> m;
+      chan.recv(m[0]);
+      chan.recv(m[1]);
+      if (droidCrypto::neq(m[uint8_t(choizes[i])], mesBuf[i])) wrong++;
+      if (droidCrypto::eq(m[0], m[1])) wrong++;
+    }
+    if (wrong) {
+      droidCrypto::Log::e("OTe", "k=%zu: %zu wrong OTs!", k, wrong);
+      ok = false;
+    }
+  }
+
+  server.join();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <droidCrypto/BitVector.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/ot/TwoChooseOne/KosDotExtReceiver.h>
+#include <droidCrypto/ot/TwoChooseOne/KosDotExtSender.h>
+#include <droidCrypto/ot/TwoChooseOne/StreamingOtExt.h>
+#include <droidCrypto/ot/VerifiedSimplestOT.h>
+#include <droidCrypto/utils/Log.h>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#define NUM_OTE (4 * 1024 * 1024 + 77)
+#define PORT 1236
+
+// the sender sends every window in the clear from its consumer, the
+// receiver checks it against its own window as it goes
+int main(int argc, char **argv) {
+  // the last window takes all OTs at once
+  const size_t windows[] = {droidCrypto::gOtExtStreamWindow, 1000 * 128,
+                            (NUM_OTE + 127) / 128 * 128};
+  std::thread server([&windows] {
+    droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 1);
+    droidCrypto::VerifiedSimplestOT baseOt;
+    droidCrypto::PRNG p = droidCrypto::PRNG::getTestPRNG();
+
+    droidCrypto::BitVector choizes(128);
+    choizes.randomize(p);
+    std::array<droidCrypto::block, 128> baseOT;
+    baseOt.receive(choizes, baseOT, p, chan);
+    std::unique_ptr<droidCrypto::OtExtSender> sender =
+        droidCrypto::newOtExtSender();
+    sender->setBaseOts(baseOT, choizes);
+
+    // the same base OTs, KosDot has to cope with a reused window buffer
+    droidCrypto::KosDotExtSender dotSender;
+    dotSender.setBaseOts(baseOT, choizes);
+    dotSender.setDelta(droidCrypto::AllOneBlock);
+
+    for (size_t w = 0; w <= 3; w++) {
+      const size_t window = windows[w % 3];
+      auto time1 = std::chrono::high_resolution_clock::now();
+      droidCrypto::otExtSendStreaming(
+          w < 3 ? (droidCrypto::OtExtSender &)*sender : dotSender, NUM_OTE, p,
+          chan,
+          [&chan](size_t begin,
+                  droidCrypto::span<std::array<droidCrypto::block, 2>> mes) {
+            chan.send((uint8_t *)mes.data(), mes.size() * sizeof(mes[0]));
+          },
+          window, 2);
+      auto time2 = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> OTes = time2 - time1;
+      droidCrypto::Log::v("OTe", "SENDER: window %zu: %fsec", window,
+                          OTes.count());
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  droidCrypto::CSocketChannel chan("127.0.0.1", PORT, 0);
+  droidCrypto::VerifiedSimplestOT baseOt;
+  droidCrypto::PRNG p = droidCrypto::PRNG::getTestPRNG();
+
+  std::array<std::array<droidCrypto::block, 2>, 128> baseOT;
+  baseOt.send(baseOT, p, chan);
+  std::unique_ptr<droidCrypto::OtExtReceiver> recv =
+      droidCrypto::newOtExtReceiver();
+  recv->setBaseOts(baseOT);
+  droidCrypto::KosDotExtReceiver dotRecv;
+  dotRecv.setBaseOts(baseOT);
+
+  droidCrypto::BitVector choizes(NUM_OTE);
+  choizes.randomize(p);
+  bool ok = true;
+  // rejected before anything is sent
+  try {
+    droidCrypto::otExtReceiveStreaming(
+        *recv, choizes, p, chan,
+        [](size_t, droidCrypto::span<droidCrypto::block>) {}, 1000);
+    droidCrypto::Log::e("OTe", "window 1000 accepted");
+    ok = false;
+  } catch (const std::runtime_error &) {
+  }
+  for (size_t w = 0; w <= 3; w++) {
+    const size_t window = windows[w % 3];
+    const bool correlated = w == 3;
+    size_t wrong = 0, seen = 0;
+    std::vector<std::array<droidCrypto::block, 2>> buf;
+    droidCrypto::otExtReceiveStreaming(
+        correlated ? (droidCrypto::OtExtReceiver &)dotRecv : *recv, choizes,
+        p, chan,
+        [&](size_t begin, droidCrypto::span<droidCrypto::block> mes) {
+          if (begin != seen) wrong++;
+          buf.resize(mes.size());
+          chan.recv((uint8_t *)buf.data(), buf.size() * sizeof(buf[0]));
+          for (size_t i = 0; i < buf.size(); i++) {
+            if (droidCrypto::neq(buf[i][uint8_t(choizes[begin + i])], mes[i]))
+              wrong++;
+            if (correlated && droidCrypto::neq(buf[i][0] ^ buf[i][1],
+                                               droidCrypto::AllOneBlock))
+              wrong++;
+          }
+          seen += mes.size();
+        },
+        window, 2);
+    if (wrong || seen != NUM_OTE) {
+      droidCrypto::Log::e("OTe", "window %zu: %zu wrong OTs!", window, wrong);
+      ok = false;
+    } else {
+      droidCrypto::Log::v("OTe", "window %zu: all OTs correct", window);
+    }
+  }
+
+  server.join();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <cstring>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/gc/circuits/LowMCCircuit.h>
+#include <droidCrypto/psi/OPRFBristolPSIServer.h>
+#include <droidCrypto/psi/OPRFBristolPSIClient.h>
+#include <droidCrypto/SecureRandom.h>
+#include "droidCrypto/BitVector.h"
+#include "droidCrypto/utils/Log.h"
+#include "droidCrypto/utils/Utils.h"
+
+int main(int argc, char** argv) {
+
+    if(argc != 3 && argc != 4) {
+        std::cout << "usage: " << argv[0] << " {role=0,1} {log2(num_inputs)} [circuit.txt]" << std::endl;
+        return -1;
+    }
+    int exp = std::stoi(std::string(argv[2]));
+    if(0 > exp || exp > 32) {
+        std::cout << "log2(num_inputs) should be between 0 and 32" << std::endl;
+        return -1;
+    }
+    size_t num_inputs = 1ULL << exp;
+
+    // both sides need the same circuit, the built-in LowMC by default
+    std::shared_ptr<const droidCrypto::BristolCircuit> circuit;
+    if(argc == 4) {
+        circuit = std::make_shared<const droidCrypto::BristolCircuit>(droidCrypto::BristolCircuit::load(argv[3]));
+    } else {
+        droidCrypto::BufferChannel unused;
+        droidCrypto::SIMDLowMCCircuitPhases lowmc(unused);
+        lowmc.compile();
+        circuit = std::make_shared<const droidCrypto::BristolCircuit>(
+                droidCrypto::BristolCircuit::fromGateList(*lowmc.gateList(), "lowmc_128_128_208"));
+    }
+
+    if(strcmp("0", argv[1]) == 0) {
+        //server
+        droidCrypto::CSocketChannel chan(nullptr, 8000, true);
+
+        droidCrypto::OPRFBristolPSIServer server(chan, circuit, 1);
+        std::vector<droidCrypto::block> elements;
+        elements.push_back(droidCrypto::toBlock((const uint8_t*)"ffffffff88888888"));
+        droidCrypto::SecureRandom rnd;
+        for(size_t i = 1; i < num_inputs; i++) {
+            elements.push_back(rnd.randBlock());
+        }
+        server.doPSI(elements);
+    }
+    else if(strcmp("1", argv[1]) == 0) {
+        //client
+        droidCrypto::CSocketChannel chan("127.0.0.1", 8000, false);
+
+        droidCrypto::OPRFBristolPSIClient client(chan, circuit);
+        std::vector<droidCrypto::block> elements;
+        elements.push_back(droidCrypto::toBlock((const uint8_t*)"ffffffff88888888"));
+        droidCrypto::SecureRandom rnd;
+        for(size_t i = 1; i < num_inputs; i++) {
+            elements.push_back(rnd.randBlock());
+        }
+
+        client.doPSI(elements);
+    }
+    else {
+        std::cout << "usage: " << argv[0] << " {0,1}" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <droidCrypto/ChannelWrapper.h>
+#include <droidCrypto/psi/OPRFLowMCPSIServer.h>
+#include <droidCrypto/psi/OPRFLowMCPSIClient.h>
+#include <droidCrypto/psi/PSIServerDaemon.h>
+#include <droidCrypto/psi/PSIServerSnapshot.h>
+#include <droidCrypto/psi/PSISetupSync.h>
+#include <droidCrypto/SecureRandom.h>
+#include "droidCrypto/utils/Log.h"
+
+int main(int argc, char** argv) {
+
+    if(argc != 4 && argc != 5) {
+        std::cout << "usage: " << argv[0] << " {role=0,1} {log2(num_inputs)} {num_clients} [server snapshot/client filter cache]" << std::endl;
+        return -1;
+    }
+    int exp = std::stoi(std::string(argv[2]));
+    if(0 > exp || exp > 32) {
+        std::cout << "log2(num_inputs) should be between 0 and 32" << std::endl;
+        return -1;
+    }
+    size_t num_inputs = 1ULL << exp;
+    size_t num_clients = std::stoul(std::string(argv[3]));
+    if(strcmp("0", argv[1]) == 0) {
+        //server, setup is done once for all clients, or loaded from the snapshot of a previous run
+        std::shared_ptr<const droidCrypto::PSIServerSetup> setup;
+        std::string snapshot = argc == 5 ? argv[4] : "";
+        if(!snapshot.empty() && access(snapshot.c_str(), R_OK) == 0) {
+            setup = droidCrypto::loadSnapshot(snapshot);
+        }
+        else {
+            std::vector<droidCrypto::block> elements;
+            elements.push_back(droidCrypto::toBlock((const uint8_t*)"ffffffff88888888"));
+            droidCrypto::SecureRandom rnd;
+            for(size_t i = 1; i < num_inputs; i++) {
+                elements.push_back(rnd.randBlock());
+            }
+            setup = droidCrypto::OPRFLowMCPSIServer::Precompute(elements, std::thread::hardware_concurrency());
+            if(!snapshot.empty()) {
+                droidCrypto::saveSnapshot(snapshot, *setup);
+            }
+        }
+
+        droidCrypto::PSIServerDaemon daemon(8000, [](droidCrypto::ChannelWrapper& chan) {
+            return std::unique_ptr<droidCrypto::PhasedPSIServer>(new droidCrypto::OPRFLowMCPSIServer(chan));
+        }, setup, 4);
+        daemon.Run(num_clients);
+
+        //second round: the clients only receive the slots changed by the update
+        std::vector<droidCrypto::block> added, removed;
+        added.push_back(droidCrypto::toBlock((const uint8_t*)"eeeeeeee77777777"));
+        daemon.UpdateSetup(droidCrypto::OPRFLowMCPSIServer::Update(*daemon.GetSetup(), added, removed));
+        if(!snapshot.empty()) {
+            droidCrypto::saveSnapshot(snapshot, *daemon.GetSetup());
+        }
+        daemon.Run(num_clients);
+        return daemon.getNumFailed() == 0 ? 0 : 1;
+    }
+    else if(strcmp("1", argv[1]) == 0) {
+        //clients, all connecting at the same time, twice with the filter of the first round kept
+        //and optionally cached on disk for the next run
+        std::vector<std::shared_ptr<droidCrypto::PSIClientFilter>> filters;
+        for(size_t c = 0; c < num_clients; c++) {
+            if(argc == 5) {
+                filters.push_back(droidCrypto::loadClientFilter(std::string(argv[4]) + "." + std::to_string(c)));
+            }
+            else {
+                filters.push_back(std::make_shared<droidCrypto::PSIClientFilter>());
+            }
+        }
+        for(int round = 0; round < 2; round++) {
+            std::vector<std::thread> clients;
+            std::vector<size_t> found(num_clients, 0);
+            for(size_t c = 0; c < num_clients; c++) {
+                clients.emplace_back([num_inputs, &found, &filters, c] {
+                    droidCrypto::CSocketChannel chan("127.0.0.1", 8000, false);
+
+                    droidCrypto::OPRFLowMCPSIClient client(chan, 1, filters[c]);
+                    std::vector<droidCrypto::block> elements;
+                    elements.push_back(droidCrypto::toBlock((const uint8_t*)"ffffffff88888888"));
+                    elements.push_back(droidCrypto::toBlock((const uint8_t*)"eeeeeeee77777777"));
+                    droidCrypto::SecureRandom rnd;
+                    for(size_t i = 2; i < num_inputs; i++) {
+                        elements.push_back(rnd.randBlock());
+                    }
+                    found[c] = client.doPSI(elements).size();
+                });
+            }
+            for(auto& t : clients) {
+                t.join();
+            }
+            for(size_t c = 0; c < num_clients; c++) {
+                droidCrypto::Log::v("PSI", "round %d, client %zu: %zu in intersection (db version %llu)", round, c,
+                                    found[c], (unsigned long long)filters[c]->db_version);
+            }
+        }
+    }
+    else {
+        std::cout << "usage: " << argv[0] << " {0,1}" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <droidCrypto/utils/MappedFile.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace droidCrypto {
+
+MappedFile::MappedFile(const std::string &path) : data_(nullptr), size_(0) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("could not open " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("could not stat " + path);
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void *map = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("could not mmap " + path);
+    }
+    data_ = (uint8_t *)map;
+  }
+  // the mapping stays valid after closing the descriptor
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) munmap(data_, size_);
+}
+
+AtomicFileWriter::AtomicFileWriter(const std::string &path)
+    : path_(path), tmp_path_(path + ".tmp"), fd_(-1), pos_(0) {
+  fd_ = open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             0600);
+  if (fd_ < 0) {
+    throw std::runtime_error("could not create " + tmp_path_);
+  }
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+  if (fd_ >= 0) {
+    close(fd_);
+    unlink(tmp_path_.c_str());
+  }
+}
+
+void AtomicFileWriter::write(const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  while (len > 0) {
+    ssize_t written = ::write(fd_, p, len);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error("could not write " + tmp_path_);
+    }
+    p += written;
+    len -= written;
+    pos_ += written;
+  }
+}
+
+void AtomicFileWriter::padTo(uint64_t offset) {
+  if (offset < pos_) {
+    throw std::runtime_error("could not write " + tmp_path_);
+  }
+  std::vector<uint8_t> zeros(offset - pos_, 0);
+  write(zeros.data(), zeros.size());
+}
+
+void AtomicFileWriter::commit() {
+  if (fsync(fd_) != 0) {
+    throw std::runtime_error("could not write " + tmp_path_);
+  }
+  close(fd_);
+  fd_ = -1;
+  if (rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+    unlink(tmp_path_.c_str());
+    throw std::runtime_error("could not rename " + tmp_path_);
+  }
+}
+}  // namespace droidCrypto
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace droidCrypto {
+
+// Private, copy-on-write memory mapping of a whole file. Pages are only read
+// from disk when they are touched, writes through data() never reach the
+// file.
+class MappedFile {
+ public:
+  // throws std::runtime_error if the file cannot be opened or mapped
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  uint8_t *data_;
+  size_t size_;
+};
+
+// Writes a file next to its destination and renames it into place on
+// commit(), so readers never see a half-written file. Created with mode
+// 0600, the files written this way hold key material.
+class AtomicFileWriter {
+ public:
+  // throws std::runtime_error if the temporary file cannot be created
+  explicit AtomicFileWriter(const std::string &path);
+  // removes the temporary file if commit() was not reached
+  ~AtomicFileWriter();
+
+  AtomicFileWriter(const AtomicFileWriter &) = delete;
+  AtomicFileWriter &operator=(const AtomicFileWriter &) = delete;
+
+  void write(const void *data, size_t len);
+  // zero-fills up to offset, which must not be behind the current position
+  void padTo(uint64_t offset);
+  uint64_t position() const { return pos_; }
+  // syncs the file to disk and moves it to path
+  void commit();
+
+ private:
+  std::string path_;
+  std::string tmp_path_;
+  int fd_;
+  uint64_t pos_;
+};
+}  // namespace droidCrypto